@@ -0,0 +1,206 @@
+import 'dart:io';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:shared_preferences/shared_preferences.dart';
+
+import 'package:health_app/controllers/health_controller.dart';
+import 'package:health_app/models/latency_histogram.dart';
+import 'package:health_app/services/alert_service.dart';
+import 'package:health_app/services/history_file.dart';
+import 'package:health_app/services/history_tile_file.dart';
+import 'package:health_app/services/live_feed.dart';
+import 'package:health_app/services/session_file.dart';
+
+import 'support/bench_result.dart';
+import 'support/packet_stream.dart';
+import 'support/vm_probe.dart';
+
+// 수신 경로 마이크로벤치마크
+//
+//   flutter test --enable-vmservice benchmark/ingest_benchmark.dart
+//
+// 합성 스트림과 녹화 스트림(benchmark/recordings/*.bin)을 HealthController 의 수신 경로에 넣음.
+//  - receive   : 패킷 단위로 _onDataReceived (디코더 -> 파싱 -> 경고/저장 전체). 재생 속도를 올려 가며
+//  - parse     : 측정 줄마다 _parseAndProcess
+//  - thresholds: 측정값마다 _checkThresholds
+//  - saveLog   : 쿨다운 없이(긴급 저장) _saveLog. 저장마다 기록 파일의 마지막 블록만 다시 씀
+// 처리량(패킷/s), 호출당 지연 분위수, 밀림(예정 도착 시각 대비), 패킷당 할당 바이트, GC 멈춤을 출력.
+// 할당/GC 는 VM 서비스가 켜져 있어야 보임 (--enable-vmservice). 없으면 '-'.
+//
+// 결과는 benchmark/baseline.json 과 비교해 나빠졌으면 실패. 기준 파일이 없어도 실패
+// (지금 잰 값이 말없이 기준이 되지 않게). BENCH_UPDATE_BASELINE=1 일 때만 이번 결과를 기준으로 저장해
+// 커밋 (같은 기기/모드에서 잰 값끼리만 비교).
+// flutter test 는 JIT(debug) 로 돌므로 절대값보다 최적화 전후 비교에 쓸 것.
+//
+// 녹화 스트림 만들기 (기기 없이 시뮬레이터 UART 출력을 그대로 저장):
+//   firmware_sim --seconds 60 --link 1:60 --uart benchmark/recordings/NAME.bin
+void main() {
+  // 재생 속도 (스트림 시간 대비 배속). 0 = 기다리지 않고 최대 속도
+  const speeds = [10.0, 100.0, 1000.0, 0.0];
+  // 최대 속도로 돌 때도 가끔 이벤트 루프에 양보해 미뤄진 저장(비동기)이 실제처럼 끼어들게
+  const yieldEvery = 64;
+  // 긴급 저장은 호출마다 파일을 쓰므로 횟수 제한
+  const saveLimit = 2000;
+
+  final baseTimeUs = DateTime(2026, 1, 1, 12).microsecondsSinceEpoch;
+  final results = <BenchResult>[];
+  final streams = <PacketStream>[];
+  VmProbe? probe;
+  late Directory tmp;
+  int controllers = 0;
+
+  setUpAll(() async {
+    probe = await VmProbe.connect();
+    tmp = await Directory.systemTemp.createTemp('ingest_bench');
+    streams.addAll([
+      PacketStream.synthetic('syn:blocks25', seconds: 120),
+      PacketStream.synthetic('syn:blocks100', seconds: 120, outputRate: 100, linesPerSecond: 4),
+      PacketStream.synthetic('syn:lines25', seconds: 120, blockSize: 0),
+    ]);
+    final dir = Directory('benchmark/recordings');
+    if (await dir.exists()) {
+      final files = await dir.list().where((f) => f.path.endsWith('.bin')).cast<File>().toList();
+      files.sort((a, b) => a.path.compareTo(b.path));
+      for (final f in files) {
+        streams.add(await PacketStream.load(f));
+      }
+    }
+  });
+
+  tearDownAll(() async {
+    await probe?.dispose();
+    await tmp.delete(recursive: true);
+  });
+
+  int nowNs(Stopwatch sw) => (sw.elapsedTicks * (1e9 / sw.frequency)).round();
+
+  HealthController freshController() {
+    SharedPreferences.setMockInitialValues({});
+    return HealthController(
+        alerts: _SilentAlerts(),
+        historyFile: HistoryFile(file: File('${tmp.path}/bench_$controllers.vlog')),
+        tileFile: HistoryTileFile(file: File('${tmp.path}/bench_$controllers.tiles')),
+        sessionFile: SessionFile(file: File('${tmp.path}/bench_${controllers++}.sessions')),
+        liveFeed: LiveFeed.off());
+  }
+
+  Future<BenchResult> run(String key, int count, double speed, double Function(int) dueSeconds,
+      Future<void>? Function(HealthController, int) call) async {
+    final controller = freshController();
+    final timings = Timings();
+    final lag = Timings();
+    await probe?.start();
+    final sw = Stopwatch()..start();
+    for (int i = 0; i < count; i++) {
+      final dueNs = speed > 0 ? (dueSeconds(i) * 1e9 / speed).round() : 0;
+      if (speed > 0) {
+        final waitNs = dueNs - nowNs(sw);
+        if (waitNs > 0) await Future<void>.delayed(Duration(microseconds: waitNs ~/ 1000));
+      } else if (i % yieldEvery == 0) {
+        await Future<void>.delayed(Duration.zero);
+      }
+      final t0 = nowNs(sw);
+      final pending = call(controller, i);
+      if (pending != null) await pending;
+      final t1 = nowNs(sw);
+      timings.add(t1 - t0);
+      if (speed > 0) lag.add(t1 - dueNs);
+    }
+    await Future<void>.delayed(Duration.zero);
+    final wall = sw.elapsedMicroseconds / 1e6;
+    final heap = await probe?.stop();
+    final streamSeconds = count == 0 ? 0.0 : dueSeconds(count - 1);
+    return BenchResult(
+      key: key,
+      packets: count,
+      offeredPerSec: speed > 0 && streamSeconds > 0 ? count * speed / streamSeconds : 0,
+      achievedPerSec: wall > 0 ? count / wall : 0,
+      p50Us: timings.percentileUs(0.5),
+      p99Us: timings.percentileUs(0.99),
+      maxUs: timings.percentileUs(1),
+      lagP99Ms: lag.percentileUs(0.99) / 1000,
+      heap: heap,
+    );
+  }
+
+  test('ingestion benchmark', () async {
+    for (final stream in streams) {
+      final packets = stream.packets;
+      final vitals = stream.vitals.toList();
+      final fields = [for (final p in vitals) p.line!.split(',')];
+      double due(int i) => packets[i].atSeconds;
+      double vitalsDue(int i) => vitals[i].atSeconds;
+
+      // JIT 워밍업 (결과 버림)
+      await run('', packets.length, 0, due, (c, i) {
+        c.ingestBytes(packets[i].bytes);
+        return null;
+      });
+
+      for (final speed in speeds) {
+        final label = speed > 0 ? '${speed.round()}x' : 'max';
+        results.add(await run('${stream.name}/receive@$label', packets.length, speed, due, (c, i) {
+          c.ingestBytes(packets[i].bytes);
+          return null;
+        }));
+      }
+      results.add(await run('${stream.name}/parse', vitals.length, 0, vitalsDue, (c, i) {
+        c.ingestLine(vitals[i].line!);
+        return null;
+      }));
+      results.add(await run('${stream.name}/thresholds', fields.length, 0, vitalsDue, (c, i) {
+        c.checkThresholds(double.parse(fields[i][2]), double.parse(fields[i][3]),
+            baseTimeUs + (vitals[i].atSeconds * 1e6).round());
+        return null;
+      }));
+      final saves = fields.length < saveLimit ? fields.length : saveLimit;
+      results.add(await run('${stream.name}/saveLog', saves, 0, vitalsDue, (c, i) {
+        return c.saveLog(double.parse(fields[i][3]), double.parse(fields[i][2]),
+            baseTimeUs + (vitals[i].atSeconds * 1e6).round(), isEmergency: true);
+      }));
+    }
+
+    print(BenchResult.header());
+    for (final r in results) {
+      print(r);
+    }
+    if (probe == null) print('(할당/GC: --enable-vmservice 로 실행해야 측정됨)');
+
+    final baseline = await Baseline.load(File('benchmark/baseline.json'));
+    if (Platform.environment['BENCH_UPDATE_BASELINE'] == '1') {
+      await baseline.save(results);
+      print('기준 저장: ${baseline.file.path}');
+      return;
+    }
+    if (baseline.isEmpty) {
+      fail('기준 없음: ${baseline.file.path}. '
+          'BENCH_UPDATE_BASELINE=1 로 실행해 기준을 만들고 커밋할 것');
+    }
+    for (final r in results) {
+      if (!baseline.has(r.key)) print('경고 기준에 없는 항목 (비교 안 함): ${r.key}');
+    }
+    final regressions = [
+      for (final r in results)
+        for (final problem in baseline.compare(r)) '${r.key}: $problem'
+    ];
+    for (final line in regressions) {
+      print('회귀 $line');
+    }
+    expect(regressions, isEmpty);
+  }, timeout: Timeout.none);
+}
+
+// 소리/알림 플러그인 없이 경고 경로만 지나가게
+class _SilentAlerts implements AlertService {
+  @override
+  final LatencyHistogram latency = LatencyHistogram();
+
+  @override
+  Future<void> init() async {}
+
+  @override
+  Future<Duration?> trigger(String message, int sampleTimeUs) async => Duration.zero;
+
+  @override
+  void dispose() {}
+}
@@ -0,0 +1,131 @@
+import 'dart:convert';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'vm_probe.dart';
+
+// 호출 하나하나의 소요 시간 (ns). 분위수는 정렬해서 정확히 계산
+class Timings {
+  final List<int> _ns = [];
+
+  int get count => _ns.length;
+
+  void add(int ns) => _ns.add(ns);
+
+  Int64List _sorted() => Int64List.fromList(_ns)..sort();
+
+  // p (0~1) 분위수 (µs)
+  double percentileUs(double p) {
+    if (_ns.isEmpty) return 0;
+    final sorted = _sorted();
+    final i = ((p * sorted.length).ceil() - 1).clamp(0, sorted.length - 1);
+    return sorted[i] / 1000;
+  }
+}
+
+class BenchResult {
+  final String key; // 스트림/단계@속도
+  final int packets;
+  final double offeredPerSec; // 재생 속도로 정해지는 입력률 (최대 속도면 0)
+  final double achievedPerSec; // 패킷 수 / 재생에 걸린 실제 시간
+  final double p50Us, p99Us, maxUs;
+  final double lagP99Ms; // 예정 도착 시각 대비 처리 완료 지연 (밀려 있는지)
+  final HeapDelta? heap;
+
+  BenchResult({
+    required this.key,
+    required this.packets,
+    required this.offeredPerSec,
+    required this.achievedPerSec,
+    required this.p50Us,
+    required this.p99Us,
+    required this.maxUs,
+    required this.lagP99Ms,
+    this.heap,
+  });
+
+  double? get bytesPerPacket => heap == null || packets == 0 ? null : heap!.bytesAllocated / packets;
+
+  Map<String, dynamic> toJson() => {
+    'packets': packets,
+    'achieved_per_s': achievedPerSec.round(),
+    'p50_us': p50Us,
+    'p99_us': p99Us,
+    if (bytesPerPacket != null) 'bytes_per_packet': bytesPerPacket!.round(),
+    if (heap != null) 'gc_pause_us': heap!.gcPauseUs,
+  };
+
+  static String header() =>
+      '${'scenario'.padRight(40)} ${'pkts'.padLeft(7)} ${'offer/s'.padLeft(8)} ${'pkt/s'.padLeft(9)} '
+      '${'p50us'.padLeft(7)} ${'p99us'.padLeft(7)} ${'maxus'.padLeft(8)} ${'lag99ms'.padLeft(8)} '
+      '${'B/pkt'.padLeft(7)} ${'gc n/ms/max'.padLeft(14)}';
+
+  @override
+  String toString() {
+    final h = heap;
+    final gc = h == null
+        ? '-'
+        : '${h.gcCount}/${(h.gcPauseUs / 1000).toStringAsFixed(1)}/${(h.gcMaxPauseUs / 1000).toStringAsFixed(1)}';
+    return '${key.padRight(40)} ${'$packets'.padLeft(7)} '
+        '${(offeredPerSec > 0 ? offeredPerSec.round().toString() : 'max').padLeft(8)} '
+        '${achievedPerSec.round().toString().padLeft(9)} '
+        '${p50Us.toStringAsFixed(1).padLeft(7)} ${p99Us.toStringAsFixed(1).padLeft(7)} '
+        '${maxUs.toStringAsFixed(0).padLeft(8)} ${lagP99Ms.toStringAsFixed(1).padLeft(8)} '
+        '${(bytesPerPacket?.round().toString() ?? '-').padLeft(7)} ${gc.padLeft(14)}';
+  }
+}
+
+// 기준 결과 파일 (benchmark/baseline.json). 같은 기기에서 잰 값끼리 비교해야 의미가 있음
+class Baseline {
+  // 이만큼 나빠지면 회귀로 봄 (측정 잡음 감안)
+  static const double MAX_THROUGHPUT_DROP = 0.20;
+  static const double MAX_P50_RISE = 0.25;
+  static const double P50_SLACK_US = 2;
+  static const double MAX_ALLOC_RISE = 0.10;
+  static const int ALLOC_SLACK_BYTES = 64;
+
+  final File file;
+  final Map<String, dynamic> _entries;
+
+  Baseline._(this.file, this._entries);
+
+  bool get isEmpty => _entries.isEmpty;
+  bool has(String key) => _entries.containsKey(key);
+
+  static Future<Baseline> load(File file) async {
+    if (!await file.exists()) return Baseline._(file, {});
+    final json = jsonDecode(await file.readAsString()) as Map<String, dynamic>;
+    return Baseline._(file, json['results'] as Map<String, dynamic>? ?? {});
+  }
+
+  Future<void> save(List<BenchResult> results) async {
+    final json = {
+      'recorded': DateTime.now().toIso8601String(),
+      'host': '${Platform.operatingSystem} ${Platform.localHostname} ${Platform.numberOfProcessors}cpu',
+      'results': {for (final r in results) r.key: r.toJson()},
+    };
+    await file.writeAsString('${const JsonEncoder.withIndent('  ').convert(json)}\n');
+  }
+
+  // 회귀 내용 (없으면 빈 목록). 기준에 없는 항목은 건너뜀
+  List<String> compare(BenchResult r) {
+    final base = _entries[r.key] as Map<String, dynamic>?;
+    if (base == null) return const [];
+    final problems = <String>[];
+    // 처리량은 최대 속도로 재생한 경우에만 비교 (정해진 속도면 입력률에 묶임)
+    final baseRate = (base['achieved_per_s'] as num).toDouble();
+    if (r.offeredPerSec == 0 && r.achievedPerSec < baseRate * (1 - MAX_THROUGHPUT_DROP)) {
+      problems.add('throughput ${r.achievedPerSec.round()}/s < baseline ${baseRate.round()}/s');
+    }
+    final baseP50 = (base['p50_us'] as num).toDouble();
+    if (r.p50Us > baseP50 * (1 + MAX_P50_RISE) + P50_SLACK_US) {
+      problems.add('p50 ${r.p50Us.toStringAsFixed(1)}us > baseline ${baseP50.toStringAsFixed(1)}us');
+    }
+    final baseAlloc = (base['bytes_per_packet'] as num?)?.toDouble();
+    final alloc = r.bytesPerPacket;
+    if (baseAlloc != null && alloc != null && alloc > baseAlloc * (1 + MAX_ALLOC_RISE) + ALLOC_SLACK_BYTES) {
+      problems.add('alloc ${alloc.round()}B/pkt > baseline ${baseAlloc.round()}B/pkt');
+    }
+    return problems;
+  }
+}
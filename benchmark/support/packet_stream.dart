@@ -0,0 +1,141 @@
+import 'dart:io';
+import 'dart:math' as math;
+import 'dart:typed_data';
+
+import 'package:health_app/services/telemetry_decoder.dart';
+import 'package:health_app/services/waveform_block.dart';
+
+// 벤치마크 입력: 기기 -> 앱 바이트 스트림을 패킷(ASCII 한 줄 또는 프레임 하나) 단위로 자른 것
+class Packet {
+  final double atSeconds; // 스트림 시작 기준 도착 시각
+  final Uint8List bytes;
+  final String? line; // ASCII 줄이면 내용 (줄바꿈 제외)
+
+  Packet(this.atSeconds, this.bytes, this.line);
+
+  bool get isVitals => line != null && line!.isNotEmpty && !line!.startsWith('\$');
+}
+
+class PacketStream {
+  final String name;
+  final double seconds;
+  final List<Packet> packets;
+
+  PacketStream(this.name, this.seconds, this.packets);
+
+  int get bytes => packets.fold(0, (n, p) => n + p.bytes.length);
+
+  Iterable<Packet> get vitals => packets.where((p) => p.isVitals);
+
+  // TelemetryDecoder 와 같은 규칙으로 자름. 도착 시각은 바이트 위치에 비례한다고 봄
+  // (줄 중간에 프레임이 끼면 디코더처럼 프레임을 먼저 내보내고 줄은 이어서 모음)
+  static PacketStream split(String name, Uint8List data, double seconds) {
+    final packets = <Packet>[];
+    final line = BytesBuilder();
+    double lineAt = 0;
+    int i = 0;
+    while (i < data.length) {
+      final b = data[i];
+      if (b == TelemetryDecoder.FRAME_SYNC) {
+        // SYNC, LEN, TYPE+payload(LEN 바이트), CRC
+        if (i + 1 >= data.length) break;
+        final end = i + 3 + data[i + 1];
+        if (end > data.length) break;
+        packets.add(Packet(seconds * i / data.length, Uint8List.sublistView(data, i, end), null));
+        i = end;
+        continue;
+      }
+      if (line.isEmpty) lineAt = seconds * i / data.length;
+      line.addByte(b);
+      i++;
+      if (b == 0x0A) {
+        final bytes = line.takeBytes();
+        packets.add(Packet(lineAt, bytes, String.fromCharCodes(bytes).trim()));
+      }
+    }
+    return PacketStream(name, seconds, packets);
+  }
+
+  // firmware_sim --uart FILE 로 녹화한 원시 바이트.
+  // 길이는 마지막 측정 줄의 샘플 번호로 추정 (기본 출력률 25Hz)
+  static Future<PacketStream> load(File file, {double outputRate = 25}) async {
+    final data = await file.readAsBytes();
+    final rough = split('', data, 1);
+    int lastSample = 0;
+    for (final p in rough.vitals) {
+      final fields = p.line!.split(',');
+      if (fields.length >= 6) lastSample = int.tryParse(fields[5]) ?? lastSample;
+    }
+    final seconds = lastSample > 0 ? lastSample / outputRate : data.length / 100.0;
+    final name = file.uri.pathSegments.last.replaceAll('.bin', '');
+    return split('rec:$name', data, seconds);
+  }
+
+  // 펌웨어 출력을 흉내 낸 합성 스트림.
+  // blockSize > 0: 'W' 파형 블록 + linesPerSecond 개의 측정 줄 (현재 펌웨어)
+  // blockSize == 0: 샘플마다 측정 줄 (블록 이전 펌웨어)
+  static PacketStream synthetic(String name,
+      {double seconds = 60,
+      double outputRate = 25,
+      double linesPerSecond = 1,
+      int blockSize = 10,
+      int seed = 1}) {
+    final rnd = math.Random(seed);
+    final out = BytesBuilder();
+    final times = <double>[];
+    final start = DateTime(2026, 1, 1, 12);
+    final total = (seconds * outputRate).round();
+    final lineEvery = blockSize == 0 ? 1 : math.max(1, (outputRate / linesPerSecond).round());
+    final block = Int32List(math.max(blockSize, 1));
+    int blockN = 0, seq = 0, wave = 0;
+
+    void emit(List<int> bytes, double at) {
+      times.add(at);
+      out.add(bytes);
+    }
+
+    for (int n = 1; n <= total; n++) {
+      final at = n / outputRate;
+      // 72BPM 근처 맥파 + 잡음, 가끔 저산소/빈맥 구간으로 경고 경로도 지나가게
+      final phase = 2 * math.pi * at * 72 / 60;
+      final prev = wave;
+      wave = (800 * math.sin(phase) + 200 * math.sin(2 * phase) + rnd.nextInt(60) - 30).round();
+      final alarm = (at ~/ 20) % 3 == 2;
+      if (blockSize > 0) {
+        block[blockN++] = wave - prev;
+        if (blockN == blockSize) {
+          final payload = WaveformBlock(seq++ & 0xFF, 'D', block).encode();
+          emit(_frame(WaveformBlock.FRAME_TYPE, payload), at);
+          blockN = 0;
+        }
+      }
+      if (n % lineEvery == 0) {
+        final t = start.add(Duration(microseconds: (at * 1e6).round()));
+        final spo2 = alarm ? 87 : 97 + rnd.nextInt(2);
+        final bpm = alarm ? 128 : 70 + rnd.nextInt(5);
+        final stamp = '${t.year}-${_2(t.month)}-${_2(t.day)} ${_2(t.hour)}:${_2(t.minute)}:${_2(t.second)}';
+        emit('$stamp,$wave,$spo2,$bpm,0,$n\r\n'.codeUnits, at);
+      }
+      if (n % (outputRate * 5).round() == 0) {
+        emit('\$P,5000,125,125,0,117000${',0' * 23}\r\n'.codeUnits, at);
+      }
+    }
+    final data = out.toBytes();
+    final packets = PacketStream.split(name, data, seconds).packets;
+    // 바이트 위치 대신 실제 생성 시각으로 교체
+    return PacketStream(name, seconds, [
+      for (int i = 0; i < packets.length; i++) Packet(times[i], packets[i].bytes, packets[i].line)
+    ]);
+  }
+
+  static List<int> _frame(int type, Uint8List payload) {
+    final body = [type, ...payload];
+    int crc = 0;
+    for (final b in body) {
+      crc = TelemetryDecoder.crc8(crc, b);
+    }
+    return [TelemetryDecoder.FRAME_SYNC, body.length, ...body, crc];
+  }
+
+  static String _2(int v) => v.toString().padLeft(2, '0');
+}
@@ -0,0 +1,80 @@
+import 'dart:developer';
+import 'dart:isolate';
+
+import 'package:vm_service/vm_service.dart';
+import 'package:vm_service/vm_service_io.dart';
+
+// 구간별 할당량과 GC 멈춤 (VM 서비스로 측정)
+class HeapDelta {
+  final int bytesAllocated;
+  final int gcCount;
+  final int gcPauseUs;
+  final int gcMaxPauseUs;
+
+  const HeapDelta(this.bytesAllocated, this.gcCount, this.gcPauseUs, this.gcMaxPauseUs);
+}
+
+// 자기 자신의 VM 서비스에 붙어 할당 프로파일과 GC 타임라인을 읽음.
+// VM 서비스가 꺼져 있으면(--enable-vmservice 없이 실행) connect() 가 null
+class VmProbe {
+  final VmService _service;
+  final String _isolateId;
+
+  VmProbe._(this._service, this._isolateId);
+
+  static Future<VmProbe?> connect() async {
+    final info = await Service.getInfo();
+    final uri = info.serverWebSocketUri;
+    final isolateId = Service.getIsolateId(Isolate.current);
+    if (uri == null || isolateId == null) return null;
+    final service = await vmServiceConnectUri(uri.toString());
+    await service.setVMTimelineFlags(['GC']);
+    return VmProbe._(service, isolateId);
+  }
+
+  // 측정 시작: 누적 할당 카운터와 타임라인을 비움 (이전 구간의 쓰레기는 먼저 수거)
+  Future<void> start() async {
+    await _service.getAllocationProfile(_isolateId, reset: true, gc: true);
+    await _service.clearVMTimeline();
+  }
+
+  Future<HeapDelta> stop() async {
+    final profile = await _service.getAllocationProfile(_isolateId);
+    int bytes = 0;
+    for (final stats in profile.members ?? const <ClassHeapStats>[]) {
+      bytes += stats.accumulatedSize ?? 0;
+    }
+
+    // 멈춤 = 세이프포인트에서 도는 수집(Collect*) 이벤트. 동시 마킹/스윕은 제외
+    final timeline = await _service.getVMTimeline();
+    final open = <String, int>{};
+    int count = 0, total = 0, longest = 0;
+    void pause(int us) {
+      count++;
+      total += us;
+      if (us > longest) longest = us;
+    }
+
+    for (final event in timeline.traceEvents ?? const <TimelineEvent>[]) {
+      final e = event.json ?? const {};
+      final name = e['name'] as String? ?? '';
+      if (e['cat'] != 'GC' || !name.startsWith('Collect')) continue;
+      final key = '${e['tid']}/$name';
+      switch (e['ph']) {
+        case 'X':
+          pause((e['dur'] as num? ?? 0).toInt());
+          break;
+        case 'B':
+          open[key] = (e['ts'] as num).toInt();
+          break;
+        case 'E':
+          final begin = open.remove(key);
+          if (begin != null) pause((e['ts'] as num).toInt() - begin);
+          break;
+      }
+    }
+    return HeapDelta(bytes, count, total, longest);
+  }
+
+  Future<void> dispose() => _service.dispose();
+}
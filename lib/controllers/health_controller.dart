@@ -1,5 +1,7 @@
 import 'dart:async';
+import 'dart:collection';
 import 'dart:convert';
+import 'dart:io';
 import 'dart:typed_data';
 import 'package:flutter/material.dart';
 import 'package:get/get.dart';
@@ -7,51 +9,159 @@ import 'package:fl_chart/fl_chart.dart';
 import 'package:intl/intl.dart';
 import 'package:flutter_bluetooth_serial/flutter_bluetooth_serial.dart';
 import 'package:permission_handler/permission_handler.dart';
-import 'package:audioplayers/audioplayers.dart';
-import 'package:flutter_local_notifications/flutter_local_notifications.dart';
 import 'package:shared_preferences/shared_preferences.dart';
+import 'package:path_provider/path_provider.dart';
 import '../models/health_log.dart';
+import '../models/history_store.dart';
+import '../models/firmware_stats.dart';
+import '../models/device_config.dart';
+import '../models/signal_quality.dart';
+import '../models/heart_rate_engine.dart';
+import '../models/latency_histogram.dart';
+import '../models/session_index.dart';
+import '../services/telemetry_decoder.dart';
+import '../services/waveform_block.dart';
+import '../services/history_batch.dart';
+import '../services/rr_batch.dart';
+import '../services/hrv_engine.dart';
+import '../services/autocorr_hr.dart';
+import '../services/clock_sync.dart';
+import '../services/history_export.dart';
+import '../services/history_file.dart';
+import '../services/history_tile_file.dart';
+import '../services/history_tiles.dart';
+import '../services/live_feed.dart';
+import '../services/reconnect_policy.dart';
+import '../services/session_file.dart';
+import '../services/alert_service.dart';
 
 class HealthController extends GetxController {
   static const String TARGET_DEVICE_NAME = "HC-05";
   
-  final double LOW_SPO2_THRESHOLD = 90.0;
-  final double LOW_HEART_RATE_THRESHOLD = 50.0;
-  final double HIGH_HEART_RATE_THRESHOLD = 120.0;
 
   var heartRate = 0.0.obs;
   var spo2 = 0.0.obs;
   var isConnected = false.obs;
   var connectionStatus = "연결 끊김".obs;
   var lastUpdated = '-'.obs;
+  var signalQuality = const SignalQuality(0).obs;
   
   var waveformData = <FlSpot>[].obs;
   double _timeCounter = 0;
-
-  var logHistory = <HealthLog>[].obs;
+  // 블록 수신 시 전체 샘플을 그리므로 ASCII 줄(10개)보다 길게 유지
+  static const int WAVEFORM_WINDOW = 150;
+  final ListQueue<FlSpot> _waveWindow = ListQueue<FlSpot>();
+  int? _lastBlockSeq;
+  DateTime? _lastBlockTime;
+
+  // 앱 쪽 자기상관 심박 추정 (기기 값과 나란히 표시, 선택 시 경고/기록에 사용)
+  var hrEngine = HeartRateEngine.device.obs;
+  var autocorrBpm = 0.0.obs;
+  var autocorrConfidence = 0.0.obs;
+  AutocorrHeartRate? _autocorr;
+  String? _autocorrStream;
+  String? _deviceAddress;
+
+  // 기기가 보내는 박동 간격으로 계산한 HRV (준비 전이면 null)
+  var hrv = Rxn<HrvSummary>();
+  final HrvEngine _hrv = HrvEngine();
+  int? _nextRrSeq;
+  DateTime? _lastRrAt;
+
+  var firmwareStats = Rxn<FirmwareStats>();
+  var deviceConfig = Rxn<DeviceConfig>();
+
+  // 기록은 열 단위 저장소에 두고, 바뀔 때마다 logRevision 을 올려 화면을 갱신
+  final HistoryStore logHistory = HistoryStore();
+  var logRevision = 0.obs;
+  // 기록 목록 필터: 경고 종류 (HistoryStore.ALERT_* 마스크, 0 이면 전체) 와 기간 (null 이면 전체)
+  var historyFilter = 0.obs;
+  var historyPeriod = Rxn<Duration>();
+  // 기록 타임라인의 LOD 타일 (기록과 함께 갱신, 캐시는 health_log.tiles)
+  final HistoryTiles historyTiles = HistoryTiles();
   DateTime? _lastSaveTime;
+  // 측정 세션 ($S/$E) 과 세션별 요약. 요약이 바뀔 때마다 sessionRevision 을 올림
+  final SessionIndex sessions = SessionIndex();
+  var sessionRevision = 0.obs;
+  // 시각 변환은 다음 실시간 줄의 시계 관측 뒤에 (재부팅 직후면 카운터가 새로 시작하므로)
+  final List<(bool, int, int)> _pendingSessionEvents = []; // (시작?, 세션 번호, sample_no)
+  // 기기 샘플 카운터 -> epoch µs
+  final ClockSync _clock = ClockSync();
+  // 마지막으로 병합한 백필 기록의 sample_no (다시 받은 배치를 거르는 기준)
+  int _backfillTicks = -1;
+  // 내보내기 진행률 (null: 진행 중 아님)
+  var exportProgress = Rxn<double>();
+  // 기기에 남아 있는 백필 기록 수 (끊긴 동안 저장된 측정값)
+  var backfillRemaining = 0.obs;
 
   BluetoothConnection? _connection;
-  String _inputBuffer = "";
+  late final TelemetryDecoder _decoder = TelemetryDecoder(
+    onLine: _parseAndProcess,
+    onFrame: _onFrame,
+  );
   var isScanning = false.obs;
   StreamSubscription<BluetoothDiscoveryResult>? _discoveryStreamSubscription;
   Timer? _reconnectTimer;
   bool _isUserIntentionalDisconnect = false;
-
-  final AudioPlayer _audioPlayer = AudioPlayer();
-  final FlutterLocalNotificationsPlugin _notificationsPlugin = FlutterLocalNotificationsPlugin();
+  // 재연결: 마지막 주소로 바로 시도, 실패 시 지터 백오프, 여러 번 실패해야 검색
+  static const String LAST_ADDRESS_KEY = 'last_device_address';
+  final ReconnectPolicy _reconnect = ReconnectPolicy();
+  DateTime? _lastDataAt;
+  var reconnectCount = 0.obs;
+  var lastReconnectTime = Rxn<Duration>();
+  var lastDataGap = Rxn<Duration>();
+
+  // 기기 설정 명령: 응답($A) 대기 중인 명령과 직렬화용 큐
+  static const Duration COMMAND_TIMEOUT = Duration(seconds: 2);
+  final Map<String, Completer<bool>> _pendingAcks = {};
+  Future<void> _commandQueue = Future.value();
+
+  // 하트비트: 기기는 이것으로 링크 끊김을 판단하고, 끊긴 동안의 측정값을 저장함
+  static const Duration HEARTBEAT_INTERVAL = Duration(seconds: 1);
+  Timer? _heartbeatTimer;
+
+  // 경고음/알림 (미리 로드) 과 샘플 -> 소리 지연 통계
+  final AlertService _alerts;
+  var lastAlertLatency = Rxn<Duration>();
   
   DateTime? _lastAlertTime; 
   
 
   static const int ALERT_COOLDOWN_SECONDS = 5; 
 
+  // 기록 파일 (health_log.vlog). 저장할 때 바뀐 블록만 다시 씀
+  final HistoryFile _historyFile;
+  final HistoryTileFile _tileFile;
+  final SessionFile _sessionFile;
+  // 예전 버전이 기록을 JSON 줄 목록으로 두던 SharedPreferences 키 (처음 읽을 때 파일로 옮기고 지움)
+  static const String LEGACY_LOGS_KEY = 'health_logs';
+  // 날짜 없이 "HH:mm:ss" 만 남은 옛 기록의 자리: 이 시각부터 순서대로 1초씩 (서로 겹치지 않게)
+  static final int LEGACY_EPOCH_US = DateTime.utc(2000).microsecondsSinceEpoch;
+
+  // 다른 로컬 프로세스로 내보내는 실시간 데이터 (Linux 에서만 켜짐)
+  final LiveFeed _liveFeed;
+
+  // alerts: 벤치마크/테스트에서 소리·알림 플러그인 없이 돌릴 때 대체
+  // historyFile, tileFile, sessionFile: 벤치마크/테스트에서 임시 파일로 대체
+  // liveFeed: 벤치마크/테스트에서 LiveFeed.off()
+  HealthController(
+      {AlertService? alerts,
+      HistoryFile? historyFile,
+      HistoryTileFile? tileFile,
+      SessionFile? sessionFile,
+      LiveFeed? liveFeed})
+      : _alerts = alerts ?? AlertService(),
+        _historyFile = historyFile ?? HistoryFile(),
+        _tileFile = tileFile ?? HistoryTileFile(),
+        _sessionFile = sessionFile ?? SessionFile(),
+        _liveFeed = liveFeed ?? LiveFeed();
+
   @override
   void onInit() {
     super.onInit();
     _requestPermissions();
     _initWaveform();
-    _initNotifications();
+    _alerts.init();
     _loadLogs();
     
     Future.delayed(const Duration(seconds: 1), autoConnect);
@@ -60,20 +170,14 @@ class HealthController extends GetxController {
   @override
   void onClose() {
     _reconnectTimer?.cancel();
+    _heartbeatTimer?.cancel();
     _discoveryStreamSubscription?.cancel();
     _connection?.dispose();
-    _audioPlayer.dispose();
+    _alerts.dispose();
     super.onClose();
   }
 
-  void _initNotifications() async {
-    const AndroidInitializationSettings initializationSettingsAndroid =
-        AndroidInitializationSettings('@mipmap/ic_launcher');
-    const InitializationSettings initializationSettings = InitializationSettings(
-      android: initializationSettingsAndroid,
-    );
-    await _notificationsPlugin.initialize(initializationSettings);
-  }
+  LatencyHistogram get alertLatency => _alerts.latency;
 
   void _initWaveform() {
     for (int i = 0; i < 50; i++) {
@@ -95,7 +199,7 @@ class HealthController extends GetxController {
   // -------------------------------------------------------------------------
   // [수정됨] 로그 저장 (패킷에서 받은 시간을 사용)
   // -------------------------------------------------------------------------
-  Future<void> _saveLog(double bpm, double sp, String packetTime, {bool isEmergency = false}) async {
+  Future<void> _saveLog(double bpm, double sp, int timeUs, {bool isEmergency = false}) async {
     // 5초 쿨다운 체크 (긴급상황 제외)
     if (!isEmergency && _lastSaveTime != null && 
         DateTime.now().difference(_lastSaveTime!).inSeconds < 5) {
@@ -106,39 +210,180 @@ class HealthController extends GetxController {
 
     if (bpm < 10 || sp < 10) return;
 
-    // [변경] DateTime.now() 대신 파라미터로 받은 packetTime 사용
-    final newLog = HealthLog(
-      time: packetTime, 
-      bpm: bpm,
-      spo2: sp,
-    );
-
-    logHistory.insert(0, newLog);
-    
-    final prefs = await SharedPreferences.getInstance();
-    List<String> jsonList = logHistory.map((log) => jsonEncode(log.toJson())).toList();
-    await prefs.setStringList('health_logs', jsonList);
+    // [변경] DateTime.now() 대신 기기 샘플 시각 사용
+    // 시계 보정으로 직전 기록보다 살짝 앞설 수 있으므로 저장소가 제자리에 넣음
+    final h = _currentHrv();
+    if (!logHistory.add(timeUs, bpm, sp,
+        flags: isEmergency ? HistoryStore.FLAG_EMERGENCY : 0,
+        sdnn: h?.sdnn.round(),
+        rmssd: h?.rmssd.round(),
+        irregularity: h == null ? null : (h.irregularity * 100).round())) return;
+    _addToTiles(timeUs);
+    logRevision.value++;
+    await _persistLogs();
     
     if(isEmergency) {
-      print("🚨 비상 데이터 긴급 저장 완료! (시간: $packetTime)");
+      print("🚨 비상 데이터 긴급 저장 완료! (시간: ${DateTime.fromMicrosecondsSinceEpoch(timeUs)})");
+    }
+  }
+
+  // 기록에 붙일 HRV. 박동 간격이 한동안 안 들어왔다면(손가락 뗌, 품질 불량) 붙이지 않음
+  static const Duration HRV_STALE = Duration(seconds: 10);
+  HrvSummary? _currentHrv() {
+    final last = _lastRrAt;
+    if (last == null || DateTime.now().difference(last) > HRV_STALE) return null;
+    return hrv.value;
+  }
+
+  // 인코딩은 여기서 바로(동기), 파일 쓰기만 비동기. 쓰기 실패는 다음 저장 때 처음부터 다시 씀
+  Future<void> _persistLogs() async {
+    try {
+      await _historyFile.save(logHistory);
+    } catch (e) {
+      print("기록 저장 실패: $e");
+      logHistory.markAllDirty();
+      await _historyFile.clear();
     }
+    try {
+      await _tileFile.save(historyTiles);
+    } catch (e) {
+      // 캐시일 뿐이므로 지우고 다음에 다시 만듦
+      print("타일 캐시 저장 실패: $e");
+      await _tileFile.clear();
+    }
+    await _persistSessions();
+  }
+
+  Future<void> _persistSessions() async {
+    try {
+      await _sessionFile.save(sessions);
+    } catch (e) {
+      print("세션 저장 실패: $e");
+      sessions.markAllDirty();
+      await _sessionFile.clear();
+    }
+  }
+
+  // 방금 저장소에 넣은 기록(저장소가 반올림한 값)을 타일에 반영
+  void _addToTiles(int timeUs) {
+    final i = logHistory.lowerBound(timeUs);
+    historyTiles.addFromStore(logHistory, i, i + 1);
+  }
+
+  // 백필 기록을 시간 순서에 맞춰 끼워 넣음. 같은 시각의 기록이 있으면 건너뜀
+  // (확인이 늦어 기기가 같은 배치를 다시 보낸 경우)
+  bool _mergeLogs(List<HealthLog> logs) {
+    bool added = false;
+    for (final log in logs) {
+      if (log.bpm < 10 || log.spo2 < 10) continue;
+      if (logHistory.addLog(log)) {
+        _addToTiles(log.timeUs);
+        added = true;
+      }
+    }
+    if (added) logRevision.value++;
+    return added;
+  }
+
+  // 세션 하나의 기록 (최신이 위)
+  HistoryView sessionView(MeasurementSession session, [int mask = 0]) {
+    final (start, end) = SessionIndex.recordRange(logHistory, session);
+    return logHistory.view(start, end, mask);
+  }
+
+  // 기록/세션 목록의 현재 기간 시작 (null 이면 전체)
+  int? get _periodStartUs {
+    final period = historyPeriod.value;
+    return period == null ? null : DateTime.now().subtract(period).microsecondsSinceEpoch;
+  }
+
+  // 현재 기간에 해당하는 오름차순 기록 인덱스 [start, length)
+  int get _historyStart {
+    final from = _periodStartUs;
+    return from == null ? 0 : logHistory.lowerBound(from);
+  }
+
+  // 현재 필터(기간 + 경고 종류)의 기록 (최신이 위). 경고 기록은 비트맵으로 바로 찾음
+  HistoryView historyView() => logHistory.view(_historyStart, logHistory.length, historyFilter.value);
+
+  // 현재 기간에서 경고 종류(mask)별 기록 수
+  int historyAlertCount(int mask) => logHistory.alertCount(mask, _historyStart, logHistory.length);
+
+  // 현재 기간과 겹치는 세션 수. 최신이 0번이므로 sessions[0, n) 이 그 세션들 (목록을 만들지 않음)
+  int historySessionCount() {
+    final from = _periodStartUs;
+    return from == null ? sessions.length : sessions.countEndingAfter(from);
   }
 
   Future<void> _loadLogs() async {
+    try {
+      await _historyFile.load(logHistory);
+    } catch (e) {
+      // 헤더가 다르거나 읽을 수 없는 파일: 새로 씀
+      print("기록 파일 읽기 실패: $e");
+      logHistory.clear();
+    }
+    await _tileFile.load(historyTiles, logHistory);
+    try {
+      await _sessionFile.load(sessions);
+    } catch (e) {
+      print("세션 파일 읽기 실패: $e");
+      sessions.clear();
+    }
+
+    // 예전 형식 (JSON 줄 목록, 최신이 앞) -> 파일로 옮김.
+    // 모든 줄이 저장소에 들어가고(이미 있던 것 포함) 파일에 쓰였을 때만 지움. 아니면 다음 실행에 다시 시도
     final prefs = await SharedPreferences.getInstance();
-    List<String>? jsonList = prefs.getStringList('health_logs');
-    
+    final jsonList = prefs.getStringList(LEGACY_LOGS_KEY);
     if (jsonList != null) {
-      logHistory.value = jsonList
-          .map((item) => HealthLog.fromJson(jsonDecode(item)))
-          .toList();
+      bool complete = true;
+      for (int i = jsonList.length - 1, k = 0; i >= 0; i--, k++) {
+        try {
+          final log = HealthLog.fromJson(jsonDecode(jsonList[i]),
+              fallbackTimeUs: LEGACY_EPOCH_US + k * Duration.microsecondsPerSecond);
+          // false 면 같은 시각의 기록이 이미 있음 (지난번에 옮기다 중단된 경우)
+          if (logHistory.addLog(log)) _addToTiles(log.timeUs);
+        } catch (e) {
+          print("옛 기록 읽기 실패: ${jsonList[i]}");
+          complete = false;
+        }
+      }
+      await _persistLogs();
+      if (complete && !logHistory.isDirty) await prefs.remove(LEGACY_LOGS_KEY);
+    }
+    logRevision.value++;
+    sessionRevision.value++;
+  }
+
+  // 앱 문서 폴더에 파일로 내보내고 경로를 돌려줌
+  Future<String?> exportHistory(ExportFormat format,
+      {DateTime? from, DateTime? to, Duration? minInterval}) async {
+    if (exportProgress.value != null) return null;
+    exportProgress.value = 0;
+    try {
+      final dir = await getApplicationDocumentsDirectory();
+      final stamp = DateFormat('yyyyMMdd_HHmmss').format(DateTime.now());
+      final file = File('${dir.path}/health_$stamp.${format.extension}');
+      final count = await HistoryExporter.export(logHistory, file,
+          format: format, from: from, to: to, minInterval: minInterval,
+          onProgress: (p) => exportProgress.value = p);
+      print("기록 $count개 내보냄: ${file.path}");
+      return file.path;
+    } finally {
+      exportProgress.value = null;
     }
   }
 
   Future<void> clearLogs() async {
     logHistory.clear();
-    final prefs = await SharedPreferences.getInstance();
-    await prefs.remove('health_logs');
+    historyTiles.clear();
+    sessions.clear();
+    _pendingSessionEvents.clear();
+    logRevision.value++;
+    sessionRevision.value++;
+    await _historyFile.clear();
+    await _tileFile.clear();
+    await _sessionFile.clear();
   }
 
   // --- 블루투스 로직 ---
@@ -155,11 +400,24 @@ class HealthController extends GetxController {
        return;
     }
 
+    // 빠른 경로: 마지막으로 연결됐던 주소 (페어링 목록 조회/검색 없이)
+    if (!_reconnect.shouldRescan) {
+      final prefs = await SharedPreferences.getInstance();
+      final cached = prefs.getString(LAST_ADDRESS_KEY);
+      if (cached != null) {
+        _startConnection(cached);
+        return;
+      }
+    }
+
     List<BluetoothDevice> bondedDevices = await FlutterBluetoothSerial.instance.getBondedDevices();
     try {
       BluetoothDevice target = bondedDevices.firstWhere((d) => d.name == TARGET_DEVICE_NAME);
-      _startConnection(target);
-      return;
+      // 페어링 목록의 주소로도 이미 실패했다면 주변 검색
+      if (_reconnect.failures < ReconnectPolicy.RESCAN_AFTER_FAILURES * 2) {
+        _startConnection(target.address);
+        return;
+      }
     } catch (e) {}
     _startScanForTarget();
   }
@@ -173,7 +431,7 @@ class HealthController extends GetxController {
       if (r.device.name == TARGET_DEVICE_NAME) {
         _discoveryStreamSubscription?.cancel();
         isScanning.value = false;
-        _startConnection(r.device);
+        _startConnection(r.device.address);
       }
     });
 
@@ -181,74 +439,297 @@ class HealthController extends GetxController {
       isScanning.value = false;
       if (!isConnected.value) {
         connectionStatus.value = "기기 못 찾음";
+        _reconnect.onAttemptFailed();
         _scheduleReconnect();
       }
     });
   }
 
-  void _startConnection(BluetoothDevice device) async {
+  void _startConnection(String address) async {
     try {
       connectionStatus.value = "연결 시도 중...";
-      _connection = await BluetoothConnection.toAddress(device.address);
+      _connection = await BluetoothConnection.toAddress(address);
+      _deviceAddress = address;
+      final engineLoaded = _loadHeartRateEngine();
+      SharedPreferences.getInstance().then((p) => p.setString(LAST_ADDRESS_KEY, address));
       
       isConnected.value = true;
       connectionStatus.value = "연결됨";
       _reconnectTimer?.cancel();
+      _reconnect.onConnected(DateTime.now());
+      reconnectCount.value = _reconnect.reconnects;
+      lastReconnectTime.value = _reconnect.lastReconnectTime;
 
       _connection!.input!.listen(_onDataReceived).onDone(() {
+        _heartbeatTimer?.cancel();
         isConnected.value = false;
         if (_isUserIntentionalDisconnect) {
           connectionStatus.value = "연결 종료됨";
         } else {
+          _reconnect.onDisconnected(DateTime.now(), _lastDataAt);
           connectionStatus.value = "연결 끊김! 재연결...";
-          _scheduleReconnect();
+          // 끊긴 직후 첫 시도는 기다리지 않음
+          autoConnect();
         }
       });
 
+      _heartbeatTimer?.cancel();
+      _heartbeatTimer = Timer.periodic(HEARTBEAT_INTERVAL, (_) => _writeLine('#HB'));
+      // 스트림 설정은 기기 RAM 에만 있으므로 자기상관을 골라 둔 기기면 연결할 때마다 다시 보냄
+      refreshDeviceConfig().then((_) => engineLoaded).then((_) {
+        if (deviceConfig.value?.stream != WaveformStream.raw) _ensureRawStream();
+      });
+
     } catch (e) {
       isConnected.value = false;
       connectionStatus.value = "연결 실패";
+      _reconnect.onAttemptFailed();
       _scheduleReconnect();
     }
   }
 
   void _scheduleReconnect() {
+    if (_isUserIntentionalDisconnect) return;
     _reconnectTimer?.cancel();
-    _reconnectTimer = Timer(const Duration(seconds: 3), autoConnect);
+    final delay = _reconnect.nextDelay();
+    connectionStatus.value = "${connectionStatus.value} (${(delay.inMilliseconds / 1000).toStringAsFixed(1)}초 후 재시도)";
+    _reconnectTimer = Timer(delay, autoConnect);
   }
 
   void toggleConnection(BuildContext context) {
     if (isConnected.value) {
       _isUserIntentionalDisconnect = true;
+      _heartbeatTimer?.cancel();
+      _reconnectTimer?.cancel();
       _connection?.dispose();
       isConnected.value = false;
       connectionStatus.value = "연결 종료";
+      _reconnect.reset();
     } else {
+      _reconnect.reset();
       autoConnect();
     }
   }
 
+  // -------------------------------------------------------------------------
+  // 기기 설정 (RX 명령 채널, "#KEY=VAL\n" -> "$A,KEY,OK|ERR" + "$C,...")
+  // -------------------------------------------------------------------------
+  Future<bool> setSampleRate(int hz) {
+    if (!DeviceConfig.SAMPLE_RATES.contains(hz)) return Future.value(false);
+    return _sendCommand('SR', '$hz');
+  }
+
+  Future<bool> setLedCurrent(int red, int ir) {
+    if (red < 0 || red > 255 || ir < 0 || ir > 255) return Future.value(false);
+    return _sendCommand('LED', '$red,$ir');
+  }
+
+  Future<bool> setTelemetryDecimation(int every) {
+    if (every < 1 || every > 100) return Future.value(false);
+    return _sendCommand('DEC', '$every');
+  }
+
+  Future<bool> setWaveformStream(WaveformStream stream) => _sendCommand('STR', stream.code);
+
+  Future<bool> refreshDeviceConfig() => _sendCommand('GET', '');
+
+  // 자기상관 엔진은 원시 PPG 로 계산하므로 파형 스트림도 raw 로 바꿈
+  Future<void> setHeartRateEngine(HeartRateEngine engine) async {
+    hrEngine.value = engine;
+    final address = _deviceAddress;
+    if (address != null) {
+      final prefs = await SharedPreferences.getInstance();
+      await prefs.setString('hr_engine_$address', engine.name);
+    }
+    if (engine == HeartRateEngine.autocorrelation) {
+      await setWaveformStream(WaveformStream.raw);
+    }
+  }
+
+  Future<void> _loadHeartRateEngine() async {
+    final prefs = await SharedPreferences.getInstance();
+    hrEngine.value = HeartRateEngine.fromName(prefs.getString('hr_engine_$_deviceAddress'));
+  }
+
+  // 자기상관 엔진인데 raw 가 아닌 스트림이 오면(기기 재부팅 등) raw 를 다시 요청.
+  // 응답을 기다리는 동안은 블록마다 중복해서 보내지 않음
+  bool _requestingRawStream = false;
+  void _ensureRawStream() {
+    if (_requestingRawStream || hrEngine.value != HeartRateEngine.autocorrelation) return;
+    _requestingRawStream = true;
+    setWaveformStream(WaveformStream.raw).whenComplete(() => _requestingRawStream = false);
+  }
+
+  // 경고/기록에 쓸 심박수. 자기상관을 골랐어도 아직 추정값이 없으면 기기 값 사용
+  double _selectedHeartRate(double deviceBpm) {
+    if (hrEngine.value == HeartRateEngine.autocorrelation && autocorrBpm.value > 0) {
+      return autocorrBpm.value;
+    }
+    return deviceBpm;
+  }
+
+  // 기기 수신 버퍼가 한 줄이므로 이전 명령의 응답을 받은 뒤에 다음 명령 전송
+  Future<bool> _sendCommand(String key, String value) {
+    final result = _commandQueue.then((_) => _transmitCommand(key, value));
+    _commandQueue = result.then((_) {}, onError: (_) {});
+    return result;
+  }
+
+  Future<bool> _transmitCommand(String key, String value) async {
+    final connection = _connection;
+    if (!isConnected.value || connection == null) return false;
+
+    final completer = Completer<bool>();
+    _pendingAcks[key] = completer;
+    connection.output.add(ascii.encode(value.isEmpty ? '#$key\n' : '#$key=$value\n'));
+    await connection.output.allSent;
+
+    return completer.future.timeout(COMMAND_TIMEOUT, onTimeout: () {
+      _pendingAcks.remove(key);
+      return false;
+    });
+  }
+
+  // 응답을 기다리지 않는 한 줄 전송 (하트비트, 백필 확인)
+  void _writeLine(String line) {
+    final connection = _connection;
+    if (!isConnected.value || connection == null) return;
+    connection.output.add(ascii.encode('$line\n'));
+  }
+
   void _onDataReceived(Uint8List data) {
-    String incomingData = utf8.decode(data);
-    _inputBuffer += incomingData;
+    final now = DateTime.now();
+    _lastDataAt = now;
+    _reconnect.onData(now);
+    if (_reconnect.lastDataGap != lastDataGap.value) lastDataGap.value = _reconnect.lastDataGap;
+    _decoder.add(data);
+  }
 
-    while (_inputBuffer.contains('\n')) {
-      int index = _inputBuffer.indexOf('\n');
-      String packet = _inputBuffer.substring(0, index).trim();
-      _inputBuffer = _inputBuffer.substring(index + 1);
-      _parseAndProcess(packet);
+  // 벤치마크/테스트용 진입점: 블루투스 없이 수신 경로를 그대로 구동
+  @visibleForTesting
+  void ingestBytes(Uint8List data) => _onDataReceived(data);
+  @visibleForTesting
+  void ingestLine(String packet) => _parseAndProcess(packet);
+  @visibleForTesting
+  void checkThresholds(double spo2, double bpm, int timeUs) => _checkThresholds(spo2, bpm, timeUs);
+  @visibleForTesting
+  Future<void> saveLog(double bpm, double sp, int timeUs, {bool isEmergency = false}) =>
+      _saveLog(bpm, sp, timeUs, isEmergency: isEmergency);
+
+  void _onFrame(int type, Uint8List payload) {
+    try {
+      switch (type) {
+        case WaveformBlock.FRAME_TYPE:
+          _onWaveformBlock(WaveformBlock.decode(payload));
+          break;
+        case HistoryBatch.FRAME_TYPE:
+          _onHistoryBatch(HistoryBatch.decode(payload));
+          break;
+        case RrBatch.FRAME_TYPE:
+          _onRrBatch(RrBatch.decode(payload));
+          break;
+      }
+    } catch (e) {
+      print("Frame Error: type=$type len=${payload.length}");
     }
   }
 
+  // 블록 하나 = 연속된 샘플 N개. 빠진 블록은 x축을 건너뛰어 시간 축을 유지
+  void _onWaveformBlock(WaveformBlock block) {
+    final last = _lastBlockSeq;
+    if (last != null) {
+      final missed = (block.seq - last - 1) & 0xFF;
+      if (missed > 0 && missed < 16) _timeCounter += missed * block.samples.length;
+    }
+    _lastBlockSeq = block.seq;
+    _lastBlockTime = DateTime.now();
+    _liveFeed.wave(block.stream, block.samples, deviceConfig.value?.waveformRate ?? 25.0,
+        _lastBlockTime!.microsecondsSinceEpoch);
+
+    for (final v in block.samples) {
+      _waveWindow.add(FlSpot(_timeCounter++, v.toDouble()));
+    }
+    while (_waveWindow.length > WAVEFORM_WINDOW) {
+      _waveWindow.removeFirst();
+    }
+    waveformData.assignAll(_waveWindow);
+    _updateAutocorr(block);
+  }
+
+  void _updateAutocorr(WaveformBlock block) {
+    // 자기상관은 원시 PPG 에서만 맞는 값이 나옴. 미분/필터 스트림이면 추정값을 버려 기기 값을 쓰게 함
+    if (block.stream != WaveformStream.raw.code) {
+      _autocorr = null;
+      _autocorrStream = block.stream;
+      autocorrBpm.value = 0;
+      autocorrConfidence.value = 0;
+      _ensureRawStream();
+      return;
+    }
+    final rate = deviceConfig.value?.waveformRate ?? 25.0;
+    var estimator = _autocorr;
+    // 스트림이나 샘플레이트가 바뀌면 창을 처음부터 다시 채움
+    if (estimator == null || estimator.sampleRate != rate || _autocorrStream != block.stream) {
+      estimator = _autocorr = AutocorrHeartRate(rate, hopSamples: block.samples.length);
+      _autocorrStream = block.stream;
+      autocorrBpm.value = 0;
+    }
+    if (estimator.addSamples(block.samples)) {
+      autocorrBpm.value = estimator.bpm ?? 0;
+      autocorrConfidence.value = estimator.confidence;
+    }
+  }
+
+  // 박동 간격: 프레임이 빠졌으면(seq 불연속) 첫 간격은 앞과 이어지지 않은 것으로 처리.
+  // 창보다 오래 끊겼다면 남은 간격은 지난 측정의 것이므로 창을 비우고 새로 시작
+  void _onRrBatch(RrBatch batch) {
+    final now = DateTime.now();
+    final last = _lastRrAt;
+    if (last != null && now.difference(last).inMilliseconds > HrvEngine.WINDOW_MS) {
+      _hrv.reset();
+    }
+    _lastRrAt = now;
+    final continues = batch.seq == _nextRrSeq;
+    for (int i = 0; i < batch.length; i++) {
+      _hrv.add(batch.intervals[i],
+          contiguous: batch.contiguous[i] == 1 && (i > 0 || continues));
+    }
+    _nextRrSeq = (batch.seq + batch.length) & 0xFFFF;
+    hrv.value = _hrv.summary;
+  }
+
+  // 끊긴 동안 저장된 기록: 바로 확인을 보내야 기기가 다음 배치를 보냄
+  // 과거 측정값이므로 경고는 울리지 않고 로그에만 병합.
+  // 기록의 sample_no 는 실시간 줄과 같은 시계 추정으로 변환하므로, 아직 실시간 줄을 받지 못했으면
+  // 확인하지 않고 버림 (기기가 잠시 뒤 같은 배치를 다시 보냄)
+  void _onHistoryBatch(HistoryBatch batch) {
+    if (!_clock.isSynced) return;
+    _writeLine('#HB=${batch.seq}');
+    backfillRemaining.value = batch.remaining;
+    // 백필 기록은 항상 지금 카운터보다 앞섬. 아니면 기기가 재부팅돼 카운터가 새로 시작한 것
+    if (_backfillTicks > (_clock.lastTicks ?? 0)) _backfillTicks = -1;
+    final logs = batch.logsAfter(_backfillTicks, _clock.toHostMicros);
+    if (batch.length > 0 && batch.ticks.last > _backfillTicks) _backfillTicks = batch.ticks.last;
+    if (_mergeLogs(logs)) _persistLogs();
+  }
+
   // -------------------------------------------------------------------------
   // [수정됨] 패킷 파싱 및 시간 추출
   // -------------------------------------------------------------------------
   void _parseAndProcess(String packet) {
     if (packet.isEmpty) return;
+    // '$' 로 시작하는 패킷은 측정값이 아닌 제어/통계 패킷
+    if (packet.startsWith('\$')) {
+      _parseTagged(packet);
+      return;
+    }
     try {
       List<String> values = packet.split(',');
       double? raw, sp, hr;
-      String packetTime = ""; // 패킷에서 추출할 시간
+      String packetTime = ""; // 패킷에서 추출할 시간 (화면 표시용)
+      int quality = 0; // 신호 품질 플래그 (구버전 펌웨어는 없음)
+      final receivedUs = DateTime.now().microsecondsSinceEpoch;
+      int timeUs = receivedUs;
 
       // Case 1: 시간 포함 4개 데이터 (시간, RAW, SPO2, BPM)
       if (values.length >= 4) {
@@ -256,6 +737,17 @@ class HealthController extends GetxController {
         raw = double.parse(values[1]);
         sp = double.parse(values[2]);
         hr = double.parse(values[3]);
+        if (values.length >= 5) quality = int.parse(values[4]);
+        if (values.length >= 6) {
+          // 샘플 카운터 + 시계 추정. 없으면(구버전) RTC 문자열 시각
+          final ticks = int.parse(values[5]);
+          final rate = deviceConfig.value?.outputRate ?? 25.0;
+          _clock.observe(ticks, receivedUs, 1e6 / rate);
+          timeUs = _clock.toHostMicros(ticks);
+        } else {
+          timeUs = DateTime.tryParse(packetTime)?.microsecondsSinceEpoch ?? receivedUs;
+        }
+        _flushSessionEvents(receivedUs);
       } 
       // Case 2: 3개 데이터 (혹시 몰라 예외처리) -> 시간은 앱 시간으로 대체
       else if (values.length == 3) {
@@ -268,81 +760,119 @@ class HealthController extends GetxController {
       if (raw != null && sp != null && hr != null) {
         spo2.value = sp;
         heartRate.value = hr;
+        signalQuality.value = SignalQuality(quality);
+        _liveFeed.vitals(timeUs, hr, sp, quality);
         
         // [변경] 패킷 시간을 UI 업데이트에 반영
         lastUpdated.value = packetTime;
 
-        _updateGraph(raw);
-        
+        // 파형 블록이 들어오는 동안에는 블록이 전체 파형을 그림
+        if (_lastBlockTime == null ||
+            DateTime.now().difference(_lastBlockTime!).inSeconds >= 2) {
+          _updateGraph(raw);
+        }
+
+        // 품질 불량 구간의 값은 움직임 등으로 오염됐을 수 있으므로 경고/저장하지 않음
+        if (quality != 0) return;
+
         // [변경] 경고 체크 및 저장 시 패킷 시간 전달
-        _checkThresholds(sp, hr, packetTime);
-        _saveLog(hr, sp, packetTime); 
+        final alarmHr = _selectedHeartRate(hr);
+        if (alarmHr >= 10 && sp >= 10 && sessions.addVitals(timeUs, alarmHr, sp)) {
+          sessionRevision.value++;
+        }
+        _checkThresholds(sp, alarmHr, timeUs);
+        _saveLog(alarmHr, sp, timeUs); 
+      }
+    } catch (e) {
+      print("Parsing Error: $packet");
+    }
+  }
+
+  void _parseTagged(String packet) {
+    try {
+      List<String> values = packet.split(',');
+      switch (values[0]) {
+        case '\$P': // loop() 프로파일러 통계
+          firmwareStats.value = FirmwareStats.parse(values);
+          break;
+        case '\$A': // 명령 응답
+          _pendingAcks.remove(values[1])?.complete(values[2] == 'OK');
+          break;
+        case '\$C': // 현재 기기 설정
+          deviceConfig.value = DeviceConfig.parse(values);
+          break;
+        case '\$S': // 측정 세션 시작 (손가락 올림): 세션 번호, sample_no
+        case '\$E': // 측정 세션 끝 (손가락 뗌)
+          _pendingSessionEvents.add((values[0] == '\$S', int.parse(values[1]), int.parse(values[2])));
+          break;
       }
     } catch (e) {
       print("Parsing Error: $packet");
     }
   }
 
+  // 실시간 줄에서 시계를 관측한 뒤 대기 중인 세션 이벤트를 반영
+  void _flushSessionEvents(int receivedUs) {
+    if (_pendingSessionEvents.isEmpty) return;
+    for (final (isStart, id, ticks) in _pendingSessionEvents) {
+      final timeUs = _clock.isSynced ? _clock.toHostMicros(ticks) : receivedUs;
+      if (isStart) {
+        sessions.start(id, timeUs);
+      } else {
+        sessions.end(id, timeUs);
+      }
+    }
+    _pendingSessionEvents.clear();
+    sessionRevision.value++;
+    _persistSessions();
+  }
+
   // -------------------------------------------------------------------------
-  // [수정됨] 경고 체크 (packetTime 전달받음)
+  // [수정됨] 경고 체크 (샘플 시각 전달받음)
   // -------------------------------------------------------------------------
-  void _checkThresholds(double currentSpo2, double currentHeartRate, String packetTime) {
+  void _checkThresholds(double currentSpo2, double currentHeartRate, int timeUs) {
     if (_lastAlertTime != null && 
         DateTime.now().difference(_lastAlertTime!).inSeconds < ALERT_COOLDOWN_SECONDS) {
       return; 
     }
 
+    // 기록 필터와 같은 규칙 (저장 해상도로 반올림한 값으로 판단)
+    final alerts = HistoryStore.alertsOfValues(currentHeartRate, currentSpo2);
     String alertMessage = "";
-    bool shouldAlert = false;
+    bool shouldAlert = alerts != 0;
 
-    if (currentSpo2 < LOW_SPO2_THRESHOLD && currentSpo2 > 10.0) {
+    if ((alerts & HistoryStore.ALERT_HYPOXIA) != 0) {
       alertMessage = "위험! 산소포화도 저하 ($currentSpo2%)";
-      shouldAlert = true;
-    } else if (currentHeartRate < LOW_HEART_RATE_THRESHOLD && currentHeartRate > 10.0) {
+    } else if ((alerts & HistoryStore.ALERT_BRADYCARDIA) != 0) {
       alertMessage = "위험! 서맥 감지 ($currentHeartRate BPM)";
-      shouldAlert = true;
-    } else if (currentHeartRate > HIGH_HEART_RATE_THRESHOLD) {
+    } else if ((alerts & HistoryStore.ALERT_TACHYCARDIA) != 0) {
       alertMessage = "위험! 빈맥 감지 ($currentHeartRate BPM)";
-      shouldAlert = true;
     }
 
     if (shouldAlert) {
-      _triggerAlert(alertMessage);
+      _triggerAlert(alertMessage, timeUs);
       _lastAlertTime = DateTime.now();
+      if (sessions.alert()) sessionRevision.value++;
       
       // [변경] 위험 상황 저장 시 패킷 시간 사용
-      _saveLog(currentHeartRate, currentSpo2, packetTime, isEmergency: true);
+      _saveLog(currentHeartRate, currentSpo2, timeUs, isEmergency: true);
     }
   }
 
-  Future<void> _triggerAlert(String message) async {
-    try {
-        await _audioPlayer.play(AssetSource('sounds/alert.mp3'));
-    } catch (e) {
-        print("Audio Error: $e");
-    }
-
-    const AndroidNotificationDetails androidDetails = AndroidNotificationDetails(
-      'health_alert_channel',
-      'Health Alerts',
-      importance: Importance.max,
-      priority: Priority.high,
-      color: Colors.red,
-      enableVibration: true,
-    );
-
-    await _notificationsPlugin.show(
-      0, '건강 위험 감지', message, 
-      const NotificationDetails(android: androidDetails),
-    );
-    
-    Get.snackbar(
-      "경고", message,
-      backgroundColor: Colors.red,
-      colorText: Colors.white,
-      snackPosition: SnackPosition.TOP,
-      duration: const Duration(seconds: 4),
-    );
+  Future<void> _triggerAlert(String message, int sampleTimeUs) async {
+    // 소리/알림은 서비스가 함께 시작하고, 스낵바는 기다리지 않고 바로 띄움
+    final sounded = _alerts.trigger(message, sampleTimeUs);
+    // 화면 없이 돌 때(벤치마크)는 스낵바를 띄울 오버레이가 없음
+    if (Get.overlayContext != null) {
+      Get.snackbar(
+        "경고", message,
+        backgroundColor: Colors.red,
+        colorText: Colors.white,
+        snackPosition: SnackPosition.TOP,
+        duration: const Duration(seconds: 4),
+      );
+    }
+    lastAlertLatency.value = await sounded;
   }
 
   void _updateGraph(double rawValue) {
@@ -18,12 +18,23 @@
 #define TWSTA 5
 #define TWSTO 4
 #define TWEN  2
+#define TWIE  0
 
 #define CS02  2
 #define WGM01 3
 #define OCIE0 1
 
+// External Interrupt (MAX30102 INT -> PE4/INT4, open-drain active low)
+#define INT4_BIT 4
+#define ISC41    1
+#define SE       5              // MCUCR: sleep enable (SM2..0 = 000 -> idle)
+
+// Timer1 (Profiler, clk/64 = 4us/tick)
+#define CS11  1
+#define CS10  0
+
 // --- UART0 Macros ---
+#define RXCIE0 7
 #define RXEN0 4
 #define TXEN0 3
 #define UDRE0 5
@@ -42,11 +53,17 @@
 #define DS1302_SCLK_PIN 0
 
 // Registers
+#define REG_INT_STATUS1 0x00
+#define REG_INT_ENABLE1 0x02
+#define PPG_RDY_EN      0x40
 #define REG_FIFO_WR_PTR 0x04
+#define REG_OVF_COUNTER 0x05
 #define REG_FIFO_RD_PTR 0x06
 #define REG_FIFO_DATA 0x07 
 #define REG_MODE_CONFIG 0x09
 #define REG_SPO2_CONFIG 0x0A
+#define REG_LED1_PA 0x0C
+#define REG_LED2_PA 0x0D
 
 // LCD Control
 #define LCD_EN 0x04  
@@ -75,12 +92,132 @@
 #define REFRACTORY_PERIOD 200   
 #define BPM_BUF_SIZE 5          
 
+// 4. Loop Profiler
+#define PROF_PERIOD_MS 5000     // 통계 패킷 전송 주기
+#define PROF_READ   0           // read_sample()
+#define PROF_FILTER 1           // LPF + HPF + 2nd Deriv
+#define PROF_DETECT 2           // Finger / Beat / SpO2
+#define PROF_RTC    3           // get_time()
+#define PROF_UART   4           // Bluetooth 출력
+#define PROF_LCD    5           // LCD 출력
+#define PROF_STAGES 6
+
+// 5. Command Channel (앱 -> 기기, "#KEY=VAL\n")
+#define CMD_BUF_SIZE 16
+#define STREAM_RAW   'R'        // raw_r
+#define STREAM_FILT  'F'        // ac_r (LPF+HPF)
+#define STREAM_DERIV 'D'        // deriv_out (기본값)
+
+// 6. Binary Frame (파형 블록 등)
+// [SYNC][LEN][TYPE][payload...][CRC8]  LEN = 1 + payload, CRC8(poly 0x07) 는 TYPE~payload
+// SYNC 가 0x80 이상이라 ASCII 줄과 섞여도 구분 가능
+#define FRAME_SYNC 0xB5
+#define FRAME_WAVE 'W'
+#define FRAME_HIST 'H'
+#define FRAME_RR   'R'
+#define BLOCK_MAX 32
+#define WD_MAX_SHIFT 3          // 파형 데시메이션 최대 1/8 (#WD=1|2|4|8)
+#define RR_MAX     8            // RR 프레임 하나에 담는 박동 간격 수 (다 차면 바로 전송)
+#define RR_SUB     64           // 박동 시각 해상도: 샘플 간격의 1/64 (포물선 보간)
+#define RR_BREAK   0x8000       // 직전 간격과 이어지지 않음 (품질 불량/손가락 뗌/범위 밖 간격 뒤)
+#define RR_MIN_MS  240          // BPM 이동평균과 같은 범위 (250 ~ 40 BPM)
+#define RR_MAX_MS  1500
+
+// 7. Store-and-Forward (링크 끊김 동안 EEPROM 에 기록 -> 재연결 후 백필)
+// 앱은 1초마다 #HB 를 보냄. LINK_TIMEOUT_MS 동안 수신이 없으면 끊긴 것으로 판단
+#define LINK_TIMEOUT_MS   3000
+#define HIST_PERIOD_MS    5000  // 끊긴 동안 기록 주기 (앱 로그 저장 주기와 동일)
+#define HIST_REC          6     // sample_no(4) + BPM(1) + SpO2(1)
+#define HIST_CAP          600   // 600 x 6 = 3600byte (EEPROM 4KB), 5초 간격이면 50분
+#define HIST_BATCH        8     // 백필 프레임 하나에 담는 기록 수
+#define BACKFILL_GAP_MS   250   // 백필 프레임 최소 간격 -> 약 200B/s, 나머지는 실시간 전송 몫
+#define BACKFILL_RETRY_MS 1000  // 이 시간 안에 #HB=seq 확인이 없으면 같은 배치 재전송
+
+// 8. Signal Quality Index (SQI)
+// SQI_WINDOW 샘플마다 판정한 플래그를 다음 구간 동안 적용. 0 이 아니면 박동/SpO2 검출을 건너뜀
+#define SQI_WINDOW   25         // 판정 구간 (FIFO 25Hz 에서 1초)
+#define SQI_CLIP     260000     // ADC(18bit, 최대 262143) 포화 근처
+#define SQI_PI_MIN   5          // 관류 지수 하한 (0.01% 단위 = 0.05%)
+#define SQI_PI_MAX   2000       // 관류 지수 상한 (20%), 이보다 크면 움직임으로 봄
+#define SQI_MOTION_X 3          // 미분 에너지 평균이 평소(기준)의 3배 이상이면 움직임
+#define SQI_EARLY_N  6          // 구간 중간이라도 이만큼 샘플이 모이면 움직임 판정을 즉시 반영
+#define SQI_REBASE   10         // 불량이 이만큼 연속되면 현재 에너지를 새 기준으로 받아들임
+#define SQI_CLIPPED  0x01
+#define SQI_LOW_PI   0x02
+#define SQI_HIGH_PI  0x04
+#define SQI_MOTION   0x08
+#define SQI_WARMUP   0x10       // 손가락 감지 직후 첫 구간
+
+// 9. TWI Driver (인터럽트 구동 트랜잭션 큐)
+// 센서 트랜잭션은 큐 순서대로, LCD 바이트는 센서 큐가 비어 있을 때만 (바이트 단위로 양보)
+#define TWI_QLEN     4          // 센서/설정 트랜잭션 큐 (2의 거듭제곱)
+#define LCD_QLEN     128        // LCD 바이트 링 (2의 거듭제곱, 한 화면 갱신 ~90byte)
+#define TWI_PENDING  0
+#define TWI_OK       1
+#define TWI_ERR      2
+#define FIFO_BATCH   8          // 한 번에 가져오는 최대 샘플 수 (x6byte)
+#define SENSOR_POLL_MS 200      // INT 신호를 놓쳤을 때를 대비한 최소 폴링 주기
+
+// 10. Scheduler (timer0_millis 기준 주기 작업, 샘플 처리는 매 패스)
+#define TASK_LINK    0          // 링크 감시 / 끊김 기록 / 백필
+#define TASK_TELEM   1          // 실시간 줄 (#DEC)
+#define TASK_RTC     2          // DS1302 읽기
+#define TASK_LCD     3          // LCD 갱신
+#define TASK_STATS   4          // $P 통계
+#define TASKS        5
+#define TELEM_UNIT_MS 40        // #DEC 단위 (25Hz 샘플 간격) -> 기본 25 = 1초
+
+// 11. Measurement Session (손가락을 올려 둔 동안이 한 세션)
+// 시작: 손가락 감지(f_det 0 -> 1) 시 "$S,번호,sample_no", 끝: 뗀 뒤 SESS_END_MS 가 지나면
+// "$E,번호,뗀 시점 sample_no". 그 전에 다시 올리면 같은 세션 (잠깐 미끄러진 경우)
+#define SESS_END_MS  2000
+
 // --- 전역 변수 ---
 char g_buf[20]; 
 
 volatile unsigned long timer0_millis = 0;
-int print_counter = 0;
+unsigned long sample_no = 0;    // 부팅 후 처리한 샘플 수 (앱이 이것으로 기기-호스트 시계 차이를 추정)
+
+// 런타임 설정 (명령 채널로 변경 가능)
+unsigned char cfg_sr_code = 1;        // SPO2_CONFIG SR 비트: 0=50, 1=100, 2=200, 3=400Hz
+unsigned char cfg_led_r = 0x1F, cfg_led_ir = 0x1F;
+unsigned char cfg_decim = 25;         // 몇 샘플마다 텔레메트리 1줄 (파형은 블록으로 전송)
+char cfg_stream = STREAM_DERIV;
+unsigned char cfg_block = 10;         // 파형 블록 크기 (0 = 블록 전송 끔)
+unsigned char cfg_wd_shift = 0;       // 파형 블록 데시메이션 R = 1 << cfg_wd_shift
+
+// 파형 블록 버퍼
+long blk_buf[BLOCK_MAX];
+unsigned char blk_n = 0, blk_seq = 0;
+unsigned char frame_buf[4 + BLOCK_MAX * 5];
+
+// 박동 간격(RR) 버퍼. 박동 시각은 millis() 가 아닌 샘플 번호로 재서
+// FIFO 를 몰아서 처리할 때의 지연이 간격에 섞이지 않음
+unsigned int rr_buf[RR_MAX];
+unsigned char rr_n = 0, rr_break = 1, rr_have = 0, rr_track = 0;
+unsigned int rr_seq = 0;          // 지금까지 보낸 간격 수 (앱이 빠진 프레임을 알아챔)
+unsigned long rr_last = 0;        // 직전 박동 시각 (sample_no x RR_SUB)
+unsigned long rr_at = 0;          // 추적 중인 하강 엣지 최저점의 샘플 번호
+long rr_min = 0, rr_before = 0;   // 최저점 값과 그 직전 샘플 값
+
+// 기록 링 버퍼 (EEPROM). 인덱스는 SRAM 에만 두어 같은 셀을 반복해서 쓰지 않음
+// (재부팅하면 남은 기록은 버려짐). 한 셀은 HIST_CAP 번 기록마다 한 번 쓰임
+eeprom unsigned char hist_ee[HIST_CAP * HIST_REC];
+unsigned int hist_head = 0;       // 다음에 쓸 위치
+unsigned int hist_count = 0;      // 아직 앱이 확인하지 않은 기록 수
+unsigned int hist_inflight = 0;   // 전송했지만 확인(#HB=seq) 대기 중인 기록 수
+unsigned char bf_seq = 0;
+unsigned long hist_last = 0, bf_last = 0, link_ms = 0;
+char link_up = 0;
+volatile char link_rx = 0;        // 수신 인터럽트가 바이트를 받으면 1
+
 long current_bpm = 0, current_spo2 = 0;
+
+// 측정 세션. 번호는 부팅 후 1부터
+unsigned int sess_id = 0;
+char sess_open = 0;
+unsigned long sess_start = 0, sess_off = 0;   // 시작 / 손가락 뗀 시점의 sample_no
+unsigned long sess_off_ms = 0;                // 손가락 뗀 시각 (ms)
 unsigned char rtc_hour = 0, rtc_min = 0, rtc_sec = 0;
 unsigned char rtc_year = 0, rtc_month = 0, rtc_day = 0;
 
@@ -110,9 +247,77 @@ interrupt [TIM0_COMP] void timer0_comp_isr(void) { timer0_millis++; }
 void millis_init(void) { TCCR0 = (1 << WGM01) | (1 << CS02); OCR0 = 249; TIMSK |= (1 << OCIE0); #asm("sei") }
 unsigned long millis(void) { unsigned long m; #asm("cli") m = timer0_millis; #asm("sei") return m; }
 
+// ==========================================
+// [Loop Profiler]
+// Timer1 을 clk/64 (4us/tick) 로 프리런 시켜 구간별 소요 tick 을 기록
+// 16bit 이므로 한 구간이 262ms 를 넘으면 안 됨 (UART 한 줄 ~35ms)
+// ==========================================
+typedef struct { unsigned int min, max; unsigned long sum; unsigned int cnt; } Prof;
+
+Prof prof[PROF_STAGES];
+unsigned long prof_busy = 0;      // 모든 구간 tick 합
+unsigned long prof_last = 0;      // 마지막 통계 전송 시각 (ms)
+unsigned int prof_samples = 0;    // 처리한 샘플 수
+unsigned int prof_polls = 0;      // 새 샘플 없이 끝난 폴링 수
+unsigned int prof_ovf = 0;        // MAX30102 FIFO 오버런 (유실 샘플 수)
+
+void prof_init(void) { TCCR1A = 0; TCCR1B = (1 << CS11) | (1 << CS10); }
+unsigned int prof_now(void) { return TCNT1; }
+void prof_end(unsigned char st, unsigned int t0) {
+    unsigned int d = (TCNT1 - t0) & 0xFFFF;    // 16bit wrap 보정 (호스트 시뮬레이터는 int 가 32bit)
+    Prof* p = &prof[st];
+    if (p->cnt == 0 || d < p->min) p->min = d;
+    if (d > p->max) p->max = d;
+    p->sum += d; p->cnt++;
+    prof_busy += d;
+}
+void prof_rst(void) {
+    unsigned char k;
+    for (k = 0; k < PROF_STAGES; k++) { prof[k].min = 0; prof[k].max = 0; prof[k].sum = 0; prof[k].cnt = 0; }
+    prof_busy = 0; prof_samples = 0; prof_polls = 0; prof_ovf = 0;
+}
+
+// ==========================================
+// [Scheduler]
+// 협조형: 작업은 짧게 끝나고 돌아와야 함. loop() 는 매 패스마다 쌓인 샘플을 먼저 처리하고
+// 기한이 된 주기 작업 중 마감(next + deadline)이 가장 이른 것 하나만 실행 -> 작업 사이마다 샘플 처리.
+// 시작이 마감을 넘기면 late 증가, 한 주기 이상 밀리면 따라잡지 않고 다음 주기로 건너뜀
+// ==========================================
+typedef struct {
+    void (*run)(unsigned long now);
+    unsigned int period, deadline;   // ms
+    unsigned long next;              // 다음 실행 시각
+    unsigned int late;               // 통계 기간 동안 마감을 넘긴 횟수
+} Task;
+
+Task tasks[TASKS];
+
+void task_init(unsigned char k, void (*run)(unsigned long now), unsigned int period, unsigned int deadline, unsigned long now) {
+    tasks[k].run = run; tasks[k].period = period; tasks[k].deadline = deadline;
+    tasks[k].next = now + period; tasks[k].late = 0;
+}
+
+void sched_run(unsigned long now) {
+    unsigned char k, pick = TASKS;
+    unsigned long due, best = 0;
+    Task *t;
+    for (k = 0; k < TASKS; k++) {
+        t = &tasks[k];
+        if ((long)(now - t->next) < 0) continue;
+        due = t->next + t->deadline;
+        if (pick == TASKS || (long)(due - best) < 0) { pick = k; best = due; }
+    }
+    if (pick == TASKS) return;
+    t = &tasks[pick];
+    if ((long)(now - best) > 0) t->late++;
+    t->run(now);
+    t->next += t->period;
+    if ((long)(now - t->next) >= 0) t->next = now + t->period;
+}
+
 void bt_init(void) { 
     UBRR0H = 0; UBRR0L = MYUBRR; 
-    UCSR0B = (1 << RXEN0) | (1 << TXEN0); 
+    UCSR0B = (1 << RXCIE0) | (1 << RXEN0) | (1 << TXEN0); 
     UCSR0C = (1 << UCSZ01) | (1 << UCSZ00); 
 }
 void bt_transmit(char data) { while (!(UCSR0A & (1 << UDRE0))); UDR0 = data; }
@@ -120,11 +325,233 @@ void bt_str(char* str) { while (*str) bt_transmit(*str++); }
 void bt_long(long val) { long_to_str(val); bt_str(g_buf); } 
 void bt_2digits(unsigned char val) { if (val < 10) bt_transmit('0'); bt_long((long)val); }
 
-void twi_start(void) { TWCR=(1<<TWINT)|(1<<TWSTA)|(1<<TWEN); while(!(TWCR&(1<<TWINT))); }
-void twi_stop(void) { TWCR=(1<<TWINT)|(1<<TWSTO)|(1<<TWEN); }
-void twi_write(unsigned char d) { TWDR=d; TWCR=(1<<TWINT)|(1<<TWEN); while(!(TWCR&(1<<TWINT))); }
-unsigned char twi_read_ack(void) { TWCR=(1<<TWINT)|(1<<TWEN)|(1<<TWEA); while(!(TWCR&(1<<TWINT))); return TWDR; }
-unsigned char twi_read_nack(void) { TWCR=(1<<TWINT)|(1<<TWEN); while(!(TWCR&(1<<TWINT))); return TWDR; }
+// 수신 인터럽트: 한 줄을 모아 cmd_buf 로 넘기고, 해석은 loop() 에서
+char rx_buf[CMD_BUF_SIZE], cmd_buf[CMD_BUF_SIZE];
+unsigned char rx_len = 0;
+volatile char cmd_ready = 0;
+
+interrupt [USART0_RXC] void usart0_rx_isr(void) {
+    char c = UDR0;
+    unsigned char k;
+    link_rx = 1;
+    if (c == '\r' || c == '\n') {
+        if (rx_len > 0 && !cmd_ready) {
+            for (k = 0; k < rx_len; k++) cmd_buf[k] = rx_buf[k];
+            cmd_buf[rx_len] = '\0';
+            cmd_ready = 1;
+        }
+        rx_len = 0;
+    }
+    else if (rx_len < CMD_BUF_SIZE - 1) rx_buf[rx_len++] = c;
+    else rx_len = 0;    // 너무 긴 줄은 버림
+}
+
+// ==========================================
+// [Binary Frame / Waveform Block]
+// 블록 payload: seq, count, stream, zigzag-varint(첫 값), zigzag-varint(차분) x (count-1)
+// 10샘플 블록이 약 25byte -> ASCII 한 줄(약 32byte)로 샘플 1개 보내던 것 대비 1/13
+// ==========================================
+unsigned char crc8(unsigned char crc, unsigned char d) {
+    unsigned char k;
+    crc ^= d;
+    for (k = 0; k < 8; k++) crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    return crc;
+}
+
+void bt_frame(unsigned char type, unsigned char* payload, unsigned char len) {
+    unsigned char k, crc;
+    bt_transmit(FRAME_SYNC); bt_transmit(len + 1); bt_transmit(type);
+    crc = crc8(0, type);
+    for (k = 0; k < len; k++) { bt_transmit(payload[k]); crc = crc8(crc, payload[k]); }
+    bt_transmit(crc);
+}
+
+unsigned char put_varint(unsigned char* b, long v) {
+    // zigzag: 0,-1,1,-2.. -> 0,1,2,3.. (작은 음수도 1byte)
+    unsigned long z = (v < 0) ? (((unsigned long)(-v)) << 1) - 1 : ((unsigned long)v) << 1;
+    unsigned char n = 0;
+    while (z >= 0x80) { b[n++] = (unsigned char)(z & 0x7F) | 0x80; z >>= 7; }
+    b[n++] = (unsigned char)z;
+    return n;
+}
+
+// 파형 데시메이션: 2차 CIC (적분기 2단은 매 샘플, 빗살 2단은 R 샘플마다 1번)
+// 곱셈 없이 덧셈/뺄셈과 시프트만으로 R 배 낮춘 샘플레이트에 맞는 저역 통과를 거침.
+// 그냥 R 번째 샘플만 보내면 미분 파형의 뾰족한 박동(폭 1~2샘플)이 건너뛰어져 사라짐.
+// 이득 R^2 (최대 64) 은 시프트로 되돌림. 적분기는 넘쳐도 되고(2의 보수에서 빗살이 상쇄),
+// 출력 자체는 |x| x 64 < 2^24 라 32비트에 들어감
+unsigned long cic_i1 = 0, cic_i2 = 0, cic_c1 = 0, cic_c2 = 0;
+unsigned char cic_n = 0;
+
+void cic_reset(void) { cic_i1 = cic_i2 = cic_c1 = cic_c2 = 0; cic_n = 0; }
+
+// 출력이 나오면 1 과 *out
+char cic_step(long x, long* out) {
+    unsigned long y, d;
+    cic_i1 += (unsigned long)x;
+    cic_i2 += cic_i1;
+    if (++cic_n < (1 << cfg_wd_shift)) return 0;
+    cic_n = 0;
+    d = cic_i2 - cic_c1; cic_c1 = cic_i2;
+    y = d - cic_c2;      cic_c2 = d;
+    *out = ((long)y) >> (cfg_wd_shift << 1);
+    return 1;
+}
+
+void send_block(void) {
+    unsigned char k, n = 0;
+    frame_buf[n++] = blk_seq++;
+    frame_buf[n++] = blk_n;
+    frame_buf[n++] = cfg_stream;
+    n += put_varint(&frame_buf[n], blk_buf[0]);
+    for (k = 1; k < blk_n; k++) n += put_varint(&frame_buf[n], blk_buf[k] - blk_buf[k - 1]);
+    bt_frame(FRAME_WAVE, frame_buf, n);
+    blk_n = 0;
+}
+
+// payload: seq(LE16, 첫 간격의 번호), n, 간격(LE16, ms | RR_BREAK) x n
+void send_rr(void) {
+    unsigned char k, n = 0;
+    frame_buf[n++] = (unsigned char)rr_seq; frame_buf[n++] = (unsigned char)(rr_seq >> 8);
+    frame_buf[n++] = rr_n;
+    for (k = 0; k < rr_n; k++) { frame_buf[n++] = (unsigned char)rr_buf[k]; frame_buf[n++] = (unsigned char)(rr_buf[k] >> 8); }
+    bt_frame(FRAME_RR, frame_buf, n);
+    rr_seq += rr_n;
+    rr_n = 0;
+}
+
+// 최저점(b)과 양옆 샘플(a, c)로 포물선 꼭짓점 위치 보간, -RR_SUB/2..RR_SUB/2
+long rr_vertex(long a, long b, long c) {
+    long num = a - c, den = 2 * (a - 2 * b + c);
+    while (den > 0x00FFFFFFL || num > 0x00FFFFFFL || num < -0x00FFFFFFL) { num >>= 1; den >>= 1; }
+    return den > 0 ? num * RR_SUB / den : 0;
+}
+
+// 박동 하나 (pos = 박동 시각). 직전 박동과의 간격을 ms 로 버퍼에 넣음
+// 샘플 간격 = 4 / SR (4샘플 평균) = 80ms >> cfg_sr_code
+void rr_beat(unsigned long pos) {
+    unsigned long ms = (pos - rr_last) * (80 >> cfg_sr_code) / RR_SUB;
+    if (rr_have) {
+        if (ms >= RR_MIN_MS && ms <= RR_MAX_MS) {
+            rr_buf[rr_n++] = (unsigned int)ms | (rr_break ? RR_BREAK : 0);
+            rr_break = 0;
+            if (rr_n >= RR_MAX) send_rr();
+        }
+        else rr_break = 1;   // 범위 밖 간격 다음 간격은 이어지지 않음
+    }
+    rr_last = pos; rr_have = 1;
+}
+
+// 통계 패킷: $P,기간ms,샘플,폴링,오버런,busy,(min,avg,max) x PROF_STAGES, 마감 초과 x TASKS
+void prof_report(unsigned long period) {
+    unsigned char k;
+    bt_str("$P,"); bt_long((long)period);
+    bt_transmit(','); bt_long((long)prof_samples);
+    bt_transmit(','); bt_long((long)prof_polls);
+    bt_transmit(','); bt_long((long)prof_ovf);
+    bt_transmit(','); bt_long((long)prof_busy);
+    for (k = 0; k < PROF_STAGES; k++) {
+        bt_transmit(','); bt_long((long)prof[k].min);
+        bt_transmit(','); bt_long(prof[k].cnt ? (long)(prof[k].sum / prof[k].cnt) : 0);
+        bt_transmit(','); bt_long((long)prof[k].max);
+    }
+    for (k = 0; k < TASKS; k++) { bt_transmit(','); bt_long((long)tasks[k].late); tasks[k].late = 0; }
+    bt_transmit('\r'); bt_transmit('\n');
+    prof_rst();
+}
+
+// ==========================================
+// [TWI Driver]
+// 바이트마다 TWINT 를 기다리며 도는 대신 TWI 인터럽트가 트랜잭션을 진행.
+// 트랜잭션 = 주소 + 쓰기 wlen byte + (rlen > 0 이면) 재시작 후 읽기 rlen byte
+// 완료되면 done 이 TWI_OK/TWI_ERR 로 바뀜 (loop() 에서 확인)
+// ==========================================
+typedef struct {
+    unsigned char sla;              // 8bit 주소 (R/W 비트 0)
+    unsigned char *wr, wlen;
+    unsigned char *rd, rlen;
+    volatile unsigned char done;
+} TwiTxn;
+
+TwiTxn *twi_q[TWI_QLEN];
+volatile unsigned char twi_qh = 0, twi_qt = 0;
+unsigned char lcd_q[LCD_QLEN];
+volatile unsigned char lcd_qh = 0, lcd_qt = 0;
+
+TwiTxn *twi_cur = 0;                // 진행 중인 트랜잭션 (0 이면 LCD 스트림)
+volatile char twi_busy = 0;
+unsigned char twi_idx = 0;
+char twi_rd_phase = 0;
+
+// 인터럽트 금지 상태에서 호출. 센서 큐 -> LCD 링 순서로 다음 작업 시작
+void twi_next(void) {
+    if (twi_qt != twi_qh) {
+        twi_cur = twi_q[twi_qt]; twi_qt = (twi_qt + 1) & (TWI_QLEN - 1);
+    }
+    else if (lcd_qt != lcd_qh) twi_cur = 0;
+    else { twi_busy = 0; return; }
+    twi_busy = 1; twi_idx = 0; twi_rd_phase = 0;
+    TWCR = (1<<TWINT)|(1<<TWSTA)|(1<<TWEN)|(1<<TWIE);
+}
+
+void twi_finish(unsigned char result) {
+    if (twi_cur) twi_cur->done = result;
+    TWCR = (1<<TWINT)|(1<<TWSTO)|(1<<TWEN);
+    while (TWCR & (1<<TWSTO));       // STOP 이 나가야 다음 START 가능 (수 us)
+    twi_next();
+}
+
+interrupt [TWI] void twi_isr(void) {
+    unsigned char st = TWSR & 0xF8;
+    TwiTxn *t = twi_cur;
+    switch (st) {
+    case 0x08: case 0x10:           // START / 재시작 -> 주소
+        if (t) TWDR = t->sla | twi_rd_phase; else TWDR = LCD_I2C_ADDR;
+        TWCR = (1<<TWINT)|(1<<TWEN)|(1<<TWIE);
+        break;
+    case 0x18: case 0x28:           // 주소/데이터 쓰기 ACK
+        if (!t) {
+            // LCD: 센서 트랜잭션이 기다리면 바이트 경계에서 양보 (LCD 바이트는 각각 독립된 포트 쓰기)
+            if (lcd_qt == lcd_qh || twi_qt != twi_qh) { twi_finish(TWI_OK); break; }
+            TWDR = lcd_q[lcd_qt]; lcd_qt = (lcd_qt + 1) & (LCD_QLEN - 1);
+            TWCR = (1<<TWINT)|(1<<TWEN)|(1<<TWIE);
+        }
+        else if (twi_idx < t->wlen) { TWDR = t->wr[twi_idx++]; TWCR = (1<<TWINT)|(1<<TWEN)|(1<<TWIE); }
+        else if (t->rlen) { twi_rd_phase = 1; twi_idx = 0; TWCR = (1<<TWINT)|(1<<TWSTA)|(1<<TWEN)|(1<<TWIE); }
+        else twi_finish(TWI_OK);
+        break;
+    case 0x50:                      // 읽기 ACK (뒤에 더 있음)
+        t->rd[twi_idx++] = TWDR;
+        // fall through
+    case 0x40:                      // SLA+R ACK -> 다음 바이트, 마지막은 NACK
+        if (twi_idx + 1 < t->rlen) TWCR = (1<<TWINT)|(1<<TWEN)|(1<<TWIE)|(1<<TWEA);
+        else TWCR = (1<<TWINT)|(1<<TWEN)|(1<<TWIE);
+        break;
+    case 0x58:                      // 마지막 바이트
+        t->rd[twi_idx++] = TWDR;
+        twi_finish(TWI_OK);
+        break;
+    default:                        // NACK, 중재 실패 등
+        twi_finish(TWI_ERR);
+        break;
+    }
+}
+
+void twi_submit(TwiTxn *t) {
+    t->done = TWI_PENDING;
+    while (((twi_qh + 1) & (TWI_QLEN - 1)) == twi_qt) { #asm("nop") }    // 큐가 가득 참
+    #asm("cli")
+    twi_q[twi_qh] = t; twi_qh = (twi_qh + 1) & (TWI_QLEN - 1);
+    if (!twi_busy) twi_next();
+    #asm("sei")
+}
+
+// 초기화/설정 변경용: 끝날 때까지 기다림
+char twi_run(TwiTxn *t) {
+    twi_submit(t);
+    while (t->done == TWI_PENDING) { #asm("nop") }
+    return t->done == TWI_OK;
+}
 
 // DS1302
 void DS1302_init(void) { DS1302_DDR|=(1<<2)|(1<<0); DS1302_PORT&=~((1<<2)|(1<<0)); }
@@ -155,11 +582,19 @@ void get_time(void) {
     rtc_year = bcd_to_dec(DS1302_read(0x8D));  
 }
 
-// LCD
+// LCD (바이트를 링에 넣기만 하고 전송은 TWI 인터럽트가 함. 링이 차면 빌 때까지 대기)
 void lcd_i2c(unsigned char *b, unsigned char l) { 
-    unsigned char i; twi_start(); twi_write(LCD_I2C_ADDR); 
-    for(i=0;i<l;i++) twi_write(b[i]); twi_stop(); 
+    unsigned char i;
+    for(i=0;i<l;i++) {
+        while (((lcd_qh + 1) & (LCD_QLEN - 1)) == lcd_qt) { #asm("nop") }
+        lcd_q[lcd_qh] = b[i]; lcd_qh = (lcd_qh + 1) & (LCD_QLEN - 1);
+    }
+    #asm("cli")
+    if (!twi_busy) twi_next();
+    #asm("sei")
 }
+// 초기화 중 delay 는 실제로 보낸 뒤부터 재야 하므로 링이 빌 때까지 기다림
+void lcd_flush(void) { while (lcd_qt != lcd_qh || twi_busy) { #asm("nop") } }
 void lcd_half_cmd(unsigned char c) {
     unsigned char b[2]; b[0] = (c & 0xF0) | LCD_EN | LCD_BL; b[1] = (c & 0xF0) | LCD_BL; lcd_i2c(b, 2);
 }
@@ -180,16 +615,22 @@ void lcd_str(char *s) { while(*s) lcd_data(*s++); }
 void lcd_long(long v) { long_to_str(v); lcd_str(g_buf); }
 
 void lcd_init(void) {
-    delay_ms(50); lcd_half_cmd(0x30); delay_ms(5); lcd_half_cmd(0x30); delay_ms(1); 
-    lcd_half_cmd(0x30); delay_ms(1); lcd_half_cmd(0x20); delay_ms(1); 
-    lcd_cmd(0x28); lcd_cmd(0x0C); lcd_cmd(0x06); lcd_cmd(0x01); delay_ms(2);   
+    delay_ms(50); lcd_half_cmd(0x30); lcd_flush(); delay_ms(5); lcd_half_cmd(0x30); lcd_flush(); delay_ms(1); 
+    lcd_half_cmd(0x30); lcd_flush(); delay_ms(1); lcd_half_cmd(0x20); lcd_flush(); delay_ms(1); 
+    lcd_cmd(0x28); lcd_cmd(0x0C); lcd_cmd(0x06); lcd_cmd(0x01); lcd_flush(); delay_ms(2);   
 }
 
 // MAX30102
-void max_wr(unsigned char r, unsigned char v) { twi_start(); twi_write(MAX30102_ADDR); twi_write(r); twi_write(v); twi_stop(); }
+void max_wr(unsigned char r, unsigned char v) {
+    unsigned char b[2]; TwiTxn t;
+    b[0] = r; b[1] = v;
+    t.sla = MAX30102_ADDR; t.wr = b; t.wlen = 2; t.rlen = 0;
+    twi_run(&t);
+}
 unsigned char max_rd(unsigned char r) {
-    unsigned char v; twi_start(); twi_write(MAX30102_ADDR); twi_write(r);
-    twi_start(); twi_write(MAX30102_ADDR|1); v=twi_read_nack(); twi_stop(); return v;
+    unsigned char v = 0; TwiTxn t;
+    t.sla = MAX30102_ADDR; t.wr = &r; t.wlen = 1; t.rd = &v; t.rlen = 1;
+    twi_run(&t); return v;
 }
 
 // ==========================================
@@ -253,26 +694,316 @@ Stat stat_r, stat_i;
 long last_beat=0, f_time=0, last_deriv=0, c_time=0;
 char f_det=0, crossed=0;
 
+// ==========================================
+// [Signal Quality]
+// 관류 지수(AC p-p / DC), ADC 포화, 미분 에너지(|deriv| 합)의 급변으로 구간 품질 판정
+// 샘플당 비교 몇 번과 덧셈 하나, 나눗셈은 구간당 한 번
+// ==========================================
+long sqi_min, sqi_max;
+unsigned long sqi_energy = 0, sqi_ref = 0;   // 현재 구간 / 평소 미분 에너지
+unsigned char sqi_n = 0, sqi_acc = 0, sqi_bad_run = 0;
+unsigned char sqi_flags = SQI_WARMUP;        // 현재 적용 중인 판정 (텔레메트리로 전송)
+unsigned char sqi_prev = SQI_WARMUP;
+long good_bpm = 0, good_spo2 = 0;            // 마지막 정상 구간 끝의 출력값
+
+void sqi_reset(void) {
+    sqi_n = 0; sqi_acc = 0; sqi_energy = 0; sqi_ref = 0; sqi_bad_run = 0;
+    sqi_flags = SQI_WARMUP;
+}
+
+void sqi_update(unsigned long raw, long dc, long ac, long deriv) {
+    long pi;
+    if (raw >= SQI_CLIP) { sqi_acc |= SQI_CLIPPED; sqi_flags |= SQI_CLIPPED; }   // 포화는 즉시 반영
+    if (sqi_n == 0 || ac < sqi_min) sqi_min = ac;
+    if (sqi_n == 0 || ac > sqi_max) sqi_max = ac;
+    sqi_energy += (deriv < 0) ? -deriv : deriv;
+    ++sqi_n;
+    // 움직임은 구간 끝까지 기다리지 않고 반영 (에너지 평균 비교: energy/n > ref/WINDOW * X)
+    if (sqi_ref && sqi_n >= SQI_EARLY_N && sqi_energy * SQI_WINDOW > sqi_ref * SQI_MOTION_X * sqi_n) {
+        sqi_acc |= SQI_MOTION; sqi_flags |= SQI_MOTION;
+    }
+    if (sqi_n < SQI_WINDOW) return;
+
+    // 관류 지수 (0.01% 단위). 오버플로를 피하려고 DC 를 먼저 100 으로 나눔
+    pi = (dc >= 100) ? (sqi_max - sqi_min) * 100 / (dc / 100) : 0;
+    if (pi < SQI_PI_MIN) sqi_acc |= SQI_LOW_PI;
+    else if (pi > SQI_PI_MAX) sqi_acc |= SQI_HIGH_PI;
+
+    // 기준 에너지는 좋은 구간으로만 갱신: 내려갈 때는 빠르게(움직임 중에 잡힌 높은 기준을 금방 버림),
+    // 올라갈 때는 천천히. 불량이 오래 지속되면 (LED 전류 변경 등) 새 수준을 수용
+    if (!sqi_ref || (sqi_acc && ++sqi_bad_run >= SQI_REBASE)) { sqi_ref = sqi_energy; sqi_bad_run = 0; }
+    else if (!sqi_acc) {
+        if (sqi_energy < sqi_ref) sqi_ref = (sqi_ref + sqi_energy) / 2;
+        else sqi_ref += (sqi_energy - sqi_ref) / 4;
+        sqi_bad_run = 0;
+    }
+
+    sqi_flags = sqi_acc;
+    sqi_n = 0; sqi_acc = 0; sqi_energy = 0;
+}
+
+// ==========================================
+// [Store-and-Forward]
+// 기록: sample_no(LE 4byte), BPM, SpO2
+// 시각은 실시간 줄과 같은 샘플 카운터로 남김 (끊긴 동안에도 계속 셈). 앱이 같은 시계 추정으로
+// 변환하므로 실시간 기록과 한 시간축에 놓임. RTC 는 설정되지 않았을 수 있어 쓰지 않음
+// 백필 프레임 payload: seq, 남은 기록 수(LE 2byte, 이 배치 제외), n, 기록 x n (오래된 것부터)
+// ==========================================
+void hist_push(void) {
+    unsigned long t = sample_no;
+    unsigned int a = hist_head * HIST_REC;
+    unsigned char k;
+    for (k = 0; k < 4; k++) { hist_ee[a + k] = (unsigned char)t; t >>= 8; }  // EEPROM 쓰기 (바이트당 ~8.5ms)
+    hist_ee[a + 4] = (unsigned char)(current_bpm > 255 ? 255 : current_bpm);
+    hist_ee[a + 5] = (unsigned char)current_spo2;
+    if (++hist_head >= HIST_CAP) hist_head = 0;
+    if (hist_count < HIST_CAP) hist_count++;    // 가득 차면 가장 오래된 기록을 덮어씀
+}
+
+void send_backfill(void) {
+    unsigned int i, a, left;
+    unsigned char k, n = 0, len = 4;
+    i = (hist_head + HIST_CAP - hist_count) % HIST_CAP;    // 가장 오래된 기록
+    n = (hist_count > HIST_BATCH) ? HIST_BATCH : (unsigned char)hist_count;
+    left = hist_count - n;
+    frame_buf[0] = bf_seq;
+    frame_buf[1] = (unsigned char)left; frame_buf[2] = (unsigned char)(left >> 8);
+    frame_buf[3] = n;
+    for (k = 0; k < n; k++) {
+        for (a = i * HIST_REC; a < (i + 1) * HIST_REC; a++) frame_buf[len++] = hist_ee[a];
+        if (++i >= HIST_CAP) i = 0;
+    }
+    bt_frame(FRAME_HIST, frame_buf, len);
+    hist_inflight = n;
+}
+
+// 링크 상태 갱신 + 끊긴 동안 기록 + 연결 중이면 백필 (실시간 데이터보다 후순위, 간격 제한)
+void link_service(unsigned long now) {
+    unsigned int t0;
+    if (link_rx) { link_rx = 0; link_ms = now; link_up = 1; }
+    else if (link_up && now - link_ms >= LINK_TIMEOUT_MS) { link_up = 0; hist_inflight = 0; }
+
+    if (!link_up) {
+        if (current_bpm && current_spo2 && !sqi_flags && now - hist_last >= HIST_PERIOD_MS) { hist_push(); hist_last = now; }
+        return;
+    }
+    if (hist_inflight && now - bf_last >= BACKFILL_RETRY_MS) hist_inflight = 0;    // 확인 없음 -> 재전송
+    if (hist_count && !hist_inflight && now - bf_last >= BACKFILL_GAP_MS) {
+        t0 = prof_now();
+        send_backfill();
+        prof_end(PROF_UART, t0);
+        bf_last = now;
+    }
+}
+
+// ==========================================
+// [Measurement Session]
+// 이벤트는 드물고 짧으므로(약 15byte) 감지한 자리에서 바로 전송.
+// 링크가 끊긴 동안 보낸 이벤트는 사라지므로 #GET 응답 뒤에 현재 상태를 다시 보냄
+// ==========================================
+void send_session(char type, unsigned long at) {
+    bt_transmit('$'); bt_transmit(type); bt_transmit(',');
+    bt_long((long)sess_id); bt_transmit(',');
+    bt_long((long)at); bt_transmit('\r'); bt_transmit('\n');
+}
+
+void session_state(void) {
+    if (sess_open) send_session('S', sess_start);
+    else if (sess_id) send_session('E', sess_off);
+}
+
+// ==========================================
+// [Command Channel]
+// #SR=50|100|200|400, #LED=r,ir, #DEC=1~100 (x40ms), #STR=R|F|D, #BLK=0|4~32,
+// #WD=1|2|4|8 (파형 블록 데시메이션), #GET
+// #HB[=seq] 는 하트비트/백필 확인 (응답 없음)
+// 응답: $A,KEY,OK|ERR 후 성공 시 현재 설정 $C,sr,led_r,led_ir,dec,stream,blk,wd
+// (#GET 은 이어서 현재 측정 세션 상태 $S 또는 $E)
+// (필터 계수는 SR=100Hz 기준이므로 SR 변경 시 차단 주파수도 같이 이동함)
+// ==========================================
+long parse_num(char** p) {
+    long v = 0;
+    while (**p >= '0' && **p <= '9') { v = v * 10 + (**p - '0'); (*p)++; }
+    return v;
+}
+
+void send_config(void) {
+    bt_str("$C,"); bt_long(50L << cfg_sr_code);
+    bt_transmit(','); bt_long(cfg_led_r);
+    bt_transmit(','); bt_long(cfg_led_ir);
+    bt_transmit(','); bt_long(cfg_decim);
+    bt_transmit(','); bt_transmit(cfg_stream);
+    bt_transmit(','); bt_long(cfg_block);
+    bt_transmit(','); bt_long(1 << cfg_wd_shift);
+    bt_transmit('\r'); bt_transmit('\n');
+}
+
+void apply_sensor_config(void) {
+    max_wr(REG_SPO2_CONFIG, 0x23 | (cfg_sr_code << 2)); // ADC 4096nA, PW 411us
+    max_wr(REG_LED1_PA, cfg_led_r); max_wr(REG_LED2_PA, cfg_led_ir);
+}
+
+void handle_command(void) {
+    char line[CMD_BUF_SIZE];
+    char *p = line, *key;
+    char ok = 0, hw = 0;    // hw: 센서 레지스터 재설정 필요
+    long v, v2;
+    unsigned char k;
+
+    // 응답 전송 중에도 다음 명령을 받을 수 있도록 먼저 복사 후 슬롯 해제
+    for (k = 0; k < CMD_BUF_SIZE; k++) line[k] = cmd_buf[k];
+    cmd_ready = 0;
+
+    if (*p++ != '#') return;
+    key = p;
+    while (*p && *p != '=') p++;
+    if (*p == '=') *p++ = '\0';
+
+    // 하트비트는 응답 없음. "#HB=seq" 는 백필 프레임 seq 수신 확인
+    if (key[0] == 'H' && key[1] == 'B' && !key[2]) {
+        if (*p && hist_inflight && (unsigned char)parse_num(&p) == bf_seq) {
+            hist_count -= hist_inflight; hist_inflight = 0; bf_seq++;
+        }
+        return;
+    }
+
+    if (key[0] == 'S' && key[1] == 'R' && !key[2]) {
+        v = parse_num(&p);
+        for (k = 0; k < 4; k++) if (v == (50L << k)) { cfg_sr_code = k; ok = 1; hw = 1; }
+        if (ok) { rr_have = 0; rr_track = 0; rr_break = 1; }   // 샘플 간격이 바뀜
+    }
+    else if (key[0] == 'L' && key[1] == 'E' && key[2] == 'D' && !key[3]) {
+        v = parse_num(&p);
+        if (*p == ',') { p++; v2 = parse_num(&p); } else v2 = v;
+        if (v <= 255 && v2 <= 255) { cfg_led_r = (unsigned char)v; cfg_led_ir = (unsigned char)v2; ok = 1; hw = 1; }
+    }
+    else if (key[0] == 'D' && key[1] == 'E' && key[2] == 'C' && !key[3]) {
+        v = parse_num(&p);
+        if (v >= 1 && v <= 100) {
+            cfg_decim = (unsigned char)v; ok = 1;
+            tasks[TASK_TELEM].period = cfg_decim * TELEM_UNIT_MS; tasks[TASK_TELEM].next = millis();
+        }
+    }
+    else if (key[0] == 'S' && key[1] == 'T' && key[2] == 'R' && !key[3]) {
+        if (*p == STREAM_RAW || *p == STREAM_FILT || *p == STREAM_DERIV) { cfg_stream = *p; blk_n = 0; cic_reset(); ok = 1; }
+    }
+    else if (key[0] == 'B' && key[1] == 'L' && key[2] == 'K' && !key[3]) {
+        v = parse_num(&p);
+        if (v == 0 || (v >= 4 && v <= BLOCK_MAX)) { cfg_block = (unsigned char)v; blk_n = 0; ok = 1; }
+    }
+    else if (key[0] == 'W' && key[1] == 'D' && !key[2]) {
+        v = parse_num(&p);
+        for (k = 0; k <= WD_MAX_SHIFT; k++) if (v == (1L << k)) { cfg_wd_shift = k; blk_n = 0; cic_reset(); ok = 1; }
+    }
+    else if (key[0] == 'G' && key[1] == 'E' && key[2] == 'T' && !key[3]) ok = 1;
+
+    if (hw) apply_sensor_config();
+    bt_str("$A,"); bt_str(key);
+    if (ok) bt_str(",OK"); else bt_str(",ERR");
+    bt_transmit('\r'); bt_transmit('\n');
+    if (ok) send_config();
+    if (ok && key[0] == 'G') session_state();
+}
+
+// 센서 FIFO 비동기 읽기: 포인터 3byte 읽기 -> 쌓인 샘플(최대 FIFO_BATCH개)을 한 번에 읽기
+// 버퍼 두 개를 번갈아 써서, 한 묶음을 필터/검출하는 동안 버스는 다음 묶음을 가져옴
+unsigned char fifo_buf[2][FIFO_BATCH * 6];
+unsigned char fifo_cnt[2] = {0, 0}, fifo_cur = 0, fifo_pos = 0;
+unsigned char fifo_ptrs[3], fifo_state = 0, fifo_fill = 0;
+unsigned char reg_fifo_ptr = REG_FIFO_WR_PTR, reg_fifo_data = REG_FIFO_DATA;
+TwiTxn txn_ptr, txn_fifo;
+// 포인터를 읽어야 할 때 1: 센서 INT(새 샘플), 방금 읽은 뒤 재확인
+volatile char fifo_poll = 1;
+unsigned long fifo_last = 0;
+
+// MAX30102 는 새 샘플마다 INT 를 내림 (PPG_RDY). FIFO 를 읽으면 다시 올라가므로
+// 마지막으로 읽은 뒤 들어온 샘플은 반드시 하강 엣지를 만듦
+interrupt [EXT_INT4] void sensor_int_isr(void) { fifo_poll = 1; }
+
+void fifo_service(void) {
+    unsigned char n;
+    unsigned long now;
+    if (fifo_state == 0) {
+        if (fifo_cnt[fifo_cur ^ 1]) return;    // 채울 버퍼가 아직 처리 전
+        now = millis();
+        if (!fifo_poll && now - fifo_last < SENSOR_POLL_MS) return;
+        fifo_poll = 0; fifo_last = now;
+        // WR_PTR, OVF_COUNTER, RD_PTR 는 연속 주소라 한 번의 burst 로 읽음
+        txn_ptr.sla = MAX30102_ADDR; txn_ptr.wr = &reg_fifo_ptr; txn_ptr.wlen = 1;
+        txn_ptr.rd = fifo_ptrs; txn_ptr.rlen = 3;
+        twi_submit(&txn_ptr); fifo_state = 1;
+    }
+    else if (fifo_state == 1 && txn_ptr.done != TWI_PENDING) {
+        fifo_state = 0;
+        if (txn_ptr.done != TWI_OK) return;
+        n = (fifo_ptrs[0] - fifo_ptrs[2]) & 0x1F;
+        if (n == 0 && fifo_ptrs[1]) n = 32;    // 가득 차서 포인터가 같아진 경우
+        if (n == 0) { prof_polls++; return; }
+        prof_ovf += fifo_ptrs[1] & 0x1F;
+        if (n > FIFO_BATCH) n = FIFO_BATCH;
+        fifo_fill = fifo_cur ^ 1;
+        txn_fifo.sla = MAX30102_ADDR; txn_fifo.wr = &reg_fifo_data; txn_fifo.wlen = 1;
+        txn_fifo.rd = fifo_buf[fifo_fill]; txn_fifo.rlen = n * 6;
+        twi_submit(&txn_fifo); fifo_state = 2;
+    }
+    else if (fifo_state == 2 && txn_fifo.done != TWI_PENDING) {
+        if (txn_fifo.done == TWI_OK) fifo_cnt[fifo_fill] = txn_fifo.rlen / 6;
+        fifo_state = 0;
+        // 포인터를 읽은 뒤 ~ 데이터를 읽기 전에 들어온 샘플은 엣지 없이 FIFO 에 남으므로 한 번 더 확인
+        fifo_poll = 1;
+    }
+}
+
+// 할 일이 없으면 idle 모드로 잠. 깨우는 것: Timer0(1ms), UART 수신, TWI 완료, 센서 INT
+// (SEI 다음 명령은 인터럽트보다 먼저 실행되므로 검사~SLEEP 사이에 들어온 인터럽트도 SLEEP 을 깨움)
+void idle_sleep(void) {
+    #asm("cli")
+    if (!cmd_ready && !fifo_poll && fifo_pos >= fifo_cnt[fifo_cur] && !fifo_cnt[fifo_cur ^ 1] &&
+        !(fifo_state == 1 && txn_ptr.done != TWI_PENDING) &&
+        !(fifo_state == 2 && txn_fifo.done != TWI_PENDING)) {
+        MCUCR |= (1 << SE);
+        #asm("sei")
+        #asm("sleep")
+        MCUCR &= ~(1 << SE);
+    }
+    #asm("sei")
+}
+
 char read_sample(unsigned long *r, unsigned long *i) {
-    unsigned char w=max_rd(REG_FIFO_WR_PTR), rd=max_rd(REG_FIFO_RD_PTR), b[6], k;
-    if(w==rd) return 0;
-    twi_start(); twi_write(MAX30102_ADDR); twi_write(REG_FIFO_DATA); twi_start(); twi_write(MAX30102_ADDR|1);
-    for(k=0;k<5;k++) b[k]=twi_read_ack(); b[5]=twi_read_nack(); twi_stop();
+    unsigned char *b;
+    fifo_service();
+    if (fifo_pos >= fifo_cnt[fifo_cur]) {
+        fifo_cnt[fifo_cur] = 0; fifo_pos = 0;
+        if (!fifo_cnt[fifo_cur ^ 1]) return 0;
+        fifo_cur ^= 1;
+        fifo_service();    // 방금 비운 버퍼로 다음 묶음을 바로 요청
+    }
+    b = &fifo_buf[fifo_cur][fifo_pos * 6]; fifo_pos++;
     *r=((unsigned long)b[0]<<16|b[1]<<8|b[2])&0x03FFFF; *i=((unsigned long)b[3]<<16|b[4]<<8|b[5])&0x03FFFF;
     return 1;
 }
 
-void loop(void) {
-    unsigned long raw_r, raw_i;
+long last_wave = 0;    // 블록을 끈 경우 실시간 줄로 보낼 파형 값
+// 실시간 줄 사이(기본 1초)의 파형 중 절댓값이 가장 큰 값 (피크 홀드).
+// 줄 주기로 한 점만 보내면 박동이 대부분 빠지므로, 구간마다 가장 두드러진 점을 보냄
+long wave_peak = 0, wave_peak_mag = -1;   // -1 = 구간에 샘플 없음
+
+// 샘플 하나: 필터 -> 품질/검출 -> 파형 블록
+void process_sample(unsigned long raw_r, unsigned long raw_i) {
     long val_r, val_i, ac_r, ac_i;
     
     // [선언부] 블록 최상단 배치
     long deriv_out; // 2차 미분 결과값
+    long wave;      // 텔레메트리로 보낼 파형 (cfg_stream)
+    long dec, mag;  // 데시메이션 출력, 피크 홀드용 절댓값
     long bpm, ar, ai, rat, rat_i, bpm_sum; 
     unsigned char k;
+    unsigned int t0;
 
-    if(!read_sample(&raw_r, &raw_i)) return;
+    prof_samples++;
+    sample_no++;
 
+    t0 = prof_now();
     // 1. [LPF 3Hz]
     val_r = lpf_3hz(&lpf_r, (long)raw_r); 
     val_i = lpf_3hz(&lpf_i, (long)raw_i);
@@ -284,11 +1015,18 @@ void loop(void) {
     // 3. [2nd Derivative] 피크 강화 필터 적용
     // ac_r 신호를 입력으로 받아 날카로운 엣지 신호 생성
     deriv_out = process_2nd_derivative(&deriv_r, ac_r);
+    prof_end(PROF_FILTER, t0);
     
+    t0 = prof_now();
     if(raw_r > FINGER_THRESHOLD) { 
-        if((millis()-f_time)>FINGER_COOLDOWN_MS) f_det=1; 
+        if(!f_det && (millis()-f_time)>FINGER_COOLDOWN_MS) {
+            f_det=1;
+            if(!sess_open) { sess_open=1; sess_id++; sess_start=sample_no; send_session('S', sess_start); }
+        }
     }
     else { 
+        if(f_det) { sess_off=sample_no; sess_off_ms=millis(); }   // 세션 끝 후보
+        if(sess_open && !f_det && millis()-sess_off_ms >= SESS_END_MS) { sess_open=0; send_session('E', sess_off); }
         // [RESET] 손가락 뗐을 때 모든 필터 초기화
         lpf_r.init=0; lpf_i.init=0; 
         hpf_r.init=0; hpf_i.init=0;
@@ -298,11 +1036,38 @@ void loop(void) {
         f_det=0; f_time=millis(); 
         current_bpm=0; current_spo2=0;
         bpm_idx = 0; bpm_cnt = 0; 
+        rr_have = 0; rr_track = 0; rr_break = 1;
+        sqi_reset();
     }
 
     if(f_det) {
+        sqi_prev = sqi_flags;
+        sqi_update(raw_r, val_r, ac_r, deriv_out);
+        if(!sqi_flags && sqi_n == 0) { good_bpm = current_bpm; good_spo2 = current_spo2; }
+    }
+
+    if(f_det && sqi_flags) {
+        // 품질 불량 구간: 검출과 SpO2 통계는 건너뜀. 회복 후 첫 박동 간격이
+        // 불량 구간을 가로질러 계산되지 않도록 이전 박동 시각도 버림
+        if(!sqi_prev) {
+            // 판정 직전(최대 1구간)에 섞여 들어간 박동은 버리고 마지막 정상 구간 값으로 복귀
+            current_bpm = good_bpm; current_spo2 = good_spo2;
+            bpm_idx = 0; bpm_cnt = 0;
+        }
+        stat_rst(&stat_r); stat_rst(&stat_i);
+        crossed = 0; last_beat = 0; last_deriv = deriv_out;
+        rr_have = 0; rr_track = 0; rr_break = 1;
+    }
+    else if(f_det) {
         stat_add(&stat_r, ac_r); // SpO2 계산용 (진폭)
         stat_add(&stat_i, ac_i);
+
+        // 박동 시각 (HRV 용): 영점 교차는 완만한 꼬리에서 일어나 박동마다 수 샘플씩
+        // 흔들리므로, 확정된 박동의 하강 엣지 최저점(가장 가파른 지점)을 끝까지 따라가 보간
+        if(rr_track) {
+            if(deriv_out < rr_min) { rr_before = last_deriv; rr_min = deriv_out; rr_at = sample_no; }
+            else { rr_beat(rr_at * RR_SUB + rr_vertex(rr_before, rr_min, deriv_out)); rr_track = 0; }
+        }
         
         // [Detection Logic]
         // 이제 'deriv_out' (2차 미분값)을 사용하여 Zero Crossing 감지
@@ -350,46 +1115,111 @@ void loop(void) {
             }
             crossed = 0; 
             last_beat = c_time; 
+            rr_track = 1; rr_before = last_deriv; rr_min = deriv_out; rr_at = sample_no;
         }
         last_deriv = deriv_out; // 다음 비교를 위해 현재 값 저장
     }
+    prof_end(PROF_DETECT, t0);
 
-    print_counter++;
-    // SR=100Hz 이므로 5번마다 전송해야 초당 20회 전송됨
-    if(print_counter >= 5) { 
-        get_time();
-        
-        // Bluetooth Output
-        bt_str("20"); bt_2digits(rtc_year); bt_transmit('-');
-        bt_2digits(rtc_month); bt_transmit('-');
-        bt_2digits(rtc_day); bt_transmit(' ');
-        bt_2digits(rtc_hour); bt_transmit(':');
-        bt_2digits(rtc_min); bt_transmit(':');
-        bt_2digits(rtc_sec); bt_transmit(',');
-        
-        // [중요] 그래프 확인을 위해 미분된 파형(deriv_out)을 전송
-        // 이 값이 0을 기준으로 위아래로 뾰족하게 튀는지 확인하세요.
-        bt_long(deriv_out); bt_transmit(','); 
-        
-        bt_long(current_spo2); bt_transmit(',');
-        bt_long(current_bpm); bt_transmit('\r'); bt_transmit('\n');
-
-        // LCD Output
-        lcd_gotoxy(0,0); lcd_str("B:"); lcd_long(current_bpm); lcd_str("  "); 
-        lcd_str("S:"); lcd_long(current_spo2); lcd_str("%  ");
-        lcd_gotoxy(0,1); 
-        if(rtc_hour<10) lcd_str("0"); lcd_long(rtc_hour); lcd_str(":");
-        if(rtc_min<10) lcd_str("0"); lcd_long(rtc_min); lcd_str(":");
-        if(rtc_sec<10) lcd_str("0"); lcd_long(rtc_sec); lcd_str("    ");
-        
-        print_counter = 0;
+    // 그래프용 파형: 기본은 미분된 파형(deriv_out)
+    if(cfg_stream == STREAM_RAW) wave = (long)raw_r;
+    else if(cfg_stream == STREAM_FILT) wave = ac_r;
+    else wave = deriv_out;
+
+    if(cfg_wd_shift == 0) dec = wave;
+    if(cfg_block && (cfg_wd_shift == 0 || cic_step(wave, &dec))) {
+        blk_buf[blk_n++] = dec;
+        if(blk_n >= cfg_block) {
+            t0 = prof_now();
+            send_block();
+            prof_end(PROF_UART, t0);
+        }
+    }
+
+    mag = wave < 0 ? -wave : wave;
+    if(mag > wave_peak_mag) { wave_peak = wave; wave_peak_mag = mag; }
+}
+
+// --- 주기 작업 ---
+void task_link(unsigned long now) { link_service(now); }
+
+void task_rtc(unsigned long now) {
+    unsigned int t0 = prof_now();
+    get_time();
+    prof_end(PROF_RTC, t0);
+}
+
+// 기본값: #DEC=25 -> 1초마다 (샘플레이트와 무관)
+void task_telem(unsigned long now) {
+    unsigned int t0 = prof_now();
+    // Bluetooth Output (시각은 task_rtc 가 읽어 둔 값)
+    bt_str("20"); bt_2digits(rtc_year); bt_transmit('-');
+    bt_2digits(rtc_month); bt_transmit('-');
+    bt_2digits(rtc_day); bt_transmit(' ');
+    bt_2digits(rtc_hour); bt_transmit(':');
+    bt_2digits(rtc_min); bt_transmit(':');
+    bt_2digits(rtc_sec); bt_transmit(',');
+    
+    // [중요] 블록을 끈 경우(#BLK=0) 그래프는 이 값으로 그려짐
+    // 이 값이 0을 기준으로 위아래로 뾰족하게 튀는지 확인하세요.
+    if (wave_peak_mag >= 0) { last_wave = wave_peak; wave_peak_mag = -1; }
+    bt_long(last_wave); bt_transmit(','); 
+    
+    bt_long(current_spo2); bt_transmit(',');
+    bt_long(current_bpm); bt_transmit(',');
+    bt_long(sqi_flags); bt_transmit(',');
+    bt_long((long)sample_no); bt_transmit('\r'); bt_transmit('\n');
+    if (rr_n) send_rr();    // 그 사이 검출된 박동 간격
+    prof_end(PROF_UART, t0);
+}
+
+void task_lcd(unsigned long now) {
+    unsigned int t0 = prof_now();
+    // LCD Output
+    lcd_gotoxy(0,0); lcd_str("B:"); lcd_long(current_bpm); lcd_str("  "); 
+    lcd_str("S:"); lcd_long(current_spo2); lcd_str("%  ");
+    lcd_gotoxy(0,1); 
+    if(rtc_hour<10) lcd_str("0"); lcd_long(rtc_hour); lcd_str(":");
+    if(rtc_min<10) lcd_str("0"); lcd_long(rtc_min); lcd_str(":");
+    if(rtc_sec<10) lcd_str("0"); lcd_long(rtc_sec); lcd_str("    ");
+    prof_end(PROF_LCD, t0);
+}
+
+void task_stats(unsigned long now) {
+    prof_report(now - prof_last);
+    prof_last = now;
+}
+
+void sched_init(unsigned long now) {
+    task_init(TASK_LINK,  task_link,  50,                           50,  now);
+    task_init(TASK_TELEM, task_telem, cfg_decim * TELEM_UNIT_MS,    100, now);
+    task_init(TASK_RTC,   task_rtc,   1000,                         200, now);
+    task_init(TASK_LCD,   task_lcd,   1000,                         500, now);
+    task_init(TASK_STATS, task_stats, PROF_PERIOD_MS,               500, now);
+}
+
+void loop(void) {
+    unsigned long raw_r, raw_i;
+    unsigned char k;
+    unsigned int t0;
+
+    if(cmd_ready) handle_command();
+
+    // 쌓인 샘플을 먼저 (한 번에 최대 FIFO_BATCH 개) 처리한 뒤 주기 작업 하나
+    for (k = 0; k < FIFO_BATCH; k++) {
+        t0 = prof_now();
+        if(!read_sample(&raw_r, &raw_i)) break;    // 빈 폴링은 fifo_service() 가 셈
+        prof_end(PROF_READ, t0);
+        process_sample(raw_r, raw_i);
     }
+    sched_run(millis());
 }
 
 void main(void) {
     millis_init();
+    prof_init();
     bt_init(); 
-    TWSR=0x00; TWBR=72; TWCR=(1<<TWEN); 
+    TWSR=0x00; TWBR=72; TWCR=(1<<TWEN)|(1<<TWIE); 
     DS1302_init();
     lcd_init(); 
     lcd_gotoxy(0,0); lcd_str("Filter: 2nd Deriv");
@@ -398,10 +1228,18 @@ void main(void) {
     max_wr(0x09, 0x40); delay_ms(100); 
     max_wr(0x08, 0x50); 
     max_wr(0x09, 0x03); 
-    max_wr(0x0A, 0x27); // SR = 100Hz
-    max_wr(0x0C, 0x1F); max_wr(0x0D, 0x1F); 
-    max_wr(0x04, 0x00); max_wr(0x05, 0x00); max_wr(0x06, 0x00);
+    apply_sensor_config(); // SR = 100Hz, LED 0x1F (기본값)
     
     delay_ms(1000); lcd_cmd(0x01);
-    while (1) { loop(); }
+    // 새 샘플 인터럽트 (INT -> PE4, 하강 엣지). 핀은 open-drain 이라 내부 풀업 사용
+    DDRE &= ~(1 << INT4_BIT); PORTE |= (1 << INT4_BIT);
+    EICRB |= (1 << ISC41); EIMSK |= (1 << INT4_BIT);
+    max_wr(REG_INT_ENABLE1, PPG_RDY_EN);
+    max_rd(REG_INT_STATUS1);    // 전원 인가 플래그 등 정리
+
+    // 대기 중에 쌓인(넘친) 샘플은 버리고 루프 시작 직전에 FIFO 초기화
+    max_wr(0x04, 0x00); max_wr(0x05, 0x00); max_wr(0x06, 0x00);
+    prof_rst(); prof_last = millis();
+    sched_init(prof_last);
+    while (1) { loop(); idle_sleep(); }
 }
\ No newline at end of file
@@ -0,0 +1,344 @@
+import 'dart:typed_data';
+
+// 기록 인덱스 집합 (roaring 방식 압축 비트맵)
+// 인덱스의 상위 16비트마다 컨테이너 하나: 값이 4096개 이하면 하위 16비트의 정렬 배열(값당 2바이트),
+// 넘으면 65536비트 비트맵(8KB). 경고 기록은 대부분 드물게 흩어져 있으므로 배열,
+// 긴 저산소 구간처럼 몰려 있으면 비트맵이 됨.
+// 기록은 끝에 덧붙으므로 추가는 마지막 컨테이너에만 (O(1)).
+// 앞 컨테이너들의 누적 개수를 두어 rank(구간 개수)/select(k번째 값)는 이진 탐색 + 컨테이너 하나.
+class AlertBitmap {
+  static const int CONTAINER_BITS = 16;
+  static const int ARRAY_MAX = 4096;
+
+  final List<int> _keys = [];
+  final List<_Container> _containers = [];
+  final List<int> _before = []; // 앞 컨테이너들의 값 개수 합
+  int _cardinality = 0;
+
+  int get cardinality => _cardinality;
+  bool get isEmpty => _cardinality == 0;
+  int get last => _keys.isEmpty ? -1 : (_keys.last << CONTAINER_BITS) | _containers.last.last;
+
+  void clear() {
+    _keys.clear();
+    _containers.clear();
+    _before.clear();
+    _cardinality = 0;
+  }
+
+  // 지금까지의 어떤 값보다 큰 값만 (기록 추가 순서)
+  void add(int value) {
+    assert(value > last);
+    final key = value >> CONTAINER_BITS;
+    if (_keys.isEmpty || _keys.last != key) {
+      _keys.add(key);
+      _containers.add(_ArrayContainer());
+      _before.add(_cardinality);
+    }
+    _containers.last = _containers.last.add(value & 0xFFFF);
+    _cardinality++;
+  }
+
+  // value 이상인 값을 모두 지움 (과거 기록이 끼워져 인덱스가 밀릴 때)
+  void truncate(int value) {
+    if (value <= 0) {
+      clear();
+      return;
+    }
+    final key = value >> CONTAINER_BITS;
+    int k = _lowerKey(key);
+    if (k < _keys.length && _keys[k] == key) {
+      final c = _containers[k].truncate(value & 0xFFFF);
+      if (c != null) {
+        _containers[k] = c;
+        k++;
+      }
+    }
+    _keys.length = k;
+    _containers.length = k;
+    _before.length = k;
+    _cardinality = k == 0 ? 0 : _before[k - 1] + _containers[k - 1].cardinality;
+  }
+
+  bool contains(int value) {
+    final k = _findKey(value >> CONTAINER_BITS);
+    return k >= 0 && _containers[k].contains(value & 0xFFFF);
+  }
+
+  // value 보다 작은 값의 개수. [a, b) 구간의 개수 = rank(b) - rank(a)
+  int rank(int value) {
+    if (value <= 0) return 0;
+    final key = value >> CONTAINER_BITS;
+    final k = _lowerKey(key);
+    if (k == _keys.length) return _cardinality;
+    if (_keys[k] != key) return _before[k];
+    return _before[k] + _containers[k].rank(value & 0xFFFF);
+  }
+
+  // 오름차순 k번째 값 (0 <= k < cardinality)
+  int select(int k) {
+    RangeError.checkValidIndex(k, this, 'k', _cardinality);
+    int lo = 0, hi = _before.length - 1;
+    while (lo < hi) {
+      final mid = (lo + hi + 1) >> 1;
+      if (_before[mid] <= k) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+    return (_keys[lo] << CONTAINER_BITS) | _containers[lo].select(k - _before[lo]);
+  }
+
+  // 합집합 (여러 경고 종류를 함께 볼 때). 컨테이너끼리 병합/비트 OR
+  static AlertBitmap or(AlertBitmap a, AlertBitmap b) {
+    final out = AlertBitmap();
+    int i = 0, j = 0;
+    while (i < a._keys.length || j < b._keys.length) {
+      final int key;
+      final _Container c;
+      if (j == b._keys.length || (i < a._keys.length && a._keys[i] < b._keys[j])) {
+        key = a._keys[i];
+        c = a._containers[i++].copy();
+      } else if (i == a._keys.length || b._keys[j] < a._keys[i]) {
+        key = b._keys[j];
+        c = b._containers[j++].copy();
+      } else {
+        key = a._keys[i];
+        c = a._containers[i++].or(b._containers[j++]);
+      }
+      out._keys.add(key);
+      out._containers.add(c);
+      out._before.add(out._cardinality);
+      out._cardinality += c.cardinality;
+    }
+    return out;
+  }
+
+  // key 이상인 첫 컨테이너
+  int _lowerKey(int key) {
+    int lo = 0, hi = _keys.length;
+    while (lo < hi) {
+      final mid = (lo + hi) >> 1;
+      if (_keys[mid] < key) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  int _findKey(int key) {
+    final k = _lowerKey(key);
+    return k < _keys.length && _keys[k] == key ? k : -1;
+  }
+}
+
+abstract class _Container {
+  int get cardinality;
+  int get last;
+  bool contains(int low);
+  int rank(int low);
+  int select(int k);
+  // 추가 후의 컨테이너 (배열이 가득 차면 비트맵으로 바뀜)
+  _Container add(int low);
+  // low 이상을 지운 컨테이너, 비면 null
+  _Container? truncate(int low);
+  _Container or(_Container other);
+  _Container copy();
+}
+
+// 정렬된 하위 16비트 배열
+class _ArrayContainer implements _Container {
+  Uint16List _values;
+  int _length;
+
+  _ArrayContainer([Uint16List? values, int length = 0])
+      : _values = values ?? Uint16List(4),
+        _length = length;
+
+  @override
+  int get cardinality => _length;
+  @override
+  int get last => _values[_length - 1];
+
+  @override
+  bool contains(int low) {
+    final i = rank(low);
+    return i < _length && _values[i] == low;
+  }
+
+  @override
+  int rank(int low) {
+    int lo = 0, hi = _length;
+    while (lo < hi) {
+      final mid = (lo + hi) >> 1;
+      if (_values[mid] < low) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  @override
+  int select(int k) => _values[k];
+
+  @override
+  _Container add(int low) {
+    if (_length == AlertBitmap.ARRAY_MAX) {
+      return _BitmapContainer.fromArray(_values, _length).add(low);
+    }
+    if (_length == _values.length) {
+      _values = Uint16List(_values.length * 2)..setRange(0, _length, _values);
+    }
+    _values[_length++] = low;
+    return this;
+  }
+
+  @override
+  _Container? truncate(int low) {
+    _length = rank(low);
+    return _length == 0 ? null : this;
+  }
+
+  @override
+  _Container or(_Container other) {
+    if (other is _BitmapContainer) return other.or(this);
+    final b = other as _ArrayContainer;
+    final out = Uint16List(_length + b._length);
+    int i = 0, j = 0, n = 0;
+    while (i < _length || j < b._length) {
+      if (j == b._length || (i < _length && _values[i] < b._values[j])) {
+        out[n++] = _values[i++];
+      } else if (i == _length || b._values[j] < _values[i]) {
+        out[n++] = b._values[j++];
+      } else {
+        out[n++] = _values[i++];
+        j++;
+      }
+    }
+    if (n > AlertBitmap.ARRAY_MAX) return _BitmapContainer.fromArray(out, n);
+    return _ArrayContainer(out, n);
+  }
+
+  @override
+  _Container copy() => _ArrayContainer(_values.sublist(0, _length), _length);
+}
+
+// 65536비트 비트맵 (32비트 워드 2048개)
+class _BitmapContainer implements _Container {
+  static const int WORDS = 2048;
+
+  final Uint32List _words;
+  int _cardinality;
+
+  _BitmapContainer(this._words, this._cardinality);
+
+  factory _BitmapContainer.fromArray(Uint16List values, int length) {
+    final words = Uint32List(WORDS);
+    for (int i = 0; i < length; i++) {
+      words[values[i] >> 5] |= 1 << (values[i] & 31);
+    }
+    return _BitmapContainer(words, length);
+  }
+
+  @override
+  int get cardinality => _cardinality;
+
+  @override
+  int get last {
+    for (int w = WORDS - 1; w >= 0; w--) {
+      final word = _words[w];
+      if (word != 0) return (w << 5) | (word.bitLength - 1);
+    }
+    return -1;
+  }
+
+  @override
+  bool contains(int low) => (_words[low >> 5] >> (low & 31)) & 1 != 0;
+
+  @override
+  int rank(int low) {
+    final w = low >> 5;
+    int n = 0;
+    for (int i = 0; i < w; i++) {
+      n += _popcount(_words[i]);
+    }
+    final bit = low & 31;
+    if (bit != 0) n += _popcount(_words[w] & ((1 << bit) - 1));
+    return n;
+  }
+
+  @override
+  int select(int k) {
+    for (int w = 0; w < WORDS; w++) {
+      int word = _words[w];
+      final c = _popcount(word);
+      if (k < c) {
+        // 워드 안에서 k번째 1
+        for (; k > 0; k--) {
+          word &= word - 1;
+        }
+        return (w << 5) | ((word & -word).bitLength - 1);
+      }
+      k -= c;
+    }
+    throw StateError('select out of range');
+  }
+
+  @override
+  _Container add(int low) {
+    _words[low >> 5] |= 1 << (low & 31);
+    _cardinality++;
+    return this;
+  }
+
+  @override
+  _Container? truncate(int low) {
+    final w = low >> 5;
+    _words[w] &= (1 << (low & 31)) - 1;
+    _words.fillRange(w + 1, WORDS, 0);
+    _cardinality = rank(low);
+    if (_cardinality == 0) return null;
+    if (_cardinality > AlertBitmap.ARRAY_MAX) return this;
+    // 다시 드물어졌으면 배열로
+    final values = Uint16List(_cardinality);
+    for (int i = 0; i < _cardinality; i++) {
+      values[i] = select(i);
+    }
+    return _ArrayContainer(values, _cardinality);
+  }
+
+  @override
+  _Container or(_Container other) {
+    final words = Uint32List.fromList(_words);
+    if (other is _BitmapContainer) {
+      for (int i = 0; i < WORDS; i++) {
+        words[i] |= other._words[i];
+      }
+    } else {
+      final a = other as _ArrayContainer;
+      for (int i = 0; i < a._length; i++) {
+        words[a._values[i] >> 5] |= 1 << (a._values[i] & 31);
+      }
+    }
+    int n = 0;
+    for (int i = 0; i < WORDS; i++) {
+      n += _popcount(words[i]);
+    }
+    return _BitmapContainer(words, n);
+  }
+
+  @override
+  _Container copy() => _BitmapContainer(Uint32List.fromList(_words), _cardinality);
+
+  static int _popcount(int x) {
+    x = x - ((x >> 1) & 0x55555555);
+    x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+    x = (x + (x >> 4)) & 0x0F0F0F0F;
+    return ((x * 0x01010101) & 0xFFFFFFFF) >> 24;
+  }
+}
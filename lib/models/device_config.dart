@@ -0,0 +1,54 @@
+// 펌웨어 런타임 설정 ($C 패킷)
+enum WaveformStream {
+  raw('R'),
+  filtered('F'),
+  derivative('D');
+
+  final String code;
+  const WaveformStream(this.code);
+
+  static WaveformStream fromCode(String code) =>
+      WaveformStream.values.firstWhere((s) => s.code == code, orElse: () => WaveformStream.derivative);
+}
+
+class DeviceConfig {
+  static const List<int> SAMPLE_RATES = [50, 100, 200, 400];
+  // FIFO_CONFIG 의 SMP_AVE (4샘플 평균) -> 파형 블록 샘플레이트 = SR / 4
+  static const int FIFO_AVERAGING = 4;
+
+  final int sampleRate;
+  final int ledRed;
+  final int ledIr;
+  final int decimation;
+  final WaveformStream stream;
+  final int blockSize; // 0 = 블록 전송 끔
+  final int waveDecimation; // 파형 블록을 기기에서 CIC 로 1/N 데시메이션 (구버전 펌웨어는 1)
+
+  // 샘플 처리 주기 (측정 줄의 sample_no 단위)
+  double get outputRate => sampleRate / FIFO_AVERAGING;
+  // 파형 블록의 샘플레이트
+  double get waveformRate => outputRate / waveDecimation;
+
+  const DeviceConfig({
+    required this.sampleRate,
+    required this.ledRed,
+    required this.ledIr,
+    required this.decimation,
+    required this.stream,
+    this.blockSize = 0,
+    this.waveDecimation = 1,
+  });
+
+  // "$C,sr,led_r,led_ir,dec,stream,blk,wd"
+  factory DeviceConfig.parse(List<String> values) {
+    return DeviceConfig(
+      sampleRate: int.parse(values[1]),
+      ledRed: int.parse(values[2]),
+      ledIr: int.parse(values[3]),
+      decimation: int.parse(values[4]),
+      stream: WaveformStream.fromCode(values[5]),
+      blockSize: values.length > 6 ? int.parse(values[6]) : 0,
+      waveDecimation: values.length > 7 ? int.parse(values[7]) : 1,
+    );
+  }
+}
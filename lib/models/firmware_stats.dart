@@ -0,0 +1,71 @@
+// 펌웨어 loop() 구간별 소요시간 통계 ($P 패킷)
+// 단위는 Timer1 tick (clk/64 = 4us)
+class StageStat {
+  final int min;
+  final int avg;
+  final int max;
+
+  const StageStat(this.min, this.avg, this.max);
+
+  double get avgMicros => avg * FirmwareStats.TICK_MICROS;
+  double get maxMicros => max * FirmwareStats.TICK_MICROS;
+}
+
+class FirmwareStats {
+  static const double TICK_MICROS = 4.0;
+  static const List<String> STAGE_NAMES = [
+    'read_sample', 'filter', 'detect', 'get_time', 'uart', 'lcd',
+  ];
+  // 펌웨어 스케줄러 주기 작업 (TASK_* 순서)
+  static const List<String> TASK_NAMES = [
+    'link', 'telemetry', 'rtc', 'lcd', 'stats',
+  ];
+
+  final int periodMs;
+  final int samples;
+  final int emptyPolls;
+  final int fifoOverruns;
+  final int busyTicks;
+  final List<StageStat> stages;
+  final List<int> taskLate; // 작업별 마감 초과 횟수 (구버전 펌웨어는 빈 목록)
+
+  FirmwareStats({
+    required this.periodMs,
+    required this.samples,
+    required this.emptyPolls,
+    required this.fifoOverruns,
+    required this.busyTicks,
+    required this.stages,
+    this.taskLate = const [],
+  });
+
+  // 실제 처리에 쓴 시간 비율을 뺀 나머지 (0.0 ~ 1.0)
+  double get headroom {
+    if (periodMs <= 0) return 0;
+    final busyMs = busyTicks * TICK_MICROS / 1000.0;
+    return (1.0 - busyMs / periodMs).clamp(0.0, 1.0);
+  }
+
+  double get sampleRate => periodMs > 0 ? samples * 1000.0 / periodMs : 0;
+
+  int get totalLate => taskLate.fold(0, (a, b) => a + b);
+
+  // "$P,기간,샘플,폴링,오버런,busy,(min,avg,max)x6,마감초과x5"
+  factory FirmwareStats.parse(List<String> values) {
+    final v = values.skip(1).map(int.parse).toList();
+    final stages = <StageStat>[];
+    for (int i = 5; i + 2 < v.length && stages.length < STAGE_NAMES.length; i += 3) {
+      stages.add(StageStat(v[i], v[i + 1], v[i + 2]));
+    }
+    final lateStart = 5 + STAGE_NAMES.length * 3;
+    return FirmwareStats(
+      periodMs: v[0],
+      samples: v[1],
+      emptyPolls: v[2],
+      fifoOverruns: v[3],
+      busyTicks: v[4],
+      stages: stages,
+      taskLate: v.length > lateStart ? v.sublist(lateStart) : const [],
+    );
+  }
+}
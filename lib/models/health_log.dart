@@ -1,23 +1,56 @@
 class HealthLog {
-  final String time;
+  final int timeUs; // epoch µs (기기 샘플 카운터를 호스트 시계로 변환한 값)
   final double bpm;
   final double spo2;
+  final int flags; // HistoryStore.FLAG_*
+  // 저장 시점의 HRV (5분 창). 박동 간격을 받기 전이거나 백필 기록이면 null
+  final int? sdnn;         // ms
+  final int? rmssd;        // ms
+  final int? irregularity; // %
 
-  HealthLog({required this.time, required this.bpm, required this.spo2});
+  HealthLog({
+    required this.timeUs,
+    required this.bpm,
+    required this.spo2,
+    this.flags = 0,
+    this.sdnn,
+    this.rmssd,
+    this.irregularity,
+  });
 
-  // JSON 변환 (저장용)
+  bool get hasHrv => sdnn != null;
+
+  DateTime get time => DateTime.fromMicrosecondsSinceEpoch(timeUs);
+
+  // JSON 변환 (저장용) - 짧은 키
   Map<String, dynamic> toJson() => {
-        'time': time,
-        'bpm': bpm,
-        'spo2': spo2,
+        't': timeUs,
+        'b': bpm,
+        's': spo2,
+        if (flags != 0) 'f': flags,
+        if (hasHrv) ...{'d': sdnn, 'r': rmssd, 'i': irregularity},
       };
 
-  // JSON 읽기 (로드용)
-  factory HealthLog.fromJson(Map<String, dynamic> json) {
+  // JSON 읽기 (로드용). 예전 형식 {"time": "yyyy-MM-dd HH:mm:ss", "bpm", "spo2"} 도 읽음
+  // fallbackTimeUs: 시각을 읽을 수 없는 옛 기록에 줄 시각 (호출한 쪽이 기록마다 다르게 줌)
+  factory HealthLog.fromJson(Map<String, dynamic> json, {int fallbackTimeUs = 0}) {
+    if (json.containsKey('t')) {
+      return HealthLog(
+        timeUs: json['t'],
+        bpm: (json['b'] as num).toDouble(),
+        spo2: (json['s'] as num).toDouble(),
+        flags: json['f'] ?? 0,
+        sdnn: json['d'],
+        rmssd: json['r'],
+        irregularity: json['i'],
+      );
+    }
+    // 시간만 있는 옛 기록("HH:mm:ss")은 날짜를 알 수 없어 fallbackTimeUs 에 둠
+    final legacy = DateTime.tryParse(json['time'] ?? '');
     return HealthLog(
-      time: json['time'],
-      bpm: json['bpm'],
-      spo2: json['spo2'],
+      timeUs: legacy?.microsecondsSinceEpoch ?? fallbackTimeUs,
+      bpm: (json['bpm'] as num).toDouble(),
+      spo2: (json['spo2'] as num).toDouble(),
     );
   }
-}
\ No newline at end of file
+}
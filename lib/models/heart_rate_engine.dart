@@ -0,0 +1,11 @@
+// 경고/기록에 쓸 심박수 계산 방식 (기기 주소별로 저장)
+enum HeartRateEngine {
+  device('기기'),           // 펌웨어의 2차 미분 영점 교차 검출
+  autocorrelation('자기상관'); // 앱에서 파형 블록으로 계산 (AutocorrHeartRate)
+
+  final String label;
+  const HeartRateEngine(this.label);
+
+  static HeartRateEngine fromName(String? name) =>
+      HeartRateEngine.values.firstWhere((e) => e.name == name, orElse: () => HeartRateEngine.device);
+}
@@ -0,0 +1,267 @@
+import 'dart:typed_data';
+
+import 'alert_bitmap.dart';
+import 'health_log.dart';
+
+// 측정 기록 저장소 (열 단위 배열)
+// 기록마다 객체를 두지 않고 시각/심박/SpO2/플래그/HRV 를 각각의 typed array 에 둠.
+// 기록 1개 = 8 + 1 + 2 + 1 + (2 + 2 + 1) = 17바이트 -> 100만 개가 약 17MB,
+// 집계/내보내기는 열 하나만 순서대로 읽음.
+//
+// 배열은 시간 오름차순으로 끝에 덧붙이고, 화면(최신이 위)에는 [] 로 뒤집힌 인덱스를 제공.
+// 백필처럼 과거 시각이 들어오면 이진 탐색한 위치에 끼워 넣음 (드문 경우).
+//
+// 경고 종류(저산소/빈맥/서맥)마다 해당 기록 인덱스의 압축 비트맵을 함께 유지하므로
+// "경고 기록만" 보기와 구간별 경고 수는 기록을 훑지 않고 비트맵의 rank/select 로 구함.
+class HistoryStore {
+  static const int FLAG_EMERGENCY = 1; // 경고 발생 시 즉시 저장된 기록
+  static const int FLAG_BACKFILL = 2;  // 링크가 끊긴 동안 기기에 저장됐다가 받은 기록
+  static const int FLAG_HRV = 4;       // HRV 열(SDNN/RMSSD/불규칙 지수)이 유효함
+  static const int SPO2_SCALE = 10;    // SpO2 는 0.1% 단위로 저장
+
+  // 경고 종류 (비트 마스크)와 기준. 경고음(HealthController)과 기록 필터가 모두 alertsOf 하나로 판단
+  // (linux/ingestd/sensor.h 도 같은 값, 같은 규칙)
+  static const int ALERT_HYPOXIA = 1;
+  static const int ALERT_TACHYCARDIA = 2;
+  static const int ALERT_BRADYCARDIA = 4;
+  static const int ALERT_ANY = ALERT_HYPOXIA | ALERT_TACHYCARDIA | ALERT_BRADYCARDIA;
+  static const List<int> ALERT_CATEGORIES = [ALERT_HYPOXIA, ALERT_TACHYCARDIA, ALERT_BRADYCARDIA];
+  static const int LOW_SPO2 = 90 * SPO2_SCALE; // 0.1% 단위, 미만이면 저산소
+  static const int HIGH_HEART_RATE = 120;      // 초과면 빈맥
+  static const int LOW_HEART_RATE = 50;        // 미만이면 서맥
+  static const int MIN_VALID = 10;             // 이하인 SpO2(%)/심박은 측정값이 아님 (손가락 없음 등)
+
+  static const int _INITIAL_CAPACITY = 1024;
+
+  Int64List _timeUs = Int64List(_INITIAL_CAPACITY);
+  Uint8List _bpm = Uint8List(_INITIAL_CAPACITY);
+  Uint16List _spo2 = Uint16List(_INITIAL_CAPACITY);
+  Uint8List _flags = Uint8List(_INITIAL_CAPACITY);
+  Uint16List _sdnn = Uint16List(_INITIAL_CAPACITY);
+  Uint16List _rmssd = Uint16List(_INITIAL_CAPACITY);
+  Uint8List _irregularity = Uint8List(_INITIAL_CAPACITY);
+  int _length = 0;
+  // 파일에 아직 쓰지 않은 첫 인덱스 (뒤에 덧붙이면 그대로, 과거에 끼워 넣으면 당겨짐)
+  int _dirtyFrom = 0;
+  // ALERT_CATEGORIES 순서의 비트맵. 여러 종류를 합친 마스크는 합집합을 만들어 두고 추가 때 같이 갱신
+  final List<AlertBitmap> _alertIndex = List.generate(ALERT_CATEGORIES.length, (_) => AlertBitmap());
+  final Map<int, AlertBitmap> _alertUnions = {};
+  // 비트맵에 반영한 앞쪽 기록 수. 과거에 끼워 넣으면 그 위치로 당겨지고 다음 조회 때 한 번에 다시 만듦
+  // (백필 배치 k개를 넣어도 재색인은 가장 앞선 위치부터 한 번)
+  int _alertsIndexed = 0;
+
+  int get length => _length;
+  int get dirtyFrom => _dirtyFrom;
+  bool get isDirty => _dirtyFrom < _length;
+  void markPersisted() => _dirtyFrom = _length;
+  void markAllDirty() => _dirtyFrom = 0;
+  bool get isEmpty => _length == 0;
+  bool get isNotEmpty => _length != 0;
+
+  // 열 직접 접근 (오름차순, 앞 length 개만 유효). 집계/내보내기용
+  Int64List get timeColumn => Int64List.sublistView(_timeUs, 0, _length);
+  Uint8List get bpmColumn => Uint8List.sublistView(_bpm, 0, _length);
+  Uint16List get spo2Column => Uint16List.sublistView(_spo2, 0, _length);
+  Uint8List get flagsColumn => Uint8List.sublistView(_flags, 0, _length);
+  Uint16List get sdnnColumn => Uint16List.sublistView(_sdnn, 0, _length);
+  Uint16List get rmssdColumn => Uint16List.sublistView(_rmssd, 0, _length);
+  Uint8List get irregularityColumn => Uint8List.sublistView(_irregularity, 0, _length);
+
+  // 최신이 0번 (화면용)
+  HealthLog operator [](int newestIndex) => at(_length - 1 - newestIndex);
+
+  // 오름차순 인덱스
+  HealthLog at(int i) {
+    final hrv = (_flags[i] & FLAG_HRV) != 0;
+    return HealthLog(
+      timeUs: _timeUs[i],
+      bpm: _bpm[i].toDouble(),
+      spo2: _spo2[i] / SPO2_SCALE,
+      flags: _flags[i],
+      sdnn: hrv ? _sdnn[i] : null,
+      rmssd: hrv ? _rmssd[i] : null,
+      irregularity: hrv ? _irregularity[i] : null,
+    );
+  }
+
+  int timeUsAt(int i) => _timeUs[i];
+
+  // 저장 해상도 (심박 정수, SpO2 0.1%)
+  static int storedBpm(double bpm) => bpm.round().clamp(0, 255);
+  static int storedSpo2(double spo2) => (spo2 * SPO2_SCALE).round().clamp(0, 0xFFFF);
+
+  // 저장된 값의 경고 종류. 측정값은 저장 해상도로 반올림해서 넣으므로(alertsOfValues)
+  // 경고가 울린 값은 저장된 기록에서도 같은 종류로 분류됨
+  static int alertsOf(int bpm, int spo2Tenths) =>
+      (spo2Tenths < LOW_SPO2 && spo2Tenths > MIN_VALID * SPO2_SCALE ? ALERT_HYPOXIA : 0) |
+      (bpm > HIGH_HEART_RATE ? ALERT_TACHYCARDIA : 0) |
+      (bpm < LOW_HEART_RATE && bpm > MIN_VALID ? ALERT_BRADYCARDIA : 0);
+
+  static int alertsOfValues(double bpm, double spo2) => alertsOf(storedBpm(bpm), storedSpo2(spo2));
+
+  int alertsAt(int i) => alertsOf(_bpm[i], _spo2[i]);
+
+  // mask 에 해당하는 기록 인덱스 (여러 종류면 합집합). 돌려받은 비트맵은 고치지 말 것
+  AlertBitmap alertIndex(int mask) {
+    _syncAlerts();
+    final single = ALERT_CATEGORIES.indexOf(mask);
+    if (single >= 0) return _alertIndex[single];
+    return _alertUnions.putIfAbsent(mask, () {
+      var out = AlertBitmap();
+      for (int c = 0; c < ALERT_CATEGORIES.length; c++) {
+        if ((mask & ALERT_CATEGORIES[c]) != 0) out = AlertBitmap.or(out, _alertIndex[c]);
+      }
+      return out;
+    });
+  }
+
+  // 오름차순 인덱스 [start, end) 중 mask 에 해당하는 기록 수
+  int alertCount(int mask, int start, int end) {
+    final index = alertIndex(mask);
+    return index.rank(end) - index.rank(start);
+  }
+
+  // [start, end) 의 기록 보기 (mask 0 이면 전체)
+  HistoryView view(int start, int end, [int mask = 0]) => HistoryView._(this, start, end, mask);
+
+  void clear() {
+    _length = _dirtyFrom = _alertsIndexed = 0;
+    for (final index in _alertIndex) {
+      index.clear();
+    }
+    _alertUnions.clear();
+  }
+
+  // 같은 시각의 기록이 이미 있으면 넣지 않고 false. sdnn 을 주면 HRV 열도 채움 (FLAG_HRV)
+  bool add(int timeUs, double bpm, double spo2,
+      {int flags = 0, int? sdnn, int? rmssd, int? irregularity}) {
+    int i = _length;
+    if (_length > 0 && _timeUs[_length - 1] >= timeUs) {
+      i = lowerBound(timeUs);
+      if (i < _length && _timeUs[i] == timeUs) return false;
+    }
+    _ensureCapacity(_length + 1);
+    if (i < _length) {
+      _timeUs.setRange(i + 1, _length + 1, _timeUs, i);
+      _bpm.setRange(i + 1, _length + 1, _bpm, i);
+      _spo2.setRange(i + 1, _length + 1, _spo2, i);
+      _flags.setRange(i + 1, _length + 1, _flags, i);
+      _sdnn.setRange(i + 1, _length + 1, _sdnn, i);
+      _rmssd.setRange(i + 1, _length + 1, _rmssd, i);
+      _irregularity.setRange(i + 1, _length + 1, _irregularity, i);
+    }
+    _timeUs[i] = timeUs;
+    _bpm[i] = storedBpm(bpm);
+    _spo2[i] = storedSpo2(spo2);
+    if (sdnn != null) {
+      _flags[i] = flags | FLAG_HRV;
+      _sdnn[i] = sdnn.clamp(0, 0xFFFF);
+      _rmssd[i] = (rmssd ?? 0).clamp(0, 0xFFFF);
+      _irregularity[i] = (irregularity ?? 0).clamp(0, 100);
+    } else {
+      _flags[i] = flags & ~FLAG_HRV;
+      _sdnn[i] = 0;
+      _rmssd[i] = 0;
+      _irregularity[i] = 0;
+    }
+    _length++;
+    if (i < _dirtyFrom) _dirtyFrom = i;
+    if (i == _alertsIndexed && i == _length - 1) {
+      _indexAlerts(i);
+      _alertsIndexed = _length;
+    } else if (i < _alertsIndexed) {
+      _alertsIndexed = i;
+    }
+    return true;
+  }
+
+  bool addLog(HealthLog log) => add(log.timeUs, log.bpm, log.spo2,
+      flags: log.flags, sdnn: log.sdnn, rmssd: log.rmssd, irregularity: log.irregularity);
+
+  // timeUs 이상인 첫 오름차순 인덱스
+  int lowerBound(int timeUs) {
+    int lo = 0, hi = _length;
+    while (lo < hi) {
+      final mid = (lo + hi) >> 1;
+      if (_timeUs[mid] < timeUs) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  // 끝에 덧붙인 기록 하나를 비트맵(과 만들어 둔 합집합)에 반영
+  void _indexAlerts(int i) {
+    final alerts = alertsOf(_bpm[i], _spo2[i]);
+    if (alerts == 0) return;
+    for (int c = 0; c < ALERT_CATEGORIES.length; c++) {
+      if ((alerts & ALERT_CATEGORIES[c]) != 0) _alertIndex[c].add(i);
+    }
+    _alertUnions.forEach((mask, union) {
+      if ((alerts & mask) != 0) union.add(i);
+    });
+  }
+
+  // 끼워 넣은 가장 앞선 위치부터 뒤는 인덱스가 밀렸으므로 잘라 내고 다시 분류
+  void _syncAlerts() {
+    if (_alertsIndexed == _length) return;
+    for (final index in _alertIndex) {
+      index.truncate(_alertsIndexed);
+    }
+    _alertUnions.clear();
+    for (int j = _alertsIndexed; j < _length; j++) {
+      final alerts = alertsOf(_bpm[j], _spo2[j]);
+      if (alerts == 0) continue;
+      for (int c = 0; c < ALERT_CATEGORIES.length; c++) {
+        if ((alerts & ALERT_CATEGORIES[c]) != 0) _alertIndex[c].add(j);
+      }
+    }
+    _alertsIndexed = _length;
+  }
+
+  void _ensureCapacity(int needed) {
+    if (needed <= _timeUs.length) return;
+    int cap = _timeUs.length * 2;
+    while (cap < needed) {
+      cap *= 2;
+    }
+    _timeUs = (Int64List(cap)..setRange(0, _length, _timeUs));
+    _bpm = (Uint8List(cap)..setRange(0, _length, _bpm));
+    _spo2 = (Uint16List(cap)..setRange(0, _length, _spo2));
+    _flags = (Uint8List(cap)..setRange(0, _length, _flags));
+    _sdnn = (Uint16List(cap)..setRange(0, _length, _sdnn));
+    _rmssd = (Uint16List(cap)..setRange(0, _length, _rmssd));
+    _irregularity = (Uint8List(cap)..setRange(0, _length, _irregularity));
+  }
+}
+
+// 저장소의 구간 [start, end) 를 최신이 위로 보여 주는 목록. mask 가 있으면 해당 경고 기록만.
+// 경고 기록의 k번째는 비트맵 select 로 바로 찾으므로 몇백만 개 중에서도 필요한 줄만 읽음.
+class HistoryView {
+  final HistoryStore store;
+  final int mask;
+  final AlertBitmap? _index;
+  final int _first; // 오름차순에서 보기의 첫 위치 (mask 가 있으면 비트맵 안의 순위)
+  final int length;
+
+  factory HistoryView._(HistoryStore store, int start, int end, int mask) {
+    if (mask == 0) return HistoryView._raw(store, 0, null, start, end - start);
+    final index = store.alertIndex(mask);
+    final first = index.rank(start);
+    return HistoryView._raw(store, mask, index, first, index.rank(end) - first);
+  }
+
+  HistoryView._raw(this.store, this.mask, this._index, this._first, this.length);
+
+  bool get isEmpty => length == 0;
+
+  // 최신이 0번 -> 저장소의 오름차순 인덱스
+  int storeIndex(int newestIndex) {
+    final k = _first + length - 1 - newestIndex;
+    return _index == null ? k : _index.select(k);
+  }
+
+  HealthLog operator [](int newestIndex) => store.at(storeIndex(newestIndex));
+}
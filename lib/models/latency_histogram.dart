@@ -0,0 +1,59 @@
+// 지연 시간 히스토그램 (ms, 2배 간격 버킷)
+// 버킷 i 의 상한 = FIRST_BOUND_MS * 2^i, 마지막 버킷은 상한 없음
+class LatencyHistogram {
+  static const int FIRST_BOUND_MS = 25;
+  static const int BUCKETS = 9; // 25, 50, ... 3200ms, 그 이상
+
+  final List<int> counts = List.filled(BUCKETS, 0);
+  int count = 0;
+  int maxMs = 0;
+  int _sumMs = 0;
+
+  int get averageMs => count == 0 ? 0 : _sumMs ~/ count;
+
+  static int upperBoundMs(int bucket) => FIRST_BOUND_MS << bucket;
+
+  void add(Duration latency) {
+    final ms = latency.inMilliseconds < 0 ? 0 : latency.inMilliseconds;
+    int b = 0;
+    while (b < BUCKETS - 1 && ms >= upperBoundMs(b)) {
+      b++;
+    }
+    counts[b]++;
+    count++;
+    _sumMs += ms;
+    if (ms > maxMs) maxMs = ms;
+  }
+
+  // p (0~1) 분위수가 들어 있는 버킷의 상한 (보수적 추정). 마지막 버킷이면 최댓값
+  int percentileMs(double p) {
+    if (count == 0) return 0;
+    final target = (p * count).ceil().clamp(1, count);
+    int seen = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+      seen += counts[b];
+      if (seen >= target) return b == BUCKETS - 1 ? maxMs : upperBoundMs(b);
+    }
+    return maxMs;
+  }
+
+  // limitMs 를 넘었을 수 있는 건수 (버킷 경계 기준)
+  int countAbove(int limitMs) {
+    int n = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+      final lower = b == 0 ? 0 : upperBoundMs(b - 1);
+      if (lower >= limitMs) n += counts[b];
+    }
+    return n;
+  }
+
+  @override
+  String toString() {
+    final parts = <String>[];
+    for (int b = 0; b < BUCKETS; b++) {
+      if (counts[b] == 0) continue;
+      parts.add(b == BUCKETS - 1 ? '>=${upperBoundMs(b - 1)}ms:${counts[b]}' : '<${upperBoundMs(b)}ms:${counts[b]}');
+    }
+    return 'n=$count avg=${averageMs}ms p95<=${percentileMs(0.95)}ms max=${maxMs}ms [${parts.join(' ')}]';
+  }
+}
@@ -0,0 +1,171 @@
+import 'history_store.dart';
+
+// 측정 세션 하나 (손가락을 올려 둔 동안, 펌웨어의 $S/$E 이벤트로 나뉨)
+// 요약은 품질이 좋은 실시간 줄마다 바로 갱신 (기록 저장 주기 5초와 무관하게 1초 단위 값 전부)
+class MeasurementSession {
+  final int deviceId; // 펌웨어의 세션 번호 (부팅 후 1부터, 재부팅하면 다시 1)
+  final int startUs;
+  int endUs;          // 열린 세션은 마지막으로 반영한 값의 시각
+  bool open;
+
+  int count = 0;
+  int bpmMin = 0, bpmMax = 0, bpmSum = 0;
+  int spo2Min = 0, spo2Max = 0, spo2Sum = 0; // 0.1% 단위 (HistoryStore 와 같음)
+  int alerts = 0;
+
+  MeasurementSession(this.deviceId, this.startUs, {int? endUs, this.open = true})
+      : endUs = endUs ?? startUs;
+
+  Duration get duration => Duration(microseconds: endUs - startUs);
+  DateTime get start => DateTime.fromMicrosecondsSinceEpoch(startUs);
+  DateTime get end => DateTime.fromMicrosecondsSinceEpoch(endUs);
+  bool get hasVitals => count > 0;
+  double get bpmAvg => count > 0 ? bpmSum / count : 0;
+  double get spo2Avg => count > 0 ? spo2Sum / count / HistoryStore.SPO2_SCALE : 0;
+  double get spo2MinPercent => spo2Min / HistoryStore.SPO2_SCALE;
+  double get spo2MaxPercent => spo2Max / HistoryStore.SPO2_SCALE;
+
+  void addVitals(int timeUs, int bpm, int spo2Tenths) {
+    if (count == 0 || bpm < bpmMin) bpmMin = bpm;
+    if (count == 0 || bpm > bpmMax) bpmMax = bpm;
+    if (count == 0 || spo2Tenths < spo2Min) spo2Min = spo2Tenths;
+    if (count == 0 || spo2Tenths > spo2Max) spo2Max = spo2Tenths;
+    bpmSum += bpm;
+    spo2Sum += spo2Tenths;
+    count++;
+    if (timeUs > endUs) endUs = timeUs;
+  }
+}
+
+// 세션 목록 (시작 시각 오름차순, 겹치지 않음)
+// 열린 세션은 마지막 하나뿐이라 갱신은 O(1), 구간 조회는 이진 탐색.
+// 세션 안의 기록은 HistoryStore 에서 시작/끝 시각으로 이진 탐색해 꺼냄 (전체를 훑지 않음).
+class SessionIndex {
+  // 다시 연결했을 때 기기가 알려 준 열린 세션이 이미 가진 세션과 같은지 볼 때의 시각 오차
+  // (끊긴 동안의 시계 보정 차이)
+  static const int SAME_START_US = 10 * 1000000;
+
+  final List<MeasurementSession> _sessions = [];
+  // 파일에 아직 쓰지 않은 첫 인덱스 (열린 세션이 바뀌면 그 자리)
+  int _dirtyFrom = 0;
+
+  int get length => _sessions.length;
+  bool get isEmpty => _sessions.isEmpty;
+  int get dirtyFrom => _dirtyFrom;
+  bool get isDirty => _dirtyFrom < _sessions.length;
+  void markPersisted() => _dirtyFrom = _sessions.length;
+  void markAllDirty() => _dirtyFrom = 0;
+
+  // 오름차순 인덱스
+  MeasurementSession at(int i) => _sessions[i];
+  // 최신이 0번 (화면용)
+  MeasurementSession operator [](int newestIndex) => _sessions[_sessions.length - 1 - newestIndex];
+
+  MeasurementSession? get current =>
+      _sessions.isNotEmpty && _sessions.last.open ? _sessions.last : null;
+
+  void clear() {
+    _sessions.clear();
+    _dirtyFrom = 0;
+  }
+
+  // 파일에서 읽은 세션 (순서대로)
+  void load(MeasurementSession session) {
+    _sessions.add(session);
+    _dirtyFrom = _sessions.length;
+  }
+
+  // $S: 새 세션. 마지막 세션을 다시 알린 것(재연결 후 #GET 응답)이면 그대로 이어 감.
+  // 열려 있던 다른 세션은 (끝 이벤트를 놓쳤으므로) 마지막 값에서 닫음
+  MeasurementSession start(int deviceId, int timeUs) {
+    if (_sessions.isNotEmpty) {
+      final last = _sessions.last;
+      if (last.deviceId == deviceId && (last.startUs - timeUs).abs() <= SAME_START_US) {
+        if (!last.open) {
+          last.open = true;
+          _touch(_sessions.length - 1);
+        }
+        return last;
+      }
+      if (last.open) _close(last, last.endUs);
+    }
+    // 시계 보정으로 이전 세션의 끝보다 살짝 앞설 수 있음
+    final previousEnd = _sessions.isNotEmpty ? _sessions.last.endUs : timeUs;
+    final session = MeasurementSession(deviceId, timeUs < previousEnd ? previousEnd : timeUs);
+    _sessions.add(session);
+    return session;
+  }
+
+  // $E: 열린 세션이 그 번호면 손가락을 뗀 시각에 닫음. 이미 닫았거나 모르는 세션이면 무시
+  void end(int deviceId, int timeUs) {
+    final open = current;
+    if (open == null || open.deviceId != deviceId) return;
+    _close(open, timeUs < open.startUs ? open.startUs : timeUs);
+  }
+
+  // 품질이 좋은 값 하나 (저장소에 넣는 값 그대로). 열린 세션이 없으면 false
+  bool addVitals(int timeUs, double bpm, double spo2) {
+    final open = current;
+    if (open == null) return false;
+    open.addVitals(timeUs, HistoryStore.storedBpm(bpm), HistoryStore.storedSpo2(spo2));
+    _touch(_sessions.length - 1);
+    return true;
+  }
+
+  bool alert() {
+    final open = current;
+    if (open == null) return false;
+    open.alerts++;
+    _touch(_sessions.length - 1);
+    return true;
+  }
+
+  // [fromUs, toUs) 와 겹치는 세션 (오름차순). 세션은 겹치지 않으므로 끝 시각도 정렬돼 있음
+  Iterable<MeasurementSession> between(int fromUs, int toUs) sync* {
+    for (int i = _firstEndingAfter(fromUs); i < _sessions.length; i++) {
+      final s = _sessions[i];
+      if (s.startUs >= toUs) break;
+      yield s;
+    }
+  }
+
+  // fromUs 뒤에 끝나는 세션 수. 세션은 겹치지 않으므로 최신부터 [0, 이 값) 이 그 세션들
+  int countEndingAfter(int fromUs) => _sessions.length - _firstEndingAfter(fromUs);
+
+  // timeUs 가 속한 세션 (없으면 null)
+  MeasurementSession? sessionAt(int timeUs) {
+    final i = _firstEndingAfter(timeUs - 1);
+    if (i >= _sessions.length) return null;
+    final s = _sessions[i];
+    return s.startUs <= timeUs && timeUs <= s.endUs ? s : null;
+  }
+
+  // 세션 안의 기록: 저장소의 오름차순 인덱스 [start, end)
+  static (int, int) recordRange(HistoryStore store, MeasurementSession s) =>
+      (store.lowerBound(s.startUs), store.lowerBound(s.endUs + 1));
+
+  // 열린 세션(항상 마지막)을 닫음
+  void _close(MeasurementSession s, int endUs) {
+    s.open = false;
+    if (endUs > s.endUs) s.endUs = endUs;
+    _touch(_sessions.length - 1);
+  }
+
+  void _touch(int i) {
+    if (i >= 0 && i < _dirtyFrom) _dirtyFrom = i;
+  }
+
+  // endUs > timeUs 인 첫 인덱스
+  int _firstEndingAfter(int timeUs) {
+    int lo = 0, hi = _sessions.length;
+    while (lo < hi) {
+      final mid = (lo + hi) >> 1;
+      if (_sessions[mid].endUs <= timeUs) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+}
@@ -0,0 +1,23 @@
+// 펌웨어 신호 품질 플래그 (실시간 줄의 5번째 값, 0 = 정상)
+// 0 이 아니면 기기가 박동/SpO2 검출을 멈춘 구간이므로 저장/경고하지 않음
+class SignalQuality {
+  static const int CLIPPED = 0x01;  // ADC 포화
+  static const int LOW_PI = 0x02;   // 관류 지수 너무 낮음 (손가락 접촉 불량)
+  static const int HIGH_PI = 0x04;  // 관류 지수 너무 높음
+  static const int MOTION = 0x08;   // 움직임
+  static const int WARMUP = 0x10;   // 손가락 감지 직후
+
+  final int flags;
+
+  const SignalQuality(this.flags);
+
+  bool get isGood => flags == 0;
+
+  String get label {
+    if (flags == 0) return "양호";
+    if ((flags & WARMUP) != 0) return "측정 준비 중";
+    if ((flags & MOTION) != 0 || (flags & HIGH_PI) != 0) return "움직임 감지";
+    if ((flags & CLIPPED) != 0) return "신호 포화";
+    return "접촉 불량";
+  }
+}
@@ -0,0 +1,78 @@
+import 'package:audioplayers/audioplayers.dart';
+import 'package:flutter/material.dart';
+import 'package:flutter_local_notifications/flutter_local_notifications.dart';
+
+import '../models/latency_histogram.dart';
+
+// 경고음 + 알림
+// 시작할 때 경고음을 저지연 플레이어(Android SoundPool)에 미리 올리고 음량 0으로 한 번 재생해
+// 디코더/오디오 경로를 깨워둠. 경고 시에는 resume() 만 호출하므로 MP3 를 다시 읽지 않음.
+// 알림 내용(채널/중요도)도 미리 만들어 두고, 소리와 알림을 순서대로 기다리지 않고 함께 시작.
+//
+// 지연 = 경고를 일으킨 샘플 시각(ClockSync 로 변환한 호스트 시각) -> 재생 시작 명령이 끝난 시각.
+// 실제 스피커 출력까지의 하드웨어 버퍼 지연(수십 ms)은 포함되지 않음.
+class AlertService {
+  static const String SOUND_ASSET = 'sounds/alert.mp3';
+  static const Duration LATENCY_TARGET = Duration(milliseconds: 500);
+
+  static const NotificationDetails _details = NotificationDetails(
+    android: AndroidNotificationDetails(
+      'health_alert_channel',
+      'Health Alerts',
+      importance: Importance.max,
+      priority: Priority.high,
+      color: Colors.red,
+      enableVibration: true,
+    ),
+  );
+
+  final AudioPlayer _player = AudioPlayer();
+  final FlutterLocalNotificationsPlugin _notifications = FlutterLocalNotificationsPlugin();
+  final LatencyHistogram latency = LatencyHistogram();
+  bool _soundReady = false;
+
+  Future<void> init() async {
+    const settings = InitializationSettings(
+      android: AndroidInitializationSettings('@mipmap/ic_launcher'),
+    );
+    await _notifications.initialize(settings);
+    try {
+      await _player.setPlayerMode(PlayerMode.lowLatency);
+      await _player.setReleaseMode(ReleaseMode.stop);
+      await _player.setSource(AssetSource(SOUND_ASSET));
+      await _player.setVolume(0);
+      await _player.resume();
+      await _player.stop();
+      await _player.setVolume(1);
+      _soundReady = true;
+    } catch (e) {
+      print("Audio preload Error: $e");
+    }
+  }
+
+  // 소리가 나기 시작하기까지의 지연을 돌려줌 (소리 재생 실패 시 null)
+  Future<Duration?> trigger(String message, int sampleTimeUs) async {
+    final notified = _notifications.show(0, '건강 위험 감지', message, _details);
+    Duration? took;
+    try {
+      if (_soundReady) {
+        await _player.stop();
+        await _player.resume();
+      } else {
+        await _player.play(AssetSource(SOUND_ASSET)); // 미리 올리지 못한 경우
+      }
+      took = Duration(
+          microseconds: DateTime.now().microsecondsSinceEpoch - sampleTimeUs);
+      latency.add(took);
+      if (took > LATENCY_TARGET) {
+        print("⚠️ 경고 지연 목표 초과: ${took.inMilliseconds}ms ($latency)");
+      }
+    } catch (e) {
+      print("Audio Error: $e");
+    }
+    await notified;
+    return took;
+  }
+
+  void dispose() => _player.dispose();
+}
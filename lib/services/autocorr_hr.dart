@@ -0,0 +1,146 @@
+import 'dart:math' as math;
+import 'dart:typed_data';
+
+// 자기상관 기반 심박 추정기 (기기의 2차 미분 영점 교차 검출과 별도로 앱에서 계산)
+// 파형 블록 샘플을 받아 HOP 마다 최근 WINDOW 초 구간의 자기상관을 구하고,
+// 40~200 BPM 에 해당하는 지연(lag) 중 최대 피크를 포물선 보간해 BPM 으로 환산.
+//
+// 25Hz 에서 8초 창 = 200샘플, 지연 7~38 -> 한 번 계산에 약 6천 번 곱셈이므로
+// 증분 갱신 대신 HOP 마다 전체를 다시 계산 (누적 오차 없음).
+// 곱셈은 Float32x4 로 4개씩 처리하고, 정렬되지 않은 지연을 위해 1~3칸 밀린 사본을 둠.
+class AutocorrHeartRate {
+  static const double MIN_BPM = 40;
+  static const double MAX_BPM = 200;
+  static const double WINDOW_SECONDS = 8;
+  static const double HPF_CUTOFF_HZ = 0.5;  // 기저선 변동 제거
+  static const double MIN_CONFIDENCE = 0.3; // 정규화 피크가 이보다 작으면 추정 안 함
+
+  final double sampleRate;
+  final int hopSamples;
+
+  late final int _window = (WINDOW_SECONDS * sampleRate).round();
+  late final int _minLag = math.max(2, (60 * sampleRate / MAX_BPM).floor());
+  late final int _maxLag = (60 * sampleRate / MIN_BPM).ceil();
+  late final double _hpfA = math.exp(-2 * math.pi * HPF_CUTOFF_HZ / sampleRate);
+
+  late final Float32List _history = Float32List(_window); // 링 버퍼
+  int _head = 0;
+  int _filled = 0;
+  int _sinceHop = 0;
+  double _lastIn = 0, _lastOut = 0;
+  bool _primed = false;
+
+  // 자기상관 계산용: _shifted[s][n] = 창의 (n + s) 번째 샘플, 창 밖은 0
+  late final int _padded = ((_window + _maxLag + 8) + 3) & ~3;
+  late final List<Float32List> _shifted = List.generate(4, (_) => Float32List(_padded));
+  late final List<Float32x4List> _lanes =
+      _shifted.map((s) => Float32x4List.view(s.buffer)).toList();
+  late final Float64List _corr = Float64List(_maxLag + 2);
+
+  double? bpm;           // 최근 추정값 (신뢰도 부족이면 null)
+  double confidence = 0; // r[lag] / r[0]
+
+  AutocorrHeartRate(this.sampleRate, {this.hopSamples = 10});
+
+  void reset() {
+    _head = 0;
+    _filled = 0;
+    _sinceHop = 0;
+    _primed = false;
+    bpm = null;
+    confidence = 0;
+  }
+
+  // 샘플을 넣고, 이번 호출에서 추정값이 갱신됐으면 true
+  bool addSamples(List<int> samples) {
+    bool updated = false;
+    for (final v in samples) {
+      final x = v.toDouble();
+      if (!_primed) {
+        _lastIn = x;
+        _lastOut = 0;
+        _primed = true;
+      }
+      // 1차 HPF: y = x - x1 + a*y1
+      _lastOut = x - _lastIn + _hpfA * _lastOut;
+      _lastIn = x;
+      _history[_head] = _lastOut;
+      _head = (_head + 1) % _window;
+      if (_filled < _window) _filled++;
+      if (++_sinceHop >= hopSamples) {
+        _sinceHop = 0;
+        if (_filled == _window) {
+          _estimate();
+          updated = true;
+        }
+      }
+    }
+    return updated;
+  }
+
+  void _estimate() {
+    // 오래된 것부터 순서대로 펼치고 평균 제거
+    final base = _shifted[0];
+    double mean = 0;
+    for (int n = 0; n < _window; n++) {
+      final v = _history[(_head + n) % _window];
+      base[n] = v;
+      mean += v;
+    }
+    mean /= _window;
+    for (int n = 0; n < _window; n++) {
+      base[n] -= mean;
+    }
+    for (int s = 1; s < 4; s++) {
+      final dst = _shifted[s];
+      dst.setRange(0, _window - s, base, s);
+      dst.fillRange(_window - s, _padded, 0);
+    }
+
+    final a = _lanes[0];
+    final quads = (_window + 3) >> 2;
+    for (int k = 0; k <= _maxLag + 1; k++) {
+      if (k != 0 && k < _minLag - 1) continue;
+      final b = _lanes[k & 3];
+      final q = k >> 2;
+      var acc = Float32x4.zero();
+      for (int i = 0; i < quads; i++) {
+        acc += a[i] * b[i + q];
+      }
+      _corr[k] = acc.x + acc.y + acc.z + acc.w;
+    }
+
+    final r0 = _corr[0];
+    if (r0 <= 0) {
+      bpm = null;
+      confidence = 0;
+      return;
+    }
+    int best = _minLag;
+    for (int k = _minLag + 1; k <= _maxLag; k++) {
+      if (_corr[k] > _corr[best]) best = k;
+    }
+    // 주기의 배수(2T, 3T..) 피크를 고른 경우: 1/m 지연 근처에도 충분히 큰 피크가 있으면 그쪽을 택함
+    // (25Hz 에서 빠른 심박은 지연이 정수에서 벗어나 배수 쪽 피크가 더 크게 나올 수 있음)
+    final top = best;
+    for (int m = 2; m <= 4; m++) {
+      final cand = (top / m).round();
+      if (cand < _minLag) break;
+      int k = math.max(cand - 1, _minLag);
+      for (int j = k + 1; j <= cand + 1; j++) {
+        if (_corr[j] > _corr[k]) k = j;
+      }
+      if (_corr[k] > 0.7 * _corr[top]) best = k;
+    }
+
+    confidence = _corr[best] / r0;
+    if (confidence < MIN_CONFIDENCE || best <= _minLag || best >= _maxLag) {
+      bpm = null;
+      return;
+    }
+    final y0 = _corr[best - 1], y1 = _corr[best], y2 = _corr[best + 1];
+    final denom = y0 - 2 * y1 + y2;
+    final delta = denom != 0 ? 0.5 * (y0 - y2) / denom : 0.0;
+    bpm = 60 * sampleRate / (best + delta.clamp(-0.5, 0.5));
+  }
+}
@@ -0,0 +1,96 @@
+import 'dart:collection';
+
+// 기기 샘플 카운터 -> 호스트 시각(epoch µs) 변환
+// 실시간 줄마다 (샘플 번호, 수신 시각) 한 쌍을 받음. 수신 시각 = 전송 시각 + 지연(>=0, 들쭉날쭉)
+// 이므로 WINDOW_US 구간마다 지연이 가장 작았던 점(하한)만 남기고, 그 점들로
+// host = offset + period * ticks 직선을 맞춤. period 가 공칭값과 다른 만큼이 센서 발진기의 drift.
+class ClockSync {
+  static const int WINDOW_US = 10 * 1000000;
+  static const int MAX_POINTS = 60; // 10분
+  static const int MIN_FIT_SPAN_US = 60 * 1000000; // 이보다 짧으면 공칭 주기 사용
+
+  double _nominalPeriodUs = 0;
+  double _periodUs = 0; // 추정한 샘플 주기 (µs/sample)
+  double _offsetUs = 0; // ticks = 0 의 호스트 시각
+  bool _synced = false;
+  int? _lastTicks;
+
+  // 현재 구간의 하한 후보
+  int _windowStart = 0;
+  int? _minTicks;
+  int _minHost = 0;
+  final ListQueue<List<int>> _points = ListQueue(); // [ticks, hostUs]
+
+  bool get isSynced => _synced;
+  int? get lastTicks => _lastTicks; // 마지막으로 관측한 샘플 번호
+  double get periodUs => _periodUs;
+  double get driftPpm => _nominalPeriodUs > 0 ? (_periodUs / _nominalPeriodUs - 1) * 1e6 : 0;
+
+  void reset() {
+    _synced = false;
+    _lastTicks = null;
+    _minTicks = null;
+    _points.clear();
+  }
+
+  // 기기가 재부팅(카운터 감소)되거나 샘플레이트가 바뀌면 처음부터 다시 맞춤
+  void observe(int ticks, int hostUs, double nominalPeriodUs) {
+    final last = _lastTicks;
+    if (nominalPeriodUs != _nominalPeriodUs || (last != null && ticks < last)) {
+      reset();
+      _nominalPeriodUs = nominalPeriodUs;
+      _periodUs = nominalPeriodUs;
+    }
+    _lastTicks = ticks;
+
+    final minTicks = _minTicks;
+    if (minTicks == null) {
+      _windowStart = hostUs;
+    }
+    if (minTicks == null || _residual(ticks, hostUs) < _residual(minTicks, _minHost)) {
+      _minTicks = ticks;
+      _minHost = hostUs;
+    }
+    if (!_synced) {
+      // 첫 구간이 끝나기 전에도 지금까지의 하한으로 바로 변환 가능하게
+      _offsetUs = _minHost - _periodUs * _minTicks!;
+      _synced = true;
+    }
+    if (hostUs - _windowStart >= WINDOW_US) {
+      _points.add([_minTicks!, _minHost]);
+      if (_points.length > MAX_POINTS) _points.removeFirst();
+      _minTicks = null;
+      _fit();
+    }
+  }
+
+  int toHostMicros(int ticks) => (_offsetUs + _periodUs * ticks).round();
+
+  double _residual(int ticks, int hostUs) => hostUs - _periodUs * ticks;
+
+  void _fit() {
+    final first = _points.first, last = _points.last;
+    if (_points.length >= 3 && last[1] - first[1] >= MIN_FIT_SPAN_US) {
+      // 최소제곱 (첫 점 기준 상대값으로 계산해 double 정밀도 유지)
+      double sx = 0, sy = 0, sxx = 0, sxy = 0;
+      for (final p in _points) {
+        final x = (p[0] - first[0]).toDouble();
+        final y = (p[1] - first[1]).toDouble();
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+      }
+      final n = _points.length;
+      final denom = n * sxx - sx * sx;
+      if (denom > 0) _periodUs = (n * sxy - sx * sy) / denom;
+    }
+    // 기울기를 정한 뒤 모든 하한 점 아래를 지나도록 절편을 잡음 (지연은 음수가 될 수 없음)
+    double offset = double.infinity;
+    for (final p in _points) {
+      final o = p[1] - _periodUs * p[0];
+      if (o < offset) offset = o;
+    }
+    _offsetUs = offset;
+  }
+}
@@ -0,0 +1,50 @@
+import 'dart:typed_data';
+
+import '../models/health_log.dart';
+import '../models/history_store.dart';
+
+// 백필 ('H' 프레임) 디코더: 링크가 끊긴 동안 기기가 EEPROM 에 쌓아둔 기록
+// payload: seq, 남은 기록 수(LE 2byte), n, 기록 x n
+// 기록: sample_no(LE 4byte, 실시간 줄의 마지막 필드와 같은 카운터), BPM, SpO2
+class HistoryBatch {
+  static const int FRAME_TYPE = 0x48; // 'H'
+  static const int RECORD_SIZE = 6;
+
+  final int seq;
+  final int remaining;
+  final Uint32List ticks; // 오래된 것부터, 오름차순
+  final Uint8List bpm;
+  final Uint8List spo2;
+
+  HistoryBatch(this.seq, this.remaining, this.ticks, this.bpm, this.spo2);
+
+  int get length => ticks.length;
+
+  static HistoryBatch decode(Uint8List payload) {
+    final data = ByteData.sublistView(payload);
+    final count = payload[3];
+    final ticks = Uint32List(count);
+    final bpm = Uint8List(count);
+    final spo2 = Uint8List(count);
+    for (int i = 0; i < count; i++) {
+      final pos = 4 + i * RECORD_SIZE;
+      ticks[i] = data.getUint32(pos, Endian.little);
+      bpm[i] = payload[pos + 4];
+      spo2[i] = payload[pos + 5];
+    }
+    return HistoryBatch(payload[0], data.getUint16(1, Endian.little), ticks, bpm, spo2);
+  }
+
+  // afterTicks 보다 뒤의 기록만 (확인이 늦어 다시 받은 배치의 앞부분은 건너뜀).
+  // 시각은 실시간 줄과 같은 시계 추정(toHostMicros)으로 변환
+  List<HealthLog> logsAfter(int afterTicks, int Function(int ticks) toHostMicros) => [
+        for (int i = 0; i < length; i++)
+          if (ticks[i] > afterTicks)
+            HealthLog(
+              timeUs: toHostMicros(ticks[i]),
+              bpm: bpm[i].toDouble(),
+              spo2: spo2[i].toDouble(),
+              flags: HistoryStore.FLAG_BACKFILL,
+            ),
+      ];
+}
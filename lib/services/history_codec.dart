@@ -0,0 +1,289 @@
+import 'dart:typed_data';
+
+import '../models/history_store.dart';
+
+// 기록 파일 코덱 (health_log.vlog)
+//
+// "VLOG" + 버전(1) 뒤에 블록 반복. 블록 = 헤더(29byte) + 비트 단위로 채운 열 데이터.
+// 헤더 (LE): 데이터 길이 u32, 기록 수 u16, 플래그 OR u8, 첫 시각 i64, 마지막 시각 i64,
+//            BPM 최소/최대 u8 x2, SpO2 최소/최대 u16 x2 (0.1%)
+// -> 구간/값 조건에 맞지 않는 블록은 헤더만 읽고 데이터 길이만큼 건너뜀.
+//
+// 데이터는 열 순서대로 (각 값은 zigzag 후 가변 폭 버킷: 접두 1 의 개수로 폭 선택, 0 이면 값 없음)
+//   시각: 첫 값은 헤더, 두 번째는 차분, 이후는 차분의 차분 (저장 주기가 일정하면 대부분 1비트)
+//   BPM / SpO2: 직전 값과의 차분
+//   플래그: 직전 값과의 XOR
+//   HRV (FLAG_HRV 기록만): SDNN / RMSSD / 불규칙 지수, 직전 HRV 기록과의 차분
+// JSON 한 줄(약 45~60byte) 대신 기록당 5~6byte.
+class HistoryCodec {
+  static const List<int> MAGIC = [0x56, 0x4C, 0x4F, 0x47]; // "VLOG"
+  static const int VERSION = 1;
+  static const int FILE_HEADER_SIZE = 5;
+  static const int BLOCK_HEADER_SIZE = 29;
+  // 블록당 기록 수. 저장할 때 바뀐 블록부터 다시 쓰므로 작을수록 저장이 가볍고, 클수록 헤더가 적음
+  static const int BLOCK_RECORDS = 256;
+
+  static const List<int> _TIME_WIDTHS = [0, 12, 22, 32, 64]; // µs: 지터 / 1초 단위 밀림 / 긴 공백
+  static const List<int> _BPM_WIDTHS = [0, 3, 5, 9];
+  static const List<int> _SPO2_WIDTHS = [0, 3, 6, 10, 17];
+  static const List<int> _FLAG_WIDTHS = [0, 8];
+  static const List<int> _HRV_WIDTHS = [0, 4, 8, 17];
+  static const List<int> _IRREGULARITY_WIDTHS = [0, 4, 8];
+
+  static Uint8List fileHeader() => Uint8List.fromList([...MAGIC, VERSION]);
+
+  // 저장소의 오름차순 [start, end) 기록 -> 블록 하나
+  static Uint8List encodeBlock(HistoryStore store, int start, int end) {
+    final times = store.timeColumn, bpm = store.bpmColumn, spo2 = store.spo2Column;
+    final flags = store.flagsColumn;
+    final sdnn = store.sdnnColumn, rmssd = store.rmssdColumn, irr = store.irregularityColumn;
+    final bits = _BitWriter();
+
+    for (int i = start + 1; i < end; i++) {
+      final delta = times[i] - times[i - 1];
+      bits.writeVar(_zigzag(i == start + 1 ? delta : delta - (times[i - 1] - times[i - 2])),
+          _TIME_WIDTHS);
+    }
+    int prev = 0;
+    for (int i = start; i < end; i++) {
+      bits.writeVar(_zigzag(bpm[i] - prev), _BPM_WIDTHS);
+      prev = bpm[i];
+    }
+    prev = 0;
+    for (int i = start; i < end; i++) {
+      bits.writeVar(_zigzag(spo2[i] - prev), _SPO2_WIDTHS);
+      prev = spo2[i];
+    }
+    prev = 0;
+    int flagsAny = 0;
+    for (int i = start; i < end; i++) {
+      bits.writeVar(flags[i] ^ prev, _FLAG_WIDTHS);
+      prev = flags[i];
+      flagsAny |= flags[i];
+    }
+    int prevSdnn = 0, prevRmssd = 0, prevIrr = 0;
+    for (int i = start; i < end; i++) {
+      if ((flags[i] & HistoryStore.FLAG_HRV) == 0) continue;
+      bits.writeVar(_zigzag(sdnn[i] - prevSdnn), _HRV_WIDTHS);
+      bits.writeVar(_zigzag(rmssd[i] - prevRmssd), _HRV_WIDTHS);
+      bits.writeVar(_zigzag(irr[i] - prevIrr), _IRREGULARITY_WIDTHS);
+      prevSdnn = sdnn[i];
+      prevRmssd = rmssd[i];
+      prevIrr = irr[i];
+    }
+    final payload = bits.finish();
+
+    int minBpm = 255, maxBpm = 0, minSpo2 = 0xFFFF, maxSpo2 = 0;
+    for (int i = start; i < end; i++) {
+      if (bpm[i] < minBpm) minBpm = bpm[i];
+      if (bpm[i] > maxBpm) maxBpm = bpm[i];
+      if (spo2[i] < minSpo2) minSpo2 = spo2[i];
+      if (spo2[i] > maxSpo2) maxSpo2 = spo2[i];
+    }
+    final out = Uint8List(BLOCK_HEADER_SIZE + payload.length);
+    ByteData.sublistView(out)
+      ..setUint32(0, payload.length, Endian.little)
+      ..setUint16(4, end - start, Endian.little)
+      ..setUint8(6, flagsAny)
+      ..setInt64(7, times[start], Endian.little)
+      ..setInt64(15, times[end - 1], Endian.little)
+      ..setUint8(23, minBpm)
+      ..setUint8(24, maxBpm)
+      ..setUint16(25, minSpo2, Endian.little)
+      ..setUint16(27, maxSpo2, Endian.little);
+    out.setRange(BLOCK_HEADER_SIZE, out.length, payload);
+    return out;
+  }
+
+  // 헤더만 훑어 블록 목록을 만듦. 쓰다 끊겨 잘린 마지막 블록은 빠짐
+  static List<HistoryBlockInfo> scan(Uint8List bytes) {
+    if (bytes.length < FILE_HEADER_SIZE) throw const FormatException('VLOG 헤더 없음');
+    for (int k = 0; k < MAGIC.length; k++) {
+      if (bytes[k] != MAGIC[k]) throw const FormatException('VLOG 헤더 없음');
+    }
+    if (bytes[4] != VERSION) throw FormatException('지원하지 않는 버전 ${bytes[4]}');
+    final blocks = <HistoryBlockInfo>[];
+    int pos = FILE_HEADER_SIZE;
+    while (pos + BLOCK_HEADER_SIZE <= bytes.length) {
+      final info = HistoryBlockInfo.read(ByteData.sublistView(bytes, pos, pos + BLOCK_HEADER_SIZE), pos);
+      if (info.end > bytes.length || info.count == 0) break;
+      blocks.add(info);
+      pos = info.end;
+    }
+    return blocks;
+  }
+
+  // 블록 하나를 저장소에 넣음 (블록은 시간순이므로 보통 끝에 덧붙음)
+  static void decodeBlock(Uint8List bytes, HistoryBlockInfo block, HistoryStore into) {
+    final n = block.count;
+    final bits = _BitReader(bytes, block.offset + BLOCK_HEADER_SIZE, block.end);
+    final times = Int64List(n);
+    times[0] = block.firstTimeUs;
+    int delta = 0;
+    for (int k = 1; k < n; k++) {
+      final v = _unzigzag(bits.readVar(_TIME_WIDTHS));
+      delta = k == 1 ? v : delta + v;
+      times[k] = times[k - 1] + delta;
+    }
+    final bpm = Int32List(n), spo2 = Int32List(n), flags = Int32List(n);
+    int prev = 0;
+    for (int k = 0; k < n; k++) {
+      bpm[k] = prev += _unzigzag(bits.readVar(_BPM_WIDTHS));
+    }
+    prev = 0;
+    for (int k = 0; k < n; k++) {
+      spo2[k] = prev += _unzigzag(bits.readVar(_SPO2_WIDTHS));
+    }
+    prev = 0;
+    for (int k = 0; k < n; k++) {
+      flags[k] = prev ^= bits.readVar(_FLAG_WIDTHS);
+    }
+    int sdnn = 0, rmssd = 0, irr = 0;
+    for (int k = 0; k < n; k++) {
+      final hrv = (flags[k] & HistoryStore.FLAG_HRV) != 0;
+      if (hrv) {
+        sdnn += _unzigzag(bits.readVar(_HRV_WIDTHS));
+        rmssd += _unzigzag(bits.readVar(_HRV_WIDTHS));
+        irr += _unzigzag(bits.readVar(_IRREGULARITY_WIDTHS));
+      }
+      into.add(times[k], bpm[k].toDouble(), spo2[k] / HistoryStore.SPO2_SCALE,
+          flags: flags[k],
+          sdnn: hrv ? sdnn : null,
+          rmssd: hrv ? rmssd : null,
+          irregularity: hrv ? irr : null);
+    }
+  }
+
+  // 파일 전체 (또는 조건에 맞는 블록만) -> 저장소. from/to 는 [from, to) epoch µs
+  static HistoryStore decode(Uint8List bytes,
+      {int? fromUs, int? toUs, bool Function(HistoryBlockInfo block)? where}) {
+    final store = HistoryStore();
+    for (final block in scan(bytes)) {
+      if (fromUs != null && block.lastTimeUs < fromUs) continue;
+      if (toUs != null && block.firstTimeUs >= toUs) continue;
+      if (where != null && !where(block)) continue;
+      decodeBlock(bytes, block, store);
+    }
+    return store;
+  }
+
+  static int _zigzag(int v) => (v << 1) ^ (v >> 63);
+  static int _unzigzag(int z) => (z >>> 1) ^ -(z & 1);
+}
+
+// 블록 헤더 (건너뛰기 판단용)
+class HistoryBlockInfo {
+  final int offset;        // 파일 안의 블록 시작 위치
+  final int payloadBytes;
+  final int count;
+  final int flagsAny;      // 블록 안 기록 플래그의 OR (예: 경고 기록이 있는 블록만)
+  final int firstTimeUs;
+  final int lastTimeUs;
+  final int minBpm, maxBpm;
+  final int minSpo2, maxSpo2; // 0.1% 단위
+
+  HistoryBlockInfo({
+    required this.offset,
+    required this.payloadBytes,
+    required this.count,
+    required this.flagsAny,
+    required this.firstTimeUs,
+    required this.lastTimeUs,
+    required this.minBpm,
+    required this.maxBpm,
+    required this.minSpo2,
+    required this.maxSpo2,
+  });
+
+  factory HistoryBlockInfo.read(ByteData h, int offset) => HistoryBlockInfo(
+        offset: offset,
+        payloadBytes: h.getUint32(0, Endian.little),
+        count: h.getUint16(4, Endian.little),
+        flagsAny: h.getUint8(6),
+        firstTimeUs: h.getInt64(7, Endian.little),
+        lastTimeUs: h.getInt64(15, Endian.little),
+        minBpm: h.getUint8(23),
+        maxBpm: h.getUint8(24),
+        minSpo2: h.getUint16(25, Endian.little),
+        maxSpo2: h.getUint16(27, Endian.little),
+      );
+
+  int get end => offset + HistoryCodec.BLOCK_HEADER_SIZE + payloadBytes;
+}
+
+// MSB 부터 채우는 비트 쓰기
+class _BitWriter {
+  Uint8List _buf = Uint8List(512);
+  int _length = 0;
+  int _acc = 0;  // 아직 바이트를 채우지 못한 비트
+  int _bits = 0; // _acc 의 비트 수 (< 8)
+
+  // 접두(버킷 번호만큼 1, 마지막 버킷이 아니면 0) + 그 버킷 폭의 값
+  void writeVar(int z, List<int> widths) {
+    final last = widths.length - 1;
+    int k = 0;
+    while (k < last && (z < 0 || widths[k] < 63 && z >= (1 << widths[k]))) {
+      k++;
+    }
+    for (int j = 0; j < k; j++) {
+      _write(1, 1);
+    }
+    if (k < last) _write(0, 1);
+    final w = widths[k];
+    if (w > 32) {
+      _write((z >> 32) & ((1 << (w - 32)) - 1), w - 32);
+      _write(z & 0xFFFFFFFF, 32);
+    } else if (w > 0) {
+      _write(z, w);
+    }
+  }
+
+  void _write(int value, int bits) {
+    _acc = (_acc << bits) | value;
+    _bits += bits;
+    while (_bits >= 8) {
+      _bits -= 8;
+      if (_length == _buf.length) _buf = (Uint8List(_buf.length * 2)..setRange(0, _length, _buf));
+      _buf[_length++] = (_acc >> _bits) & 0xFF;
+    }
+    _acc &= (1 << _bits) - 1;
+  }
+
+  Uint8List finish() {
+    if (_bits > 0) _write(0, 8 - _bits);
+    return Uint8List.sublistView(_buf, 0, _length);
+  }
+}
+
+class _BitReader {
+  final Uint8List _bytes;
+  int _pos;
+  final int _end;
+  int _acc = 0;
+  int _bits = 0;
+
+  _BitReader(this._bytes, this._pos, this._end);
+
+  int readVar(List<int> widths) {
+    final last = widths.length - 1;
+    int k = 0;
+    while (k < last && _read(1) == 1) {
+      k++;
+    }
+    final w = widths[k];
+    if (w > 32) return (_read(w - 32) << 32) | _read(32);
+    return w > 0 ? _read(w) : 0;
+  }
+
+  int _read(int bits) {
+    while (_bits < bits) {
+      if (_pos >= _end) throw const FormatException('블록 데이터가 잘림');
+      _acc = (_acc << 8) | _bytes[_pos++];
+      _bits += 8;
+    }
+    _bits -= bits;
+    final v = (_acc >> _bits) & ((1 << bits) - 1);
+    _acc &= (1 << _bits) - 1;
+    return v;
+  }
+}
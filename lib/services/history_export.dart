@@ -0,0 +1,311 @@
+import 'dart:async';
+import 'dart:collection';
+import 'dart:io';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import '../models/history_store.dart';
+
+enum ExportFormat {
+  csv('CSV', 'csv'),
+  binary('바이너리', 'hlog');
+
+  final String label;
+  final String extension;
+  const ExportFormat(this.label, this.extension);
+}
+
+// 기록 내보내기 (CSV / 열 단위 바이너리)
+// 저장소에서 CHUNK 개씩 잘라 백그라운드 isolate 로 보내 인코딩하고, 결과를 파일에 순서대로 씀.
+// 동시에 MAX_IN_FLIGHT 개 청크만 진행하고 청크마다 flush 를 기다리므로
+// 기록이 몇 달 치여도 메모리는 청크 몇 개 분량으로 일정하고 UI 스레드는 복사만 함.
+class HistoryExporter {
+  static const int CHUNK = 8192;
+  static const int MAX_IN_FLIGHT = 2;
+
+  // 내보낸 기록 수를 돌려줌. from/to 는 [from, to), minInterval 은 이 간격보다 촘촘한 기록을 솎아냄
+  static Future<int> export(
+    HistoryStore store,
+    File file, {
+    required ExportFormat format,
+    DateTime? from,
+    DateTime? to,
+    Duration? minInterval,
+    void Function(double progress)? onProgress,
+  }) async {
+    final start = from == null ? 0 : store.lowerBound(from.microsecondsSinceEpoch);
+    final end = to == null ? store.length : store.lowerBound(to.microsecondsSinceEpoch);
+    final worker = await _EncoderWorker.spawn(format, minInterval?.inMicroseconds ?? 0);
+    final sink = file.openWrite();
+    final pending = ListQueue<Future<_Encoded>>();
+    int exported = 0;
+    int done = 0;
+
+    Future<void> writeOldest() async {
+      final encoded = await pending.removeFirst();
+      sink.add(encoded.bytes);
+      await sink.flush(); // 파일 쓰기가 인코딩보다 느리면 여기서 기다림
+      exported += encoded.records;
+      done += encoded.scanned;
+      onProgress?.call(end > start ? done / (end - start) : 1);
+    }
+
+    try {
+      sink.add(HistoryChunkEncoder.header(format));
+      for (int pos = start; pos < end; pos += CHUNK) {
+        // 도중에 기록이 추가돼도 [start, end) 범위는 그대로 (백필이 끼어들어 밀린 중복은 인코더가 거름)
+        final n = (end - pos) < CHUNK ? end - pos : CHUNK;
+        pending.add(worker.encode(_packChunk(store, pos, n), n));
+        if (pending.length >= MAX_IN_FLIGHT) await writeOldest();
+      }
+      while (pending.isNotEmpty) {
+        await writeOldest();
+      }
+    } finally {
+      await sink.close();
+      worker.close();
+    }
+    return exported;
+  }
+
+  // 열 4개를 버퍼 하나로 묶어 복사 없이 넘김 (정렬: 시각 8n, SpO2 2n, BPM n, 플래그 n)
+  static TransferableTypedData _packChunk(HistoryStore store, int pos, int n) {
+    return TransferableTypedData.fromList([
+      Int64List.sublistView(store.timeColumn, pos, pos + n),
+      Uint16List.sublistView(store.spo2Column, pos, pos + n),
+      Uint8List.sublistView(store.bpmColumn, pos, pos + n),
+      Uint8List.sublistView(store.flagsColumn, pos, pos + n),
+    ]);
+  }
+}
+
+// 청크 인코더 (isolate 안에서 실행, 청크 사이의 상태 유지)
+//
+// CSV: time,epoch_us,bpm,spo2,flags
+// 바이너리: "HLOG" + 버전(1) 뒤에 블록 반복
+//   블록 = varint(개수) + varint(첫 시각) + varint(시각 차분) x (개수-1)
+//          + BPM x 개수 + SpO2(LE u16, 0.1%) x 개수 + 플래그 x 개수
+class HistoryChunkEncoder {
+  static const List<int> MAGIC = [0x48, 0x4C, 0x4F, 0x47]; // "HLOG"
+  static const int VERSION = 1;
+
+  final ExportFormat format;
+  final int minIntervalUs;
+  int? _lastTime;
+
+  HistoryChunkEncoder(this.format, this.minIntervalUs);
+
+  static Uint8List header(ExportFormat format) {
+    if (format == ExportFormat.csv) {
+      return Uint8List.fromList('time,epoch_us,bpm,spo2,flags\n'.codeUnits);
+    }
+    return Uint8List.fromList([...MAGIC, VERSION]);
+  }
+
+  // 솎아내기/중복 제거 후 남은 기록 수와 인코딩 결과
+  (Uint8List, int) encode(Int64List times, Uint8List bpm, Uint16List spo2, Uint8List flags) {
+    final keep = <int>[];
+    for (int i = 0; i < times.length; i++) {
+      final t = times[i];
+      final last = _lastTime;
+      if (last != null && (t <= last || t - last < minIntervalUs)) continue;
+      _lastTime = t;
+      keep.add(i);
+    }
+    if (keep.isEmpty) return (Uint8List(0), 0);
+    return format == ExportFormat.csv
+        ? (_csv(keep, times, bpm, spo2, flags), keep.length)
+        : (_binary(keep, times, bpm, spo2, flags), keep.length);
+  }
+
+  Uint8List _csv(List<int> keep, Int64List times, Uint8List bpm, Uint16List spo2, Uint8List flags) {
+    final sb = StringBuffer();
+    for (final i in keep) {
+      final t = DateTime.fromMicrosecondsSinceEpoch(times[i]);
+      sb
+        ..write(_local(t))
+        ..write(',')
+        ..write(times[i])
+        ..write(',')
+        ..write(bpm[i])
+        ..write(',')
+        ..write(spo2[i] ~/ HistoryStore.SPO2_SCALE)
+        ..write('.')
+        ..write(spo2[i] % HistoryStore.SPO2_SCALE)
+        ..write(',')
+        ..write(flags[i])
+        ..write('\n');
+    }
+    return Uint8List.fromList(sb.toString().codeUnits);
+  }
+
+  static String _local(DateTime t) {
+    String two(int v) => v.toString().padLeft(2, '0');
+    return '${t.year}-${two(t.month)}-${two(t.day)} ${two(t.hour)}:${two(t.minute)}:${two(t.second)}';
+  }
+
+  Uint8List _binary(List<int> keep, Int64List times, Uint8List bpm, Uint16List spo2, Uint8List flags) {
+    final out = BytesBuilder(copy: false);
+    final varints = BytesBuilder();
+    _varint(varints, keep.length);
+    int prev = 0;
+    for (final i in keep) {
+      _varint(varints, times[i] - prev); // 첫 값은 절대 시각, 이후는 양수 차분
+      prev = times[i];
+    }
+    out.add(varints.takeBytes());
+    final n = keep.length;
+    final cols = Uint8List(n * 4);
+    final spo2Bytes = ByteData.sublistView(cols, n, n * 3);
+    for (int k = 0; k < n; k++) {
+      final i = keep[k];
+      cols[k] = bpm[i];
+      spo2Bytes.setUint16(k * 2, spo2[i], Endian.little);
+      cols[n * 3 + k] = flags[i];
+    }
+    out.add(cols);
+    return out.takeBytes();
+  }
+
+  static void _varint(BytesBuilder out, int v) {
+    while (v >= 0x80) {
+      out.addByte((v & 0x7F) | 0x80);
+      v >>= 7;
+    }
+    out.addByte(v);
+  }
+
+  // 바이너리 파일을 저장소로 다시 읽음 (가져오기/검증용)
+  static HistoryStore decodeBinary(Uint8List bytes) {
+    for (int k = 0; k < MAGIC.length; k++) {
+      if (bytes[k] != MAGIC[k]) throw const FormatException('HLOG 헤더 없음');
+    }
+    if (bytes[4] != VERSION) throw FormatException('지원하지 않는 버전 ${bytes[4]}');
+    final store = HistoryStore();
+    int pos = 5;
+    int readVarint() {
+      int v = 0, shift = 0, b;
+      do {
+        b = bytes[pos++];
+        v |= (b & 0x7F) << shift;
+        shift += 7;
+      } while ((b & 0x80) != 0);
+      return v;
+    }
+
+    while (pos < bytes.length) {
+      final n = readVarint();
+      final times = Int64List(n);
+      int t = 0;
+      for (int k = 0; k < n; k++) {
+        t += readVarint();
+        times[k] = t;
+      }
+      final data = ByteData.sublistView(bytes, pos, pos + n * 4);
+      for (int k = 0; k < n; k++) {
+        store.add(times[k], bytes[pos + k].toDouble(),
+            data.getUint16(n + k * 2, Endian.little) / HistoryStore.SPO2_SCALE,
+            flags: bytes[pos + n * 3 + k]);
+      }
+      pos += n * 4;
+    }
+    return store;
+  }
+}
+
+class _WorkerState {
+  final ListQueue<(Completer<_Encoded>, int)> waiting = ListQueue();
+  Object? error;
+}
+
+class _Encoded {
+  final Uint8List bytes;
+  final int records;
+  final int scanned;
+  _Encoded(this.bytes, this.records, this.scanned);
+}
+
+// 인코딩 전용 isolate. 요청은 순서대로 처리되므로 응답도 같은 순서로 옴
+// 첫 메시지는 isolate 의 요청용 SendPort, 이후는 (인코딩 결과, 남은 기록 수).
+// isolate 안에서 예외가 나거나 isolate 가 끝나 버리면 (onError/onExit) 기다리던 요청을 모두 실패시킴
+class _EncoderWorker {
+  final Isolate _isolate;
+  final ReceivePort _port;
+  final SendPort _send;
+  final _WorkerState _state;
+
+  _EncoderWorker._(this._isolate, this._port, this._send, this._state);
+
+  static Future<_EncoderWorker> spawn(ExportFormat format, int minIntervalUs) async {
+    final port = ReceivePort();
+    final ready = Completer<SendPort>();
+    final state = _WorkerState();
+    void fail(Object error) {
+      state.error ??= error;
+      if (!ready.isCompleted) ready.completeError(error);
+      while (state.waiting.isNotEmpty) {
+        state.waiting.removeFirst().$1.completeError(error);
+      }
+    }
+
+    port.listen((msg) {
+      if (msg is SendPort) {
+        ready.complete(msg);
+      } else if (msg is List) {
+        // onError: [오류 문자열, 스택 문자열]
+        fail(RemoteError('${msg[0]}', '${msg[1]}'));
+      } else if (msg == null) {
+        // onExit (close() 로 끝낼 때는 포트를 먼저 닫으므로 오지 않음)
+        fail(StateError('내보내기 인코더 isolate 가 종료됨'));
+      } else if (state.waiting.isNotEmpty) {
+        final (completer, scanned) = state.waiting.removeFirst();
+        final (TransferableTypedData data, int records) = msg as (TransferableTypedData, int);
+        completer.complete(_Encoded(data.materialize().asUint8List(), records, scanned));
+      }
+    });
+    try {
+      final isolate = await Isolate.spawn(_main, (port.sendPort, format, minIntervalUs),
+          onError: port.sendPort, onExit: port.sendPort, errorsAreFatal: true);
+      return _EncoderWorker._(isolate, port, await ready.future, state);
+    } catch (_) {
+      port.close();
+      rethrow;
+    }
+  }
+
+  Future<_Encoded> encode(TransferableTypedData chunk, int n) {
+    final error = _state.error;
+    if (error != null) return Future<_Encoded>.error(error)..ignore();
+    final completer = Completer<_Encoded>();
+    _state.waiting.add((completer, n));
+    _send.send((chunk, n));
+    // 앞 청크가 실패하면 내보내기가 중단되어 뒤 청크는 아무도 기다리지 않으므로 처리되지 않은 오류로 보고하지 않음
+    return completer.future..ignore();
+  }
+
+  void close() {
+    _send.send(null);
+    _port.close();
+    _isolate.kill(priority: Isolate.beforeNextEvent);
+  }
+
+  static Future<void> _main((SendPort, ExportFormat, int) args) async {
+    final (reply, format, minIntervalUs) = args;
+    final requests = ReceivePort();
+    reply.send(requests.sendPort);
+    final encoder = HistoryChunkEncoder(format, minIntervalUs);
+    await for (final msg in requests) {
+      if (msg == null) break;
+      final (TransferableTypedData chunk, int n) = msg as (TransferableTypedData, int);
+      final buf = chunk.materialize();
+      final (bytes, records) = encoder.encode(
+        buf.asInt64List(0, n),
+        buf.asUint8List(n * 10, n),
+        buf.asUint16List(n * 8, n),
+        buf.asUint8List(n * 11, n),
+      );
+      reply.send((TransferableTypedData.fromList([bytes]), records));
+    }
+    requests.close();
+  }
+}
@@ -0,0 +1,105 @@
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:path_provider/path_provider.dart';
+
+import '../models/history_store.dart';
+import 'history_codec.dart';
+
+// 기록 파일 (앱 지원 폴더의 health_log.vlog, 형식은 HistoryCodec)
+// 저장소 오름차순 인덱스 [k x BLOCK_RECORDS, (k+1) x BLOCK_RECORDS) 가 블록 k.
+// 저장할 때는 아직 쓰지 않은 첫 기록이 든 블록부터 끝까지만 다시 씀:
+// 보통은 마지막 블록 하나(수 KB), 백필로 과거에 끼워 넣었으면 그 블록부터.
+// 쓰다가 끊겨 잘린 마지막 블록은 읽을 때 버려지고 다음 저장에서 다시 써짐.
+// Linux 데몬(linux/ingestd)도 같은 파일을 같은 방식으로 읽고 씀.
+class HistoryFile {
+  static const String FILE_NAME = 'health_log.vlog';
+
+  final Future<File> Function() _locate;
+  File? _file;
+  final List<int> _blockOffsets = []; // 블록 k 의 파일 내 시작 위치
+  int _end = 0;                       // 유효한 데이터의 끝 (0 = 파일 없음)
+  Future<void> _writing = Future.value();
+
+  // file: 테스트/벤치마크에서 임시 파일 지정. 없으면 앱 지원 폴더
+  HistoryFile({File? file})
+      : _locate = file != null
+            ? (() async => file)
+            : (() async => File('${(await getApplicationSupportDirectory()).path}/$FILE_NAME'));
+
+  Future<File> get file async => _file ??= await _locate();
+
+  // 파일 -> 저장소 (저장소는 비우고 채움). 파일이 없으면 false
+  Future<bool> load(HistoryStore into) async {
+    final f = await file;
+    into.clear();
+    _blockOffsets.clear();
+    _end = 0;
+    if (!await f.exists()) return false;
+    final bytes = await f.readAsBytes();
+    final blocks = HistoryCodec.scan(bytes);
+    bool aligned = true;
+    for (final block in blocks) {
+      // 앞 블록이 꽉 차 있어야 인덱스 -> 블록 대응이 맞음 (다른 블록 크기로 쓴 파일이면 전부 다시 씀)
+      if (into.length != _blockOffsets.length * HistoryCodec.BLOCK_RECORDS) aligned = false;
+      _blockOffsets.add(block.offset);
+      HistoryCodec.decodeBlock(bytes, block, into);
+    }
+    _end = blocks.isEmpty ? HistoryCodec.FILE_HEADER_SIZE : blocks.last.end;
+    into.markPersisted();
+    if (!aligned) _invalidate(into);
+    return true;
+  }
+
+  // 바뀐 블록부터 다시 씀. 저장이 겹치면 순서대로 (인코딩은 호출 시점의 저장소 기준)
+  Future<void> save(HistoryStore store) {
+    if (!store.isDirty && _end > 0) return _writing;
+    final first = store.dirtyFrom ~/ HistoryCodec.BLOCK_RECORDS;
+    final offset = first < _blockOffsets.length ? _blockOffsets[first] : _end;
+    final out = BytesBuilder(copy: false);
+    if (offset == 0) out.add(HistoryCodec.fileHeader());
+    _blockOffsets.length = first < _blockOffsets.length ? first : _blockOffsets.length;
+    int pos = offset == 0 ? HistoryCodec.FILE_HEADER_SIZE : offset;
+    for (int start = first * HistoryCodec.BLOCK_RECORDS; start < store.length;
+        start += HistoryCodec.BLOCK_RECORDS) {
+      final end = start + HistoryCodec.BLOCK_RECORDS < store.length
+          ? start + HistoryCodec.BLOCK_RECORDS
+          : store.length;
+      final block = HistoryCodec.encodeBlock(store, start, end);
+      _blockOffsets.add(pos);
+      pos += block.length;
+      out.add(block);
+    }
+    _end = pos;
+    store.markPersisted();
+    final bytes = out.takeBytes();
+    return _writing = _writing.then((_) => _write(offset, bytes), onError: (_) => _write(offset, bytes));
+  }
+
+  Future<void> clear() async {
+    _blockOffsets.clear();
+    _end = 0;
+    await _writing.catchError((_) {});
+    final f = await file;
+    if (await f.exists()) await f.delete();
+  }
+
+  Future<void> _write(int offset, Uint8List bytes) async {
+    final f = await file;
+    final raf = await f.open(mode: FileMode.append);
+    try {
+      await raf.truncate(offset);
+      await raf.setPosition(offset);
+      await raf.writeFrom(bytes);
+      await raf.flush();
+    } finally {
+      await raf.close();
+    }
+  }
+
+  void _invalidate(HistoryStore store) {
+    _blockOffsets.clear();
+    _end = 0;
+    store.markAllDirty();
+  }
+}
@@ -0,0 +1,167 @@
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:path_provider/path_provider.dart';
+
+import '../models/history_store.dart';
+import 'history_tiles.dart';
+
+// 타임라인 타일 캐시 (앱 지원 폴더의 health_log.tiles)
+// 기록 파일에서 언제든 다시 만들 수 있는 파생 데이터. 앱을 켤 때마다 몇 달 치 기록을
+// 다시 집계하지 않으려고 둠.
+// 헤더 32바이트 + 타일 항목(레벨, 키 16바이트 + 타일)의 나열. 타일은 처음 쓸 때 자리를 받고
+// 그 뒤에는 바뀐 타일만 제자리에 다시 씀.
+// 헤더의 기록 수/마지막 시각이 저장소와 맞으면 그 뒤에 붙은 기록만 더하고,
+// 맞지 않으면(과거에 끼워 넣음, 쓰다 끊김, 다른 형식) 저장소에서 다시 만듦.
+// 쓰는 동안에는 헤더의 기록 수를 -1 로 둬서 중간에 끊긴 캐시를 믿지 않음.
+class HistoryTileFile {
+  static const String FILE_NAME = 'health_log.tiles';
+  static const int MAGIC = 0x4C495456; // "VTIL"
+  static const int VERSION = 1;
+  static const int HEADER_SIZE = 32;
+  static const int ENTRY_HEADER = 16;
+  static const int ENTRY_SIZE = ENTRY_HEADER + HistoryTiles.TILE_BYTES;
+  // 자주 바뀌는 건 최신 타일 몇 개뿐이고 캐시가 늦어도 읽을 때 따라잡으므로 가끔만 씀
+  static const Duration SAVE_INTERVAL = Duration(minutes: 1);
+
+  final Future<File> Function() _locate;
+  File? _file;
+  final Map<int, int> _slots = {}; // (키, 레벨) -> 항목 번호
+  bool _rewrite = true;            // 다음 저장에서 파일 전체를 새로 씀
+  DateTime? _lastSave;
+  Future<void> _writing = Future.value();
+
+  // file: 테스트/벤치마크에서 임시 파일 지정. 없으면 앱 지원 폴더
+  HistoryTileFile({File? file})
+      : _locate = file != null
+            ? (() async => file)
+            : (() async => File('${(await getApplicationSupportDirectory()).path}/$FILE_NAME'));
+
+  Future<File> get file async => _file ??= await _locate();
+
+  // 캐시 -> 타일. 저장소에 맞춰 모자란 부분을 채우거나 다시 만듦. 캐시를 그대로 썼으면 true
+  // 읽은 뒤부터는 동기로 처리하므로 그사이 들어온 기록도 한 번씩만 반영됨
+  Future<bool> load(HistoryTiles into, HistoryStore store) async {
+    final f = await file;
+    Uint8List? bytes;
+    try {
+      if (await f.exists()) bytes = await f.readAsBytes();
+    } catch (e) {
+      print("타일 캐시 읽기 실패: $e");
+    }
+    into.clear();
+    _slots.clear();
+    _rewrite = true;
+    if (bytes != null) {
+      try {
+        if (_read(bytes, into) &&
+            into.recordCount <= store.length &&
+            store.lowerBound(into.lastTimeUs + 1) == into.recordCount) {
+          into.markClean();
+          into.addFromStore(store, into.recordCount);
+          _rewrite = false;
+          return true;
+        }
+      } catch (e) {
+        print("타일 캐시 읽기 실패: $e");
+      }
+    }
+    _slots.clear();
+    into.rebuild(store);
+    return false;
+  }
+
+  // 바뀐 타일만 씀. force 가 아니면 SAVE_INTERVAL 에 한 번
+  Future<void> save(HistoryTiles tiles, {bool force = false}) {
+    final now = DateTime.now();
+    if (!force && _lastSave != null && now.difference(_lastSave!) < SAVE_INTERVAL) return _writing;
+    if (!_rewrite && tiles.dirtyTiles.isEmpty) return _writing;
+    _lastSave = now;
+
+    final rewrite = _rewrite;
+    if (rewrite) _slots.clear();
+    final writes = <int, Uint8List>{}; // 항목 번호 -> 항목
+    for (final tile in rewrite ? tiles.tiles : tiles.dirtyTiles) {
+      final slot = _slots.putIfAbsent(tile.key * HistoryTiles.LEVELS + tile.level, () => _slots.length);
+      final entry = Uint8List(ENTRY_SIZE);
+      ByteData.sublistView(entry)
+        ..setUint8(0, tile.level)
+        ..setInt64(8, tile.key, Endian.little);
+      entry.setRange(ENTRY_HEADER, ENTRY_SIZE, tile.encode());
+      writes[slot] = entry;
+    }
+    tiles.markClean();
+    _rewrite = false;
+    final header = _header(tiles.recordCount, tiles.lastTimeUs);
+    Future<void> write() => _write(rewrite, writes, header);
+    return _writing = _writing.then((_) => write(), onError: (_) => write());
+  }
+
+  Future<void> clear() async {
+    _slots.clear();
+    _rewrite = true;
+    await _writing.catchError((_) {});
+    final f = await file;
+    if (await f.exists()) await f.delete();
+  }
+
+  bool _read(Uint8List bytes, HistoryTiles into) {
+    if (bytes.length < HEADER_SIZE) return false;
+    final data = ByteData.sublistView(bytes);
+    if (data.getUint32(0, Endian.little) != MAGIC ||
+        data.getUint16(4, Endian.little) != VERSION ||
+        data.getUint16(6, Endian.little) != HistoryTiles.LEVELS ||
+        data.getUint32(8, Endian.little) != HistoryTiles.BASE_BUCKET_US ~/ 1000000 ||
+        data.getUint32(12, Endian.little) != HistoryTiles.TILE_BUCKETS) {
+      return false;
+    }
+    final recordCount = data.getInt64(16, Endian.little);
+    if (recordCount < 0) return false;
+    final entries = (bytes.length - HEADER_SIZE) ~/ ENTRY_SIZE;
+    for (int i = 0; i < entries; i++) {
+      final pos = HEADER_SIZE + i * ENTRY_SIZE;
+      final level = data.getUint8(pos);
+      final key = data.getInt64(pos + 8, Endian.little);
+      if (level >= HistoryTiles.LEVELS) return false;
+      into.putTile(HistoryTile.decode(level, key, bytes, pos + ENTRY_HEADER));
+      _slots[key * HistoryTiles.LEVELS + level] = i;
+    }
+    into.recordCount = recordCount;
+    into.lastTimeUs = data.getInt64(24, Endian.little);
+    return true;
+  }
+
+  static Uint8List _header(int recordCount, int lastTimeUs) {
+    final out = Uint8List(HEADER_SIZE);
+    ByteData.sublistView(out)
+      ..setUint32(0, MAGIC, Endian.little)
+      ..setUint16(4, VERSION, Endian.little)
+      ..setUint16(6, HistoryTiles.LEVELS, Endian.little)
+      ..setUint32(8, HistoryTiles.BASE_BUCKET_US ~/ 1000000, Endian.little)
+      ..setUint32(12, HistoryTiles.TILE_BUCKETS, Endian.little)
+      ..setInt64(16, recordCount, Endian.little)
+      ..setInt64(24, lastTimeUs, Endian.little);
+    return out;
+  }
+
+  Future<void> _write(bool rewrite, Map<int, Uint8List> writes, Uint8List header) async {
+    final f = await file;
+    final raf = await f.open(mode: rewrite ? FileMode.write : FileMode.append);
+    try {
+      // 쓰는 동안은 무효 표시
+      await raf.setPosition(0);
+      await raf.writeFrom(_header(-1, 0));
+      await raf.flush();
+      for (final e in writes.entries) {
+        await raf.setPosition(HEADER_SIZE + e.key * ENTRY_SIZE);
+        await raf.writeFrom(e.value);
+      }
+      await raf.flush();
+      await raf.setPosition(0);
+      await raf.writeFrom(header);
+      await raf.flush();
+    } finally {
+      await raf.close();
+    }
+  }
+}
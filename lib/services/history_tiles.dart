@@ -0,0 +1,197 @@
+import 'dart:typed_data';
+
+import '../models/history_store.dart';
+
+// 기록 타임라인용 LOD 피라미드
+// 레벨 L 의 칸(bucket) 폭 = 1분 x 4^L (L = 0..6: 1분 ~ 약 2.8일), 칸 TILE_BUCKETS 개가 타일 하나.
+// 칸마다 개수와 심박/SpO2 의 최소/최대/합을 둠. 기록 하나가 들어오면 레벨마다 칸 하나만 갱신(O(레벨 수)),
+// 집계는 순서와 무관하므로 백필로 과거에 끼워 넣어도 같은 방식.
+// 화면에 보이는 구간은 칸 폭이 픽셀 폭 이하인 가장 거친 레벨의 타일만 읽으므로
+// 한 달을 보든 몇 분을 보든 그리는 칸 수는 화면 폭의 몇 배 이내. 1분보다 잘게 보면 원본 기록을 그림.
+class HistoryTiles {
+  static const int BASE_BUCKET_US = 60 * 1000000;
+  static const int LEVELS = 7;
+  static const int LEVEL_SHIFT = 2; // 레벨마다 칸 폭 x4
+  static const int TILE_BUCKETS = 256;
+
+  // 타일 직렬화: 칸마다 개수(u32) 심박 최소/최대(u8) 합(u32) SpO2 최소/최대(u16) 합(u32), 열 단위
+  static const int TILE_BYTES = TILE_BUCKETS * (4 + 1 + 1 + 4 + 2 + 2 + 4);
+
+  final List<Map<int, HistoryTile>> _levels =
+      List.generate(LEVELS, (_) => <int, HistoryTile>{});
+  final Set<HistoryTile> _dirty = {};
+
+  // 반영한 기록 수와 그중 가장 늦은 시각 (디스크 캐시가 저장소와 맞는지 확인용)
+  int recordCount = 0;
+  int lastTimeUs = 0;
+
+  static int bucketUs(int level) => BASE_BUCKET_US << (LEVEL_SHIFT * level);
+  static int tileUs(int level) => bucketUs(level) * TILE_BUCKETS;
+
+  Iterable<HistoryTile> get tiles => _levels.expand((l) => l.values);
+  Iterable<HistoryTile> get dirtyTiles => _dirty;
+  void markClean() => _dirty.clear();
+  bool get isEmpty => recordCount == 0;
+
+  void clear() {
+    for (final level in _levels) {
+      level.clear();
+    }
+    _dirty.clear();
+    recordCount = 0;
+    lastTimeUs = 0;
+  }
+
+  // 저장소에 넣은 값 그대로 (심박은 정수, SpO2 는 0.1% 단위)
+  void add(int timeUs, int bpm, int spo2Tenths) {
+    for (int level = 0; level < LEVELS; level++) {
+      final bucket = _floorDiv(timeUs, bucketUs(level));
+      final key = _floorDiv(bucket, TILE_BUCKETS);
+      final tile = _levels[level].putIfAbsent(key, () => HistoryTile(level, key));
+      tile.add(bucket - key * TILE_BUCKETS, bpm, spo2Tenths);
+      _dirty.add(tile);
+    }
+    recordCount++;
+    if (timeUs > lastTimeUs) lastTimeUs = timeUs;
+  }
+
+  // 저장소의 오름차순 인덱스 [from, to) 를 반영
+  void addFromStore(HistoryStore store, [int from = 0, int? to]) {
+    final time = store.timeColumn, bpm = store.bpmColumn, spo2 = store.spo2Column;
+    final end = to ?? store.length;
+    for (int i = from; i < end; i++) {
+      add(time[i], bpm[i], spo2[i]);
+    }
+  }
+
+  void rebuild(HistoryStore store) {
+    clear();
+    addFromStore(store);
+  }
+
+  // 디스크에서 읽은 타일 (HistoryTileFile)
+  void putTile(HistoryTile tile) => _levels[tile.level][tile.key] = tile;
+
+  // 폭 pixels 로 [fromUs, toUs) 를 그릴 때 쓸 레벨. 칸 하나가 한 픽셀보다 넓지 않은 가장 거친 레벨,
+  // 1분 칸도 한 픽셀보다 넓으면 -1 (원본 기록)
+  static int levelFor(int fromUs, int toUs, double pixels) {
+    final usPerPixel = (toUs - fromUs) / (pixels < 1 ? 1 : pixels);
+    int level = -1;
+    while (level + 1 < LEVELS && bucketUs(level + 1) <= usPerPixel) {
+      level++;
+    }
+    return level;
+  }
+
+  // [fromUs, toUs) 와 겹치는 칸 (빈 칸 제외, 시간 오름차순). 보이는 타일만 읽음
+  TimelineSeries query(int level, int fromUs, int toUs) {
+    final width = bucketUs(level);
+    final out = TimelineSeries(width);
+    final tiles = _levels[level];
+    final firstBucket = _floorDiv(fromUs, width);
+    final lastBucket = _floorDiv(toUs - 1, width);
+    for (int key = _floorDiv(firstBucket, TILE_BUCKETS);
+        key <= _floorDiv(lastBucket, TILE_BUCKETS); key++) {
+      final tile = tiles[key];
+      if (tile == null) continue;
+      final base = key * TILE_BUCKETS;
+      final lo = firstBucket > base ? firstBucket - base : 0;
+      final hi = lastBucket < base + TILE_BUCKETS - 1 ? lastBucket - base : TILE_BUCKETS - 1;
+      for (int b = lo; b <= hi; b++) {
+        final n = tile.count[b];
+        if (n == 0) continue;
+        out.add((base + b) * width, tile.bpmMin[b], tile.bpmMax[b], tile.bpmSum[b] / n,
+            tile.spo2Min[b] / HistoryStore.SPO2_SCALE, tile.spo2Max[b] / HistoryStore.SPO2_SCALE,
+            tile.spo2Sum[b] / n / HistoryStore.SPO2_SCALE);
+      }
+    }
+    return out;
+  }
+
+  // 원본 기록 구간 (가장 잘게 볼 때). 칸 폭 0
+  static TimelineSeries raw(HistoryStore store, int fromUs, int toUs) {
+    final out = TimelineSeries(0);
+    final time = store.timeColumn, bpm = store.bpmColumn, spo2 = store.spo2Column;
+    for (int i = store.lowerBound(fromUs), end = store.lowerBound(toUs); i < end; i++) {
+      final sp = spo2[i] / HistoryStore.SPO2_SCALE;
+      out.add(time[i], bpm[i], bpm[i], bpm[i].toDouble(), sp, sp, sp);
+    }
+    return out;
+  }
+
+  static int _floorDiv(int a, int b) => a >= 0 ? a ~/ b : -((-a + b - 1) ~/ b);
+}
+
+// 타일 하나 = 레벨 level 의 칸 [key x TILE_BUCKETS, (key+1) x TILE_BUCKETS)
+class HistoryTile {
+  static const int _B = HistoryTiles.TILE_BUCKETS;
+
+  final int level;
+  final int key;
+  final Uint32List count = Uint32List(_B);
+  final Uint8List bpmMin = Uint8List(_B);
+  final Uint8List bpmMax = Uint8List(_B);
+  final Uint32List bpmSum = Uint32List(_B);
+  final Uint16List spo2Min = Uint16List(_B);
+  final Uint16List spo2Max = Uint16List(_B);
+  final Uint32List spo2Sum = Uint32List(_B);
+
+  HistoryTile(this.level, this.key);
+
+  void add(int b, int bpm, int spo2Tenths) {
+    if (count[b] == 0 || bpm < bpmMin[b]) bpmMin[b] = bpm;
+    if (count[b] == 0 || bpm > bpmMax[b]) bpmMax[b] = bpm;
+    if (count[b] == 0 || spo2Tenths < spo2Min[b]) spo2Min[b] = spo2Tenths;
+    if (count[b] == 0 || spo2Tenths > spo2Max[b]) spo2Max[b] = spo2Tenths;
+    count[b]++;
+    bpmSum[b] += bpm;
+    spo2Sum[b] += spo2Tenths;
+  }
+
+  // 열 단위로 이어 붙임 (이 기기의 캐시이므로 호스트 바이트 순서 그대로)
+  Uint8List encode() {
+    final out = Uint8List(HistoryTiles.TILE_BYTES);
+    int pos = 0;
+    for (final column in _columns) {
+      final bytes = column.buffer.asUint8List(column.offsetInBytes, column.lengthInBytes);
+      out.setRange(pos, pos + bytes.length, bytes);
+      pos += bytes.length;
+    }
+    return out;
+  }
+
+  static HistoryTile decode(int level, int key, Uint8List bytes, [int offset = 0]) {
+    final tile = HistoryTile(level, key);
+    int pos = offset;
+    for (final column in tile._columns) {
+      column.buffer.asUint8List(column.offsetInBytes, column.lengthInBytes)
+          .setRange(0, column.lengthInBytes, bytes, pos);
+      pos += column.lengthInBytes;
+    }
+    return tile;
+  }
+
+  List<TypedData> get _columns => [count, bpmMin, bpmMax, bpmSum, spo2Min, spo2Max, spo2Sum];
+}
+
+// 그릴 칸 목록 (시간 오름차순). 원본 기록이면 width 0, 최소=최대=평균
+class TimelineSeries {
+  final int width; // 칸 폭 (µs)
+  final List<int> startUs = [];
+  final List<double> bpmMin = [], bpmMax = [], bpmAvg = [];
+  final List<double> spo2Min = [], spo2Max = [], spo2Avg = [];
+
+  TimelineSeries(this.width);
+
+  int get length => startUs.length;
+
+  void add(int t, int bMin, int bMax, double bAvg, double sMin, double sMax, double sAvg) {
+    startUs.add(t);
+    bpmMin.add(bMin.toDouble());
+    bpmMax.add(bMax.toDouble());
+    bpmAvg.add(bAvg);
+    spo2Min.add(sMin);
+    spo2Max.add(sMax);
+    spo2Avg.add(sAvg);
+  }
+}
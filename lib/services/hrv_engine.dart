@@ -0,0 +1,110 @@
+import 'dart:math' as math;
+import 'dart:typed_data';
+
+// 창 하나의 HRV 요약 (기록에 함께 저장)
+class HrvSummary {
+  final int beats;            // 창 안의 간격 수
+  final double meanNn;        // 평균 간격 (ms)
+  final double sdnn;          // 간격의 표준편차 (ms)
+  final double rmssd;         // 연속 간격 차이의 RMS (ms)
+  final double irregularity;  // 이웃 간격과 크게 다른 쌍의 비율 (0~1)
+
+  const HrvSummary({
+    required this.beats,
+    required this.meanNn,
+    required this.sdnn,
+    required this.rmssd,
+    required this.irregularity,
+  });
+
+  bool get isIrregular => irregularity >= HrvEngine.IRREGULAR_SCORE;
+}
+
+// 박동 간격(RR) 스트림의 HRV / 리듬 불규칙성 (창 단위, 박동당 O(1))
+// 창 = 최근 WINDOW_MS 동안의 간격. 합/제곱합/연속 차분 제곱합/불규칙 쌍 수를 누적해 두고
+// 새 간격은 더하고 창에서 밀려난 간격은 빼므로 기록을 다시 훑지 않음.
+// 값이 모두 정수(ms)라 오래 돌려도 누적 오차가 없음.
+//
+// 불규칙 지수: 직전 간격보다 IRREGULAR_PERCENT% 넘게 달라진 간격의 비율.
+// 정상 동리듬은 대개 0.1 미만이고, 심방세동처럼 불규칙한 리듬은 절반 가까이 됨 (선별용, 진단 아님)
+class HrvEngine {
+  static const int WINDOW_MS = 5 * 60 * 1000; // 단기 HRV 표준 구간 (5분)
+  static const int MIN_PAIRS = 20;            // 연속 쌍이 이보다 적으면 값을 내지 않음
+  static const int IRREGULAR_PERCENT = 20;
+  static const double IRREGULAR_SCORE = 0.3;  // 이 이상이면 불규칙 리듬 의심
+
+  // 5분 x 250 BPM = 1250개 < 2048
+  static const int _CAPACITY = 2048;
+  static const int _MASK = _CAPACITY - 1;
+
+  final Int32List _rr = Int32List(_CAPACITY);     // 링 버퍼 (ms)
+  final Uint8List _paired = Uint8List(_CAPACITY); // 1 = 앞 간격과의 쌍이 합계에 들어 있음
+  int _head = 0;
+  int _count = 0;
+
+  int _sum = 0;          // Σ rr
+  int _sumSq = 0;        // Σ rr²
+  int _pairs = 0;        // 이어진 연속 쌍 수
+  int _sumSqDiff = 0;    // Σ (rr[i] - rr[i-1])²
+  int _irregular = 0;    // 불규칙 쌍 수
+
+  int get beats => _count;
+  int get pairs => _pairs;
+  bool get isReady => _pairs >= MIN_PAIRS;
+
+  void reset() {
+    _head = 0;
+    _count = 0;
+    _sum = _sumSq = _pairs = _sumSqDiff = _irregular = 0;
+  }
+
+  // contiguous: 직전 간격과 바로 이어진 간격인지 (끊김 뒤 첫 간격이면 false)
+  void add(int rrMs, {bool contiguous = true}) {
+    if (_count == _CAPACITY) _evict();
+    final i = (_head + _count) & _MASK;
+    final paired = contiguous && _count > 0;
+    _rr[i] = rrMs;
+    _paired[i] = paired ? 1 : 0;
+    _count++;
+    _sum += rrMs;
+    _sumSq += rrMs * rrMs;
+    if (paired) _pair(_rr[(i - 1) & _MASK], rrMs, 1);
+    while (_sum > WINDOW_MS && _count > 1) {
+      _evict();
+    }
+  }
+
+  HrvSummary? get summary {
+    if (!isReady) return null;
+    final n = _count;
+    // 표본 분산 = (nΣx² - (Σx)²) / n(n-1), 분자는 정수로 정확히 계산
+    final variance = (n * _sumSq - _sum * _sum) / (n * (n - 1));
+    return HrvSummary(
+      beats: n,
+      meanNn: _sum / n,
+      sdnn: math.sqrt(math.max(0, variance)),
+      rmssd: math.sqrt(_sumSqDiff / _pairs),
+      irregularity: _irregular / _pairs,
+    );
+  }
+
+  // 가장 오래된 간격을 빼고, 그 간격이 다음 간격과 이룬 쌍도 뺌
+  void _evict() {
+    final v = _rr[_head];
+    _sum -= v;
+    _sumSq -= v * v;
+    _head = (_head + 1) & _MASK;
+    _count--;
+    if (_count > 0 && _paired[_head] == 1) {
+      _pair(v, _rr[_head], -1);
+      _paired[_head] = 0;
+    }
+  }
+
+  void _pair(int prev, int next, int sign) {
+    final d = next - prev;
+    _pairs += sign;
+    _sumSqDiff += sign * d * d;
+    if (d.abs() * 100 > prev * IRREGULAR_PERCENT) _irregular += sign;
+  }
+}
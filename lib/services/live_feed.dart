@@ -0,0 +1,61 @@
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+
+// 실시간 데이터를 같은 PC 의 다른 프로세스(간호 스테이션 집계기, 기록기 등)에 내보냄 (Linux 전용)
+// 러너(linux/runner)가 받은 메시지를 공유 메모리 링(linux/live/live_ring.h)에 한 번 복사하고,
+// 구독자는 각자 링을 읽으므로 구독자 수와 속도가 앱에 영향을 주지 않음.
+// 전송은 응답을 기다리지 않음. 형식: 종류 바이트 + live_ring.h 의 구조체 (리틀 엔디언)
+class LiveFeed {
+  static const String CHANNEL = 'health_app/live';
+  static const int TYPE_WAVE = 0x57;   // 'W'
+  static const int TYPE_VITALS = 0x56; // 'V'
+  static const int MAX_MESSAGE = 240;  // 슬롯 하나에 들어가는 크기 (kMaxMessage)
+  static const int WAVE_HEADER = 16;
+  static const int MAX_WAVE_SAMPLES = (MAX_MESSAGE - WAVE_HEADER) ~/ 4;
+
+  final BasicMessageChannel<ByteData>? _channel;
+
+  LiveFeed()
+      : _channel = Platform.isLinux
+            ? const BasicMessageChannel<ByteData>(CHANNEL, BinaryCodec())
+            : null;
+
+  // 벤치마크/테스트용: 아무것도 보내지 않음
+  LiveFeed.off() : _channel = null;
+
+  bool get enabled => _channel != null;
+
+  // 파형 블록. 슬롯보다 큰 블록은 나눠 보냄 (뒤 조각의 시각은 샘플 간격만큼 밀림)
+  void wave(String stream, Int32List samples, double rateHz, int timeUs) {
+    final channel = _channel;
+    if (channel == null) return;
+    for (int start = 0; start < samples.length; start += MAX_WAVE_SAMPLES) {
+      final count = samples.length - start < MAX_WAVE_SAMPLES ? samples.length - start : MAX_WAVE_SAMPLES;
+      final data = ByteData(1 + WAVE_HEADER + count * 4);
+      data.setUint8(0, TYPE_WAVE);
+      data.setUint8(1, stream.codeUnitAt(0));
+      data.setUint16(3, count, Endian.little);
+      data.setFloat32(5, rateHz, Endian.little);
+      data.setInt64(9, timeUs + (start * 1e6 / rateHz).round(), Endian.little);
+      for (int i = 0; i < count; i++) {
+        data.setInt32(1 + WAVE_HEADER + i * 4, samples[start + i], Endian.little);
+      }
+      channel.send(data);
+    }
+  }
+
+  // 측정값 한 줄 (quality: SQI 플래그, 0 = 양호)
+  void vitals(int timeUs, double bpm, double spo2, int quality) {
+    final channel = _channel;
+    if (channel == null) return;
+    final data = ByteData(1 + 24);
+    data.setUint8(0, TYPE_VITALS);
+    data.setUint8(1, quality & 0xFF);
+    data.setFloat32(5, bpm, Endian.little);
+    data.setFloat32(9, spo2, Endian.little);
+    data.setInt64(17, timeUs, Endian.little);
+    channel.send(data);
+  }
+}
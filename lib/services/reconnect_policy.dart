@@ -0,0 +1,84 @@
+import 'dart:math' as math;
+
+// 재연결 정책 + 끊김 통계
+// 끊기면 마지막으로 연결됐던 주소로 바로 연결을 시도하고, 실패할 때마다 대기 시간을
+// 2배씩(지터 포함) 늘림. 연속 RESCAN_AFTER_FAILURES 번 실패하면 그때만 이름 검색/주변 검색으로 넘어감
+// (주변 검색은 10초 이상 걸리고 무선을 독점하므로 매번 하지 않음).
+class ReconnectPolicy {
+  static const Duration BASE_DELAY = Duration(milliseconds: 500);
+  static const Duration MAX_DELAY = Duration(seconds: 30);
+  static const int RESCAN_AFTER_FAILURES = 3;
+
+  final math.Random _random;
+
+  int failures = 0;
+
+  // 통계: 끊긴 뒤 다시 연결되기까지 / 마지막 데이터부터 다음 데이터까지
+  DateTime? _disconnectedAt;
+  DateTime? _lastDataBeforeDrop;
+  bool _awaitingData = false;
+  int reconnects = 0;
+  Duration? lastReconnectTime;
+  Duration maxReconnectTime = Duration.zero;
+  Duration totalReconnectTime = Duration.zero;
+  Duration? lastDataGap;
+  Duration totalDataGap = Duration.zero;
+
+  ReconnectPolicy({math.Random? random}) : _random = random ?? math.Random();
+
+  bool get shouldRescan => failures >= RESCAN_AFTER_FAILURES;
+
+  Duration get averageReconnectTime =>
+      reconnects == 0 ? Duration.zero : totalReconnectTime ~/ reconnects;
+
+  // 다음 시도까지 대기 시간: [d/2, d) 범위 (d = BASE * 2^failures, 최대 MAX)
+  // 여러 기기가 동시에 끊겨도 같은 순간에 몰리지 않도록 절반은 무작위
+  Duration nextDelay() {
+    final exp = math.min(failures, 16);
+    final capped = math.min(BASE_DELAY.inMilliseconds * (1 << exp), MAX_DELAY.inMilliseconds);
+    final half = capped ~/ 2;
+    return Duration(milliseconds: half + _random.nextInt(half + 1));
+  }
+
+  void onAttemptFailed() => failures++;
+
+  void onConnected(DateTime now) {
+    failures = 0;
+    final since = _disconnectedAt;
+    if (since != null) {
+      final took = now.difference(since);
+      reconnects++;
+      lastReconnectTime = took;
+      totalReconnectTime += took;
+      if (took > maxReconnectTime) maxReconnectTime = took;
+      _disconnectedAt = null;
+    }
+  }
+
+  // 사용자가 직접 끊은 경우는 부르지 않음 (통계에서 제외)
+  void onDisconnected(DateTime now, DateTime? lastData) {
+    _disconnectedAt ??= now;
+    _lastDataBeforeDrop ??= lastData;
+    _awaitingData = true;
+  }
+
+  // 재연결 뒤 첫 데이터가 들어오면 공백 길이를 기록
+  void onData(DateTime now) {
+    if (!_awaitingData) return;
+    _awaitingData = false;
+    final last = _lastDataBeforeDrop;
+    _lastDataBeforeDrop = null;
+    if (last == null) return;
+    final gap = now.difference(last);
+    lastDataGap = gap;
+    totalDataGap += gap;
+  }
+
+  // 사용자가 직접 연결/해제할 때: 백오프와 진행 중인 끊김 기록을 버림
+  void reset() {
+    failures = 0;
+    _disconnectedAt = null;
+    _lastDataBeforeDrop = null;
+    _awaitingData = false;
+  }
+}
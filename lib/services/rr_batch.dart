@@ -0,0 +1,42 @@
+import 'dart:typed_data';
+
+// 박동 간격 ('R' 프레임) 코덱
+// payload: seq(LE 2byte, 첫 간격의 번호), n, 간격(LE 2byte) x n
+// 간격: 하위 15비트 = ms, 최상위 비트 = 직전 간격과 이어지지 않음
+//   (품질 불량/손가락 뗌/범위 밖 간격 뒤라 연속 차분을 계산하면 안 됨)
+class RrBatch {
+  static const int FRAME_TYPE = 0x52; // 'R'
+  static const int BREAK = 0x8000;
+
+  final int seq;
+  final Uint16List intervals; // ms
+  final Uint8List contiguous; // 1 = 직전 간격과 이어짐
+
+  RrBatch(this.seq, this.intervals, this.contiguous);
+
+  int get length => intervals.length;
+
+  static RrBatch decode(Uint8List payload) {
+    final data = ByteData.sublistView(payload);
+    final count = payload[2];
+    final intervals = Uint16List(count);
+    final contiguous = Uint8List(count);
+    for (int i = 0; i < count; i++) {
+      final v = data.getUint16(3 + i * 2, Endian.little);
+      intervals[i] = v & ~BREAK;
+      contiguous[i] = (v & BREAK) == 0 ? 1 : 0;
+    }
+    return RrBatch(data.getUint16(0, Endian.little), intervals, contiguous);
+  }
+
+  // 펌웨어 send_rr() 과 같은 형식 (테스트/부하 생성용)
+  Uint8List encode() {
+    final out = ByteData(3 + length * 2);
+    out.setUint16(0, seq & 0xFFFF, Endian.little);
+    out.setUint8(2, length);
+    for (int i = 0; i < length; i++) {
+      out.setUint16(3 + i * 2, intervals[i] | (contiguous[i] == 0 ? BREAK : 0), Endian.little);
+    }
+    return out.buffer.asUint8List();
+  }
+}
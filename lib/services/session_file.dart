@@ -0,0 +1,137 @@
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:path_provider/path_provider.dart';
+
+import '../models/session_index.dart';
+
+// 측정 세션 목록 (앱 지원 폴더의 health_log.sessions)
+// 헤더 16바이트 + 세션마다 고정 크기 항목. 세션 i 는 항상 같은 자리에 있으므로
+// 저장할 때는 바뀐 첫 세션(보통 열린 마지막 세션 하나)부터 끝까지만 다시 씀.
+// 항목: 시작/끝 시각(i64), 값 개수, 심박 합, SpO2 합, 경고 수(u32),
+//       SpO2 최소/최대(u16), 심박 최소/최대(u8), 기기 세션 번호(u16), 플래그(u8)
+class SessionFile {
+  static const String FILE_NAME = 'health_log.sessions';
+  static const int MAGIC = 0x53455356; // "VSES"
+  static const int VERSION = 1;
+  static const int HEADER_SIZE = 16;
+  static const int ENTRY_SIZE = 48;
+  static const int _FLAG_OPEN = 1;
+
+  final Future<File> Function() _locate;
+  File? _file;
+  bool _exists = false;
+  Future<void> _writing = Future.value();
+
+  // file: 테스트/벤치마크에서 임시 파일 지정. 없으면 앱 지원 폴더
+  SessionFile({File? file})
+      : _locate = file != null
+            ? (() async => file)
+            : (() async => File('${(await getApplicationSupportDirectory()).path}/$FILE_NAME'));
+
+  Future<File> get file async => _file ??= await _locate();
+
+  // 파일 -> 목록 (목록은 비우고 채움). 파일이 없거나 형식이 다르면 false (다음 저장에서 새로 씀)
+  Future<bool> load(SessionIndex into) async {
+    final f = await file;
+    into.clear();
+    _exists = false;
+    if (!await f.exists()) return false;
+    final bytes = await f.readAsBytes();
+    if (bytes.length < HEADER_SIZE) return false;
+    final data = ByteData.sublistView(bytes);
+    if (data.getUint32(0, Endian.little) != MAGIC ||
+        data.getUint16(4, Endian.little) != VERSION ||
+        data.getUint16(6, Endian.little) != ENTRY_SIZE) {
+      return false;
+    }
+    // 쓰다 끊겨 잘린 마지막 항목은 버림
+    final count = (bytes.length - HEADER_SIZE) ~/ ENTRY_SIZE;
+    for (int i = 0; i < count; i++) {
+      into.load(_decode(data, HEADER_SIZE + i * ENTRY_SIZE));
+    }
+    _exists = true;
+    return true;
+  }
+
+  // 바뀐 세션부터 끝까지 다시 씀. 저장이 겹치면 순서대로 (인코딩은 호출 시점의 목록 기준)
+  Future<void> save(SessionIndex sessions) {
+    if (!sessions.isDirty && _exists) return _writing;
+    final first = _exists ? sessions.dirtyFrom : 0;
+    final out = BytesBuilder(copy: false);
+    if (!_exists) out.add(_header());
+    for (int i = first; i < sessions.length; i++) {
+      out.add(_encode(sessions.at(i)));
+    }
+    sessions.markPersisted();
+    final offset = _exists ? HEADER_SIZE + first * ENTRY_SIZE : 0;
+    _exists = true;
+    final bytes = out.takeBytes();
+    return _writing = _writing.then((_) => _write(offset, bytes), onError: (_) => _write(offset, bytes));
+  }
+
+  Future<void> clear() async {
+    _exists = false;
+    await _writing.catchError((_) {});
+    final f = await file;
+    if (await f.exists()) await f.delete();
+  }
+
+  static Uint8List _header() {
+    final out = Uint8List(HEADER_SIZE);
+    ByteData.sublistView(out)
+      ..setUint32(0, MAGIC, Endian.little)
+      ..setUint16(4, VERSION, Endian.little)
+      ..setUint16(6, ENTRY_SIZE, Endian.little);
+    return out;
+  }
+
+  static Uint8List _encode(MeasurementSession s) {
+    final out = Uint8List(ENTRY_SIZE);
+    ByteData.sublistView(out)
+      ..setInt64(0, s.startUs, Endian.little)
+      ..setInt64(8, s.endUs, Endian.little)
+      ..setUint32(16, s.count, Endian.little)
+      ..setUint32(20, s.bpmSum, Endian.little)
+      ..setUint32(24, s.spo2Sum, Endian.little)
+      ..setUint32(28, s.alerts, Endian.little)
+      ..setUint16(32, s.spo2Min, Endian.little)
+      ..setUint16(34, s.spo2Max, Endian.little)
+      ..setUint8(36, s.bpmMin)
+      ..setUint8(37, s.bpmMax)
+      ..setUint16(38, s.deviceId & 0xFFFF, Endian.little)
+      ..setUint8(40, s.open ? _FLAG_OPEN : 0);
+    return out;
+  }
+
+  static MeasurementSession _decode(ByteData data, int pos) {
+    final s = MeasurementSession(
+      data.getUint16(pos + 38, Endian.little),
+      data.getInt64(pos, Endian.little),
+      endUs: data.getInt64(pos + 8, Endian.little),
+      open: (data.getUint8(pos + 40) & _FLAG_OPEN) != 0,
+    );
+    s.count = data.getUint32(pos + 16, Endian.little);
+    s.bpmSum = data.getUint32(pos + 20, Endian.little);
+    s.spo2Sum = data.getUint32(pos + 24, Endian.little);
+    s.alerts = data.getUint32(pos + 28, Endian.little);
+    s.spo2Min = data.getUint16(pos + 32, Endian.little);
+    s.spo2Max = data.getUint16(pos + 34, Endian.little);
+    s.bpmMin = data.getUint8(pos + 36);
+    s.bpmMax = data.getUint8(pos + 37);
+    return s;
+  }
+
+  Future<void> _write(int offset, Uint8List bytes) async {
+    final f = await file;
+    final raf = await f.open(mode: FileMode.append);
+    try {
+      await raf.truncate(offset);
+      await raf.setPosition(offset);
+      await raf.writeFrom(bytes);
+      await raf.flush();
+    } finally {
+      await raf.close();
+    }
+  }
+}
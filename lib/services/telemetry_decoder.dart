@@ -0,0 +1,82 @@
+import 'dart:typed_data';
+
+// 기기 -> 앱 바이트 스트림 분리기
+// ASCII 줄("...\r\n")과 바이너리 프레임([SYNC][LEN][TYPE][payload][CRC8])이 섞여 들어옴.
+// SYNC(0xB5)는 ASCII 범위 밖이라 줄 안에는 나타나지 않음.
+// CRC 가 틀린 프레임은 LEN 이 깨져 뒤의 줄/프레임까지 삼켰을 수 있으므로 SYNC 다음부터 다시 훑음.
+// 줄은 ASCII 뿐이므로 그 밖의 바이트(다시 훑은 프레임의 나머지)가 오면 받던 줄은 버림.
+class TelemetryDecoder {
+  static const int FRAME_SYNC = 0xB5;
+  static const int MAX_LINE = 256;
+
+  final void Function(String line) onLine;
+  final void Function(int type, Uint8List payload) onFrame;
+
+  int badFrames = 0;
+
+  final List<int> _lineBytes = [];
+  Uint8List? _frame; // null: LEN 대기
+  int _frameLen = 0; // 받은 바이트 수
+  bool _inFrame = false;
+
+  TelemetryDecoder({required this.onLine, required this.onFrame});
+
+  void add(Uint8List data) {
+    for (int i = 0; i < data.length; i++) {
+      final b = data[i];
+      if (_inFrame) {
+        _feedFrame(b);
+      } else if (b == FRAME_SYNC) {
+        _inFrame = true;
+        _frame = null;
+      } else if (b == 0x0A) {
+        final line = String.fromCharCodes(_lineBytes).trim();
+        _lineBytes.clear();
+        onLine(line);
+      } else if ((b < 0x20 && b != 0x0D) || b > 0x7E) {
+        _lineBytes.clear(); // 깨진 프레임의 나머지
+      } else if (_lineBytes.length < MAX_LINE) {
+        _lineBytes.add(b);
+      }
+    }
+  }
+
+  void _feedFrame(int b) {
+    if (_frame == null) {
+      if (b == 0) {
+        _inFrame = false;
+        badFrames++;
+        return;
+      }
+      _frame = Uint8List(b + 1); // TYPE + payload + CRC
+      _frameLen = 0;
+      return;
+    }
+    final frame = _frame!;
+    frame[_frameLen++] = b;
+    if (_frameLen < frame.length) return;
+
+    _inFrame = false;
+    int crc = 0;
+    for (int k = 0; k < frame.length - 1; k++) {
+      crc = crc8(crc, frame[k]);
+    }
+    if (crc != frame[frame.length - 1]) {
+      badFrames++;
+      add(Uint8List(frame.length + 1)
+        ..[0] = frame.length - 1 // LEN
+        ..setRange(1, frame.length + 1, frame));
+      return;
+    }
+    onFrame(frame[0], Uint8List.sublistView(frame, 1, frame.length - 1));
+  }
+
+  // 펌웨어 crc8() 과 동일 (poly 0x07)
+  static int crc8(int crc, int d) {
+    crc ^= d;
+    for (int k = 0; k < 8; k++) {
+      crc = (crc & 0x80) != 0 ? ((crc << 1) ^ 0x07) & 0xFF : (crc << 1) & 0xFF;
+    }
+    return crc;
+  }
+}
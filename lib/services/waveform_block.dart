@@ -0,0 +1,52 @@
+import 'dart:typed_data';
+
+// 파형 블록 ('W' 프레임) 코덱
+// payload: seq, count, stream, zigzag-varint(첫 값), zigzag-varint(차분) x (count-1)
+class WaveformBlock {
+  static const int FRAME_TYPE = 0x57; // 'W'
+
+  final int seq;
+  final String stream;
+  final Int32List samples;
+
+  WaveformBlock(this.seq, this.stream, this.samples);
+
+  static WaveformBlock decode(Uint8List payload) {
+    final seq = payload[0];
+    final count = payload[1];
+    final stream = String.fromCharCode(payload[2]);
+    final samples = Int32List(count);
+    int pos = 3;
+    int value = 0;
+    for (int i = 0; i < count; i++) {
+      int z = 0, shift = 0, b;
+      do {
+        b = payload[pos++];
+        z |= (b & 0x7F) << shift;
+        shift += 7;
+      } while ((b & 0x80) != 0);
+      final delta = (z >> 1) ^ -(z & 1);
+      value = i == 0 ? delta : value + delta;
+      samples[i] = value;
+    }
+    return WaveformBlock(seq, stream, samples);
+  }
+
+  // 펌웨어 send_block() 과 같은 형식 (테스트/부하 생성용)
+  Uint8List encode() {
+    final out = BytesBuilder();
+    out.addByte(seq & 0xFF);
+    out.addByte(samples.length);
+    out.addByte(stream.codeUnitAt(0));
+    for (int i = 0; i < samples.length; i++) {
+      int v = i == 0 ? samples[0] : samples[i] - samples[i - 1];
+      int z = v < 0 ? ((-v) << 1) - 1 : v << 1;
+      while (z >= 0x80) {
+        out.addByte((z & 0x7F) | 0x80);
+        z >>= 7;
+      }
+      out.addByte(z);
+    }
+    return out.toBytes();
+  }
+}
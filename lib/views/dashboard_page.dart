@@ -1,6 +1,8 @@
 import 'package:flutter/material.dart';
 import 'package:get/get.dart';
 import '../controllers/health_controller.dart';
+import '../models/device_config.dart';
+import '../models/heart_rate_engine.dart';
 import '../widgets/health_card.dart';
 import '../widgets/pulse_waveform.dart';
 
@@ -96,6 +98,76 @@ class HealthDashboardPage extends StatelessWidget {
                           ),
                         ],
                       ),
+                      // 심박 엔진 비교/선택 (선택한 값으로 경고/기록)
+                      Obx(() {
+                        final ac = controller.autocorrBpm.value;
+                        return Padding(
+                          padding: const EdgeInsets.only(top: 12),
+                          child: Row(
+                            children: [
+                              Expanded(
+                                child: Text(
+                                  "기기 ${controller.heartRate.value.round()}  |  자기상관 "
+                                  "${ac > 0 ? ac.round() : '-'}"
+                                  "${ac > 0 ? ' (${(controller.autocorrConfidence.value * 100).round()}%)' : ''}",
+                                  style: TextStyle(fontSize: 12, color: Colors.grey.shade600),
+                                ),
+                              ),
+                              for (final engine in HeartRateEngine.values)
+                                Padding(
+                                  padding: const EdgeInsets.only(left: 6),
+                                  child: ChoiceChip(
+                                    label: Text(engine.label, style: const TextStyle(fontSize: 12)),
+                                    selected: controller.hrEngine.value == engine,
+                                    onSelected: (_) => controller.setHeartRateEngine(engine),
+                                    visualDensity: VisualDensity.compact,
+                                  ),
+                                ),
+                            ],
+                          ),
+                        );
+                      }),
+                      Obx(() {
+                        final quality = controller.signalQuality.value;
+                        if (quality.isGood) return const SizedBox.shrink();
+                        return Padding(
+                          padding: const EdgeInsets.only(top: 12),
+                          child: Row(
+                            children: [
+                              Icon(Icons.info_outline, size: 16, color: Colors.orange.shade700),
+                              const SizedBox(width: 6),
+                              Text(
+                                "신호 품질: ${quality.label} (기록/경고 일시 중지)",
+                                style: TextStyle(fontSize: 12, color: Colors.orange.shade700),
+                              ),
+                            ],
+                          ),
+                        );
+                      }),
+                      // 심박 변이도 (최근 5분 박동 간격)
+                      Obx(() {
+                        final h = controller.hrv.value;
+                        final color = h != null && h.isIrregular ? Colors.orange.shade700 : Colors.grey.shade600;
+                        return Padding(
+                          padding: const EdgeInsets.only(top: 12),
+                          child: Row(
+                            children: [
+                              Icon(Icons.timeline, size: 16, color: color),
+                              const SizedBox(width: 6),
+                              Expanded(
+                                child: Text(
+                                  h == null
+                                      ? "심박 변이도: 박동 간격 수집 중"
+                                      : "심박 변이도: SDNN ${h.sdnn.round()}ms · RMSSD ${h.rmssd.round()}ms"
+                                        " · 불규칙 ${(h.irregularity * 100).round()}%"
+                                        "${h.isIrregular ? ' (불규칙 리듬 의심)' : ''}",
+                                  style: TextStyle(fontSize: 12, color: color),
+                                ),
+                              ),
+                            ],
+                          ),
+                        );
+                      }),
                       const SizedBox(height: 32),
 
                       // 그래프 영역
@@ -152,9 +224,15 @@ class HealthDashboardPage extends StatelessWidget {
                             // 차트 위젯
                             SizedBox(
                               height: 200,
-                              child: Obx(() => PulseWaveform(
-                                    points: controller.waveformData.toList(),
-                                  )),
+                              child: Obx(() {
+                                final stream = controller.deviceConfig.value?.stream;
+                                final fixedRange = stream == null || stream == WaveformStream.derivative;
+                                return PulseWaveform(
+                                  points: controller.waveformData.toList(),
+                                  minY: fixedRange ? -2000 : null,
+                                  maxY: fixedRange ? 1500 : null,
+                                );
+                              }),
                             ),
                           ],
                         ),
@@ -165,6 +243,17 @@ class HealthDashboardPage extends StatelessWidget {
                         "마지막 데이터 수신: ${controller.lastUpdated.value}",
                         style: TextStyle(color: Colors.grey.shade500, fontSize: 12),
                       )),
+                      Obx(() {
+                        final took = controller.lastReconnectTime.value;
+                        if (took == null) return const SizedBox.shrink();
+                        final gap = controller.lastDataGap.value;
+                        return Text(
+                          "재연결 ${controller.reconnectCount.value}회 · 최근 "
+                          "${(took.inMilliseconds / 1000).toStringAsFixed(1)}초"
+                          "${gap != null ? ' · 데이터 공백 ${(gap.inMilliseconds / 1000).toStringAsFixed(1)}초' : ''}",
+                          style: TextStyle(color: Colors.grey.shade500, fontSize: 12),
+                        );
+                      }),
                     ],
                   ),
                 ),
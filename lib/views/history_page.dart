@@ -1,6 +1,11 @@
 import 'package:flutter/material.dart';
 import 'package:get/get.dart';
+import 'package:intl/intl.dart';
 import '../controllers/health_controller.dart';
+import '../models/history_store.dart';
+import '../models/session_index.dart';
+import '../services/history_export.dart';
+import '../widgets/history_timeline.dart';
 
 class HistoryPage extends StatelessWidget {
   const HistoryPage({super.key});
@@ -9,58 +14,246 @@ class HistoryPage extends StatelessWidget {
   Widget build(BuildContext context) {
     final controller = Get.find<HealthController>();
 
-    return Scaffold(
-      appBar: AppBar(
-        title: const Text("측정 기록"),
-        actions: [
-          IconButton(
-            icon: const Icon(Icons.delete_outline),
-            onPressed: () {
-              Get.defaultDialog(
-                title: "기록 삭제",
-                middleText: "모든 측정 기록을 삭제하시겠습니까?",
-                textConfirm: "삭제",
-                textCancel: "취소",
-                confirmTextColor: Colors.white,
-                onConfirm: () {
-                  controller.clearLogs();
-                  Get.back();
+    return DefaultTabController(
+      length: 3,
+      child: Scaffold(
+        appBar: AppBar(
+          title: const Text("측정 기록"),
+          bottom: const TabBar(tabs: [Tab(text: "그래프"), Tab(text: "목록"), Tab(text: "세션")]),
+          actions: [
+            Obx(() {
+              final progress = controller.exportProgress.value;
+              if (progress != null) {
+                return Padding(
+                  padding: const EdgeInsets.all(14),
+                  child: SizedBox(
+                    width: 20,
+                    height: 20,
+                    child: CircularProgressIndicator(strokeWidth: 2, value: progress),
+                  ),
+                );
+              }
+              return PopupMenuButton<ExportFormat>(
+                icon: const Icon(Icons.file_download_outlined),
+                tooltip: "내보내기",
+                onSelected: (format) async {
+                  try {
+                    final path = await controller.exportHistory(format);
+                    if (path != null) Get.snackbar("내보내기 완료", path);
+                  } catch (e) {
+                    Get.snackbar("내보내기 실패", "$e");
+                  }
                 },
+                itemBuilder: (context) => [
+                  for (final format in ExportFormat.values)
+                    PopupMenuItem(value: format, child: Text("${format.label} 파일로 내보내기")),
+                ],
               );
-            },
-          )
-        ],
+            }),
+            IconButton(
+              icon: const Icon(Icons.delete_outline),
+              onPressed: () {
+                Get.defaultDialog(
+                  title: "기록 삭제",
+                  middleText: "모든 측정 기록을 삭제하시겠습니까?",
+                  textConfirm: "삭제",
+                  textCancel: "취소",
+                  confirmTextColor: Colors.white,
+                  onConfirm: () {
+                    controller.clearLogs();
+                    Get.back();
+                  },
+                );
+              },
+            )
+          ],
+        ),
+        body: Obx(() {
+          final revision = controller.logRevision.value; // 기록이 바뀌면 다시 그림
+          controller.sessionRevision.value; // 열린 세션의 요약도 실시간으로
+          if (controller.logHistory.isEmpty) {
+            return const Center(child: Text("저장된 기록이 없습니다."));
+          }
+          return TabBarView(
+            // 가로 드래그는 그래프의 이동에 씀
+            physics: const NeverScrollableScrollPhysics(),
+            children: [
+              Padding(
+                padding: const EdgeInsets.fromLTRB(8, 16, 16, 8),
+                child: HistoryTimeline(
+                    store: controller.logHistory, tiles: controller.historyTiles, revision: revision),
+              ),
+              _buildList(controller),
+              _buildSessions(controller),
+            ],
+          );
+        }),
       ),
-      body: Obx(() {
-        if (controller.logHistory.isEmpty) {
-          return const Center(child: Text("저장된 기록이 없습니다."));
-        }
-        return ListView.builder(
-          itemCount: controller.logHistory.length,
-          itemBuilder: (context, index) {
-            final log = controller.logHistory[index];
-            final bool isWarning = log.spo2 < 90 || log.bpm > 120 || log.bpm < 50;
+    );
+  }
+
+  static const Map<int, String> _ALERT_LABELS = {
+    HistoryStore.ALERT_HYPOXIA: "저산소",
+    HistoryStore.ALERT_TACHYCARDIA: "빈맥",
+    HistoryStore.ALERT_BRADYCARDIA: "서맥",
+  };
+  static const Map<String, Duration?> _PERIODS = {
+    "전체": null,
+    "24시간": Duration(days: 1),
+    "7일": Duration(days: 7),
+  };
 
-            return ListTile(
-              leading: CircleAvatar(
-                backgroundColor: isWarning ? Colors.red.shade50 : Colors.blue.shade50,
-                child: Icon(
-                  Icons.monitor_heart, 
-                  color: isWarning ? Colors.red : Colors.blue
+  // 기간/경고 종류로 거른 기록. 개수와 k번째 기록은 경고 비트맵에서 바로 구하므로 기록을 훑지 않음
+  Widget _buildList(HealthController controller) {
+    final view = controller.historyView();
+    final filter = controller.historyFilter.value;
+    return Column(
+      children: [
+        SingleChildScrollView(
+          scrollDirection: Axis.horizontal,
+          padding: const EdgeInsets.symmetric(horizontal: 8, vertical: 4),
+          child: Row(
+            children: [
+              ..._periodChips(controller),
+              const SizedBox(width: 8),
+              for (final entry in _ALERT_LABELS.entries)
+                Padding(
+                  padding: const EdgeInsets.only(right: 4),
+                  child: FilterChip(
+                    label: Text("${entry.value} ${controller.historyAlertCount(entry.key)}"),
+                    selected: (filter & entry.key) != 0,
+                    selectedColor: Colors.red.shade100,
+                    onSelected: (_) => controller.historyFilter.value = filter ^ entry.key,
+                  ),
                 ),
-              ),
-              title: Text(
-                log.time, 
-                style: const TextStyle(fontWeight: FontWeight.bold)
-              ),
-              subtitle: Text("심박수: ${log.bpm.round()} BPM  |  SpO2: ${log.spo2}%"),
-              trailing: isWarning 
-                  ? const Icon(Icons.warning_amber, color: Colors.red)
-                  : const Icon(Icons.check_circle_outline, color: Colors.green),
-            );
-          },
+            ],
+          ),
+        ),
+        Expanded(
+          child: view.isEmpty
+              ? const Center(child: Text("해당하는 기록이 없습니다."))
+              : ListView.builder(
+                  itemCount: view.length,
+                  itemBuilder: (context, index) => _logTile(view, index),
+                ),
+        ),
+      ],
+    );
+  }
+
+  // 기록/세션 탭이 함께 쓰는 기간 선택
+  List<Widget> _periodChips(HealthController controller) => [
+        for (final entry in _PERIODS.entries)
+          Padding(
+            padding: const EdgeInsets.only(right: 4),
+            child: ChoiceChip(
+              label: Text(entry.key),
+              selected: controller.historyPeriod.value == entry.value,
+              onSelected: (_) => controller.historyPeriod.value = entry.value,
+            ),
+          ),
+      ];
+
+  Widget _logTile(HistoryView view, int index) {
+    final i = view.storeIndex(index);
+    final log = view.store.at(i);
+    final bool isWarning = view.mask != 0 || view.store.alertsAt(i) != 0;
+
+    return ListTile(
+      leading: CircleAvatar(
+        backgroundColor: isWarning ? Colors.red.shade50 : Colors.blue.shade50,
+        child: Icon(
+          Icons.monitor_heart, 
+          color: isWarning ? Colors.red : Colors.blue
+        ),
+      ),
+      title: Text(
+        DateFormat('yyyy-MM-dd HH:mm:ss').format(log.time), 
+        style: const TextStyle(fontWeight: FontWeight.bold)
+      ),
+      subtitle: Text("심박수: ${log.bpm.round()} BPM  |  SpO2: ${log.spo2}%"
+          "${log.hasHrv ? '  |  RMSSD: ${log.rmssd}ms' : ''}"),
+      trailing: isWarning 
+          ? const Icon(Icons.warning_amber, color: Colors.red)
+          : const Icon(Icons.check_circle_outline, color: Colors.green),
+    );
+  }
+
+  // 측정 세션 (최신이 위). 요약은 세션 목록에 이미 있으므로 기록을 훑지 않음.
+  // 기간에 걸친 세션은 최신부터 연속이므로 개수만 구함
+  Widget _buildSessions(HealthController controller) {
+    final sessions = controller.sessions;
+    if (sessions.isEmpty) {
+      return const Center(child: Text("측정 세션이 없습니다."));
+    }
+    final count = controller.historySessionCount();
+    return Column(
+      children: [
+        SingleChildScrollView(
+          scrollDirection: Axis.horizontal,
+          padding: const EdgeInsets.symmetric(horizontal: 8, vertical: 4),
+          child: Row(children: _periodChips(controller)),
+        ),
+        Expanded(
+          child: count == 0
+              ? const Center(child: Text("해당하는 세션이 없습니다."))
+              : _sessionList(controller, count),
+        ),
+      ],
+    );
+  }
+
+  Widget _sessionList(HealthController controller, int count) {
+    final sessions = controller.sessions;
+    return ListView.builder(
+      itemCount: count,
+      itemBuilder: (context, index) {
+        final s = sessions[index];
+        return ListTile(
+          leading: CircleAvatar(
+            backgroundColor: s.alerts > 0 ? Colors.red.shade50 : Colors.blue.shade50,
+            child: Icon(Icons.timer_outlined, color: s.alerts > 0 ? Colors.red : Colors.blue),
+          ),
+          title: Text(
+            "${DateFormat('yyyy-MM-dd HH:mm').format(s.start)}  (${_formatDuration(s.duration)})",
+            style: const TextStyle(fontWeight: FontWeight.bold),
+          ),
+          subtitle: Text(s.hasVitals
+              ? "심박수: ${s.bpmMin}~${s.bpmMax} (평균 ${s.bpmAvg.round()}) BPM\n"
+                  "SpO2: ${s.spo2MinPercent}~${s.spo2MaxPercent} (평균 ${s.spo2Avg.toStringAsFixed(1)})%"
+                  "${s.alerts > 0 ? '  |  경고 ${s.alerts}회' : ''}"
+              : "측정값 없음"),
+          isThreeLine: s.hasVitals,
+          trailing: s.open
+              ? const Chip(label: Text("측정 중"))
+              : const Icon(Icons.chevron_right),
+          onTap: () => _showSession(controller, s),
         );
-      }),
+      },
     );
   }
-}
\ No newline at end of file
+
+  void _showSession(HealthController controller, MeasurementSession session) {
+    final logs = controller.sessionView(session);
+    Get.bottomSheet(
+      Container(
+        color: Colors.white,
+        child: logs.isEmpty
+            ? const Padding(
+                padding: EdgeInsets.all(24),
+                child: Text("이 세션에 저장된 기록이 없습니다."),
+              )
+            : ListView.builder(
+                itemCount: logs.length,
+                itemBuilder: (context, index) => _logTile(logs, index),
+              ),
+      ),
+    );
+  }
+
+  static String _formatDuration(Duration d) {
+    if (d.inHours > 0) return "${d.inHours}시간 ${d.inMinutes % 60}분";
+    if (d.inMinutes > 0) return "${d.inMinutes}분 ${d.inSeconds % 60}초";
+    return "${d.inSeconds}초";
+  }
+}
@@ -0,0 +1,218 @@
+import 'dart:math' as math;
+
+import 'package:flutter/gestures.dart';
+import 'package:flutter/material.dart';
+import 'package:intl/intl.dart';
+
+import '../models/history_store.dart';
+import '../services/history_tiles.dart';
+
+// 기록 타임라인 (위: 심박수, 아래: SpO2)
+// 칸마다 최소~최대를 옅은 막대로, 평균을 선으로 그림. 보이는 구간과 폭에 맞는 레벨의 타일만 읽고,
+// 1분 칸도 한 픽셀보다 넓을 만큼 확대하면 원본 기록을 점으로 그림.
+// 드래그/핀치(마우스 휠)로 이동/확대, 두 번 탭하면 전체 보기.
+class HistoryTimeline extends StatefulWidget {
+  final HistoryStore store;
+  final HistoryTiles tiles;
+  final int revision; // 기록이 바뀌면 다시 그림
+
+  const HistoryTimeline({super.key, required this.store, required this.tiles, required this.revision});
+
+  @override
+  State<HistoryTimeline> createState() => _HistoryTimelineState();
+}
+
+class _HistoryTimelineState extends State<HistoryTimeline> {
+  static const int MIN_SPAN_US = 60 * 1000000; // 가장 크게 확대했을 때 1분
+  static const double AXIS_WIDTH = 40;
+
+  int? _fromUs, _toUs; // 보이는 구간. null 이면 전체
+  int _scaleFromUs = 0, _scaleToUs = 0;
+  double _scaleFocus = 0;
+
+  (int, int) _fullRange() {
+    final store = widget.store;
+    if (store.isEmpty) {
+      final now = DateTime.now().microsecondsSinceEpoch;
+      return (now - Duration.microsecondsPerDay, now);
+    }
+    final first = store.timeUsAt(0), last = store.timeUsAt(store.length - 1);
+    final pad = math.max(MIN_SPAN_US, (last - first) ~/ 50);
+    return (first - pad, last + pad);
+  }
+
+  (int, int) get _range {
+    final from = _fromUs, to = _toUs;
+    return from != null && to != null ? (from, to) : _fullRange();
+  }
+
+  // 가운데를 유지한 채 폭을 1분 ~ 전체 구간의 2배로 제한
+  void _setRange(int from, int to) {
+    final (fullFrom, fullTo) = _fullRange();
+    final maxSpan = (fullTo - fullFrom) * 2;
+    int span = (to - from).clamp(MIN_SPAN_US, math.max(MIN_SPAN_US, maxSpan));
+    final center = from + (to - from) ~/ 2;
+    from = center - span ~/ 2;
+    setState(() {
+      _fromUs = from;
+      _toUs = from + span;
+    });
+  }
+
+  void _zoom(double factor, double focus) {
+    final (from, to) = _range;
+    final pivot = from + ((to - from) * focus).round();
+    _setRange(pivot - ((pivot - from) * factor).round(), pivot + ((to - pivot) * factor).round());
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    return LayoutBuilder(builder: (context, constraints) {
+      final plotWidth = math.max(1.0, constraints.maxWidth - AXIS_WIDTH);
+      double focusOf(Offset local) => ((local.dx - AXIS_WIDTH) / plotWidth).clamp(0.0, 1.0);
+      return Listener(
+        onPointerSignal: (event) {
+          if (event is PointerScrollEvent) {
+            _zoom(math.pow(1.0015, event.scrollDelta.dy).toDouble(), focusOf(event.localPosition));
+          }
+        },
+        child: GestureDetector(
+          onDoubleTap: () => setState(() => _fromUs = _toUs = null),
+          onScaleStart: (d) {
+            final (from, to) = _range;
+            _scaleFromUs = from;
+            _scaleToUs = to;
+            _scaleFocus = focusOf(d.localFocalPoint);
+          },
+          onScaleUpdate: (d) {
+            final span = _scaleToUs - _scaleFromUs;
+            final newSpan = (span / d.horizontalScale).round();
+            // 핀치 시작점의 시각이 손가락 아래에 머물도록
+            final pivot = _scaleFromUs + (span * _scaleFocus).round();
+            final focus = focusOf(d.localFocalPoint);
+            final from = pivot - (newSpan * focus).round();
+            _setRange(from, from + newSpan);
+          },
+          child: CustomPaint(
+            size: Size(constraints.maxWidth, constraints.maxHeight),
+            painter: _TimelinePainter(widget.store, widget.tiles, _range, widget.revision,
+                Theme.of(context).textTheme.bodySmall ?? const TextStyle(fontSize: 11)),
+          ),
+        ),
+      );
+    });
+  }
+}
+
+class _TimelinePainter extends CustomPainter {
+  static const double AXIS_WIDTH = _HistoryTimelineState.AXIS_WIDTH;
+  static const double TIME_AXIS_HEIGHT = 20;
+
+  final HistoryStore store;
+  final HistoryTiles tiles;
+  final int fromUs, toUs;
+  final int revision;
+  final TextStyle labelStyle;
+
+  _TimelinePainter(this.store, this.tiles, (int, int) range, this.revision, this.labelStyle)
+      : fromUs = range.$1,
+        toUs = range.$2;
+
+  @override
+  void paint(Canvas canvas, Size size) {
+    final plot = Rect.fromLTRB(AXIS_WIDTH, 0, size.width, size.height - TIME_AXIS_HEIGHT);
+    if (plot.width <= 0 || plot.height <= 0) return;
+    final level = HistoryTiles.levelFor(fromUs, toUs, plot.width);
+    final series = level < 0
+        ? HistoryTiles.raw(store, fromUs, toUs)
+        : tiles.query(level, fromUs, toUs);
+
+    final gap = 4.0;
+    final half = (plot.height - gap) / 2;
+    final bpmRect = Rect.fromLTWH(plot.left, plot.top, plot.width, half);
+    final spo2Rect = Rect.fromLTWH(plot.left, plot.top + half + gap, plot.width, half);
+    _panel(canvas, bpmRect, series, series.bpmMin, series.bpmMax, series.bpmAvg, 40, 160,
+        Colors.red, "BPM");
+    _panel(canvas, spo2Rect, series, series.spo2Min, series.spo2Max, series.spo2Avg, 85, 100,
+        Colors.blue, "SpO2");
+    _timeAxis(canvas, Rect.fromLTRB(plot.left, plot.bottom, plot.right, size.height));
+  }
+
+  double _x(Rect r, int t) => r.left + (t - fromUs) / (toUs - fromUs) * r.width;
+
+  void _panel(Canvas canvas, Rect r, TimelineSeries s, List<double> mins, List<double> maxs,
+      List<double> avgs, double lo, double hi, Color color, String label) {
+    // 보이는 값에 맞춰 세로 범위를 넓힘 (기본 범위보다 좁히지는 않음)
+    for (int i = 0; i < s.length; i++) {
+      if (mins[i] < lo) lo = mins[i];
+      if (maxs[i] > hi) hi = maxs[i];
+    }
+    double y(double v) => r.bottom - (v - lo) / (hi - lo) * r.height;
+
+    final grid = Paint()..color = Colors.grey.shade300..strokeWidth = 1;
+    canvas.drawLine(r.topLeft, r.topRight, grid);
+    canvas.drawLine(r.bottomLeft, r.bottomRight, grid);
+    _text(canvas, hi.round().toString(), Offset(2, r.top));
+    _text(canvas, lo.round().toString(), Offset(2, r.bottom - 14));
+    _text(canvas, label, Offset(2, r.center.dy - 7));
+
+    canvas.save();
+    canvas.clipRect(r);
+    final band = Paint()
+      ..color = color.withOpacity(0.25)
+      ..strokeWidth = math.max(1.0, s.width / (toUs - fromUs) * r.width);
+    final line = Paint()
+      ..color = color
+      ..strokeWidth = 1.5
+      ..style = PaintingStyle.stroke;
+    final path = Path();
+    // 원본 기록은 저장 주기(5초)보다 한참 벌어지면, 칸은 이웃 칸이 비면 선을 끊음
+    final breakUs = s.width > 0 ? s.width : 60 * 1000000;
+    final dots = s.width == 0 && s.length * 4 < r.width ? (Paint()..color = color) : null;
+    for (int i = 0; i < s.length; i++) {
+      final x = _x(r, s.startUs[i] + s.width ~/ 2);
+      if (s.width > 0) canvas.drawLine(Offset(x, y(mins[i])), Offset(x, y(maxs[i])), band);
+      final p = Offset(x, y(avgs[i]));
+      if (i == 0 || s.startUs[i] - s.startUs[i - 1] > breakUs) {
+        path.moveTo(p.dx, p.dy);
+      } else {
+        path.lineTo(p.dx, p.dy);
+      }
+      if (dots != null) canvas.drawCircle(p, 2, dots);
+    }
+    canvas.drawPath(path, line);
+    canvas.restore();
+  }
+
+  // 구간 폭에 맞춘 눈금 5개 남짓
+  void _timeAxis(Canvas canvas, Rect r) {
+    final span = toUs - fromUs;
+    final format = span > 3 * Duration.microsecondsPerDay
+        ? DateFormat('MM-dd')
+        : span > Duration.microsecondsPerDay
+            ? DateFormat('MM-dd HH:mm')
+            : span > 10 * Duration.microsecondsPerMinute
+                ? DateFormat('HH:mm')
+                : DateFormat('HH:mm:ss');
+    const ticks = 4;
+    for (int i = 0; i <= ticks; i++) {
+      final t = fromUs + span * i ~/ ticks;
+      final text = format.format(DateTime.fromMicrosecondsSinceEpoch(t));
+      final dx = r.left + r.width * i / ticks;
+      _text(canvas, text, Offset(dx, r.top + 2), center: true, maxX: r.right);
+    }
+  }
+
+  void _text(Canvas canvas, String text, Offset at, {bool center = false, double? maxX}) {
+    final painter = TextPainter(
+        text: TextSpan(text: text, style: labelStyle), textDirection: TextDirection.ltr)
+      ..layout();
+    double dx = center ? at.dx - painter.width / 2 : at.dx;
+    if (maxX != null && dx + painter.width > maxX) dx = maxX - painter.width;
+    painter.paint(canvas, Offset(math.max(0, dx), at.dy));
+  }
+
+  @override
+  bool shouldRepaint(_TimelinePainter old) =>
+      old.fromUs != fromUs || old.toUs != toUs || old.revision != revision || old.store != store;
+}
@@ -4,14 +4,17 @@ import 'package:intl/intl.dart';
 
 class PulseWaveform extends StatelessWidget {
   final List<FlSpot> points;
-  const PulseWaveform({super.key, required this.points});
+  // 미분 파형 기준 고정 범위. raw/필터 파형은 null 로 넘겨 자동 범위 사용
+  final double? minY;
+  final double? maxY;
+  const PulseWaveform({super.key, required this.points, this.minY = -2000, this.maxY = 1500});
 
   @override
   Widget build(BuildContext context) {
     return LineChart(
       LineChartData(
-        maxY: 1500,
-        minY: -2000,
+        maxY: maxY,
+        minY: minY,
         clipData: const FlClipData.all(),
         gridData: const FlGridData(show: false),
         titlesData: FlTitlesData(
@@ -30,7 +33,7 @@ class PulseWaveform extends StatelessWidget {
             sideTitles: SideTitles(
               showTitles: true, // X축 보이기
               reservedSize: 30, // 글자가 들어갈 공간 확보
-              interval: 10, // 10 단위로 숫자 표시 (데이터에 맞춰 조절 필요)
+              interval: points.length > 50 ? 50 : 10, // 블록 수신 시 점이 많으므로 간격 확대
               getTitlesWidget: (value, meta) {
                 return Padding(
                   padding: const EdgeInsets.only(top: 5.0),
@@ -48,7 +51,7 @@ class PulseWaveform extends StatelessWidget {
             sideTitles: SideTitles(
               showTitles: true, // Y축 보이기
               reservedSize: 40, // Y축 글자가 잘리지 않도록 공간 확보 (중요)
-              interval: 500, // 필요하면 간격 설정 (없으면 자동)
+              interval: minY != null ? 500 : null, // 필요하면 간격 설정 (없으면 자동)
               getTitlesWidget: (value, meta) {
                 return Text(
                   value.toInt().toString(),
@@ -0,0 +1,12 @@
+# Rewrites CodeVisionAVR-only syntax in the firmware so it compiles as plain
+# C++ against include/mega128.h:
+#   interrupt [VEC] void name(void)  ->  SIM_ISR(VEC, name)
+#   #asm("insn")                     ->  sim_asm_insn();
+#
+# Usage: cmake -DINPUT=<atmega_code.c> -DOUTPUT=<file.cc> -P cvavr_to_gcc.cmake
+file(READ "${INPUT}" source)
+string(REGEX REPLACE
+  "interrupt[ \t]*\\[[ \t]*([A-Za-z0-9_]+)[ \t]*\\][ \t]*void[ \t]+([A-Za-z0-9_]+)[ \t]*\\([ \t]*void[ \t]*\\)"
+  "SIM_ISR(\\1, \\2)" source "${source}")
+string(REGEX REPLACE "#asm\\(\"([a-z]+)\"\\)" "sim_asm_\\1();" source "${source}")
+file(WRITE "${OUTPUT}" "${source}")
@@ -0,0 +1,313 @@
+#include "devices.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "include/mega128.h"
+#include "sim_core.h"
+
+namespace sim {
+
+// --- MAX30102 ----------------------------------------------------------------
+
+namespace {
+
+constexpr uint8_t kRegIntStatus1 = 0x00;
+constexpr uint8_t kRegIntEnable1 = 0x02;
+constexpr uint8_t kRegFifoWrPtr = 0x04;
+constexpr uint8_t kRegOvfCounter = 0x05;
+constexpr uint8_t kRegFifoRdPtr = 0x06;
+constexpr uint8_t kRegFifoData = 0x07;
+constexpr uint8_t kRegFifoConfig = 0x08;
+constexpr uint8_t kRegModeConfig = 0x09;
+constexpr uint8_t kRegSpo2Config = 0x0A;
+constexpr uint8_t kRegLed1Pa = 0x0C;
+constexpr uint8_t kRegLed2Pa = 0x0D;
+constexpr uint8_t kRegPartId = 0xFF;
+
+constexpr uint8_t kIntAlmostFull = 0x80;
+constexpr uint8_t kIntPpgReady = 0x40;
+
+const int kSampleRates[8] = {50, 100, 200, 400, 800, 1000, 1600, 3200};
+const int kAverages[8] = {1, 2, 4, 8, 16, 32, 32, 32};
+
+uint32_t ScaleByLed(uint32_t value, uint8_t amplitude) {
+  uint64_t scaled = static_cast<uint64_t>(value) * amplitude / 0x1F;
+  return static_cast<uint32_t>(std::min<uint64_t>(scaled, 0x3FFFF));
+}
+
+}  // namespace
+
+Max30102::Max30102(PpgSource* source) : source_(source) {
+  regs_[kRegPartId] = 0x15;
+}
+
+double Max30102::output_rate_hz() const {
+  return static_cast<double>(kSampleRates[(regs_[kRegSpo2Config] >> 2) & 0x07]) /
+         kAverages[regs_[kRegFifoConfig] >> 5];
+}
+
+void Max30102::Start(bool read) {
+  if (!read) pointer_pending_ = true;
+}
+
+bool Max30102::Write(uint8_t data) {
+  if (pointer_pending_) {
+    pointer_ = data;
+    pointer_pending_ = false;
+    return true;
+  }
+  WriteRegister(pointer_, data);
+  if (pointer_ != kRegFifoData) pointer_++;
+  return true;
+}
+
+uint8_t Max30102::Read(bool) {
+  uint8_t value = ReadRegister(pointer_);
+  if (pointer_ != kRegFifoData) pointer_++;
+  return value;
+}
+
+int Max30102::FifoCount() const {
+  if (fifo_full_) return kFifoDepth;
+  return (regs_[kRegFifoWrPtr] - regs_[kRegFifoRdPtr]) & (kFifoDepth - 1);
+}
+
+void Max30102::WriteRegister(uint8_t reg, uint8_t value) {
+  if (reg == kRegModeConfig && (value & 0x40)) {
+    // RESET: registers back to power-on state, bit self-clears.
+    std::memset(regs_, 0, sizeof(regs_));
+    regs_[kRegPartId] = 0x15;
+    fifo_full_ = false;
+    byte_in_sample_ = 0;
+    average_count_ = 0;
+    Reschedule();
+    return;
+  }
+  regs_[reg] = value;
+  switch (reg) {
+    case kRegFifoWrPtr:
+    case kRegFifoRdPtr:
+      regs_[reg] &= kFifoDepth - 1;
+      fifo_full_ = false;
+      byte_in_sample_ = 0;
+      // Loss and backlog are judged from the firmware's last FIFO reset,
+      // so samples that piled up during start-up delays don't count.
+      samples_lost_ = 0;
+      max_fifo_depth_ = 0;
+      break;
+    case kRegModeConfig:
+    case kRegSpo2Config:
+    case kRegFifoConfig:
+      average_count_ = 0;
+      Reschedule();
+      break;
+    case kRegIntEnable1:
+      UpdateInterrupt();
+      break;
+  }
+}
+
+uint8_t Max30102::ReadRegister(uint8_t reg) {
+  if (reg == kRegIntStatus1) {
+    uint8_t status = regs_[reg];
+    regs_[reg] = 0;
+    UpdateInterrupt();
+    return status;
+  }
+  if (reg != kRegFifoData) return regs_[reg];
+
+  int count = FifoCount();
+  if (count == 0) return 0;
+  int slot = regs_[kRegFifoRdPtr];
+  uint32_t word = byte_in_sample_ < 3 ? fifo_red_[slot] : fifo_ir_[slot];
+  int shift = 16 - 8 * (byte_in_sample_ % 3);
+  uint8_t value = static_cast<uint8_t>(word >> shift);
+  bool two_channel = (regs_[kRegModeConfig] & 0x07) != 0x02;
+  if (++byte_in_sample_ == (two_channel ? 6 : 3)) {
+    byte_in_sample_ = 0;
+    regs_[kRegFifoRdPtr] = (slot + 1) & (kFifoDepth - 1);
+    regs_[kRegOvfCounter] = 0;
+    fifo_full_ = false;
+    samples_popped_++;
+    regs_[kRegIntStatus1] &= ~(kIntAlmostFull | kIntPpgReady);
+    UpdateInterrupt();
+  }
+  return value;
+}
+
+void Max30102::Reschedule() {
+  uint64_t generation = ++generation_;
+  uint8_t mode = regs_[kRegModeConfig];
+  bool active = !(mode & 0x80) &&
+                ((mode & 0x07) == 0x02 || (mode & 0x07) == 0x03 || (mode & 0x07) == 0x07);
+  if (!active) return;
+  uint64_t period = kCpuHz / kSampleRates[(regs_[kRegSpo2Config] >> 2) & 0x07];
+  Schedule(Now() + period, [this, generation] { Acquire(generation); });
+}
+
+void Max30102::Acquire(uint64_t generation) {
+  if (generation != generation_) return;
+  uint64_t period = kCpuHz / kSampleRates[(regs_[kRegSpo2Config] >> 2) & 0x07];
+  Schedule(Now() + period, [this, generation] { Acquire(generation); });
+
+  PpgSample s;
+  if (!source_->At(static_cast<double>(Now()) / kCpuHz, &s)) throw Halt();
+  average_red_ += ScaleByLed(s.red, regs_[kRegLed1Pa]);
+  average_ir_ += ScaleByLed(s.ir, regs_[kRegLed2Pa]);
+  int n = kAverages[regs_[kRegFifoConfig] >> 5];
+  if (++average_count_ < n) return;
+
+  uint32_t red = static_cast<uint32_t>(average_red_ / n);
+  uint32_t ir = static_cast<uint32_t>(average_ir_ / n);
+  average_red_ = average_ir_ = 0;
+  average_count_ = 0;
+  samples_produced_++;
+
+  if (FifoCount() == kFifoDepth) {
+    samples_lost_++;
+    if (regs_[kRegOvfCounter] < 0x1F) regs_[kRegOvfCounter]++;
+    if (!(regs_[kRegFifoConfig] & 0x10)) return;  // no rollover: drop newest
+    regs_[kRegFifoRdPtr] = (regs_[kRegFifoRdPtr] + 1) & (kFifoDepth - 1);
+    byte_in_sample_ = 0;
+  }
+  int slot = regs_[kRegFifoWrPtr];
+  fifo_red_[slot] = red;
+  fifo_ir_[slot] = ir;
+  regs_[kRegFifoWrPtr] = (slot + 1) & (kFifoDepth - 1);
+  fifo_full_ = regs_[kRegFifoWrPtr] == regs_[kRegFifoRdPtr];
+
+  int count = FifoCount();
+  max_fifo_depth_ = std::max(max_fifo_depth_, count);
+  regs_[kRegIntStatus1] |= kIntPpgReady;
+  if (count >= kFifoDepth - (regs_[kRegFifoConfig] & 0x0F)) {
+    regs_[kRegIntStatus1] |= kIntAlmostFull;
+  }
+  UpdateInterrupt();
+}
+
+void Max30102::UpdateInterrupt() {
+  bool asserted = regs_[kRegIntStatus1] & regs_[kRegIntEnable1];
+  if (on_int_pin) on_int_pin(!asserted);
+}
+
+// --- LCD ---------------------------------------------------------------------
+
+namespace {
+constexpr uint8_t kLcdRs = 0x01;
+constexpr uint8_t kLcdEn = 0x04;
+}  // namespace
+
+bool Lcd::Write(uint8_t data) {
+  if (!cleared_) {
+    std::memset(ddram_, ' ', sizeof(ddram_));
+    cleared_ = true;
+  }
+  if ((port_ & kLcdEn) && !(data & kLcdEn)) Latch(data >> 4, data & kLcdRs);
+  port_ = data;
+  return true;
+}
+
+void Lcd::Latch(uint8_t nibble, bool rs) {
+  if (!four_bit_) {
+    Execute(static_cast<uint8_t>(nibble << 4), rs);
+    return;
+  }
+  if (!have_high_) {
+    high_ = nibble;
+    have_high_ = true;
+    return;
+  }
+  have_high_ = false;
+  Execute(static_cast<uint8_t>((high_ << 4) | nibble), rs);
+}
+
+void Lcd::Execute(uint8_t value, bool rs) {
+  if (rs) {
+    ddram_[address_ & 0x7F] = static_cast<char>(value);
+    address_ = (address_ + 1) & 0x7F;
+    if (on_change) on_change();
+    return;
+  }
+  if (value & 0x80) {
+    address_ = value & 0x7F;
+  } else if ((value & 0xE0) == 0x20) {
+    four_bit_ = !(value & 0x10);
+  } else if (value == 0x01) {
+    std::memset(ddram_, ' ', sizeof(ddram_));
+    address_ = 0;
+    if (on_change) on_change();
+  }
+}
+
+std::string Lcd::Line(int row) const {
+  if (!cleared_) return std::string(16, ' ');
+  return std::string(ddram_ + (row ? 0x40 : 0x00), 16);
+}
+
+// --- DS1302 ------------------------------------------------------------------
+
+namespace {
+constexpr uint8_t kSclk = 0x01;
+constexpr uint8_t kIo = 0x02;
+constexpr uint8_t kRst = 0x04;
+
+uint8_t ToBcd(int v) { return static_cast<uint8_t>(((v / 10) << 4) | (v % 10)); }
+}  // namespace
+
+Ds1302::Ds1302(time_t start) : start_(start) {}
+
+void Ds1302::Attach() {
+  PORTB.on_write = [this](uint8_t old_value, uint8_t new_value) {
+    OnPort(old_value, new_value);
+  };
+  PINB.on_read = [this](Reg8& reg) {
+    uint8_t v = PORTB.raw;
+    if (!(DDRB.raw & kIo)) v = io_out_ ? (v | kIo) : (v & ~kIo);
+    reg.raw = v;
+  };
+}
+
+void Ds1302::OnPort(uint8_t old_value, uint8_t new_value) {
+  if (!(new_value & kRst)) {
+    active_ = false;
+    return;
+  }
+  if (!(old_value & kRst)) {
+    active_ = true;
+    bit_ = 0;
+    command_ = 0;
+  }
+  if (!active_) return;
+
+  bool rising = !(old_value & kSclk) && (new_value & kSclk);
+  bool falling = (old_value & kSclk) && !(new_value & kSclk);
+  if (rising) {
+    if (bit_ < 8) {
+      if (new_value & kIo) command_ |= 1 << bit_;
+      if (++bit_ == 8 && (command_ & 0x01)) data_out_ = Register(command_);
+    } else {
+      bit_++;
+    }
+  } else if (falling && bit_ >= 8 && (command_ & 0x01)) {
+    io_out_ = (data_out_ >> ((bit_ - 8) & 0x07)) & 0x01;
+  }
+}
+
+uint8_t Ds1302::Register(uint8_t command) const {
+  time_t now = start_ + static_cast<time_t>(Now() / kCpuHz);
+  struct tm t;
+  localtime_r(&now, &t);
+  switch ((command >> 1) & 0x1F) {
+    case 0: return ToBcd(t.tm_sec);
+    case 1: return ToBcd(t.tm_min);
+    case 2: return ToBcd(t.tm_hour);
+    case 3: return ToBcd(t.tm_mday);
+    case 4: return ToBcd(t.tm_mon + 1);
+    case 5: return ToBcd(t.tm_wday + 1);
+    case 6: return ToBcd(t.tm_year % 100);
+    default: return 0;
+  }
+}
+
+}  // namespace sim
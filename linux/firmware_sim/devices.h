@@ -0,0 +1,109 @@
+#ifndef FIRMWARE_SIM_DEVICES_H_
+#define FIRMWARE_SIM_DEVICES_H_
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+
+#include "peripherals.h"
+#include "ppg_source.h"
+
+// Off-chip parts on the board: MAX30102 pulse oximeter and the PCF8574 LCD
+// backpack on TWI, and the DS1302 RTC bit-banged on PORTB.
+namespace sim {
+
+class Max30102 : public I2cDevice {
+ public:
+  explicit Max30102(PpgSource* source);
+
+  uint8_t address() const override { return 0x57; }
+  void Start(bool read) override;
+  bool Write(uint8_t data) override;
+  uint8_t Read(bool ack) override;
+
+  // Level of the open-drain INT output (active low).
+  std::function<void(bool)> on_int_pin;
+
+  uint64_t samples_produced() const { return samples_produced_; }
+  uint64_t samples_popped() const { return samples_popped_; }
+  // Both counted since the firmware last wrote a FIFO pointer.
+  uint64_t samples_lost() const { return samples_lost_; }
+  int max_fifo_depth() const { return max_fifo_depth_; }
+  double output_rate_hz() const;
+
+ private:
+  static constexpr int kFifoDepth = 32;
+
+  void WriteRegister(uint8_t reg, uint8_t value);
+  uint8_t ReadRegister(uint8_t reg);
+  int FifoCount() const;
+  void Reschedule();
+  void Acquire(uint64_t generation);
+  void UpdateInterrupt();
+
+  PpgSource* source_;
+  uint8_t regs_[256] = {};
+  uint8_t pointer_ = 0;
+  bool pointer_pending_ = false;
+
+  uint32_t fifo_red_[kFifoDepth] = {};
+  uint32_t fifo_ir_[kFifoDepth] = {};
+  bool fifo_full_ = false;
+  int byte_in_sample_ = 0;
+  int average_count_ = 0;
+  uint64_t average_red_ = 0, average_ir_ = 0;
+
+  uint64_t generation_ = 0;
+  uint64_t samples_produced_ = 0;
+  uint64_t samples_popped_ = 0;
+  uint64_t samples_lost_ = 0;
+  int max_fifo_depth_ = 0;
+};
+
+// HD44780 behind a PCF8574 (P0=RS, P1=RW, P2=EN, P3=backlight, P7..P4=data).
+class Lcd : public I2cDevice {
+ public:
+  uint8_t address() const override { return 0x27; }
+  void Start(bool) override {}
+  bool Write(uint8_t data) override;
+  uint8_t Read(bool) override { return 0xFF; }
+
+  std::string Line(int row) const;
+  std::function<void()> on_change;
+
+ private:
+  void Latch(uint8_t nibble, bool rs);
+  void Execute(uint8_t value, bool rs);
+
+  uint8_t port_ = 0;
+  bool four_bit_ = false;
+  bool have_high_ = false;
+  uint8_t high_ = 0;
+  uint8_t address_ = 0;
+  char ddram_[128];
+  bool cleared_ = false;
+};
+
+// DS1302 on PORTB: RST=PB2, IO=PB1, SCLK=PB0. Time starts at |start| and
+// follows the virtual clock.
+class Ds1302 {
+ public:
+  explicit Ds1302(time_t start);
+  void Attach();
+
+ private:
+  void OnPort(uint8_t old_value, uint8_t new_value);
+  uint8_t Register(uint8_t command) const;
+
+  time_t start_;
+  bool active_ = false;
+  int bit_ = 0;
+  uint8_t command_ = 0;
+  uint8_t data_out_ = 0;
+  bool io_out_ = true;
+};
+
+}  // namespace sim
+
+#endif  // FIRMWARE_SIM_DEVICES_H_
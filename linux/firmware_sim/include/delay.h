@@ -0,0 +1,9 @@
+// Host stand-in for CodeVisionAVR's <delay.h>: delays advance the virtual
+// clock instead of spinning.
+#ifndef FIRMWARE_SIM_DELAY_H_
+#define FIRMWARE_SIM_DELAY_H_
+
+void delay_us(unsigned int us);
+void delay_ms(unsigned int ms);
+
+#endif  // FIRMWARE_SIM_DELAY_H_
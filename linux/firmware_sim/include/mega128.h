@@ -0,0 +1,53 @@
+// Host stand-in for CodeVisionAVR's <mega128.h>, used only by firmware_sim.
+// The firmware source is compiled as C++ after cvavr_to_gcc.cmake rewrites
+// the CodeVision-only syntax (interrupt [...] and #asm("...")) into the
+// SIM_ISR / sim_asm_* forms below.
+#ifndef FIRMWARE_SIM_MEGA128_H_
+#define FIRMWARE_SIM_MEGA128_H_
+
+#include "sim_core.h"
+
+// I/O registers touched by the firmware. Bit names are defined by the
+// firmware itself, as with the real CodeVision header.
+extern sim::Reg8 PORTB, DDRB, PINB;
+extern sim::Reg8 PORTE, DDRE, PINE;
+extern sim::Reg8 TCCR0, OCR0, TIMSK, TIFR;
+extern sim::Reg8 TCCR1A, TCCR1B, ETIMSK;
+extern sim::Reg8 TCCR2, OCR2;
+extern sim::Reg8 UBRR0H, UBRR0L, UCSR0A, UCSR0B, UCSR0C, UDR0;
+extern sim::Reg8 TWCR, TWDR, TWSR, TWBR;
+extern sim::Reg8 EICRA, EICRB, EIMSK, EIFR;
+extern sim::Reg8 MCUCR;
+extern sim::Reg16 TCNT1;
+
+// Interrupt vector numbers (CodeVisionAVR numbering).
+#define EXT_INT0    2
+#define EXT_INT4    6
+#define TIM2_COMP   10
+#define TIM1_OVF    15
+#define TIM0_COMP   16
+#define USART0_RXC  19
+#define USART0_DRE  20
+#define USART0_TXC  21
+#define TWI         34
+
+#define SIM_ISR(vector, name)                                    \
+  void name(void);                                               \
+  static sim::IsrRegistration name##_registration(vector, name); \
+  void name(void)
+
+inline void sim_asm_sei() { sim::Sei(); }
+inline void sim_asm_cli() { sim::Cli(); }
+inline void sim_asm_sleep() { sim::Sleep(); }
+inline void sim_asm_nop() { sim::Advance(1); }
+inline void sim_asm_wdr() { sim::Advance(1); }
+
+// CodeVision memory-space qualifiers; the host has a single address space.
+#define eeprom
+#define flash const
+
+// The firmware's void main(void) becomes an ordinary function the simulator
+// calls after wiring up the peripheral models.
+#define main firmware_main
+
+#endif  // FIRMWARE_SIM_MEGA128_H_
@@ -0,0 +1,638 @@
+// Runs the unmodified firmware (lib/etc/atmega_code.c) on the host against
+// the simulated mega128 HAL, a MAX30102 fed from recorded or synthetic PPG,
+// a DS1302, an I2C LCD and a UART that goes to a file or a pseudo-terminal.
+//
+// At the end it prints a report of what the loop achieved in virtual time
+// and exits non-zero when one of the --expect/--max budgets is violated, so
+// it can gate CI without a board attached.
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "devices.h"
+#include "peripherals.h"
+#include "ppg_source.h"
+#include "sim_core.h"
+
+void firmware_main();
+
+void delay_us(unsigned int us) { sim::Advance(static_cast<uint64_t>(us) * 16); }
+void delay_ms(unsigned int ms) { sim::Advance(static_cast<uint64_t>(ms) * 16000); }
+
+namespace {
+
+struct Options {
+  std::string ppg = "synth:72";
+  double ppg_rate = 100;
+  double lift_every = 0;
+  double lift_seconds = 0;
+  double motion_every = 0;
+  double motion_seconds = 0;
+  double seconds = 60;
+  std::string uart;
+  std::string rtc;
+  bool realtime = false;
+  bool show_lcd = false;
+  double expect_bpm = 0;
+  double bpm_tolerance = 5;
+  long max_bad_bpm = -1;
+  long max_overruns = -1;
+  int max_fifo_depth = -1;
+  double max_uart_util = -1;
+  double max_twi_util = -1;
+  double min_cpu_sleep = -1;
+  double min_wave_rate = -1;
+  double expect_wave_bpm = 0;
+  long min_backfill = -1;
+  double expect_rr = 0;
+  double rr_tolerance = 20;
+  double max_rr_jitter = -1;
+  std::vector<std::pair<double, double>> links;
+  std::vector<std::string> sends;
+  double send_at = 2;
+  std::vector<std::string> expect_lines;
+};
+
+void Usage() {
+  std::fprintf(stderr,
+      "usage: firmware_sim [options]\n"
+      "  --ppg synth[:BPM]|FILE   optical input (default synth:72)\n"
+      "  --ppg-rate HZ            sample rate of FILE (default 100)\n"
+      "  --lift EVERY:SECONDS     synthetic finger lifts\n"
+      "  --motion EVERY:SECONDS   synthetic motion artefacts\n"
+      "  --seconds N              virtual run time (default 60)\n"
+      "  --uart FILE|pty|-        where UART0 TX goes (default: discarded)\n"
+      "  --realtime               pace virtual time to the wall clock\n"
+      "  --rtc 'YYYY-MM-DD HH:MM:SS'  DS1302 start time (default: now)\n"
+      "  --lcd                    print the LCD contents at the end\n"
+      "  --expect-bpm N           fail unless the reported BPM is N\n"
+      "  --bpm-tolerance N        allowed BPM error (default 5)\n"
+      "  --max-bad-bpm N          with --expect-bpm, fail if more than N vitals\n"
+      "                           lines flagged good carry a BPM outside tolerance\n"
+      "  --max-overruns N         fail if more FIFO samples are lost\n"
+      "  --max-fifo-depth N       fail if the FIFO backlog exceeds N\n"
+      "  --max-uart-util F        fail if TX line utilisation exceeds F\n"
+      "  --max-twi-util F         fail if TWI bus utilisation exceeds F\n"
+      "  --min-cpu-sleep F        fail unless the CPU sleeps at least fraction F\n"
+      "  --min-wave-rate HZ       fail if fewer waveform samples/s arrive in frames\n"
+      "  --expect-wave-bpm N      fail unless the beats visible in the waveform frames\n"
+      "                           (derivative stream) come at N per minute, within\n"
+      "                           --bpm-tolerance\n"
+      "  --link FROM:TO           act like the app between FROM and TO seconds:\n"
+      "                           #HB every second and #HB=seq for each backfill\n"
+      "                           frame (repeatable; outside it the link is down)\n"
+      "  --min-backfill N         fail unless N stored records were backfilled in\n"
+      "                           sample-counter order and none are left on the device\n"
+      "  --expect-rr MS           fail unless the median beat interval is MS\n"
+      "  --rr-tolerance MS        allowed beat interval error (default 20)\n"
+      "  --max-rr-jitter MS       fail if adjacent beat intervals differ by more\n"
+      "                           than MS\n"
+      "  --send TEXT              type TEXT into UART0 RX ('\\n' escapes allowed);\n"
+      "                           repeated --send go out 0.5 s apart, like a host\n"
+      "                           waiting for each acknowledgement\n"
+      "  --send-at SECONDS        when the first --send starts (default 2)\n"
+      "  --expect-line PREFIX     fail unless a UART line starts with PREFIX\n");
+}
+
+bool ParseOptions(int argc, char** argv, Options* o) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+    const char* v = nullptr;
+    if (a == "--realtime") { o->realtime = true; continue; }
+    if (a == "--lcd") { o->show_lcd = true; continue; }
+    if (!(v = next())) return false;
+    if (a == "--ppg") o->ppg = v;
+    else if (a == "--ppg-rate") o->ppg_rate = std::atof(v);
+    else if (a == "--lift") {
+      if (std::sscanf(v, "%lf:%lf", &o->lift_every, &o->lift_seconds) != 2) return false;
+    }
+    else if (a == "--motion") {
+      if (std::sscanf(v, "%lf:%lf", &o->motion_every, &o->motion_seconds) != 2) return false;
+    }
+    else if (a == "--seconds") o->seconds = std::atof(v);
+    else if (a == "--uart") o->uart = v;
+    else if (a == "--rtc") o->rtc = v;
+    else if (a == "--expect-bpm") o->expect_bpm = std::atof(v);
+    else if (a == "--bpm-tolerance") o->bpm_tolerance = std::atof(v);
+    else if (a == "--max-bad-bpm") o->max_bad_bpm = std::atol(v);
+    else if (a == "--max-overruns") o->max_overruns = std::atol(v);
+    else if (a == "--max-fifo-depth") o->max_fifo_depth = std::atoi(v);
+    else if (a == "--max-uart-util") o->max_uart_util = std::atof(v);
+    else if (a == "--max-twi-util") o->max_twi_util = std::atof(v);
+    else if (a == "--min-cpu-sleep") o->min_cpu_sleep = std::atof(v);
+    else if (a == "--min-wave-rate") o->min_wave_rate = std::atof(v);
+    else if (a == "--expect-wave-bpm") o->expect_wave_bpm = std::atof(v);
+    else if (a == "--min-backfill") o->min_backfill = std::atol(v);
+    else if (a == "--expect-rr") o->expect_rr = std::atof(v);
+    else if (a == "--rr-tolerance") o->rr_tolerance = std::atof(v);
+    else if (a == "--max-rr-jitter") o->max_rr_jitter = std::atof(v);
+    else if (a == "--link") {
+      double from, to;
+      if (std::sscanf(v, "%lf:%lf", &from, &to) != 2) return false;
+      o->links.emplace_back(from, to);
+    }
+    else if (a == "--send") o->sends.push_back(v);
+    else if (a == "--send-at") o->send_at = std::atof(v);
+    else if (a == "--expect-line") o->expect_lines.push_back(v);
+    else return false;
+  }
+  return true;
+}
+
+// Splits the firmware's UART output into ASCII lines and binary frames
+// ([0xB5][len][type][payload][crc8]) and keeps what the report needs:
+// reported BPM values, the latest $-tagged packets and frame counts.
+class TelemetryTap {
+ public:
+  void Feed(uint8_t byte) {
+    if (frame_state_ != kNoFrame || byte == kFrameSync) {
+      FeedFrame(byte);
+      return;
+    }
+    if (byte == '\n') {
+      Line(line_);
+      line_.clear();
+    } else if (byte != '\r' && line_.size() < 512) {
+      line_.push_back(static_cast<char>(byte));
+    }
+  }
+
+  uint64_t lines() const { return lines_; }
+  uint64_t frames() const { return frames_; }
+  uint64_t bad_frames() const { return bad_frames_; }
+  uint64_t wave_samples() const { return wave_samples_; }
+
+  // Beats visible in the derivative waveform frames: troughs reaching half
+  // the depth of the deepest ones, re-armed once the wave comes back above
+  // a quarter of it. A decimator that drops the sharp troughs loses beats.
+  size_t WaveBeats() const {
+    if (wave_.empty()) return 0;
+    std::vector<long> sorted(wave_);
+    std::sort(sorted.begin(), sorted.end());
+    long depth = sorted[sorted.size() / 50];
+    if (depth >= 0) return 0;
+    size_t beats = 0;
+    bool armed = true;
+    for (long v : wave_) {
+      if (armed && v < depth / 2) {
+        beats++;
+        armed = false;
+      } else if (!armed && v > depth / 4) {
+        armed = true;
+      }
+    }
+    return beats;
+  }
+  uint64_t backfill_records() const { return backfill_records_; }
+  long backfill_remaining() const { return backfill_remaining_; }
+  uint64_t backfill_misordered() const { return backfill_misordered_; }
+  const std::vector<int>& rr_intervals() const { return rr_; }
+  uint64_t rr_breaks() const { return rr_breaks_; }
+  // Largest difference between two adjacent intervals not split by a break.
+  int rr_jitter() const { return rr_jitter_; }
+
+  double RrMedian() const {
+    if (rr_.empty()) return 0;
+    std::vector<int> sorted(rr_);
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[sorted.size() / 2];
+  }
+
+  // Called for every good frame with its type and payload.
+  std::function<void(uint8_t, const uint8_t*, int)> on_frame;
+  const std::string& last_vitals() const { return last_vitals_; }
+  const std::string& last_stats() const { return last_stats_; }
+
+  bool Saw(const std::string& prefix) const {
+    for (const std::string& line : tagged_) {
+      if (line.compare(0, prefix.size(), prefix) == 0) return true;
+    }
+    return last_vitals_.compare(0, prefix.size(), prefix) == 0;
+  }
+
+  uint64_t flagged_lines() const { return flagged_lines_; }
+
+  // Vitals lines marked good whose BPM is off by more than |tolerance|.
+  long BadBpm(double expect, double tolerance) const {
+    return std::count_if(good_bpm_.begin(), good_bpm_.end(),
+                         [&](long bpm) { return std::abs(bpm - expect) > tolerance; });
+  }
+
+  // Median of the last reported non-zero BPM values.
+  double Bpm() const {
+    if (bpm_.empty()) return 0;
+    std::vector<long> tail(bpm_.end() - std::min<size_t>(bpm_.size(), 20), bpm_.end());
+    std::sort(tail.begin(), tail.end());
+    return static_cast<double>(tail[tail.size() / 2]);
+  }
+
+ private:
+  static constexpr uint8_t kFrameSync = 0xB5;
+  static constexpr int kNoFrame = -2, kFrameLength = -1;
+
+  static uint8_t Crc8(uint8_t crc, uint8_t d) {
+    crc ^= d;
+    for (int k = 0; k < 8; k++) crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    return crc;
+  }
+
+  void FeedFrame(uint8_t byte) {
+    if (frame_state_ == kNoFrame) {
+      frame_state_ = kFrameLength;
+      return;
+    }
+    if (frame_state_ == kFrameLength) {
+      frame_.clear();
+      frame_length_ = byte;
+      frame_state_ = 0;
+      return;
+    }
+    frame_.push_back(byte);
+    if (static_cast<int>(frame_.size()) <= frame_length_) return;
+    frame_state_ = kNoFrame;
+    uint8_t crc = 0;
+    for (int i = 0; i < frame_length_; i++) crc = Crc8(crc, frame_[i]);
+    if (frame_length_ < 1 || crc != frame_.back()) {
+      bad_frames_++;
+      return;
+    }
+    frames_++;
+    // seq, n, stream, zigzag varints (first value, then deltas)
+    if (frame_[0] == 'W' && frame_length_ >= 4) {
+      wave_samples_ += frame_[2];
+      long value = 0;
+      int pos = 4;
+      for (int i = 0; i < frame_[2] && pos < frame_length_; i++) {
+        unsigned long z = 0;
+        int shift = 0;
+        while (pos < frame_length_) {
+          uint8_t b = frame_[pos++];
+          z |= static_cast<unsigned long>(b & 0x7F) << shift;
+          shift += 7;
+          if (!(b & 0x80)) break;
+        }
+        long delta = static_cast<long>(z >> 1) ^ -static_cast<long>(z & 1);
+        value = i == 0 ? delta : value + delta;
+        wave_.push_back(value);
+      }
+    }
+    // seq, remaining (LE16), n, records (sample_no LE32, bpm, spo2) x n
+    if (frame_[0] == 'H' && frame_length_ >= 5) {
+      backfill_remaining_ = frame_[2] | (frame_[3] << 8);
+      int n = std::min(frame_[4] + 0, (frame_length_ - 5) / 6);
+      for (int i = 0; i < n; i++) {
+        const uint8_t* r = &frame_[5 + 6 * i];
+        long sample = static_cast<long>(r[0] | (r[1] << 8) | (r[2] << 16) |
+                                        (static_cast<unsigned long>(r[3]) << 24));
+        // Stored records are stamped with the live sample counter: oldest
+        // first, and all of them before the line that is being sent now.
+        if (sample <= last_backfill_sample_ || sample >= last_sample_) backfill_misordered_++;
+        last_backfill_sample_ = sample;
+      }
+      backfill_records_ += frame_[4];
+    }
+    // seq (LE16), n, intervals (LE16 ms, bit 15 = not adjacent to the previous)
+    if (frame_[0] == 'R' && frame_length_ >= 4) {
+      int n = std::min(frame_[3] + 0, (frame_length_ - 4) / 2);
+      for (int i = 0; i < n; i++) {
+        int v = frame_[4 + 2 * i] | (frame_[5 + 2 * i] << 8);
+        int ms = v & 0x7FFF;
+        if (v & 0x8000) {
+          rr_breaks_++;
+        } else if (!rr_.empty()) {
+          rr_jitter_ = std::max(rr_jitter_, std::abs(ms - rr_.back()));
+        }
+        rr_.push_back(ms);
+      }
+    }
+    if (on_frame) on_frame(frame_[0], frame_.data() + 1, frame_length_ - 1);
+  }
+
+  void Line(const std::string& line) {
+    if (line.empty()) return;
+    lines_++;
+    if (line[0] == '$') {
+      if (line.compare(0, 3, "$P,") == 0) {
+        last_stats_ = line;
+      } else if (tagged_.size() < 256) {
+        tagged_.push_back(line);
+      }
+      return;
+    }
+    last_vitals_ = line;
+    // time,wave,spo2,bpm[,sqi flags[,sample_no]]
+    char time[24];
+    long wave, spo2, bpm, sqi = 0, sample = -1;
+    if (std::sscanf(line.c_str(), "%23[^,],%ld,%ld,%ld,%ld,%ld", time, &wave, &spo2, &bpm, &sqi,
+                    &sample) < 4) {
+      return;
+    }
+    if (sample >= 0) last_sample_ = sample;
+    if (bpm > 0) bpm_.push_back(bpm);
+    if (bpm > 0 && sqi == 0) good_bpm_.push_back(bpm);
+    if (sqi != 0) flagged_lines_++;
+  }
+
+  std::string line_;
+  uint64_t lines_ = 0;
+  std::string last_vitals_;
+  std::string last_stats_;
+  std::vector<long> bpm_;
+  std::vector<long> good_bpm_;
+  uint64_t flagged_lines_ = 0;
+  std::vector<std::string> tagged_;
+  int frame_state_ = kNoFrame;
+  int frame_length_ = 0;
+  std::vector<uint8_t> frame_;
+  uint64_t frames_ = 0;
+  uint64_t bad_frames_ = 0;
+  uint64_t wave_samples_ = 0;
+  std::vector<long> wave_;
+  uint64_t backfill_records_ = 0;
+  long backfill_remaining_ = 0;
+  uint64_t backfill_misordered_ = 0;
+  long last_backfill_sample_ = -1;
+  long last_sample_ = 0;
+  std::vector<int> rr_;
+  uint64_t rr_breaks_ = 0;
+  int rr_jitter_ = 0;
+};
+
+std::string Unescape(const std::string& text) {
+  std::string out;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '\\' && i + 1 < text.size()) {
+      char c = text[++i];
+      out.push_back(c == 'n' ? '\n' : c == 'r' ? '\r' : c);
+    } else {
+      out.push_back(text[i]);
+    }
+  }
+  return out;
+}
+
+// The host side of the RX line. Whole lines are queued and typed in one
+// byte every two frame times, so lines from different sources never
+// interleave, as with the app writing each command in one piece.
+class HostTx {
+ public:
+  void Send(const std::string& text) {
+    bool idle = pending_.empty();
+    pending_.insert(pending_.end(), text.begin(), text.end());
+    if (idle) Pump();
+  }
+
+  void SendAt(const std::string& text, double at_seconds) {
+    sim::Schedule(static_cast<uint64_t>(at_seconds * sim::kCpuHz), [this, text] { Send(text); });
+  }
+
+ private:
+  void Pump() {
+    sim::Schedule(sim::Now() + sim::kCpuHz / 480, [this] {
+      sim::UartReceive(static_cast<uint8_t>(pending_.front()));
+      pending_.pop_front();
+      if (!pending_.empty()) Pump();
+    });
+  }
+
+  std::deque<char> pending_;
+};
+
+// Stands in for the app during each --link window: a heartbeat every second
+// and an immediate acknowledgement of every backfill frame.
+class HostLink {
+ public:
+  HostLink(HostTx* tx, std::vector<std::pair<double, double>> windows)
+      : tx_(tx), windows_(std::move(windows)) {
+    for (const auto& w : windows_) {
+      for (double t = w.first; t < w.second; t += 1) tx_->SendAt("#HB\n", t);
+    }
+  }
+
+  void OnFrame(uint8_t type, const uint8_t* payload, int length) {
+    if (type != 'H' || length < 1 || !Up()) return;
+    tx_->Send("#HB=" + std::to_string(payload[0]) + "\n");
+  }
+
+ private:
+  bool Up() const {
+    double now = static_cast<double>(sim::Now()) / sim::kCpuHz;
+    for (const auto& w : windows_) {
+      if (now >= w.first && now < w.second) return true;
+    }
+    return false;
+  }
+
+  HostTx* tx_;
+  std::vector<std::pair<double, double>> windows_;
+};
+
+int OpenUart(const std::string& spec) {
+  if (spec.empty()) return -1;
+  if (spec == "-") return STDOUT_FILENO;
+  if (spec == "pty") {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+      std::perror("posix_openpt");
+      std::exit(2);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    std::fprintf(stderr, "UART0 on %s\n", ptsname(fd));
+    return fd;
+  }
+  int fd = open(spec.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    std::perror(spec.c_str());
+    std::exit(2);
+  }
+  return fd;
+}
+
+time_t ParseRtc(const std::string& text) {
+  if (text.empty()) return std::time(nullptr);
+  struct tm t = {};
+  if (!strptime(text.c_str(), "%Y-%m-%d %H:%M:%S", &t)) {
+    std::fprintf(stderr, "bad --rtc value: %s\n", text.c_str());
+    std::exit(2);
+  }
+  t.tm_isdst = -1;
+  return std::mktime(&t);
+}
+
+// Every virtual millisecond: pull host->device bytes from the pty and, in
+// realtime mode, sleep until the wall clock catches up.
+void SchedulePoll(int fd, bool is_pty, bool realtime,
+                  std::chrono::steady_clock::time_point start) {
+  sim::Schedule(sim::Now() + sim::kCpuHz / 1000, [=] {
+    if (is_pty) {
+      uint8_t buf[64];
+      ssize_t n = read(fd, buf, sizeof(buf));
+      for (ssize_t i = 0; i < n; i++) sim::UartReceive(buf[i]);
+    }
+    if (realtime) {
+      auto virtual_time = std::chrono::microseconds(sim::Now() / (sim::kCpuHz / 1000000));
+      std::this_thread::sleep_until(start + virtual_time);
+    }
+    SchedulePoll(fd, is_pty, realtime, start);
+  });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!ParseOptions(argc, argv, &opt)) {
+    Usage();
+    return 2;
+  }
+
+  std::unique_ptr<sim::PpgSource> ppg;
+  if (opt.ppg.compare(0, 5, "synth") == 0) {
+    double bpm = opt.ppg.size() > 6 ? std::atof(opt.ppg.c_str() + 6) : 72;
+    ppg = sim::MakeSyntheticPpg(bpm, opt.lift_every, opt.lift_seconds, opt.motion_every,
+                                opt.motion_seconds);
+  } else {
+    std::string error;
+    ppg = sim::LoadPpgFile(opt.ppg, opt.ppg_rate, &error);
+    if (!ppg) {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      return 2;
+    }
+  }
+
+  int uart_fd = OpenUart(opt.uart);
+  TelemetryTap tap;
+  sim::InitTimers();
+  sim::InitTwi();
+  sim::InitUart([&](uint8_t byte) {
+    tap.Feed(byte);
+    if (uart_fd >= 0 && write(uart_fd, &byte, 1) < 0 && opt.uart != "pty") {
+      std::perror("uart");
+      std::exit(2);
+    }
+  });
+
+  sim::Max30102 sensor(ppg.get());
+  sensor.on_int_pin = [](bool level) { sim::SetPinE(4, level); };
+  sim::Lcd lcd;
+  sim::Ds1302 rtc(ParseRtc(opt.rtc));
+  sim::AttachI2cDevice(&sensor);
+  sim::AttachI2cDevice(&lcd);
+  rtc.Attach();
+  sim::SetPinE(4, true);
+
+  HostTx host_tx;
+  HostLink host_link(&host_tx, opt.links);
+  tap.on_frame = [&](uint8_t type, const uint8_t* payload, int length) {
+    host_link.OnFrame(type, payload, length);
+  };
+  for (size_t i = 0; i < opt.sends.size(); i++) {
+    host_tx.SendAt(Unescape(opt.sends[i]), opt.send_at + 0.5 * i);
+  }
+  SchedulePoll(uart_fd, opt.uart == "pty", opt.realtime, std::chrono::steady_clock::now());
+  sim::SetDeadline(static_cast<uint64_t>(opt.seconds * sim::kCpuHz));
+  try {
+    firmware_main();
+  } catch (const sim::Halt&) {
+  }
+
+  double seconds = static_cast<double>(sim::Now()) / sim::kCpuHz;
+  const sim::BusStats& twi = sim::GetTwiStats();
+  const sim::UartStats& uart = sim::GetUartStats();
+  double twi_util = twi.busy_cycles / static_cast<double>(sim::Now());
+  double uart_util = uart.busy_cycles / static_cast<double>(sim::Now());
+  double cpu_sleep = sim::SleptCycles() / static_cast<double>(sim::Now());
+
+  std::printf("virtual_seconds   %.3f\n", seconds);
+  std::printf("sensor_rate_hz    %.1f\n", sensor.output_rate_hz());
+  std::printf("samples_produced  %llu\n", (unsigned long long)sensor.samples_produced());
+  std::printf("samples_consumed  %llu\n", (unsigned long long)sensor.samples_popped());
+  std::printf("samples_lost      %llu\n", (unsigned long long)sensor.samples_lost());
+  std::printf("max_fifo_depth    %d\n", sensor.max_fifo_depth());
+  std::printf("twi_transactions  %llu\n", (unsigned long long)twi.transactions);
+  std::printf("twi_bytes         %llu\n", (unsigned long long)twi.bytes);
+  std::printf("twi_utilisation   %.1f%%\n", 100 * twi_util);
+  std::printf("uart_tx_bytes     %llu (%.0f B/s)\n", (unsigned long long)uart.tx_bytes,
+              uart.tx_bytes / seconds);
+  std::printf("uart_utilisation  %.1f%%\n", 100 * uart_util);
+  std::printf("cpu_sleep         %.1f%%\n", 100 * cpu_sleep);
+  std::printf("telemetry_lines   %llu\n", (unsigned long long)tap.lines());
+  std::printf("telemetry_frames  %llu (%llu bad)\n", (unsigned long long)tap.frames(),
+              (unsigned long long)tap.bad_frames());
+  std::printf("wave_samples      %llu (%.1f/s)\n", (unsigned long long)tap.wave_samples(),
+              tap.wave_samples() / seconds);
+  std::printf("wave_beats        %zu (%.1f/min)\n", tap.WaveBeats(), tap.WaveBeats() * 60 / seconds);
+  std::printf("backfill_records  %llu (%ld left, %llu misordered)\n",
+              (unsigned long long)tap.backfill_records(), tap.backfill_remaining(),
+              (unsigned long long)tap.backfill_misordered());
+  std::printf("rr_intervals      %zu (%llu breaks, median %.0f ms, jitter %d ms)\n",
+              tap.rr_intervals().size(), (unsigned long long)tap.rr_breaks(), tap.RrMedian(),
+              tap.rr_jitter());
+  std::printf("last_vitals       %s\n", tap.last_vitals().c_str());
+  std::printf("last_stats        %s\n", tap.last_stats().c_str());
+  std::printf("reported_bpm      %.0f\n", tap.Bpm());
+  std::printf("low_quality_lines %llu\n", (unsigned long long)tap.flagged_lines());
+  if (opt.expect_bpm > 0) {
+    std::printf("bad_bpm_lines     %ld\n", tap.BadBpm(opt.expect_bpm, opt.bpm_tolerance));
+  }
+  if (opt.show_lcd) {
+    std::printf("lcd               [%s]\n", lcd.Line(0).c_str());
+    std::printf("                  [%s]\n", lcd.Line(1).c_str());
+  }
+
+  int failures = 0;
+  auto check = [&](bool ok, const char* what) {
+    if (!ok) {
+      std::fprintf(stderr, "FAIL: %s\n", what);
+      failures++;
+    }
+  };
+  if (opt.expect_bpm > 0) {
+    check(std::abs(tap.Bpm() - opt.expect_bpm) <= opt.bpm_tolerance, "reported BPM");
+    if (opt.max_bad_bpm >= 0) {
+      check(tap.BadBpm(opt.expect_bpm, opt.bpm_tolerance) <= opt.max_bad_bpm, "BPM on good-quality lines");
+    }
+  }
+  if (opt.max_overruns >= 0) {
+    check(sensor.samples_lost() <= static_cast<uint64_t>(opt.max_overruns), "FIFO overruns");
+  }
+  if (opt.max_fifo_depth >= 0) {
+    check(sensor.max_fifo_depth() <= opt.max_fifo_depth, "FIFO depth");
+  }
+  if (opt.max_uart_util >= 0) check(uart_util <= opt.max_uart_util, "UART utilisation");
+  if (opt.max_twi_util >= 0) check(twi_util <= opt.max_twi_util, "TWI utilisation");
+  if (opt.min_cpu_sleep >= 0) check(cpu_sleep >= opt.min_cpu_sleep, "CPU sleep time");
+  if (opt.min_wave_rate >= 0) {
+    check(tap.wave_samples() / seconds >= opt.min_wave_rate, "waveform sample rate");
+  }
+  if (opt.expect_wave_bpm > 0) {
+    check(std::abs(tap.WaveBeats() * 60 / seconds - opt.expect_wave_bpm) <= opt.bpm_tolerance,
+          "beats in the waveform");
+  }
+  if (opt.min_backfill >= 0) {
+    check(tap.backfill_records() >= static_cast<uint64_t>(opt.min_backfill) &&
+              tap.backfill_remaining() == 0 && tap.backfill_misordered() == 0,
+          "backfilled records");
+  }
+  if (opt.expect_rr > 0) {
+    check(std::abs(tap.RrMedian() - opt.expect_rr) <= opt.rr_tolerance, "beat interval");
+  }
+  if (opt.max_rr_jitter >= 0) check(tap.rr_jitter() <= opt.max_rr_jitter, "beat interval jitter");
+  for (const std::string& prefix : opt.expect_lines) {
+    check(tap.Saw(prefix), ("UART line " + prefix).c_str());
+  }
+  return failures ? 1 : 0;
+}
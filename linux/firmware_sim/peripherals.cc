@@ -0,0 +1,254 @@
+#include "peripherals.h"
+
+#include <vector>
+
+#include "include/mega128.h"
+
+sim::Reg8 PORTB, DDRB, PINB;
+sim::Reg8 PORTE, DDRE, PINE;
+sim::Reg8 TCCR0, OCR0, TIMSK, TIFR;
+sim::Reg8 TCCR1A, TCCR1B, ETIMSK;
+sim::Reg8 TCCR2, OCR2;
+sim::Reg8 UBRR0H, UBRR0L, UCSR0A, UCSR0B, UCSR0C, UDR0;
+sim::Reg8 TWCR, TWDR, TWSR, TWBR;
+sim::Reg8 EICRA, EICRB, EIMSK, EIFR;
+sim::Reg8 MCUCR;
+sim::Reg16 TCNT1;
+
+namespace sim {
+
+namespace {
+
+// --- Timers ----------------------------------------------------------------
+
+// Timer0 on the mega128 has its own prescaler table (CS0[2:0]).
+const uint64_t kTimer0Prescale[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+const uint64_t kTimer1Prescale[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+
+uint64_t g_timer0_generation = 0;
+uint64_t g_timer1_origin = 0;
+
+void ScheduleTimer0(uint64_t generation) {
+  uint64_t prescale = kTimer0Prescale[TCCR0.raw & 0x07];
+  if (prescale == 0) return;
+  uint64_t period = (static_cast<uint64_t>(OCR0.raw) + 1) * prescale;
+  Schedule(Now() + period, [generation] {
+    if (generation != g_timer0_generation) return;
+    if (TIMSK.raw & 0x02) RaiseIrq(TIM0_COMP);  // OCIE0
+    ScheduleTimer0(generation);
+  });
+}
+
+void RestartTimer0(uint8_t, uint8_t) { ScheduleTimer0(++g_timer0_generation); }
+
+// --- USART0 ----------------------------------------------------------------
+
+constexpr uint8_t kRxc = 7, kUdre = 5, kRxcie = 7, kRxen = 4, kTxen = 3;
+constexpr uint8_t kDataOverrun = 3;
+
+std::function<void(uint8_t)> g_uart_sink;
+std::deque<uint8_t> g_tx;  // front is in the shift register
+std::deque<uint8_t> g_rx;  // two-level receive FIFO
+UartStats g_uart_stats;
+
+uint64_t UartFrameCycles() {
+  unsigned ubrr = (static_cast<unsigned>(UBRR0H.raw) << 8) | UBRR0L.raw;
+  return 10 * 16 * static_cast<uint64_t>(ubrr + 1);  // 8N1, normal speed
+}
+
+void UartStartShift() {
+  uint64_t frame = UartFrameCycles();
+  g_uart_stats.busy_cycles += frame;
+  Schedule(Now() + frame, [] {
+    uint8_t byte = g_tx.front();
+    g_tx.pop_front();
+    g_uart_stats.tx_bytes++;
+    if (g_uart_sink) g_uart_sink(byte);
+    if (!g_tx.empty()) UartStartShift();
+  });
+}
+
+// --- TWI master --------------------------------------------------------------
+
+constexpr uint8_t kTwint = 7, kTwea = 6, kTwsta = 5, kTwsto = 4, kTwen = 2;
+constexpr uint8_t kTwie = 0;
+
+enum class TwiPhase { kIdle, kAddress, kTransmit, kReceive };
+
+std::vector<I2cDevice*> g_devices;
+I2cDevice* g_target = nullptr;
+TwiPhase g_phase = TwiPhase::kIdle;
+bool g_bus_owned = false;
+uint64_t g_bus_free_at = 0;
+BusStats g_twi_stats;
+
+uint64_t TwiBitCycles() {
+  static const uint64_t kPrescale[4] = {1, 4, 16, 64};
+  return 16 + 2 * static_cast<uint64_t>(TWBR.raw) * kPrescale[TWSR.raw & 0x03];
+}
+
+void TwiComplete(uint64_t cycles, uint8_t status) {
+  g_twi_stats.busy_cycles += cycles;
+  Schedule(Now() + cycles, [status] {
+    TWSR.raw = (TWSR.raw & 0x03) | status;
+    TWCR.raw |= 1 << kTwint;
+    if (TWCR.raw & (1 << kTwie)) RaiseIrq(TWI);
+  });
+}
+
+void TwiControl(uint8_t, uint8_t value) {
+  if (!(value & (1 << kTwen))) return;
+  // Writing a one to TWINT clears the flag and starts the next operation.
+  if (!(value & (1 << kTwint))) return;
+  TWCR.raw &= ~(1 << kTwint);
+  ClearIrq(TWI);
+
+  if (value & (1 << kTwsto)) {
+    if (g_target) g_target->Stop();
+    g_target = nullptr;
+    g_phase = TwiPhase::kIdle;
+    g_bus_owned = false;
+    g_bus_free_at = Now() + TwiBitCycles();
+    g_twi_stats.busy_cycles += TwiBitCycles();
+    TWCR.raw &= ~(1 << kTwsto);
+    return;
+  }
+
+  if (value & (1 << kTwsta)) {
+    uint64_t wait = g_bus_free_at > Now() ? g_bus_free_at - Now() : 0;
+    uint8_t status = g_bus_owned ? 0x10 : 0x08;  // repeated / START
+    if (!g_bus_owned) g_twi_stats.transactions++;
+    if (g_target) g_target->Stop();
+    g_target = nullptr;
+    g_bus_owned = true;
+    g_phase = TwiPhase::kAddress;
+    TwiComplete(wait + TwiBitCycles(), status);
+    return;
+  }
+
+  uint64_t byte_cycles = 9 * TwiBitCycles();
+  g_twi_stats.bytes++;
+  switch (g_phase) {
+    case TwiPhase::kAddress: {
+      uint8_t sla = TWDR.raw;
+      bool read = sla & 1;
+      g_target = nullptr;
+      for (I2cDevice* d : g_devices) {
+        if (d->address() == (sla >> 1)) g_target = d;
+      }
+      if (g_target) {
+        g_target->Start(read);
+        g_phase = read ? TwiPhase::kReceive : TwiPhase::kTransmit;
+        TwiComplete(byte_cycles, read ? 0x40 : 0x18);
+      } else {
+        g_twi_stats.nacks++;
+        g_phase = TwiPhase::kIdle;
+        TwiComplete(byte_cycles, read ? 0x48 : 0x20);
+      }
+      break;
+    }
+    case TwiPhase::kTransmit: {
+      bool ack = g_target && g_target->Write(TWDR.raw);
+      if (!ack) g_twi_stats.nacks++;
+      TwiComplete(byte_cycles, ack ? 0x28 : 0x30);
+      break;
+    }
+    case TwiPhase::kReceive: {
+      bool ack = value & (1 << kTwea);
+      TWDR.raw = g_target ? g_target->Read(ack) : 0xFF;
+      TwiComplete(byte_cycles, ack ? 0x50 : 0x58);
+      break;
+    }
+    case TwiPhase::kIdle:
+      TwiComplete(byte_cycles, 0xF8);
+      break;
+  }
+}
+
+// --- External interrupts -----------------------------------------------------
+
+void EvaluatePinE(int bit, bool old_level, bool level) {
+  if (bit < 4 || !(EIMSK.raw & (1 << bit))) return;
+  uint8_t sense = (EICRB.raw >> ((bit - 4) * 2)) & 0x03;
+  bool fire = (sense == 0 && !level) ||                 // low level
+              (sense == 1 && old_level != level) ||     // any edge
+              (sense == 2 && old_level && !level) ||    // falling
+              (sense == 3 && !old_level && level);      // rising
+  if (fire) RaiseIrq(EXT_INT4 + (bit - 4));
+}
+
+uint8_t g_pine_inputs = 0xFF;
+
+}  // namespace
+
+void InitTimers() {
+  TCCR0.on_write = RestartTimer0;
+  OCR0.on_write = RestartTimer0;
+  TCCR1B.on_write = [](uint8_t, uint8_t) { g_timer1_origin = Now(); };
+  TCNT1.on_read = [] {
+    uint64_t prescale = kTimer1Prescale[TCCR1B.raw & 0x07];
+    if (prescale == 0) return static_cast<uint16_t>(0);
+    return static_cast<uint16_t>((Now() - g_timer1_origin) / prescale);
+  };
+}
+
+void InitUart(std::function<void(uint8_t)> sink) {
+  g_uart_sink = std::move(sink);
+  UCSR0A.raw = 1 << kUdre;
+  UCSR0A.on_read = [](Reg8& reg) {
+    uint8_t v = reg.raw & ~((1 << kUdre) | (1 << kRxc));
+    if (g_tx.size() < 2) v |= 1 << kUdre;
+    if (!g_rx.empty()) v |= 1 << kRxc;
+    reg.raw = v;
+  };
+  UDR0.on_write = [](uint8_t, uint8_t byte) {
+    if (!(UCSR0B.raw & (1 << kTxen))) return;
+    if (g_tx.size() >= 2) return;  // written while UDRE was clear: lost
+    g_tx.push_back(byte);
+    if (g_tx.size() == 1) UartStartShift();
+  };
+  UDR0.on_read = [](Reg8& reg) {
+    if (g_rx.empty()) return;
+    reg.raw = g_rx.front();
+    g_rx.pop_front();
+    if (g_rx.empty()) {
+      ClearIrq(USART0_RXC);
+      UCSR0A.raw &= ~(1 << kDataOverrun);
+    }
+  };
+}
+
+void UartReceive(uint8_t byte) {
+  Schedule(Now() + UartFrameCycles(), [byte] {
+    if (!(UCSR0B.raw & (1 << kRxen))) return;
+    if (g_rx.size() >= 2) {
+      g_uart_stats.rx_overruns++;
+      UCSR0A.raw |= 1 << kDataOverrun;
+      return;
+    }
+    g_rx.push_back(byte);
+    g_uart_stats.rx_bytes++;
+    if (UCSR0B.raw & (1 << kRxcie)) RaiseIrq(USART0_RXC);
+  });
+}
+
+const UartStats& GetUartStats() { return g_uart_stats; }
+
+void InitTwi() { TWCR.on_write = TwiControl; }
+
+void AttachI2cDevice(I2cDevice* device) { g_devices.push_back(device); }
+
+const BusStats& GetTwiStats() { return g_twi_stats; }
+
+void SetPinE(int bit, bool level) {
+  bool old_level = g_pine_inputs & (1 << bit);
+  if (level) {
+    g_pine_inputs |= 1 << bit;
+  } else {
+    g_pine_inputs &= ~(1 << bit);
+  }
+  PINE.raw = g_pine_inputs;
+  EvaluatePinE(bit, old_level, level);
+}
+
+}  // namespace sim
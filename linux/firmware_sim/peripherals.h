@@ -0,0 +1,59 @@
+#ifndef FIRMWARE_SIM_PERIPHERALS_H_
+#define FIRMWARE_SIM_PERIPHERALS_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+
+// On-chip peripheral models of the ATmega128 that the firmware drives:
+// Timer0/1, USART0 and the TWI master. Each one attaches hooks to the
+// registers declared in include/mega128.h.
+namespace sim {
+
+// A device on the TWI bus, addressed by its 7-bit address.
+class I2cDevice {
+ public:
+  virtual ~I2cDevice() = default;
+  virtual uint8_t address() const = 0;
+  // Called after SLA+R/W was acknowledged.
+  virtual void Start(bool read) = 0;
+  // Returns true for ACK.
+  virtual bool Write(uint8_t data) = 0;
+  virtual uint8_t Read(bool ack) = 0;
+  virtual void Stop() {}
+};
+
+struct BusStats {
+  uint64_t transactions = 0;
+  uint64_t bytes = 0;
+  uint64_t busy_cycles = 0;
+  uint64_t nacks = 0;
+};
+
+struct UartStats {
+  uint64_t tx_bytes = 0;
+  uint64_t busy_cycles = 0;
+  uint64_t rx_bytes = 0;
+  uint64_t rx_overruns = 0;
+};
+
+void InitTimers();
+
+// USART0. Transmitted bytes are handed to |sink| once their last stop bit
+// has left the shift register.
+void InitUart(std::function<void(uint8_t)> sink);
+// Queues a byte on the RX line; it arrives after one frame time.
+void UartReceive(uint8_t byte);
+const UartStats& GetUartStats();
+
+void InitTwi();
+void AttachI2cDevice(I2cDevice* device);
+const BusStats& GetTwiStats();
+
+// Drives an external interrupt pin (INT4..INT7 live on PORTE).
+void SetPinE(int bit, bool level);
+
+}  // namespace sim
+
+#endif  // FIRMWARE_SIM_PERIPHERALS_H_
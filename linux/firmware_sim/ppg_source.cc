@@ -0,0 +1,104 @@
+#include "ppg_source.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+namespace sim {
+
+namespace {
+
+class FilePpg : public PpgSource {
+ public:
+  FilePpg(std::vector<PpgSample> samples, double rate_hz)
+      : samples_(std::move(samples)), rate_hz_(rate_hz) {}
+
+  bool At(double seconds, PpgSample* sample) override {
+    size_t index = static_cast<size_t>(seconds * rate_hz_);
+    if (index >= samples_.size()) return false;
+    *sample = samples_[index];
+    return true;
+  }
+
+ private:
+  std::vector<PpgSample> samples_;
+  double rate_hz_;
+};
+
+class SyntheticPpg : public PpgSource {
+ public:
+  SyntheticPpg(double bpm, double lift_every, double lift_seconds,
+               double motion_every, double motion_seconds)
+      : beat_hz_(bpm / 60.0),
+        lift_every_(lift_every),
+        lift_seconds_(lift_seconds),
+        motion_every_(motion_every),
+        motion_seconds_(motion_seconds) {}
+
+  bool At(double t, PpgSample* sample) override {
+    if (lift_every_ > 0 && std::fmod(t, lift_every_) > lift_every_ - lift_seconds_) {
+      sample->red = 1200;
+      sample->ir = 1500;
+      return true;
+    }
+    double phase = std::fmod(t * beat_hz_, 1.0);
+    // Systolic upstroke and decay plus a smaller dicrotic wave.
+    double pulse = std::exp(-std::pow((phase - 0.15) / 0.07, 2)) +
+                   0.15 * std::exp(-std::pow((phase - 0.45) / 0.08, 2));
+    double wander = std::sin(2 * M_PI * 0.2 * t);
+    uint32_t n = static_cast<uint32_t>(t * 1000.0) * 2654435761u;
+    double noise = static_cast<double>(n >> 24) / 255.0 - 0.5;
+    double motion = 0;
+    if (motion_every_ > 0 && std::fmod(t, motion_every_) > motion_every_ - motion_seconds_) {
+      // Finger shifting on the window: a few Hz of swings several times the
+      // pulse amplitude, inside the detector's passband.
+      motion = 4000 * std::sin(2 * M_PI * 1.7 * t) + 2500 * std::sin(2 * M_PI * 2.9 * t + 1);
+    }
+    sample->red = static_cast<uint32_t>(100000 - 900 * pulse + 300 * wander + 20 * noise + motion);
+    sample->ir = static_cast<uint32_t>(110000 - 1000 * pulse + 300 * wander + 20 * noise + motion);
+    return true;
+  }
+
+ private:
+  double beat_hz_;
+  double lift_every_;
+  double lift_seconds_;
+  double motion_every_;
+  double motion_seconds_;
+};
+
+}  // namespace
+
+std::unique_ptr<PpgSource> LoadPpgFile(const std::string& path, double rate_hz,
+                                       std::string* error) {
+  std::ifstream in(path);
+  if (!in) {
+    *error = "cannot open " + path;
+    return nullptr;
+  }
+  std::vector<PpgSample> samples;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    char* end = nullptr;
+    PpgSample s;
+    s.red = static_cast<uint32_t>(std::strtoul(line.c_str(), &end, 10));
+    s.ir = (*end == ',') ? static_cast<uint32_t>(std::strtoul(end + 1, nullptr, 10)) : s.red;
+    samples.push_back(s);
+  }
+  if (samples.empty()) {
+    *error = path + " has no samples";
+    return nullptr;
+  }
+  return std::make_unique<FilePpg>(std::move(samples), rate_hz);
+}
+
+std::unique_ptr<PpgSource> MakeSyntheticPpg(double bpm, double lift_every,
+                                            double lift_seconds,
+                                            double motion_every,
+                                            double motion_seconds) {
+  return std::make_unique<SyntheticPpg>(bpm, lift_every, lift_seconds, motion_every,
+                                        motion_seconds);
+}
+
+}  // namespace sim
@@ -0,0 +1,42 @@
+#ifndef FIRMWARE_SIM_PPG_SOURCE_H_
+#define FIRMWARE_SIM_PPG_SOURCE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+struct PpgSample {
+  uint32_t red;
+  uint32_t ir;
+};
+
+// Optical signal seen by the MAX30102 photodiode, sampled at an arbitrary
+// time so the sensor model can run at whatever rate the firmware configures.
+class PpgSource {
+ public:
+  virtual ~PpgSource() = default;
+  // Returns false once the source is exhausted.
+  virtual bool At(double seconds, PpgSample* sample) = 0;
+};
+
+// Recorded PPG, one "red,ir" (or single "red") line per sample at |rate_hz|.
+// Lines starting with '#' are ignored.
+std::unique_ptr<PpgSource> LoadPpgFile(const std::string& path, double rate_hz,
+                                       std::string* error);
+
+// Synthetic finger: DC level plus a pulse train at |bpm| with a dicrotic
+// notch, a little baseline wander and deterministic noise. The finger is
+// lifted for |lift_seconds| every |lift_every| seconds, and moves (large
+// irregular swings on top of the pulse) for |motion_seconds| every
+// |motion_every| seconds (0 disables either).
+std::unique_ptr<PpgSource> MakeSyntheticPpg(double bpm, double lift_every,
+                                            double lift_seconds,
+                                            double motion_every = 0,
+                                            double motion_seconds = 0);
+
+}  // namespace sim
+
+#endif  // FIRMWARE_SIM_PPG_SOURCE_H_
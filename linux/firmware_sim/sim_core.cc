@@ -0,0 +1,121 @@
+#include "sim_core.h"
+
+#include <map>
+#include <utility>
+
+namespace sim {
+
+namespace {
+
+constexpr int kVectorCount = 36;
+constexpr uint64_t kIsrEntryCycles = 20;
+
+uint64_t g_now = 0;
+uint64_t g_deadline = UINT64_MAX;
+std::multimap<uint64_t, std::function<void()>> g_events;
+
+Isr g_isr[kVectorCount] = {};
+bool g_pending[kVectorCount] = {};
+bool g_global_enable = false;
+bool g_in_isr = false;
+uint64_t g_serviced = 0;
+uint64_t g_slept = 0;
+
+void Dispatch() {
+  if (g_in_isr) return;
+  // Lower vector numbers have priority, like on the AVR.
+  for (int v = 0; v < kVectorCount && g_global_enable; v++) {
+    if (!g_pending[v] || !g_isr[v]) continue;
+    g_pending[v] = false;
+    g_in_isr = true;
+    g_global_enable = false;
+    g_now += kIsrEntryCycles;
+    g_isr[v]();
+    g_global_enable = true;  // RETI
+    g_in_isr = false;
+    g_serviced++;
+    v = -1;
+  }
+}
+
+void RunEventsUntil(uint64_t target) {
+  while (!g_events.empty() && g_events.begin()->first <= target) {
+    auto it = g_events.begin();
+    std::function<void()> fn = std::move(it->second);
+    if (it->first > g_now) g_now = it->first;
+    g_events.erase(it);
+    fn();
+  }
+}
+
+}  // namespace
+
+uint64_t Now() { return g_now; }
+
+void Advance(uint64_t cycles) {
+  uint64_t target = g_now + cycles;
+  RunEventsUntil(target);
+  if (target > g_now) g_now = target;
+  if (g_now >= g_deadline) throw Halt();
+  Dispatch();
+}
+
+void SetDeadline(uint64_t cycle) { g_deadline = cycle; }
+
+void Schedule(uint64_t at, std::function<void()> fn) {
+  g_events.emplace(at, std::move(fn));
+}
+
+void RegisterIsr(int vector, Isr isr) {
+  if (vector >= 0 && vector < kVectorCount) g_isr[vector] = isr;
+}
+
+void RaiseIrq(int vector) {
+  if (vector >= 0 && vector < kVectorCount) g_pending[vector] = true;
+}
+
+void ClearIrq(int vector) {
+  if (vector >= 0 && vector < kVectorCount) g_pending[vector] = false;
+}
+
+void Sei() {
+  g_global_enable = true;
+  Dispatch();
+}
+
+void Cli() { g_global_enable = false; }
+
+bool InterruptsEnabled() { return g_global_enable; }
+
+void Sleep() {
+  uint64_t serviced = g_serviced;
+  uint64_t start = g_now;
+  while (g_serviced == serviced) {
+    if (g_events.empty()) throw Halt();
+    uint64_t next = g_events.begin()->first;
+    try {
+      Advance(next > g_now ? next - g_now : 1);
+    } catch (const Halt&) {
+      g_slept += g_now - start;
+      throw;
+    }
+  }
+  g_slept += g_now - start;
+}
+
+uint64_t SleptCycles() { return g_slept; }
+
+uint8_t Reg8::Read() {
+  Advance(kAccessCycles);
+  if (on_read) on_read(*this);
+  return raw;
+}
+
+void Reg8::Write(uint8_t v) {
+  Advance(kAccessCycles);
+  uint8_t old_value = raw;
+  raw = v;
+  if (on_write) on_write(old_value, v);
+}
+
+}  // namespace sim
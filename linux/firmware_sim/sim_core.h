@@ -0,0 +1,80 @@
+#ifndef FIRMWARE_SIM_SIM_CORE_H_
+#define FIRMWARE_SIM_SIM_CORE_H_
+
+#include <cstdint>
+#include <functional>
+
+// Virtual ATmega128 core: a cycle clock, a timed event queue, interrupt
+// dispatch and memory-mapped I/O registers with read/write hooks.
+//
+// Only HAL interactions cost time. Every register access is charged a few
+// cycles (roughly one polling-loop iteration) and peripherals complete their
+// work after the number of cycles the real hardware would need, so busy-wait
+// loops in the firmware advance the clock exactly like they burn CPU on the
+// board. Pure computation between register accesses is free.
+namespace sim {
+
+constexpr uint64_t kCpuHz = 16000000;
+constexpr uint64_t kAccessCycles = 3;
+
+// Thrown from inside the HAL to unwind out of the firmware's endless loop.
+struct Halt {};
+
+uint64_t Now();
+void Advance(uint64_t cycles);
+// Stops the simulation (by throwing Halt) once the clock reaches |cycle|.
+void SetDeadline(uint64_t cycle);
+
+// Runs |fn| once the clock reaches |at|. Events at the same cycle run in
+// scheduling order.
+void Schedule(uint64_t at, std::function<void()> fn);
+
+// Interrupt controller. |vector| uses the CodeVisionAVR vector numbers.
+using Isr = void (*)();
+void RegisterIsr(int vector, Isr isr);
+void RaiseIrq(int vector);
+void ClearIrq(int vector);
+void Sei();
+void Cli();
+bool InterruptsEnabled();
+// Blocks until an interrupt has been serviced (SLEEP instruction).
+void Sleep();
+// Cycles spent inside Sleep(), for the idle-time report.
+uint64_t SleptCycles();
+
+struct IsrRegistration {
+  IsrRegistration(int vector, Isr isr) { RegisterIsr(vector, isr); }
+};
+
+// An 8-bit I/O register. Compound assignments are read-modify-write, so
+// they trigger both hooks like the equivalent IN/OUT sequence would.
+class Reg8 {
+ public:
+  using ReadHook = std::function<void(Reg8&)>;
+  using WriteHook = std::function<void(uint8_t old_value, uint8_t new_value)>;
+
+  operator uint8_t() { return Read(); }
+  Reg8& operator=(unsigned v) { Write(static_cast<uint8_t>(v)); return *this; }
+  Reg8& operator|=(unsigned v) { Write(Read() | v); return *this; }
+  Reg8& operator&=(unsigned v) { Write(Read() & v); return *this; }
+  Reg8& operator^=(unsigned v) { Write(Read() ^ v); return *this; }
+
+  uint8_t Read();
+  void Write(uint8_t v);
+
+  // Direct access for peripheral models; bypasses hooks and costs nothing.
+  uint8_t raw = 0;
+  ReadHook on_read;
+  WriteHook on_write;
+};
+
+// A 16-bit register whose value is computed on every read (e.g. TCNT1).
+class Reg16 {
+ public:
+  operator unsigned() { Advance(kAccessCycles); return on_read ? on_read() : 0; }
+  std::function<uint16_t()> on_read;
+};
+
+}  // namespace sim
+
+#endif  // FIRMWARE_SIM_SIM_CORE_H_
@@ -0,0 +1,679 @@
+// Virtual sensor fleet: N pseudo-terminals, each carrying what one sensor's
+// firmware sends over the HC-05 link, for stress-testing a receiver (the
+// app, or health_ingestd with one DEVICE=STORE pair per sensor).
+//
+// Every sensor is a SensorStream (vitals lines, waveform and beat frames)
+// played out in device time, which runs --speed times faster than the wall
+// clock, through a model of the link: messages are delayed by up to
+// --jitter, queued in the module's TX buffer (dropped whole when it is
+// full), drained at --baud and handed to the pty in --burst sized gulps.
+// --corrupt damages a fraction of them so the receiver must reject them,
+// and --disconnect takes sensors away and brings them back on a new pty
+// behind the same DIR/sensorNN link.
+//
+// At the end it prints what was sent. With a command after "--" it runs
+// the receiver on the links, stops it with SIGTERM once everything has been
+// read, and with --check compares the per-device counters health_ingestd
+// reports with what was actually delivered.
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sensor_stream.h"
+
+namespace {
+
+struct Options {
+  int sensors = 4;
+  double seconds = 60;  // device time
+  double speed = 1;
+  double sample_rate = 100;
+  int decimation = 25;
+  int block = 10;
+  double bpm_lo = 60, bpm_hi = 100;
+  double spo2_lo = 95, spo2_hi = 99;
+  double lift_every = 0, lift_seconds = 0;
+  std::string ppg_file;
+  double ppg_rate = 100;
+  int baud = 9600;
+  size_t tx_buffer = 1024;
+  double jitter_ms = 0;
+  double burst_ms = 0;
+  double corrupt = 0;
+  double disconnect_every = 0, disconnect_seconds = 0;
+  uint32_t seed = 1;
+  std::string dir;
+  bool check = false;
+  std::vector<std::string> command;
+};
+
+void Usage() {
+  std::fprintf(stderr,
+      "usage: health_fleet_sim [options] [-- COMMAND ARGS...]\n"
+      "  --sensors N           virtual sensors, one pty each (default 4)\n"
+      "  --seconds N           device time to run (default 60)\n"
+      "  --speed K             device time runs K times faster than the wall clock\n"
+      "  --sr N, --dec N, --block N\n"
+      "                        sample rate, samples per vitals line and per waveform\n"
+      "                        frame, as set with #SR/#DEC/#BLK (default 100, 25, 10)\n"
+      "  --bpm LO:HI           heart rates, spread over the sensors (default 60:100)\n"
+      "  --spo2 LO:HI          SpO2, spread the same way (default 95:99)\n"
+      "  --lift EVERY:SECONDS  finger lifted (low signal quality) for SECONDS every EVERY\n"
+      "  --ppg FILE            recorded \"red,ir\" PPG instead of the synthetic finger,\n"
+      "                        each sensor starting at a different point\n"
+      "  --ppg-rate N          sample rate of FILE (default 100)\n"
+      "  --baud N              link speed in device time (default 9600)\n"
+      "  --tx-buffer N         bytes the module buffers; messages that do not fit are\n"
+      "                        dropped (default 1024)\n"
+      "  --jitter MS           delay each message by up to MS, keeping their order\n"
+      "  --burst MS            hand bytes to the pty only every MS (link scheduling)\n"
+      "  --corrupt P           damage a fraction P of vitals lines and frames\n"
+      "  --disconnect EVERY:SECONDS\n"
+      "                        drop each sensor's link for SECONDS every EVERY, at a\n"
+      "                        different phase per sensor\n"
+      "  --seed N              random seed (default 1)\n"
+      "  --dir DIR             where the sensorNN links go (default /tmp/health_fleet.PID)\n"
+      "  --check               compare COMMAND's health_ingestd report with what was\n"
+      "                        delivered; exit non-zero on a mismatch\n"
+      "  COMMAND               run on the links; an argument containing {} is repeated\n"
+      "                        per sensor with {} = link path and {n} = sensor number,\n"
+      "                        e.g. -- health_ingestd {}=/tmp/fleet_{n}.vlog\n");
+}
+
+bool ParsePair(const char* v, double* a, double* b) {
+  char* end = nullptr;
+  *a = std::strtod(v, &end);
+  if (end == v) return false;
+  if (*end == '\0') {
+    *b = *a;
+    return true;
+  }
+  if (*end != ':') return false;
+  const char* rest = end + 1;
+  *b = std::strtod(rest, &end);
+  return end != rest && *end == '\0';
+}
+
+bool ParseOptions(int argc, char** argv, Options* o) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--") {
+      o->command.assign(argv + i + 1, argv + argc);
+      break;
+    }
+    if (a == "--check") { o->check = true; continue; }
+    if (i + 1 >= argc) return false;
+    const char* v = argv[++i];
+    bool ok = true;
+    if (a == "--sensors") o->sensors = std::atoi(v);
+    else if (a == "--seconds") o->seconds = std::atof(v);
+    else if (a == "--speed") o->speed = std::atof(v);
+    else if (a == "--sr") o->sample_rate = std::atof(v);
+    else if (a == "--dec") o->decimation = std::atoi(v);
+    else if (a == "--block") o->block = std::atoi(v);
+    else if (a == "--bpm") ok = ParsePair(v, &o->bpm_lo, &o->bpm_hi);
+    else if (a == "--spo2") ok = ParsePair(v, &o->spo2_lo, &o->spo2_hi);
+    else if (a == "--lift") ok = ParsePair(v, &o->lift_every, &o->lift_seconds);
+    else if (a == "--ppg") o->ppg_file = v;
+    else if (a == "--ppg-rate") o->ppg_rate = std::atof(v);
+    else if (a == "--baud") o->baud = std::atoi(v);
+    else if (a == "--tx-buffer") o->tx_buffer = std::strtoul(v, nullptr, 10);
+    else if (a == "--jitter") o->jitter_ms = std::atof(v);
+    else if (a == "--burst") o->burst_ms = std::atof(v);
+    else if (a == "--corrupt") o->corrupt = std::atof(v);
+    else if (a == "--disconnect") ok = ParsePair(v, &o->disconnect_every, &o->disconnect_seconds);
+    else if (a == "--seed") o->seed = static_cast<uint32_t>(std::strtoul(v, nullptr, 10));
+    else if (a == "--dir") o->dir = v;
+    else return false;
+    if (!ok) return false;
+  }
+  if (o->check && o->command.empty()) return false;
+  return o->sensors > 0 && o->seconds > 0 && o->speed > 0 && o->baud > 0 &&
+         (o->disconnect_every == 0 || o->disconnect_seconds < o->disconnect_every);
+}
+
+int64_t MonotonicUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+volatile sig_atomic_t g_stop = 0;
+
+void OnSignal(int) { g_stop = 1; }
+
+// What a receiver should have counted, in health_ingestd's terms.
+struct Delivered {
+  uint64_t bytes = 0;
+  uint64_t lines = 0;
+  uint64_t frames = 0;
+  uint64_t bad = 0;
+  uint64_t low_quality = 0;
+  uint64_t beats = 0;
+};
+
+struct VirtualSensor {
+  enum State { kUp, kDraining, kDown };
+
+  int index = 0;
+  std::string link;
+  fleet::SensorStream stream;
+  std::mt19937 rng;
+  int master = -1;
+  int slave = -1;  // held open so the pty survives the receiver reopening it
+  State state = kUp;
+  double next_drop = 0;  // device time
+  double up_at = 0;
+  int64_t drain_deadline = 0;  // monotonic
+  int quiet_polls = 0;
+  bool inexact = false;  // data left unread when the link went down
+
+  std::deque<fleet::SensorStream::Message> delayed;  // jitter
+  double last_release = 0;
+  std::string tx;     // module TX buffer
+  double credit = 0;  // bytes the UART may send
+  double last_step = 0;
+  std::string wire;   // sent, waiting for the next burst
+  int64_t last_burst = -1;
+  std::string rx;     // host commands
+
+  uint64_t generated = 0, sent = 0, dropped = 0, offline = 0, corrupted = 0;
+  uint64_t reconnects = 0;
+  Delivered delivered;
+};
+
+class Fleet {
+ public:
+  explicit Fleet(const Options& opt) : opt_(opt) {}
+
+  bool Init() {
+    dir_ = opt_.dir;
+    if (dir_.empty()) {
+      dir_ = "/tmp/health_fleet." + std::to_string(getpid());
+      if (mkdir(dir_.c_str(), 0755) != 0) {
+        std::perror(dir_.c_str());
+        return false;
+      }
+      made_dir_ = true;
+    }
+    int64_t rtc = static_cast<int64_t>(std::time(nullptr));
+    for (int i = 0; i < opt_.sensors; i++) {
+      std::unique_ptr<VirtualSensor> s(new VirtualSensor);
+      double f = opt_.sensors > 1 ? static_cast<double>(i) / (opt_.sensors - 1) : 0;
+      fleet::StreamConfig config;
+      config.sample_rate = opt_.sample_rate;
+      config.decimation = opt_.decimation;
+      config.block = opt_.block;
+      config.bpm = std::round(opt_.bpm_lo + (opt_.bpm_hi - opt_.bpm_lo) * f);
+      config.spo2 = std::round(opt_.spo2_lo + (opt_.spo2_hi - opt_.spo2_lo) * f);
+      config.lift_every = opt_.lift_every;
+      config.lift_seconds = opt_.lift_seconds;
+      config.ppg_file = opt_.ppg_file;
+      config.ppg_rate = opt_.ppg_rate;
+      config.ppg_offset = 7.3 * i;
+      config.rtc_start = rtc;
+      std::string error;
+      if (!s->stream.Init(config, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return false;
+      }
+      char name[32];
+      std::snprintf(name, sizeof(name), "/sensor%02d", i);
+      s->index = i;
+      s->link = dir_ + name;
+      s->rng.seed(opt_.seed * 7919u + static_cast<uint32_t>(i));
+      if (opt_.disconnect_every > 0) {
+        s->next_drop = std::uniform_real_distribution<double>(0, opt_.disconnect_every)(s->rng);
+      }
+      if (!Connect(s.get())) return false;
+      sensors_.push_back(std::move(s));
+    }
+    return true;
+  }
+
+  // Runs the receiver command, if any, on the links.
+  bool Spawn() {
+    if (opt_.command.empty()) return true;
+    std::vector<std::string> args;
+    for (const std::string& a : opt_.command) {
+      if (a.find("{}") == std::string::npos) {
+        args.push_back(a);
+        continue;
+      }
+      for (const auto& s : sensors_) {
+        args.push_back(Substitute(Substitute(a, "{}", s->link), "{n}", std::to_string(s->index)));
+      }
+    }
+    int out[2];
+    if (pipe2(out, O_CLOEXEC) != 0) {
+      std::perror("pipe2");
+      return false;
+    }
+    child_ = fork();
+    if (child_ < 0) {
+      std::perror("fork");
+      return false;
+    }
+    if (child_ == 0) {
+      dup2(out[1], STDOUT_FILENO);
+      std::vector<char*> argv;
+      for (std::string& a : args) argv.push_back(&a[0]);
+      argv.push_back(nullptr);
+      execvp(argv[0], argv.data());
+      std::perror(argv[0]);
+      _exit(127);
+    }
+    close(out[1]);
+    child_out_fd_ = out[0];
+    fcntl(child_out_fd_, F_SETFL, fcntl(child_out_fd_, F_GETFL) | O_NONBLOCK);
+    return true;
+  }
+
+  void Run() {
+    start_us_ = MonotonicUs();
+    int64_t settle_deadline = 0;
+    while (!g_stop) {
+      double now = (MonotonicUs() - start_us_) * 1e-6 * opt_.speed;
+      bool generating = now < opt_.seconds;
+      for (auto& s : sensors_) Step(s.get(), std::min(now, opt_.seconds), now, generating);
+      ReadChild();
+      if (child_ > 0 && waitpid(child_, &child_status_, WNOHANG) == child_) {
+        child_ = -1;
+        child_failed_ = true;
+        break;
+      }
+      if (!generating) {
+        // Everything sent must be read before the receiver is stopped.
+        if (!settle_deadline) settle_deadline = MonotonicUs() + 5000000;
+        bool settled = true;
+        for (auto& s : sensors_) settled = settled && s->delayed.empty() && Drained(s.get());
+        if (settled) break;
+        if (MonotonicUs() >= settle_deadline) {
+          for (auto& s : sensors_) {
+            if (!s->delayed.empty() || !Drained(s.get())) s->inexact = true;
+          }
+          break;
+        }
+      }
+      poll(nullptr, 0, kTickMs);
+    }
+    wall_seconds_ = (MonotonicUs() - start_us_) * 1e-6;
+    device_seconds_ = std::min(opt_.seconds, wall_seconds_ * opt_.speed);
+  }
+
+  // Stops the receiver and collects its report.
+  void Stop() {
+    if (child_ > 0) {
+      kill(child_, SIGTERM);
+      pollfd p = {child_out_fd_, POLLIN, 0};
+      int64_t deadline = MonotonicUs() + 10000000;
+      while (MonotonicUs() < deadline) {
+        poll(&p, 1, 100);
+        if (!ReadChild()) break;
+      }
+      waitpid(child_, &child_status_, 0);
+      child_ = -1;
+    }
+    for (auto& s : sensors_) Disconnect(s.get());
+    if (made_dir_) rmdir(dir_.c_str());
+  }
+
+  int Report() {
+    uint64_t sent = 0, bytes = 0, dropped = 0, offline = 0, corrupted = 0, generated = 0;
+    for (const auto& s : sensors_) {
+      std::printf("%-28s bpm %3.0f sent %llu bytes %llu dropped %llu offline %llu "
+                  "corrupted %llu reconnects %llu%s\n",
+                  s->link.c_str(), Bpm(*s),
+                  (unsigned long long)s->sent, (unsigned long long)s->delivered.bytes,
+                  (unsigned long long)s->dropped, (unsigned long long)s->offline,
+                  (unsigned long long)s->corrupted, (unsigned long long)s->reconnects,
+                  s->inexact ? " (not fully read)" : "");
+      generated += s->generated;
+      sent += s->sent;
+      bytes += s->delivered.bytes;
+      dropped += s->dropped;
+      offline += s->offline;
+      corrupted += s->corrupted;
+    }
+    std::printf("sensors            %zu\n", sensors_.size());
+    std::printf("device_seconds     %.1f\n", device_seconds_);
+    std::printf("wall_seconds       %.1f\n", wall_seconds_);
+    std::printf("messages           %llu\n", (unsigned long long)generated);
+    std::printf("messages_sent      %llu\n", (unsigned long long)sent);
+    std::printf("messages_dropped   %llu\n", (unsigned long long)dropped);
+    std::printf("messages_offline   %llu\n", (unsigned long long)offline);
+    std::printf("messages_corrupted %llu\n", (unsigned long long)corrupted);
+    std::printf("bytes_sent         %llu\n", (unsigned long long)bytes);
+    std::printf("throughput_kBps    %.1f\n", wall_seconds_ > 0 ? bytes / wall_seconds_ / 1e3 : 0);
+
+    int status = 0;
+    if (child_failed_) {
+      std::fprintf(stderr, "FAIL: receiver exited before the end of the run\n");
+      status = 1;
+    } else if (!opt_.command.empty() &&
+               !(WIFEXITED(child_status_) && WEXITSTATUS(child_status_) == 0)) {
+      std::fprintf(stderr, "FAIL: receiver exit status %d\n",
+                   WIFEXITED(child_status_) ? WEXITSTATUS(child_status_) : -1);
+      status = 1;
+    }
+    if (opt_.check && !Check()) status = 1;
+    if (status != 0 || !opt_.check) std::fwrite(child_out_.data(), 1, child_out_.size(), stdout);
+    return status;
+  }
+
+ private:
+  static constexpr int kTickMs = 5;
+  static constexpr int kQuietPolls = 3;
+  static constexpr int64_t kDrainUs = 2000000;
+
+  static std::string Substitute(std::string s, const std::string& what, const std::string& with) {
+    for (size_t at = s.find(what); at != std::string::npos; at = s.find(what, at + with.size())) {
+      s.replace(at, what.size(), with);
+    }
+    return s;
+  }
+
+  double Bpm(const VirtualSensor& s) const {
+    double f = opt_.sensors > 1 ? static_cast<double>(s.index) / (opt_.sensors - 1) : 0;
+    return std::round(opt_.bpm_lo + (opt_.bpm_hi - opt_.bpm_lo) * f);
+  }
+
+  // A new pty behind the sensor's link, replaced atomically.
+  bool Connect(VirtualSensor* s) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    char path[64];
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0 ||
+        ptsname_r(master, path, sizeof(path)) != 0) {
+      std::perror("posix_openpt");
+      if (master >= 0) close(master);
+      return false;
+    }
+    int slave = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (slave < 0) {
+      std::perror(path);
+      close(master);
+      return false;
+    }
+    // No echo or line editing: the firmware's bytes arrive as sent.
+    termios tio = {};
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    std::string tmp = s->link + ".new";
+    unlink(tmp.c_str());
+    if (symlink(path, tmp.c_str()) != 0 || rename(tmp.c_str(), s->link.c_str()) != 0) {
+      std::perror(s->link.c_str());
+      close(slave);
+      close(master);
+      return false;
+    }
+    s->master = master;
+    s->slave = slave;
+    s->state = VirtualSensor::kUp;
+    s->rx.clear();
+    return true;
+  }
+
+  // The link goes before the pty, so a receiver cannot reopen the old
+  // path after its number has been handed to another sensor.
+  void Disconnect(VirtualSensor* s) {
+    unlink(s->link.c_str());
+    if (s->slave >= 0) close(s->slave);
+    if (s->master >= 0) close(s->master);
+    s->slave = s->master = -1;
+  }
+
+  // Nothing queued and the receiver has read everything, for a few polls
+  // in a row (bytes may still be on their way into the line discipline).
+  bool Drained(VirtualSensor* s) {
+    if (!s->tx.empty() || !s->wire.empty()) {
+      s->quiet_polls = 0;
+      return false;
+    }
+    int unread = 0;
+    if (s->slave >= 0 && ioctl(s->slave, FIONREAD, &unread) == 0 && unread > 0) {
+      s->quiet_polls = 0;
+      return false;
+    }
+    return ++s->quiet_polls >= kQuietPolls;
+  }
+
+  void Step(VirtualSensor* s, double until, double now, bool generating) {
+    if (generating) {
+      std::vector<fleet::SensorStream::Message> out;
+      s->stream.Advance(until, &out);
+      for (auto& m : out) Delay(s, std::move(m));
+    }
+    ReadCommands(s, now);
+
+    while (!s->delayed.empty() && s->delayed.front().device_s <= now) {
+      Accept(s, std::move(s->delayed.front()));
+      s->delayed.pop_front();
+    }
+
+    // The UART drains the TX buffer at the line rate.
+    s->credit += (now - s->last_step) * opt_.baud / 10.0;
+    s->last_step = now;
+    size_t n = std::min(s->tx.size(), static_cast<size_t>(s->credit));
+    s->wire.append(s->tx, 0, n);
+    s->tx.erase(0, n);
+    s->credit -= n;
+    if (s->tx.empty()) s->credit = std::min(s->credit, 1.0);
+
+    int64_t burst = opt_.burst_ms > 0 ? static_cast<int64_t>(now * 1e3 / opt_.burst_ms) : 0;
+    if (s->master >= 0 && !s->wire.empty() && (opt_.burst_ms <= 0 || burst != s->last_burst)) {
+      ssize_t w = write(s->master, s->wire.data(), s->wire.size());
+      if (w > 0) s->wire.erase(0, static_cast<size_t>(w));
+      s->last_burst = burst;
+    }
+
+    switch (s->state) {
+      case VirtualSensor::kUp:
+        if (opt_.disconnect_every > 0 && generating && now >= s->next_drop) {
+          s->state = VirtualSensor::kDraining;
+          s->drain_deadline = MonotonicUs() + kDrainUs;
+          s->quiet_polls = 0;
+        }
+        break;
+      case VirtualSensor::kDraining: {
+        bool drained = Drained(s);
+        if (!drained && MonotonicUs() < s->drain_deadline) break;
+        if (!drained) s->inexact = true;
+        s->tx.clear();
+        s->wire.clear();
+        Disconnect(s);
+        s->up_at = s->next_drop + opt_.disconnect_seconds;
+        s->next_drop += opt_.disconnect_every;
+        s->state = VirtualSensor::kDown;
+        break;
+      }
+      case VirtualSensor::kDown:
+        if (now >= s->up_at && Connect(s)) s->reconnects++;
+        break;
+    }
+  }
+
+  void Delay(VirtualSensor* s, fleet::SensorStream::Message m) {
+    s->generated++;
+    double release = m.device_s;
+    if (opt_.jitter_ms > 0) {
+      release += std::uniform_real_distribution<double>(0, opt_.jitter_ms * 1e-3)(s->rng);
+    }
+    s->last_release = std::max(s->last_release, release);
+    m.device_s = s->last_release;
+    s->delayed.push_back(std::move(m));
+  }
+
+  // The firmware hands a message to the module; it is sent if the link is
+  // up and the TX buffer has room for all of it.
+  void Accept(VirtualSensor* s, fleet::SensorStream::Message m) {
+    if (s->state != VirtualSensor::kUp) {
+      s->offline++;
+      return;
+    }
+    if (s->tx.size() + m.bytes.size() > opt_.tx_buffer) {
+      s->dropped++;
+      return;
+    }
+    if (m.kind != fleet::SensorStream::kConfig && opt_.corrupt > 0 &&
+        std::uniform_real_distribution<double>(0, 1)(s->rng) < opt_.corrupt &&
+        fleet::SensorStream::Corrupt(&m, s->rng())) {
+      s->corrupted++;
+    }
+    Delivered& d = s->delivered;
+    d.bytes += m.bytes.size();
+    switch (m.kind) {
+      case fleet::SensorStream::kVitals:
+        d.lines++;
+        if (m.corrupt) d.bad++;
+        else if (m.low_quality) d.low_quality++;
+        break;
+      case fleet::SensorStream::kConfig:
+        d.lines++;
+        break;
+      case fleet::SensorStream::kWave:
+      case fleet::SensorStream::kBeats:
+        if (!m.corrupt) {
+          d.frames++;
+          d.beats += m.beats;
+        }
+        break;
+    }
+    s->sent++;
+    s->tx += m.bytes;
+  }
+
+  // The receiver asks for the configuration when it opens the port.
+  void ReadCommands(VirtualSensor* s, double now) {
+    if (s->master < 0) return;
+    char buf[256];
+    ssize_t n;
+    while ((n = read(s->master, buf, sizeof(buf))) > 0) s->rx.append(buf, static_cast<size_t>(n));
+    for (size_t nl = s->rx.find('\n'); nl != std::string::npos; nl = s->rx.find('\n')) {
+      std::string line = s->rx.substr(0, nl);
+      s->rx.erase(0, nl + 1);
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      if (line == "#GET") Delay(s, s->stream.Config(now));
+    }
+    if (s->rx.size() > 256) s->rx.clear();
+  }
+
+  bool ReadChild() {
+    if (child_out_fd_ < 0) return false;
+    char buf[4096];
+    while (true) {
+      ssize_t n = read(child_out_fd_, buf, sizeof(buf));
+      if (n > 0) {
+        child_out_.append(buf, static_cast<size_t>(n));
+        continue;
+      }
+      if (n < 0 && (errno == EAGAIN || errno == EINTR)) return true;
+      close(child_out_fd_);
+      child_out_fd_ = -1;
+      return false;
+    }
+  }
+
+  // Matches health_ingestd's per-device report lines:
+  // "DEVICE bytes N lines N frames N bad N low_quality N ... beats N".
+  bool Check() {
+    std::map<std::string, std::map<std::string, uint64_t>> reported;
+    std::istringstream in(child_out_);
+    std::string line;
+    while (std::getline(in, line)) {
+      std::istringstream fields(line);
+      std::string device, key;
+      uint64_t value;
+      fields >> device;
+      while (fields >> key >> value) reported[device][key] = value;
+    }
+    int matched = 0, skipped = 0;
+    bool ok = true;
+    for (const auto& s : sensors_) {
+      if (s->inexact) {
+        skipped++;
+        continue;
+      }
+      auto it = reported.find(s->link);
+      if (it == reported.end()) {
+        std::fprintf(stderr, "FAIL: %s not in the receiver's report\n", s->link.c_str());
+        ok = false;
+        continue;
+      }
+      const Delivered& d = s->delivered;
+      const std::pair<const char*, uint64_t> expected[] = {
+          {"bytes", d.bytes}, {"lines", d.lines}, {"frames", d.frames},
+          {"bad", d.bad}, {"low_quality", d.low_quality}, {"beats", d.beats}};
+      bool same = true;
+      for (const auto& e : expected) {
+        uint64_t got = it->second.count(e.first) ? it->second.at(e.first) : ~uint64_t{0};
+        if (got != e.second) {
+          std::fprintf(stderr, "FAIL: %s %s: sent %llu, received %llu\n", s->link.c_str(),
+                       e.first, (unsigned long long)e.second, (unsigned long long)got);
+          same = false;
+        }
+      }
+      if (same) matched++;
+      ok = ok && same;
+    }
+    std::printf("checked            %d of %zu sensors match (%d not fully read)\n", matched,
+                sensors_.size(), skipped);
+    if (matched == 0) ok = false;
+    return ok;
+  }
+
+  const Options& opt_;
+  std::string dir_;
+  bool made_dir_ = false;
+  std::vector<std::unique_ptr<VirtualSensor>> sensors_;
+  int64_t start_us_ = 0;
+  double wall_seconds_ = 0, device_seconds_ = 0;
+  pid_t child_ = -1;
+  int child_status_ = 0;
+  bool child_failed_ = false;
+  int child_out_fd_ = -1;
+  std::string child_out_;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!ParseOptions(argc, argv, &opt)) {
+    Usage();
+    return 2;
+  }
+  signal(SIGINT, OnSignal);
+  signal(SIGTERM, OnSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  Fleet fleet(opt);
+  if (!fleet.Init() || !fleet.Spawn()) {
+    fleet.Stop();
+    return 2;
+  }
+  fleet.Run();
+  fleet.Stop();
+  return fleet.Report();
+}
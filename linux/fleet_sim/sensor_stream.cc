@@ -0,0 +1,200 @@
+#include "sensor_stream.h"
+
+#include <cmath>
+#include <ctime>
+#include <utility>
+
+namespace fleet {
+
+namespace {
+
+constexpr uint8_t kFrameSync = 0xB5;
+constexpr uint8_t kFrameWave = 'W';
+constexpr uint8_t kFrameRr = 'R';
+constexpr uint8_t kStreamRaw = 'R';
+constexpr size_t kRrMax = 8;          // RR_MAX
+constexpr uint16_t kRrBreak = 0x8000;  // RR_BREAK
+constexpr int kLowPerfusion = 0x02;   // SQI_LOW_PI: what a lifted finger reads as
+
+uint8_t Crc8(uint8_t crc, uint8_t d) {
+  crc ^= d;
+  for (int k = 0; k < 8; k++) crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+  return crc;
+}
+
+void PutVarint(std::vector<uint8_t>* out, int64_t v) {
+  uint64_t z = v < 0 ? (static_cast<uint64_t>(-v) << 1) - 1 : static_cast<uint64_t>(v) << 1;
+  while (z >= 0x80) {
+    out->push_back(static_cast<uint8_t>(z & 0x7F) | 0x80);
+    z >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(z));
+}
+
+// Whether the bytes of a rejected frame, rescanned as a receiver does,
+// neither start a frame nor end a line, and end in a non-ASCII byte that
+// drops them all before the next line.
+bool RescansClean(const std::string& frame) {
+  for (size_t i = 2; i < frame.size(); i++) {
+    uint8_t b = static_cast<uint8_t>(frame[i]);
+    if (b == kFrameSync || b == '\n') return false;
+  }
+  uint8_t last = static_cast<uint8_t>(frame.back());
+  return (last < 0x20 && last != '\r') || last > 0x7E;
+}
+
+}  // namespace
+
+std::string Frame(uint8_t type, const std::vector<uint8_t>& payload) {
+  std::string out;
+  out.push_back(static_cast<char>(kFrameSync));
+  out.push_back(static_cast<char>(payload.size() + 1));
+  out.push_back(static_cast<char>(type));
+  uint8_t crc = Crc8(0, type);
+  for (uint8_t b : payload) {
+    out.push_back(static_cast<char>(b));
+    crc = Crc8(crc, b);
+  }
+  out.push_back(static_cast<char>(crc));
+  return out;
+}
+
+bool SensorStream::Init(const StreamConfig& config, std::string* error) {
+  config_ = config;
+  if (config_.block < 4 || config_.block > 32) {
+    *error = "block must be 4..32 samples";
+    return false;
+  }
+  if (config_.decimation < 1 || config_.sample_rate <= 0) {
+    *error = "bad sample rate or decimation";
+    return false;
+  }
+  if (!config_.ppg_file.empty()) {
+    ppg_ = sim::LoadPpgFile(config_.ppg_file, config_.ppg_rate, error);
+    if (!ppg_) return false;
+  } else {
+    ppg_ = sim::MakeSyntheticPpg(config_.bpm, config_.lift_every, config_.lift_seconds);
+  }
+  return true;
+}
+
+SensorStream::Message SensorStream::Config(double device_s) const {
+  Message m;
+  m.kind = kConfig;
+  m.device_s = device_s;
+  m.bytes = "$C," + std::to_string(static_cast<long>(config_.sample_rate)) + ",31,31," +
+            std::to_string(config_.decimation) + ",R," + std::to_string(config_.block) +
+            ",1\r\n";
+  return m;
+}
+
+void SensorStream::Advance(double until_s, std::vector<Message>* out) {
+  while (static_cast<double>(sample_no_) / output_rate() <= until_s) {
+    Sample(static_cast<double>(sample_no_) / output_rate(), out);
+  }
+}
+
+bool SensorStream::Lifted(double t) const {
+  return config_.lift_every > 0 &&
+         std::fmod(t, config_.lift_every) > config_.lift_every - config_.lift_seconds;
+}
+
+void SensorStream::Sample(double t, std::vector<Message>* out) {
+  bool lifted = Lifted(t);
+  sim::PpgSample s = {};
+  if (!ppg_->At(t + config_.ppg_offset - ppg_base_, &s)) {
+    ppg_base_ = t + config_.ppg_offset;  // start the recording over
+    ppg_->At(0, &s);
+  }
+  last_wave_ = static_cast<int32_t>(s.ir);
+  block_.push_back(last_wave_);
+  if (block_.size() == static_cast<size_t>(config_.block)) FlushBlock(t, out);
+
+  int64_t beat = static_cast<int64_t>(std::floor(t * config_.bpm / 60.0));
+  if (lifted) {
+    beat_break_ = true;
+  } else if (beat_index_ >= 0 && beat != beat_index_) {
+    uint16_t ms = static_cast<uint16_t>(std::lround(60000.0 / config_.bpm));
+    beats_.push_back(beat_break_ ? ms | kRrBreak : ms);
+    beat_break_ = false;
+    if (beats_.size() == kRrMax) FlushBeats(t, out);
+  }
+  beat_index_ = beat;
+
+  if (sample_no_ % config_.decimation == 0) {
+    time_t now = static_cast<time_t>(config_.rtc_start + static_cast<int64_t>(t));
+    struct tm local = {};
+    localtime_r(&now, &local);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+    Message m;
+    m.kind = kVitals;
+    m.device_s = t;
+    m.low_quality = lifted;
+    m.bytes = std::string(stamp) + "," + std::to_string(last_wave_) + "," +
+              std::to_string(std::lround(config_.spo2)) + "," +
+              std::to_string(std::lround(config_.bpm)) + "," +
+              std::to_string(lifted ? kLowPerfusion : 0) + "," + std::to_string(sample_no_) +
+              "\r\n";
+    out->push_back(std::move(m));
+  }
+  sample_no_++;
+}
+
+void SensorStream::FlushBlock(double t, std::vector<Message>* out) {
+  std::vector<uint8_t> payload = {block_seq_++, static_cast<uint8_t>(block_.size()), kStreamRaw};
+  for (size_t k = 0; k < block_.size(); k++) {
+    PutVarint(&payload, k == 0 ? block_[0] : int64_t{block_[k]} - block_[k - 1]);
+  }
+  block_.clear();
+  Message m;
+  m.kind = kWave;
+  m.device_s = t;
+  m.bytes = Frame(kFrameWave, payload);
+  out->push_back(std::move(m));
+}
+
+void SensorStream::FlushBeats(double t, std::vector<Message>* out) {
+  std::vector<uint8_t> payload = {static_cast<uint8_t>(beat_seq_),
+                                  static_cast<uint8_t>(beat_seq_ >> 8),
+                                  static_cast<uint8_t>(beats_.size())};
+  for (uint16_t v : beats_) {
+    payload.push_back(static_cast<uint8_t>(v));
+    payload.push_back(static_cast<uint8_t>(v >> 8));
+  }
+  Message m;
+  m.kind = kBeats;
+  m.device_s = t;
+  m.beats = static_cast<int>(beats_.size());
+  m.bytes = Frame(kFrameRr, payload);
+  beat_seq_ = static_cast<uint16_t>(beat_seq_ + beats_.size());
+  beats_.clear();
+  out->push_back(std::move(m));
+}
+
+bool SensorStream::Corrupt(Message* m, uint32_t random) {
+  if (m->kind == kVitals) {
+    // The SpO2 field (third): no longer a number, so the line is rejected.
+    size_t field = m->bytes.find(',');
+    if (field != std::string::npos) field = m->bytes.find(',', field + 1);
+    if (field != std::string::npos) m->bytes[field + 1] = 'x';
+    m->corrupt = true;
+    return true;
+  }
+  std::string bytes = m->bytes;
+  if ((random >> 24) % 4 == 0 && static_cast<uint8_t>(bytes[1]) < 0xFF) {
+    // The CRC over TYPE .. CRC is zero and the swallowed byte (a sync byte
+    // or the start of a line) never is, so the frame is rejected.
+    bytes[1] = static_cast<char>(bytes[1] + 1);
+  } else {
+    // TYPE .. CRC; the sync and length bytes keep the receiver in step.
+    size_t at = 2 + random % (bytes.size() - 2);
+    bytes[at] = static_cast<char>(bytes[at] ^ (1 << ((random >> 16) & 7)));
+  }
+  if (!RescansClean(bytes)) return false;
+  m->bytes = std::move(bytes);
+  m->corrupt = true;
+  return true;
+}
+
+}  // namespace fleet
@@ -0,0 +1,90 @@
+#ifndef FLEET_SIM_SENSOR_STREAM_H_
+#define FLEET_SIM_SENSOR_STREAM_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ppg_source.h"
+
+namespace fleet {
+
+struct StreamConfig {
+  double sample_rate = 100;  // SR; the firmware averages 4 samples, so 25 Hz out
+  int decimation = 25;       // output samples per vitals line (#DEC)
+  int block = 10;            // samples per waveform frame (#BLK)
+  double bpm = 72;           // reported in vitals lines and used for the pulse and beats
+  double spo2 = 97;
+  double lift_every = 0;     // finger lifted for lift_seconds every lift_every
+  double lift_seconds = 0;
+  std::string ppg_file;      // recorded PPG instead of the synthetic finger
+  double ppg_rate = 100;
+  double ppg_offset = 0;     // seconds into the recording (sensors start apart)
+  int64_t rtc_start = 0;     // epoch seconds of the device clock at t = 0
+};
+
+// What the firmware (lib/etc/atmega_code.c) puts on the UART for one
+// sensor, in the same wire format: "time,wave,spo2,bpm,sqi,sample_no"
+// vitals lines, 'W' waveform frames (raw stream) and 'R' beat-interval
+// frames, plus the "$C" line it answers #GET with. Nothing is measured from
+// the waveform; the vitals and beats are the configured truth, so a
+// receiver's results can be compared with them.
+class SensorStream {
+ public:
+  enum Kind { kVitals, kWave, kBeats, kConfig };
+
+  struct Message {
+    Kind kind = kVitals;
+    double device_s = 0;  // device time the firmware would send it
+    std::string bytes;
+    int beats = 0;         // intervals in an 'R' frame
+    bool low_quality = false;
+    bool corrupt = false;
+  };
+
+  bool Init(const StreamConfig& config, std::string* error);
+
+  // Appends everything the device sends up to device time |until_s|.
+  void Advance(double until_s, std::vector<Message>* out);
+
+  Message Config(double device_s) const;
+
+  double output_rate() const { return config_.sample_rate / 4; }
+
+  // Damages |m| so that a receiver must reject it, and only it: the SpO2
+  // field of a vitals line becomes non-numeric, or one bit of a frame after
+  // its length byte flips (CRC-8 catches every single-bit error), or the
+  // length byte grows by one so that the frame swallows the first byte of
+  // the next message, which a receiver must rescan. |random| picks the
+  // damage. A receiver rescans a rejected frame's bytes, so a frame is only
+  // damaged if none of them can start a frame, end a line or be taken as
+  // the start of the next line; otherwise |m| is left intact and false is
+  // returned. Config lines are never damaged.
+  static bool Corrupt(Message* m, uint32_t random);
+
+ private:
+  void Sample(double t, std::vector<Message>* out);
+  void FlushBlock(double t, std::vector<Message>* out);
+  void FlushBeats(double t, std::vector<Message>* out);
+  bool Lifted(double t) const;
+
+  StreamConfig config_;
+  std::unique_ptr<sim::PpgSource> ppg_;
+  double ppg_base_ = 0;  // recordings loop
+  int64_t sample_no_ = 0;
+  int32_t last_wave_ = 0;
+  std::vector<int32_t> block_;
+  uint8_t block_seq_ = 0;
+  int64_t beat_index_ = -1;
+  bool beat_break_ = true;
+  std::vector<uint16_t> beats_;
+  uint16_t beat_seq_ = 0;
+};
+
+// [0xB5][LEN][TYPE][payload][CRC8], as bt_frame() sends it.
+std::string Frame(uint8_t type, const std::vector<uint8_t>& payload);
+
+}  // namespace fleet
+
+#endif  // FLEET_SIM_SENSOR_STREAM_H_
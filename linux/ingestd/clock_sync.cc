@@ -0,0 +1,74 @@
+#include "clock_sync.h"
+
+#include <cmath>
+#include <limits>
+
+namespace ingest {
+
+void ClockSync::Reset() {
+  synced_ = false;
+  have_last_ = false;
+  have_min_ = false;
+  points_.clear();
+}
+
+void ClockSync::Observe(int64_t ticks, int64_t host_us, double nominal_period_us) {
+  if (nominal_period_us != nominal_period_us_ || (have_last_ && ticks < last_ticks_)) {
+    Reset();
+    nominal_period_us_ = nominal_period_us;
+    period_us_ = nominal_period_us;
+  }
+  have_last_ = true;
+  last_ticks_ = ticks;
+
+  if (!have_min_) window_start_ = host_us;
+  if (!have_min_ || Residual(ticks, host_us) < Residual(min_.ticks, min_.host_us)) {
+    min_ = {ticks, host_us};
+    have_min_ = true;
+  }
+  if (!synced_) {
+    // Usable right away, before the first window closes.
+    offset_us_ = min_.host_us - period_us_ * min_.ticks;
+    synced_ = true;
+  }
+  if (host_us - window_start_ >= kWindowUs) {
+    points_.push_back(min_);
+    if (points_.size() > kMaxPoints) points_.pop_front();
+    have_min_ = false;
+    Fit();
+  }
+}
+
+int64_t ClockSync::ToHostMicros(int64_t ticks) const {
+  return static_cast<int64_t>(std::llround(offset_us_ + period_us_ * ticks));
+}
+
+double ClockSync::Residual(int64_t ticks, int64_t host_us) const {
+  return host_us - period_us_ * ticks;
+}
+
+void ClockSync::Fit() {
+  const Point& first = points_.front();
+  const Point& last = points_.back();
+  if (points_.size() >= 3 && last.host_us - first.host_us >= kMinFitSpanUs) {
+    // Least squares relative to the first point to keep double precision.
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const Point& p : points_) {
+      double x = static_cast<double>(p.ticks - first.ticks);
+      double y = static_cast<double>(p.host_us - first.host_us);
+      sx += x;
+      sy += y;
+      sxx += x * x;
+      sxy += x * y;
+    }
+    double n = static_cast<double>(points_.size());
+    double denom = n * sxx - sx * sx;
+    if (denom > 0) period_us_ = (n * sxy - sx * sy) / denom;
+  }
+  // Put the line under every envelope point (delays cannot be negative).
+  double offset = std::numeric_limits<double>::infinity();
+  for (const Point& p : points_) offset = std::fmin(offset, p.host_us - period_us_ * p.ticks);
+  offset_us_ = offset;
+}
+
+}  // namespace ingest
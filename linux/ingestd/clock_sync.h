@@ -0,0 +1,58 @@
+#ifndef INGESTD_CLOCK_SYNC_H_
+#define INGESTD_CLOCK_SYNC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace ingest {
+
+// Device sample counter -> host time (epoch µs); port of the app's
+// ClockSync (lib/services/clock_sync.dart).
+//
+// Each vitals line pairs a sample number with its receive time, which is
+// the send time plus a non-negative, jittery delay. Every kWindowUs only
+// the point with the smallest delay (the lower envelope) is kept, and
+// host = offset + period * ticks is fitted through those points.
+class ClockSync {
+ public:
+  static constexpr int64_t kWindowUs = 10 * 1000000;
+  static constexpr size_t kMaxPoints = 60;                 // 10 minutes
+  static constexpr int64_t kMinFitSpanUs = 60 * 1000000;   // below: nominal period
+
+  bool synced() const { return synced_; }
+  double period_us() const { return period_us_; }
+  // Last observed sample number (0 before the first vitals line).
+  int64_t last_ticks() const { return last_ticks_; }
+
+  void Reset();
+  // Starts over when the device reboots (counter goes back) or the
+  // sample rate changes.
+  void Observe(int64_t ticks, int64_t host_us, double nominal_period_us);
+  int64_t ToHostMicros(int64_t ticks) const;
+
+ private:
+  struct Point {
+    int64_t ticks;
+    int64_t host_us;
+  };
+
+  double Residual(int64_t ticks, int64_t host_us) const;
+  void Fit();
+
+  double nominal_period_us_ = 0;
+  double period_us_ = 0;
+  double offset_us_ = 0;
+  bool synced_ = false;
+  bool have_last_ = false;
+  int64_t last_ticks_ = 0;
+
+  int64_t window_start_ = 0;
+  bool have_min_ = false;
+  Point min_ = {0, 0};
+  std::deque<Point> points_;
+};
+
+}  // namespace ingest
+
+#endif  // INGESTD_CLOCK_SYNC_H_
@@ -0,0 +1,268 @@
+#include "history_codec.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ingest {
+
+namespace {
+
+const char kMagic[4] = {'V', 'L', 'O', 'G'};
+
+// Bucket widths, identical to HistoryCodec's.
+const int kTimeWidths[] = {0, 12, 22, 32, 64};
+const int kBpmWidths[] = {0, 3, 5, 9};
+const int kSpo2Widths[] = {0, 3, 6, 10, 17};
+const int kFlagWidths[] = {0, 8};
+const int kHrvWidths[] = {0, 4, 8, 17};
+const int kIrregularityWidths[] = {0, 4, 8};
+
+uint64_t Zigzag(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t Unzigzag(uint64_t z) {
+  return static_cast<int64_t>(z >> 1) ^ -static_cast<int64_t>(z & 1);
+}
+
+class BitWriter {
+ public:
+  explicit BitWriter(std::string* out) : out_(out) {}
+
+  template <size_t N>
+  void WriteVar(uint64_t z, const int (&widths)[N]) {
+    const size_t last = N - 1;
+    size_t k = 0;
+    while (k < last && widths[k] < 64 && z >= (uint64_t{1} << widths[k])) k++;
+    for (size_t j = 0; j < k; j++) Write(1, 1);
+    if (k < last) Write(0, 1);
+    int w = widths[k];
+    if (w > 32) {
+      Write(z >> 32, w - 32);
+      Write(z & 0xFFFFFFFFu, 32);
+    } else if (w > 0) {
+      Write(z, w);
+    }
+  }
+
+  void Finish() {
+    if (bits_ > 0) Write(0, 8 - bits_);
+  }
+
+ private:
+  void Write(uint64_t value, int bits) {
+    acc_ = (acc_ << bits) | (value & ((uint64_t{1} << bits) - 1));
+    bits_ += bits;
+    while (bits_ >= 8) {
+      bits_ -= 8;
+      out_->push_back(static_cast<char>((acc_ >> bits_) & 0xFF));
+    }
+    acc_ &= (uint64_t{1} << bits_) - 1;
+  }
+
+  std::string* out_;
+  uint64_t acc_ = 0;
+  int bits_ = 0;  // < 8 between writes
+};
+
+class BitReader {
+ public:
+  BitReader(const std::string& bytes, size_t pos, size_t end)
+      : bytes_(bytes), pos_(pos), end_(end) {}
+
+  bool ok() const { return ok_; }
+
+  template <size_t N>
+  uint64_t ReadVar(const int (&widths)[N]) {
+    const size_t last = N - 1;
+    size_t k = 0;
+    while (k < last && Read(1) == 1) k++;
+    int w = widths[k];
+    if (w > 32) {
+      uint64_t high = Read(w - 32);
+      return (high << 32) | Read(32);
+    }
+    return w > 0 ? Read(w) : 0;
+  }
+
+ private:
+  uint64_t Read(int bits) {
+    while (bits_ < bits) {
+      if (pos_ >= end_) {
+        ok_ = false;
+        return 0;
+      }
+      acc_ = (acc_ << 8) | static_cast<uint8_t>(bytes_[pos_++]);
+      bits_ += 8;
+    }
+    bits_ -= bits;
+    uint64_t v = (acc_ >> bits_) & ((uint64_t{1} << bits) - 1);
+    acc_ &= (uint64_t{1} << bits_) - 1;
+    return v;
+  }
+
+  const std::string& bytes_;
+  size_t pos_;
+  size_t end_;
+  uint64_t acc_ = 0;
+  int bits_ = 0;
+  bool ok_ = true;
+};
+
+template <typename T>
+void PutLe(std::string* out, size_t at, T v) {
+  for (size_t i = 0; i < sizeof(T); i++) {
+    (*out)[at + i] = static_cast<char>((static_cast<uint64_t>(v) >> (8 * i)) & 0xFF);
+  }
+}
+
+template <typename T>
+T GetLe(const std::string& in, size_t at) {
+  uint64_t v = 0;
+  for (size_t i = sizeof(T); i-- > 0;) v = (v << 8) | static_cast<uint8_t>(in[at + i]);
+  return static_cast<T>(v);
+}
+
+}  // namespace
+
+void AppendHistoryFileHeader(std::string* out) {
+  out->append(kMagic, sizeof(kMagic));
+  out->push_back(static_cast<char>(kHistoryVersion));
+}
+
+void EncodeHistoryBlock(const VitalsRecord* r, size_t count, std::string* out) {
+  size_t header = out->size();
+  out->resize(header + HistoryBlock::kHeaderSize);
+  BitWriter bits(out);
+
+  for (size_t i = 1; i < count; i++) {
+    int64_t delta = r[i].time_us - r[i - 1].time_us;
+    bits.WriteVar(Zigzag(i == 1 ? delta : delta - (r[i - 1].time_us - r[i - 2].time_us)),
+                  kTimeWidths);
+  }
+  int prev = 0;
+  for (size_t i = 0; i < count; i++) {
+    bits.WriteVar(Zigzag(r[i].bpm - prev), kBpmWidths);
+    prev = r[i].bpm;
+  }
+  prev = 0;
+  for (size_t i = 0; i < count; i++) {
+    bits.WriteVar(Zigzag(r[i].spo2_x10 - prev), kSpo2Widths);
+    prev = r[i].spo2_x10;
+  }
+  prev = 0;
+  uint8_t flags_any = 0;
+  for (size_t i = 0; i < count; i++) {
+    bits.WriteVar(static_cast<uint64_t>(r[i].flags ^ prev), kFlagWidths);
+    prev = r[i].flags;
+    flags_any |= r[i].flags;
+  }
+  VitalsHrv last;
+  for (size_t i = 0; i < count; i++) {
+    if (!(r[i].flags & kHistoryFlagHrv)) continue;
+    const VitalsHrv& h = r[i].hrv;
+    bits.WriteVar(Zigzag(h.sdnn_ms - last.sdnn_ms), kHrvWidths);
+    bits.WriteVar(Zigzag(h.rmssd_ms - last.rmssd_ms), kHrvWidths);
+    bits.WriteVar(Zigzag(h.irregularity_pct - last.irregularity_pct), kIrregularityWidths);
+    last = h;
+  }
+  bits.Finish();
+
+  uint8_t min_bpm = 255, max_bpm = 0;
+  uint16_t min_spo2 = 0xFFFF, max_spo2 = 0;
+  for (size_t i = 0; i < count; i++) {
+    min_bpm = std::min(min_bpm, r[i].bpm);
+    max_bpm = std::max(max_bpm, r[i].bpm);
+    min_spo2 = std::min(min_spo2, r[i].spo2_x10);
+    max_spo2 = std::max(max_spo2, r[i].spo2_x10);
+  }
+  PutLe<uint32_t>(out, header, static_cast<uint32_t>(out->size() - header - HistoryBlock::kHeaderSize));
+  PutLe<uint16_t>(out, header + 4, static_cast<uint16_t>(count));
+  PutLe<uint8_t>(out, header + 6, flags_any);
+  PutLe<int64_t>(out, header + 7, r[0].time_us);
+  PutLe<int64_t>(out, header + 15, r[count - 1].time_us);
+  PutLe<uint8_t>(out, header + 23, min_bpm);
+  PutLe<uint8_t>(out, header + 24, max_bpm);
+  PutLe<uint16_t>(out, header + 25, min_spo2);
+  PutLe<uint16_t>(out, header + 27, max_spo2);
+}
+
+bool ScanHistoryBlocks(const std::string& bytes, std::vector<HistoryBlock>* blocks,
+                       std::string* error) {
+  blocks->clear();
+  if (bytes.size() < kHistoryFileHeaderSize || std::memcmp(bytes.data(), kMagic, 4) != 0) {
+    *error = "not a history file (no VLOG header)";
+    return false;
+  }
+  if (static_cast<uint8_t>(bytes[4]) != kHistoryVersion) {
+    *error = "unsupported history file version " + std::to_string(static_cast<uint8_t>(bytes[4]));
+    return false;
+  }
+  size_t pos = kHistoryFileHeaderSize;
+  while (pos + HistoryBlock::kHeaderSize <= bytes.size()) {
+    HistoryBlock b;
+    b.offset = pos;
+    b.payload_bytes = GetLe<uint32_t>(bytes, pos);
+    b.count = GetLe<uint16_t>(bytes, pos + 4);
+    b.flags_any = GetLe<uint8_t>(bytes, pos + 6);
+    b.first_time_us = GetLe<int64_t>(bytes, pos + 7);
+    b.last_time_us = GetLe<int64_t>(bytes, pos + 15);
+    b.min_bpm = GetLe<uint8_t>(bytes, pos + 23);
+    b.max_bpm = GetLe<uint8_t>(bytes, pos + 24);
+    b.min_spo2_x10 = GetLe<uint16_t>(bytes, pos + 25);
+    b.max_spo2_x10 = GetLe<uint16_t>(bytes, pos + 27);
+    if (b.end() > bytes.size() || b.count == 0) break;
+    blocks->push_back(b);
+    pos = b.end();
+  }
+  return true;
+}
+
+bool DecodeHistoryBlock(const std::string& bytes, const HistoryBlock& block,
+                        std::vector<VitalsRecord>* out) {
+  BitReader bits(bytes, block.offset + HistoryBlock::kHeaderSize, block.end());
+  size_t base = out->size();
+  out->resize(base + block.count);
+  VitalsRecord* r = out->data() + base;
+
+  r[0].time_us = block.first_time_us;
+  int64_t delta = 0;
+  for (size_t k = 1; k < block.count; k++) {
+    int64_t v = Unzigzag(bits.ReadVar(kTimeWidths));
+    delta = k == 1 ? v : delta + v;
+    r[k].time_us = r[k - 1].time_us + delta;
+  }
+  int prev = 0;
+  for (size_t k = 0; k < block.count; k++) {
+    prev += static_cast<int>(Unzigzag(bits.ReadVar(kBpmWidths)));
+    r[k].bpm = static_cast<uint8_t>(prev);
+  }
+  prev = 0;
+  for (size_t k = 0; k < block.count; k++) {
+    prev += static_cast<int>(Unzigzag(bits.ReadVar(kSpo2Widths)));
+    r[k].spo2_x10 = static_cast<uint16_t>(prev);
+  }
+  prev = 0;
+  for (size_t k = 0; k < block.count; k++) {
+    prev ^= static_cast<int>(bits.ReadVar(kFlagWidths));
+    r[k].flags = static_cast<uint8_t>(prev);
+  }
+  int sdnn = 0, rmssd = 0, irregularity = 0;
+  for (size_t k = 0; k < block.count; k++) {
+    r[k].hrv = VitalsHrv();
+    if (!(r[k].flags & kHistoryFlagHrv)) continue;
+    sdnn += static_cast<int>(Unzigzag(bits.ReadVar(kHrvWidths)));
+    rmssd += static_cast<int>(Unzigzag(bits.ReadVar(kHrvWidths)));
+    irregularity += static_cast<int>(Unzigzag(bits.ReadVar(kIrregularityWidths)));
+    r[k].hrv.sdnn_ms = static_cast<uint16_t>(sdnn);
+    r[k].hrv.rmssd_ms = static_cast<uint16_t>(rmssd);
+    r[k].hrv.irregularity_pct = static_cast<uint8_t>(irregularity);
+  }
+  if (!bits.ok()) {
+    out->resize(base);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace ingest
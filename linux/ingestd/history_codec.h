@@ -0,0 +1,78 @@
+#ifndef INGESTD_HISTORY_CODEC_H_
+#define INGESTD_HISTORY_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The app's history file format (health_log.vlog); port of HistoryCodec
+// (lib/services/history_codec.dart). Both sides read and write the same
+// bytes.
+//
+// "VLOG" and a version byte, then blocks of up to kBlockRecords records.
+// A block is a 29-byte little-endian header (payload length u32, count
+// u16, OR of the flags u8, first and last time i64, BPM min/max u8,
+// SpO2 min/max u16) and a bit-packed payload, so a range scan can skip a
+// block from its header alone. The payload stores each column in turn;
+// every value is zigzag-encoded and written MSB first with a unary prefix
+// that picks one of a few widths (a lone 0 bit when the value is 0):
+//   time   delta for the second record, delta-of-delta after that
+//   BPM, SpO2  delta from the previous record
+//   flags  XOR with the previous record
+//   HRV    records with kFlagHrv only: SDNN, RMSSD, irregularity, each a
+//          delta from the previous HRV record
+namespace ingest {
+
+struct VitalsHrv {
+  uint16_t sdnn_ms = 0;
+  uint16_t rmssd_ms = 0;
+  uint8_t irregularity_pct = 0;
+};
+
+struct VitalsRecord {
+  int64_t time_us;
+  uint8_t bpm;
+  uint16_t spo2_x10;  // HistoryStore keeps SpO2 in 0.1 % steps
+  uint8_t flags;
+  VitalsHrv hrv;      // valid if flags & kHistoryFlagHrv
+};
+
+constexpr uint8_t kHistoryFlagHrv = 4;  // HistoryStore.FLAG_HRV
+
+struct HistoryBlock {
+  static constexpr size_t kHeaderSize = 29;
+
+  size_t offset = 0;  // of the header in the file
+  uint32_t payload_bytes = 0;
+  uint16_t count = 0;
+  uint8_t flags_any = 0;
+  int64_t first_time_us = 0;
+  int64_t last_time_us = 0;
+  uint8_t min_bpm = 0, max_bpm = 0;
+  uint16_t min_spo2_x10 = 0, max_spo2_x10 = 0;
+
+  size_t end() const { return offset + kHeaderSize + payload_bytes; }
+};
+
+constexpr uint8_t kHistoryVersion = 1;
+constexpr size_t kHistoryFileHeaderSize = 5;
+constexpr size_t kHistoryBlockRecords = 256;
+
+void AppendHistoryFileHeader(std::string* out);
+
+// Appends records[0, count) (ascending time, count > 0) as one block.
+void EncodeHistoryBlock(const VitalsRecord* records, size_t count, std::string* out);
+
+// Reads the block headers. A block cut short by an interrupted write ends
+// the list. Returns false (with |error|) if |bytes| is not a history file.
+bool ScanHistoryBlocks(const std::string& bytes, std::vector<HistoryBlock>* blocks,
+                       std::string* error);
+
+// Appends the records of |block| to |out|.
+bool DecodeHistoryBlock(const std::string& bytes, const HistoryBlock& block,
+                        std::vector<VitalsRecord>* out);
+
+}  // namespace ingest
+
+#endif  // INGESTD_HISTORY_CODEC_H_
@@ -0,0 +1,61 @@
+#include "hrv.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace ingest {
+
+void HrvEngine::Reset() {
+  head_ = 0;
+  count_ = 0;
+  sum_ = sum_sq_ = pairs_ = sum_sq_diff_ = irregular_ = 0;
+}
+
+void HrvEngine::Add(int rr_ms, bool contiguous) {
+  if (count_ == kCapacity) Evict();
+  int i = (head_ + count_) % kCapacity;
+  bool paired = contiguous && count_ > 0;
+  rr_[i] = rr_ms;
+  paired_[i] = paired ? 1 : 0;
+  count_++;
+  sum_ += rr_ms;
+  sum_sq_ += static_cast<int64_t>(rr_ms) * rr_ms;
+  if (paired) Pair(rr_[(i + kCapacity - 1) % kCapacity], rr_ms, 1);
+  while (sum_ > kWindowMs && count_ > 1) Evict();
+}
+
+bool HrvEngine::Get(Summary* out) const {
+  if (pairs_ < kMinPairs) return false;
+  int64_t n = count_;
+  // Sample variance (n·Σx² - (Σx)²) / n(n-1); the numerator is exact.
+  double variance = static_cast<double>(n * sum_sq_ - sum_ * sum_) / (n * (n - 1));
+  out->beats = count_;
+  out->mean_nn = static_cast<double>(sum_) / n;
+  out->sdnn = std::sqrt(std::max(0.0, variance));
+  out->rmssd = std::sqrt(static_cast<double>(sum_sq_diff_) / pairs_);
+  out->irregularity = static_cast<double>(irregular_) / pairs_;
+  return true;
+}
+
+// Drops the oldest interval and the pair it formed with the next one.
+void HrvEngine::Evict() {
+  int v = rr_[head_];
+  sum_ -= v;
+  sum_sq_ -= static_cast<int64_t>(v) * v;
+  head_ = (head_ + 1) % kCapacity;
+  count_--;
+  if (count_ > 0 && paired_[head_]) {
+    Pair(v, rr_[head_], -1);
+    paired_[head_] = 0;
+  }
+}
+
+void HrvEngine::Pair(int prev, int next, int sign) {
+  int64_t d = next - prev;
+  pairs_ += sign;
+  sum_sq_diff_ += sign * d * d;
+  if (std::abs(d) * 100 > static_cast<int64_t>(prev) * kIrregularPercent) irregular_ += sign;
+}
+
+}  // namespace ingest
@@ -0,0 +1,63 @@
+#ifndef INGESTD_HRV_H_
+#define INGESTD_HRV_H_
+
+#include <array>
+#include <cstdint>
+
+namespace ingest {
+
+// Windowed heart-rate variability over the beat intervals the firmware
+// sends in 'R' frames; port of the app's HrvEngine
+// (lib/services/hrv_engine.dart).
+//
+// The window holds the last kWindowMs of intervals. Sums of the
+// intervals, their squares, the squared successive differences and the
+// count of irregular pairs are kept as integers; an interval entering the
+// window is added and one leaving it is subtracted, so each beat costs
+// O(1) and the sums never drift.
+class HrvEngine {
+ public:
+  static constexpr int kWindowMs = 5 * 60 * 1000;
+  static constexpr int kMinPairs = 20;
+  // A pair is irregular if the interval changed by more than this percent.
+  static constexpr int kIrregularPercent = 20;
+  static constexpr double kIrregularScore = 0.3;
+
+  struct Summary {
+    int beats = 0;
+    double mean_nn = 0;       // ms
+    double sdnn = 0;          // ms
+    double rmssd = 0;         // ms
+    double irregularity = 0;  // fraction of irregular pairs
+  };
+
+  int beats() const { return count_; }
+  int64_t pairs() const { return pairs_; }
+
+  void Reset();
+  // |contiguous| is false for the first interval after a break (poor
+  // signal, lost frame), which must not be differenced with the previous.
+  void Add(int rr_ms, bool contiguous);
+  // False until kMinPairs successive pairs are in the window.
+  bool Get(Summary* out) const;
+
+ private:
+  static constexpr int kCapacity = 2048;  // 5 min at 250 BPM = 1250
+
+  void Evict();
+  void Pair(int prev, int next, int sign);
+
+  std::array<int32_t, kCapacity> rr_{};
+  std::array<uint8_t, kCapacity> paired_{};
+  int head_ = 0;
+  int count_ = 0;
+  int64_t sum_ = 0;
+  int64_t sum_sq_ = 0;
+  int64_t pairs_ = 0;
+  int64_t sum_sq_diff_ = 0;
+  int64_t irregular_ = 0;
+};
+
+}  // namespace ingest
+
+#endif  // INGESTD_HRV_H_
@@ -0,0 +1,358 @@
+// Headless ingest daemon: reads one or more sensors over serial and logs
+// their vitals into the app's storage, without GTK or the Flutter engine.
+//
+// Each DEVICE=STORE pair is an independent stream (decoder, clock sync,
+// alert and logging state) served from a single epoll loop, so one core
+// handles many sensors. The packet decoding, alert rules and log format
+// follow the app (see sensor.h), and STORE is the same history file
+// (health_log.vlog) the app reads its history from.
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sensor.h"
+#include "vitals_log.h"
+
+namespace {
+
+struct Options {
+  std::vector<std::pair<std::string, std::string>> streams;  // device, store
+  int baud = 9600;
+  double flush_seconds = 5;
+  double reopen_seconds = 2;
+  std::string alert_exec;
+  bool exit_on_eof = false;
+  bool quiet = false;
+  long expect_saved = -1;
+  long expect_stored = -1;
+  bool expect_reencoded = false;
+};
+
+void Usage() {
+  std::fprintf(stderr,
+      "usage: health_ingestd [options] DEVICE=STORE...\n"
+      "  DEVICE                serial port (/dev/rfcomm0, /dev/ttyUSB0, a pty) or a\n"
+      "                        recorded stream (firmware_sim --uart FILE), read to its end\n"
+      "  STORE                 the app's history file (health_log.vlog); created if\n"
+      "                        missing, importing health_logs from a shared_preferences.json\n"
+      "                        in the same directory\n"
+      "  --baud N              serial speed (default 9600)\n"
+      "  --flush-seconds N     how often changed logs are written (default 5);\n"
+      "                        a log is written at once after an alert\n"
+      "  --reopen-seconds N    retry interval for a device that went away (default 2)\n"
+      "  --alert-exec PROGRAM  run PROGRAM DEVICE MESSAGE for every alert\n"
+      "  --exit-on-eof         exit once every device has reached end of file\n"
+      "  --quiet               do not print alerts\n"
+      "  --expect-saved N      exit non-zero unless N vitals were logged in total\n"
+      "  --expect-stored N     exit non-zero unless the stores hold N records in total\n"
+      "  --expect-reencoded    exit non-zero unless re-encoding each store reproduces\n"
+      "                        its file byte for byte\n");
+}
+
+bool ParseOptions(int argc, char** argv, Options* o) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--exit-on-eof") { o->exit_on_eof = true; continue; }
+    if (a == "--quiet") { o->quiet = true; continue; }
+    if (a == "--expect-reencoded") { o->expect_reencoded = true; continue; }
+    if (a.compare(0, 2, "--") != 0) {
+      size_t eq = a.find('=');
+      if (eq == std::string::npos || eq == 0 || eq + 1 == a.size()) return false;
+      o->streams.emplace_back(a.substr(0, eq), a.substr(eq + 1));
+      continue;
+    }
+    if (i + 1 >= argc) return false;
+    const char* v = argv[++i];
+    if (a == "--baud") o->baud = std::atoi(v);
+    else if (a == "--flush-seconds") o->flush_seconds = std::atof(v);
+    else if (a == "--reopen-seconds") o->reopen_seconds = std::atof(v);
+    else if (a == "--alert-exec") o->alert_exec = v;
+    else if (a == "--expect-saved") o->expect_saved = std::atol(v);
+    else if (a == "--expect-stored") o->expect_stored = std::atol(v);
+    else return false;
+  }
+  return !o->streams.empty();
+}
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int64_t MonotonicUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+speed_t BaudConstant(int baud) {
+  switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    default: return B9600;
+  }
+}
+
+volatile sig_atomic_t g_stop = 0;
+
+void OnSignal(int) { g_stop = 1; }
+
+struct Endpoint {
+  std::string device;
+  std::unique_ptr<ingest::Sensor> sensor;
+  int fd = -1;
+  bool eof = false;
+  int64_t reopen_at = 0;  // monotonic
+};
+
+class Daemon {
+ public:
+  explicit Daemon(const Options& opt) : opt_(opt) {}
+
+  bool Init() {
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_ < 0) {
+      std::perror("epoll_create1");
+      return false;
+    }
+    for (const auto& stream : opt_.streams) {
+      ingest::VitalsLog*& log = logs_by_path_[stream.second];
+      if (!log) {
+        logs_.emplace_back(new ingest::VitalsLog(stream.second));
+        log = logs_.back().get();
+        std::string error;
+        if (!log->Load(&error)) {
+          std::fprintf(stderr, "%s\n", error.c_str());
+          return false;
+        }
+      }
+      std::unique_ptr<Endpoint> ep(new Endpoint);
+      ep->device = stream.first;
+      ep->sensor.reset(new ingest::Sensor(stream.first, log));
+      Endpoint* raw = ep.get();
+      ep->sensor->send = [raw](const std::string& line) {
+        if (raw->fd < 0) return;
+        std::string out = line + "\n";
+        // Non-blocking; a full TX buffer only costs a heartbeat.
+        ssize_t ignored = write(raw->fd, out.data(), out.size());
+        (void)ignored;
+      };
+      ep->sensor->on_alert = [this, raw, log](const std::string& message) {
+        Alert(raw->device, message);
+        Flush(log);
+      };
+      endpoints_.push_back(std::move(ep));
+    }
+    return true;
+  }
+
+  void Run() {
+    for (auto& ep : endpoints_) Open(ep.get());
+    epoll_event events[64];
+    int64_t next_flush = MonotonicUs() + static_cast<int64_t>(opt_.flush_seconds * 1e6);
+    while (!g_stop) {
+      if (opt_.exit_on_eof && AllAtEof()) break;
+      int n = epoll_wait(epoll_, events, 64, 200);
+      if (n < 0 && errno != EINTR) {
+        std::perror("epoll_wait");
+        break;
+      }
+      for (int i = 0; i < n; i++) Drain(static_cast<Endpoint*>(events[i].data.ptr));
+
+      int64_t now = NowUs(), mono = MonotonicUs();
+      for (auto& ep : endpoints_) {
+        if (ep->fd >= 0) {
+          ep->sensor->OnTick(now);
+        } else if (!ep->eof && mono >= ep->reopen_at) {
+          Open(ep.get());
+        }
+      }
+      if (mono >= next_flush) {
+        for (auto& log : logs_) Flush(log.get());
+        next_flush = mono + static_cast<int64_t>(opt_.flush_seconds * 1e6);
+      }
+    }
+    for (auto& log : logs_) Flush(log.get());
+  }
+
+  int Report(int64_t startup_us) {
+    uint64_t saved = 0, stored = 0;
+    for (auto& ep : endpoints_) {
+      const ingest::Sensor::Stats& s = ep->sensor->stats();
+      std::printf("%-20s bytes %llu lines %llu frames %llu bad %llu low_quality %llu "
+                  "saved %llu backfilled %llu alerts %llu beats %llu\n",
+                  ep->device.c_str(), (unsigned long long)s.bytes, (unsigned long long)s.lines,
+                  (unsigned long long)s.frames, (unsigned long long)s.bad_lines,
+                  (unsigned long long)s.low_quality, (unsigned long long)s.saved,
+                  (unsigned long long)s.backfilled, (unsigned long long)s.alerts,
+                  (unsigned long long)s.beats);
+      saved += s.saved;
+    }
+    for (auto& log : logs_) stored += log->size();
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    double cpu_ms = usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3 +
+                    usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+    std::printf("streams           %zu\n", endpoints_.size());
+    std::printf("logs_saved        %llu\n", (unsigned long long)saved);
+    std::printf("logs_stored       %llu\n", (unsigned long long)stored);
+    std::printf("startup_ms        %.1f\n", startup_us / 1e3);
+    std::printf("cpu_ms            %.1f\n", cpu_ms);
+    std::printf("max_rss_kb        %ld\n", usage.ru_maxrss);
+
+    int status = 0;
+    auto check = [&](bool ok, const char* what) {
+      if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        status = 1;
+      }
+    };
+    if (write_errors_ > 0) check(false, "store write");
+    if (opt_.expect_saved >= 0) check(saved >= (uint64_t)opt_.expect_saved, "vitals logged");
+    if (opt_.expect_stored >= 0) check(stored >= (uint64_t)opt_.expect_stored, "records stored");
+    if (opt_.expect_reencoded) {
+      for (auto& log : logs_) {
+        std::string error;
+        if (!log->MatchesFile(&error)) {
+          std::fprintf(stderr, "%s\n", error.c_str());
+          check(false, "store re-encoding");
+        }
+      }
+    }
+    return status;
+  }
+
+ private:
+  void Open(Endpoint* ep) {
+    // Recordings are only read; heartbeats must not end up in the file.
+    struct stat st = {};
+    bool recording = stat(ep->device.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+    int fd = open(ep->device.c_str(),
+                  (recording ? O_RDONLY : O_RDWR) | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+      if (!ep->reopen_at) std::fprintf(stderr, "%s: %s\n", ep->device.c_str(), std::strerror(errno));
+      ep->reopen_at = MonotonicUs() + static_cast<int64_t>(opt_.reopen_seconds * 1e6);
+      ep->eof = opt_.exit_on_eof;
+      return;
+    }
+    if (isatty(fd)) {
+      termios tio = {};
+      tcgetattr(fd, &tio);
+      cfmakeraw(&tio);
+      cfsetispeed(&tio, BaudConstant(opt_.baud));
+      cfsetospeed(&tio, BaudConstant(opt_.baud));
+      tio.c_cflag |= CLOCAL | CREAD;
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+    ep->fd = fd;
+    ep->sensor->OnOpen(NowUs());
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = ep;
+    if (epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      // Regular files (recordings) cannot be polled: read them through.
+      Drain(ep);
+    }
+  }
+
+  void Drain(Endpoint* ep) {
+    uint8_t buf[4096];
+    while (ep->fd >= 0) {
+      ssize_t n = read(ep->fd, buf, sizeof(buf));
+      if (n > 0) {
+        ep->sensor->OnBytes(buf, static_cast<size_t>(n), NowUs());
+        continue;
+      }
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0 && errno == EAGAIN) return;
+      // EOF, or EIO once the other end of a pty / rfcomm link is gone.
+      Close(ep);
+    }
+  }
+
+  void Close(Endpoint* ep) {
+    epoll_ctl(epoll_, EPOLL_CTL_DEL, ep->fd, nullptr);
+    close(ep->fd);
+    ep->fd = -1;
+    ep->eof = opt_.exit_on_eof;
+    ep->reopen_at = MonotonicUs() + static_cast<int64_t>(opt_.reopen_seconds * 1e6);
+  }
+
+  bool AllAtEof() const {
+    for (const auto& ep : endpoints_) {
+      if (!ep->eof) return false;
+    }
+    return true;
+  }
+
+  void Flush(ingest::VitalsLog* log) {
+    if (!log->dirty()) return;
+    std::string error;
+    if (!log->Save(&error)) {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      write_errors_++;
+    }
+  }
+
+  void Alert(const std::string& device, const std::string& message) {
+    if (!opt_.quiet) {
+      std::printf("ALERT %s %s\n", device.c_str(), message.c_str());
+      std::fflush(stdout);
+    }
+    if (opt_.alert_exec.empty()) return;
+    pid_t pid = fork();
+    if (pid == 0) {
+      execlp(opt_.alert_exec.c_str(), opt_.alert_exec.c_str(), device.c_str(), message.c_str(),
+             static_cast<char*>(nullptr));
+      _exit(127);
+    }
+    if (pid < 0) std::perror("fork");
+  }
+
+  const Options& opt_;
+  int epoll_ = -1;
+  std::vector<std::unique_ptr<ingest::VitalsLog>> logs_;
+  std::map<std::string, ingest::VitalsLog*> logs_by_path_;
+  std::vector<std::unique_ptr<Endpoint>> endpoints_;
+  int write_errors_ = 0;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int64_t start = MonotonicUs();
+  Options opt;
+  if (!ParseOptions(argc, argv, &opt)) {
+    Usage();
+    return 2;
+  }
+  signal(SIGINT, OnSignal);
+  signal(SIGTERM, OnSignal);
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGCHLD, SIG_IGN);  // alert hooks are never waited for
+
+  // Startup = ready to receive: stores loaded, sensors set up.
+  Daemon daemon(opt);
+  if (!daemon.Init()) return 2;
+  int64_t startup_us = MonotonicUs() - start;
+  daemon.Run();
+  return daemon.Report(startup_us);
+}
@@ -0,0 +1,149 @@
+#include "sensor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <utility>
+
+namespace ingest {
+
+Sensor::Sensor(std::string name, VitalsLog* log) : name_(std::move(name)), log_(log) {
+  decoder_.on_line = [this](const std::string& line) { OnLine(line); };
+  decoder_.on_frame = [this](uint8_t type, const uint8_t* payload, size_t length) {
+    OnFrame(type, payload, length);
+  };
+}
+
+void Sensor::OnOpen(int64_t now_us) {
+  now_us_ = now_us;
+  next_heartbeat_us_ = now_us + kHeartbeatUs;
+  if (send) send("#GET");
+}
+
+void Sensor::OnBytes(const uint8_t* data, size_t length, int64_t now_us) {
+  now_us_ = now_us;
+  stats_.bytes += length;
+  decoder_.Add(data, length);
+}
+
+void Sensor::OnTick(int64_t now_us) {
+  if (now_us < next_heartbeat_us_) return;
+  next_heartbeat_us_ = now_us + kHeartbeatUs;
+  if (send) send("#HB");
+}
+
+void Sensor::OnLine(const std::string& line) {
+  if (line.empty()) return;
+  stats_.lines++;
+  if (line[0] == '$') {
+    double rate = ParseOutputRate(line);
+    if (rate > 0) output_rate_ = rate;
+    return;
+  }
+  Vitals v;
+  if (!ParseVitals(line, &v)) {
+    stats_.bad_lines++;
+    return;
+  }
+  int64_t time_us = now_us_;
+  if (v.sample_no >= 0) {
+    clock_.Observe(v.sample_no, now_us_, 1e6 / output_rate_);
+    time_us = clock_.ToHostMicros(v.sample_no);
+  } else if (!v.time.empty()) {
+    int64_t t = ParseLocalTime(v.time);
+    if (t >= 0) time_us = t;
+  }
+  // Values from a poor-quality stretch (motion, finger lifted) are neither
+  // alerted on nor logged.
+  if (v.quality != 0) {
+    stats_.low_quality++;
+    return;
+  }
+  CheckThresholds(v.spo2, v.bpm, time_us);
+  SaveLog(v.bpm, v.spo2, time_us, false);
+}
+
+void Sensor::OnFrame(uint8_t type, const uint8_t* payload, size_t length) {
+  stats_.frames++;
+  if (type == RrBatch::kFrameType) {
+    RrBatch batch;
+    if (DecodeRrBatch(payload, length, &batch)) OnBeatIntervals(batch);
+    return;
+  }
+  if (type != HistoryBatch::kFrameType) return;
+  HistoryBatch batch;
+  if (!DecodeHistoryBatch(payload, length, &batch)) return;
+  // Records are timed through the vitals-line clock; until it is synced the
+  // batch is left unacknowledged and the device sends it again.
+  if (!clock_.synced()) return;
+  // Acknowledge right away so the device sends the next batch; these are
+  // past values, so they are merged without alerting.
+  if (send) send("#HB=" + std::to_string(batch.seq));
+  // Stored records always precede the live counter; if not, the device
+  // rebooted and its counter started over.
+  if (backfill_ticks_ > clock_.last_ticks()) backfill_ticks_ = -1;
+  for (const BackfillRecord& r : batch.records) {
+    // Skips the part of a resent batch (lost acknowledgement) already merged.
+    if (static_cast<int64_t>(r.sample_no) <= backfill_ticks_) continue;
+    backfill_ticks_ = r.sample_no;
+    if (r.bpm < 10 || r.spo2 < 10) continue;
+    int64_t time_us = clock_.ToHostMicros(r.sample_no);
+    if (log_->Add(time_us, r.bpm, r.spo2, VitalsLog::kFlagBackfill)) stats_.backfilled++;
+  }
+}
+
+// Like the app: a gap in seq (lost frame) breaks the first interval, and
+// after a pause longer than the window the old intervals are dropped.
+void Sensor::OnBeatIntervals(const RrBatch& batch) {
+  if (have_rr_ && now_us_ - last_rr_us_ > HrvEngine::kWindowMs * int64_t{1000}) hrv_.Reset();
+  have_rr_ = true;
+  last_rr_us_ = now_us_;
+  bool continues = batch.seq == next_rr_seq_;
+  for (size_t i = 0; i < batch.intervals.size(); i++) {
+    hrv_.Add(batch.intervals[i], batch.contiguous[i] && (i > 0 || continues));
+  }
+  stats_.beats += batch.intervals.size();
+  next_rr_seq_ = (batch.seq + static_cast<int>(batch.intervals.size())) & 0xFFFF;
+}
+
+void Sensor::CheckThresholds(double spo2, double bpm, int64_t time_us) {
+  if (alerted_ && time_us - last_alert_us_ < kAlertCooldownUs) return;
+
+  long bpm_q = std::lround(bpm);
+  long spo2_x10 = std::lround(spo2 * 10);
+  char message[96];
+  if (spo2_x10 < kLowSpo2X10 && spo2_x10 > kMinValid * 10) {
+    std::snprintf(message, sizeof(message), "low SpO2 (%g%%)", spo2);
+  } else if (bpm_q < kLowHeartRate && bpm_q > kMinValid) {
+    std::snprintf(message, sizeof(message), "bradycardia (%g BPM)", bpm);
+  } else if (bpm_q > kHighHeartRate) {
+    std::snprintf(message, sizeof(message), "tachycardia (%g BPM)", bpm);
+  } else {
+    return;
+  }
+  stats_.alerts++;
+  alerted_ = true;
+  last_alert_us_ = time_us;
+  if (on_alert) on_alert(message);
+  SaveLog(bpm, spo2, time_us, true);
+}
+
+void Sensor::SaveLog(double bpm, double spo2, int64_t time_us, bool emergency) {
+  if (!emergency && saved_ && time_us - last_save_us_ < kSaveIntervalUs) return;
+  saved_ = true;
+  last_save_us_ = time_us;
+  if (bpm < 10 || spo2 < 10) return;
+  uint8_t flags = emergency ? VitalsLog::kFlagEmergency : 0;
+  HrvEngine::Summary h;
+  if (have_rr_ && now_us_ - last_rr_us_ <= kHrvStaleUs && hrv_.Get(&h)) {
+    VitalsLog::Hrv hrv;
+    hrv.sdnn_ms = static_cast<uint16_t>(std::min(65535L, std::lround(h.sdnn)));
+    hrv.rmssd_ms = static_cast<uint16_t>(std::min(65535L, std::lround(h.rmssd)));
+    hrv.irregularity_pct = static_cast<uint8_t>(std::lround(h.irregularity * 100));
+    if (log_->Add(time_us, bpm, spo2, flags, &hrv)) stats_.saved++;
+  } else if (log_->Add(time_us, bpm, spo2, flags)) {
+    stats_.saved++;
+  }
+}
+
+}  // namespace ingest
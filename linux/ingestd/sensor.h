@@ -0,0 +1,98 @@
+#ifndef INGESTD_SENSOR_H_
+#define INGESTD_SENSOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "clock_sync.h"
+#include "hrv.h"
+#include "telemetry.h"
+#include "vitals_log.h"
+
+namespace ingest {
+
+// One sensor stream: what HealthController does for a connected device,
+// minus the UI. Vitals lines are mapped to host time, checked against the
+// alert rules and logged with the app's cadence; beat intervals feed the
+// HRV window stored with each record; backfill frames are acknowledged
+// and merged. All times are passed in, so the same code runs
+// live and on recorded streams.
+class Sensor {
+ public:
+  // Alert rule of the app (HistoryStore.alertsOf): values are rounded to the
+  // stored resolution (whole BPM, 0.1 % SpO2) before they are compared, so
+  // an alarm and the stored record always agree.
+  static constexpr long kLowSpo2X10 = 900;
+  static constexpr long kHighHeartRate = 120;
+  static constexpr long kLowHeartRate = 50;
+  static constexpr long kMinValid = 10;
+  static constexpr int64_t kAlertCooldownUs = 5 * 1000000;
+  static constexpr int64_t kSaveIntervalUs = 5 * 1000000;
+  static constexpr int64_t kHeartbeatUs = 1000000;
+  static constexpr double kDefaultOutputRate = 25.0;
+  // HRV is stored with a record only while beat intervals keep arriving.
+  static constexpr int64_t kHrvStaleUs = 10 * 1000000;
+
+  struct Stats {
+    uint64_t bytes = 0;
+    uint64_t lines = 0;
+    uint64_t frames = 0;
+    uint64_t bad_lines = 0;
+    uint64_t low_quality = 0;
+    uint64_t saved = 0;
+    uint64_t backfilled = 0;
+    uint64_t beats = 0;
+    uint64_t alerts = 0;
+  };
+
+  Sensor(std::string name, VitalsLog* log);
+
+  // Host -> device line (without the newline).
+  std::function<void(const std::string& line)> send;
+  // Fired for every alert with the reason, after the cooldown.
+  std::function<void(const std::string& message)> on_alert;
+
+  const std::string& name() const { return name_; }
+  const Stats& stats() const { return stats_; }
+  const HrvEngine& hrv() const { return hrv_; }
+  VitalsLog* log() const { return log_; }
+
+  // The link came up: ask for the configuration and start heartbeats.
+  void OnOpen(int64_t now_us);
+  void OnBytes(const uint8_t* data, size_t length, int64_t now_us);
+  // Heartbeats keep the device from treating the link as down and
+  // storing vitals for backfill.
+  void OnTick(int64_t now_us);
+
+ private:
+  void OnLine(const std::string& line);
+  void OnFrame(uint8_t type, const uint8_t* payload, size_t length);
+  void OnBeatIntervals(const RrBatch& batch);
+  void CheckThresholds(double spo2, double bpm, int64_t time_us);
+  void SaveLog(double bpm, double spo2, int64_t time_us, bool emergency);
+
+  std::string name_;
+  VitalsLog* log_;
+  TelemetryDecoder decoder_;
+  ClockSync clock_;
+  int64_t backfill_ticks_ = -1;  // sample number of the last merged backfill record
+  double output_rate_ = kDefaultOutputRate;
+  int64_t now_us_ = 0;
+  int64_t next_heartbeat_us_ = 0;
+  // Cooldowns run on sample time (not the wall clock) so a recorded stream
+  // replayed at full speed is logged exactly as it was live.
+  bool alerted_ = false;
+  int64_t last_alert_us_ = 0;
+  bool saved_ = false;
+  int64_t last_save_us_ = 0;
+  HrvEngine hrv_;
+  int next_rr_seq_ = -1;
+  bool have_rr_ = false;
+  int64_t last_rr_us_ = 0;  // host time of the last 'R' frame
+  Stats stats_;
+};
+
+}  // namespace ingest
+
+#endif  // INGESTD_SENSOR_H_
@@ -0,0 +1,180 @@
+#include "telemetry.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+namespace ingest {
+
+namespace {
+
+std::string Trim(const std::string& s) {
+  size_t begin = 0, end = s.size();
+  while (begin < end && static_cast<unsigned char>(s[begin]) <= ' ') begin++;
+  while (end > begin && static_cast<unsigned char>(s[end - 1]) <= ' ') end--;
+  return s.substr(begin, end - begin);
+}
+
+std::vector<std::string> Split(const std::string& s) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  while (true) {
+    size_t comma = s.find(',', start);
+    fields.push_back(s.substr(start, comma == std::string::npos ? comma : comma - start));
+    if (comma == std::string::npos) return fields;
+    start = comma + 1;
+  }
+}
+
+// Whole-field number parse, like Dart's double.parse (no trailing junk).
+bool ToDouble(const std::string& s, double* out) {
+  if (s.empty()) return false;
+  char* end = nullptr;
+  *out = std::strtod(s.c_str(), &end);
+  return *end == '\0';
+}
+
+bool ToInt(const std::string& s, int64_t* out) {
+  if (s.empty()) return false;
+  char* end = nullptr;
+  *out = std::strtoll(s.c_str(), &end, 10);
+  return *end == '\0';
+}
+
+}  // namespace
+
+uint8_t TelemetryDecoder::Crc8(uint8_t crc, uint8_t d) {
+  crc ^= d;
+  for (int k = 0; k < 8; k++) crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+  return crc;
+}
+
+void TelemetryDecoder::Add(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    uint8_t b = data[i];
+    if (in_frame_) {
+      FeedFrame(b);
+    } else if (b == kFrameSync) {
+      in_frame_ = true;
+      have_length_ = false;
+    } else if (b == '\n') {
+      std::string line = Trim(line_);
+      line_.clear();
+      if (on_line) on_line(line);
+    } else if ((b < 0x20 && b != '\r') || b > 0x7E) {
+      line_.clear();  // the rest of a damaged frame
+    } else if (line_.size() < kMaxLine) {
+      line_.push_back(static_cast<char>(b));
+    }
+  }
+}
+
+void TelemetryDecoder::FeedFrame(uint8_t b) {
+  if (!have_length_) {
+    if (b == 0) {
+      in_frame_ = false;
+      bad_frames_++;
+      return;
+    }
+    frame_length_ = b + 1u;  // TYPE + payload + CRC
+    frame_.clear();
+    have_length_ = true;
+    return;
+  }
+  frame_.push_back(b);
+  if (frame_.size() < frame_length_) return;
+
+  in_frame_ = false;
+  uint8_t crc = 0;
+  for (size_t k = 0; k + 1 < frame_.size(); k++) crc = Crc8(crc, frame_[k]);
+  if (crc != frame_.back()) {
+    bad_frames_++;
+    std::vector<uint8_t> rescan;
+    rescan.reserve(frame_.size() + 1);
+    rescan.push_back(static_cast<uint8_t>(frame_length_ - 1));  // LEN
+    rescan.insert(rescan.end(), frame_.begin(), frame_.end());
+    Add(rescan.data(), rescan.size());
+    return;
+  }
+  if (on_frame) on_frame(frame_[0], frame_.data() + 1, frame_.size() - 2);
+}
+
+bool ParseVitals(const std::string& line, Vitals* out) {
+  if (line.empty() || line[0] == '$') return false;
+  std::vector<std::string> v = Split(line);
+  Vitals r;
+  if (v.size() >= 4) {
+    int64_t n = 0;
+    r.time = v[0];
+    if (!ToDouble(v[1], &r.wave) || !ToDouble(v[2], &r.spo2) || !ToDouble(v[3], &r.bpm)) {
+      return false;
+    }
+    if (v.size() >= 5) {
+      if (!ToInt(v[4], &n)) return false;
+      r.quality = static_cast<int>(n);
+    }
+    if (v.size() >= 6) {
+      if (!ToInt(v[5], &n)) return false;
+      r.sample_no = n;
+    }
+  } else if (v.size() == 3) {
+    if (!ToDouble(v[0], &r.wave) || !ToDouble(v[1], &r.spo2) || !ToDouble(v[2], &r.bpm)) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+  *out = r;
+  return true;
+}
+
+double ParseOutputRate(const std::string& line) {
+  if (line.compare(0, 3, "$C,") != 0) return 0;
+  return std::atoi(line.c_str() + 3) / 4.0;
+}
+
+int64_t ParseLocalTime(const std::string& text) {
+  struct tm t = {};
+  const char* end = strptime(text.c_str(), "%Y-%m-%d %H:%M:%S", &t);
+  if (end == nullptr || *end != '\0') return -1;
+  t.tm_isdst = -1;
+  time_t seconds = std::mktime(&t);
+  return seconds == static_cast<time_t>(-1) ? -1 : static_cast<int64_t>(seconds) * 1000000;
+}
+
+// payload: seq, remaining (LE16), n, records x n
+// record: time (LE32, year6|month4|day5|second-of-day17), BPM, SpO2
+bool DecodeHistoryBatch(const uint8_t* payload, size_t length, HistoryBatch* out) {
+  if (length < 4) return false;
+  size_t count = payload[3];
+  if (length < 4 + count * HistoryBatch::kRecordSize) return false;
+  out->seq = payload[0];
+  out->remaining = payload[1] | (payload[2] << 8);
+  out->records.clear();
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* r = payload + 4 + i * HistoryBatch::kRecordSize;
+    uint32_t sample_no =
+        r[0] | (r[1] << 8) | (r[2] << 16) | (static_cast<uint32_t>(r[3]) << 24);
+    out->records.push_back({sample_no, r[4], r[5]});
+  }
+  return true;
+}
+
+// payload: seq (LE16), n, intervals (LE16 ms | kBreak) x n
+bool DecodeRrBatch(const uint8_t* payload, size_t length, RrBatch* out) {
+  if (length < 3) return false;
+  size_t count = payload[2];
+  if (length < 3 + count * 2) return false;
+  out->seq = static_cast<uint16_t>(payload[0] | (payload[1] << 8));
+  out->intervals.clear();
+  out->contiguous.clear();
+  for (size_t i = 0; i < count; i++) {
+    uint16_t v = static_cast<uint16_t>(payload[3 + i * 2] | (payload[4 + i * 2] << 8));
+    out->intervals.push_back(v & ~RrBatch::kBreak);
+    out->contiguous.push_back((v & RrBatch::kBreak) == 0);
+  }
+  return true;
+}
+
+}  // namespace ingest
@@ -0,0 +1,100 @@
+#ifndef INGESTD_TELEMETRY_H_
+#define INGESTD_TELEMETRY_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Device -> host byte stream, decoded exactly like the app's
+// TelemetryDecoder / HistoryBatch / vitals-line parser (lib/services).
+namespace ingest {
+
+// Splits ASCII lines ("...\r\n") from binary frames
+// ([0xB5][LEN][TYPE][payload][CRC8]); LEN counts TYPE and payload.
+// A frame failing its CRC may have a damaged LEN that swallowed the
+// messages after it, so the bytes after its sync byte are scanned again.
+// Lines are ASCII only: any other byte (the rest of a rescanned frame)
+// drops the partial line.
+class TelemetryDecoder {
+ public:
+  static constexpr uint8_t kFrameSync = 0xB5;
+  static constexpr size_t kMaxLine = 256;
+
+  std::function<void(const std::string& line)> on_line;
+  std::function<void(uint8_t type, const uint8_t* payload, size_t length)> on_frame;
+
+  void Add(const uint8_t* data, size_t length);
+
+  uint64_t bad_frames() const { return bad_frames_; }
+
+  // Same CRC as the firmware's crc8() (poly 0x07).
+  static uint8_t Crc8(uint8_t crc, uint8_t d);
+
+ private:
+  void FeedFrame(uint8_t byte);
+
+  std::string line_;
+  bool in_frame_ = false;
+  bool have_length_ = false;
+  std::vector<uint8_t> frame_;
+  size_t frame_length_ = 0;
+  uint64_t bad_frames_ = 0;
+};
+
+// "time,wave,spo2,bpm[,sqi_flags[,sample_no]]", or "wave,spo2,bpm" from
+// very old firmware.
+struct Vitals {
+  std::string time;
+  double wave = 0;
+  double spo2 = 0;
+  double bpm = 0;
+  int quality = 0;          // 0 = good
+  int64_t sample_no = -1;   // -1 when the firmware does not send it
+};
+
+bool ParseVitals(const std::string& line, Vitals* out);
+
+// "$C,sr,led_r,led_ir,dec,stream,blk": returns the waveform output rate
+// (SR / 4, the FIFO averaging), or 0 if |line| is not a config packet.
+double ParseOutputRate(const std::string& line);
+
+// Local "YYYY-MM-DD HH:MM:SS" (DS1302 time) -> epoch microseconds, or -1.
+int64_t ParseLocalTime(const std::string& text);
+
+// 'H' frame: records the device stored while the link was down. Each is
+// stamped with the same sample counter as the vitals lines, so it maps to
+// host time through the same ClockSync.
+struct BackfillRecord {
+  uint32_t sample_no;
+  uint8_t bpm;
+  uint8_t spo2;
+};
+
+struct HistoryBatch {
+  static constexpr uint8_t kFrameType = 'H';
+  static constexpr size_t kRecordSize = 6;
+
+  uint8_t seq = 0;
+  unsigned remaining = 0;
+  std::vector<BackfillRecord> records;
+};
+
+bool DecodeHistoryBatch(const uint8_t* payload, size_t length, HistoryBatch* out);
+
+// 'R' frame: beat intervals. seq numbers the first interval, so a gap
+// shows a lost frame.
+struct RrBatch {
+  static constexpr uint8_t kFrameType = 'R';
+  static constexpr uint16_t kBreak = 0x8000;  // not adjacent to the previous
+
+  uint16_t seq = 0;
+  std::vector<uint16_t> intervals;  // ms
+  std::vector<bool> contiguous;
+};
+
+bool DecodeRrBatch(const uint8_t* payload, size_t length, RrBatch* out);
+
+}  // namespace ingest
+
+#endif  // INGESTD_TELEMETRY_H_
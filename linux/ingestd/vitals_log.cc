@@ -0,0 +1,374 @@
+#include "vitals_log.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "telemetry.h"
+
+namespace ingest {
+
+namespace {
+
+// Just enough JSON to read shared_preferences.json: strings are decoded,
+// every other value can be skipped and kept as raw text.
+class JsonReader {
+ public:
+  explicit JsonReader(const std::string& text) : s_(text) {}
+
+  bool AtEnd() {
+    SkipSpace();
+    return pos_ >= s_.size();
+  }
+
+  bool Consume(char c) {
+    SkipSpace();
+    if (pos_ < s_.size() && s_[pos_] == c) {
+      pos_++;
+      return true;
+    }
+    return false;
+  }
+
+  bool Peek(char c) {
+    SkipSpace();
+    return pos_ < s_.size() && s_[pos_] == c;
+  }
+
+  bool String(std::string* out) {
+    if (!Consume('"')) return false;
+    out->clear();
+    while (pos_ < s_.size()) {
+      char c = s_[pos_++];
+      if (c == '"') return true;
+      if (c != '\\') {
+        out->push_back(c);
+        continue;
+      }
+      if (pos_ >= s_.size()) return false;
+      c = s_[pos_++];
+      switch (c) {
+        case 'b': out->push_back('\b'); break;
+        case 'f': out->push_back('\f'); break;
+        case 'n': out->push_back('\n'); break;
+        case 'r': out->push_back('\r'); break;
+        case 't': out->push_back('\t'); break;
+        case 'u': {
+          if (pos_ + 4 > s_.size()) return false;
+          unsigned code = static_cast<unsigned>(std::strtoul(s_.substr(pos_, 4).c_str(), nullptr, 16));
+          pos_ += 4;
+          // Keys and log entries are ASCII; anything else only needs to
+          // survive as valid UTF-8 (surrogate pairs are not recombined).
+          if (code < 0x80) {
+            out->push_back(static_cast<char>(code));
+          } else if (code < 0x800) {
+            out->push_back(static_cast<char>(0xC0 | (code >> 6)));
+            out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+          } else {
+            out->push_back(static_cast<char>(0xE0 | (code >> 12)));
+            out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+          }
+          break;
+        }
+        default: out->push_back(c); break;
+      }
+    }
+    return false;
+  }
+
+  bool Number(double* out) {
+    SkipSpace();
+    const char* begin = s_.c_str() + pos_;
+    char* end = nullptr;
+    *out = std::strtod(begin, &end);
+    if (end == begin) return false;
+    pos_ += end - begin;
+    return true;
+  }
+
+  // Skips one value of any type; |raw| receives its text.
+  bool Skip(std::string* raw) {
+    SkipSpace();
+    size_t start = pos_;
+    int depth = 0;
+    std::string ignored;
+    do {
+      if (pos_ >= s_.size()) return false;
+      char c = s_[pos_];
+      if (c == '"') {
+        if (!String(&ignored)) return false;
+        continue;
+      }
+      if (c == '{' || c == '[') depth++;
+      if (c == '}' || c == ']') depth--;
+      if (depth < 0) return false;
+      pos_++;
+      if (depth == 0 && c != '{' && c != '[' && c != '}' && c != ']') {
+        // Scalar: run to the next delimiter.
+        while (pos_ < s_.size() && !std::strchr(",}] \t\r\n", s_[pos_])) pos_++;
+      }
+    } while (depth > 0);
+    if (raw) *raw = s_.substr(start, pos_ - start);
+    return true;
+  }
+
+ private:
+  void SkipSpace() {
+    while (pos_ < s_.size() &&
+           (s_[pos_] == ' ' || s_[pos_] == '\t' || s_[pos_] == '\r' || s_[pos_] == '\n')) {
+      pos_++;
+    }
+  }
+
+  const std::string& s_;
+  size_t pos_ = 0;
+};
+
+// One HealthLog, current {"t","b","s","f","d","r","i"} or legacy
+// {"time","bpm","spo2"}.
+bool ParseLog(const std::string& json, int64_t* time_us, double* bpm, double* spo2,
+              uint8_t* flags, VitalsLog::Hrv* hrv) {
+  JsonReader r(json);
+  if (!r.Consume('{')) return false;
+  bool have_time = false, have_bpm = false, have_spo2 = false;
+  std::string key, text;
+  double number = 0;
+  *time_us = 0;
+  *flags = 0;
+  *hrv = VitalsLog::Hrv();
+  while (!r.Consume('}')) {
+    if (!r.String(&key) || !r.Consume(':')) return false;
+    if (r.Peek('"')) {
+      if (!r.String(&text)) return false;
+      if (key == "time") {
+        // Time-only legacy entries ("HH:mm:ss") have no date; like the app,
+        // treat them as the oldest.
+        int64_t t = ParseLocalTime(text);
+        *time_us = t < 0 ? 0 : t;
+        have_time = true;
+      }
+    } else if (r.Number(&number)) {
+      if (key == "t") {
+        *time_us = static_cast<int64_t>(std::llround(number));
+        have_time = true;
+      } else if (key == "b" || key == "bpm") {
+        *bpm = number;
+        have_bpm = true;
+      } else if (key == "s" || key == "spo2") {
+        *spo2 = number;
+        have_spo2 = true;
+      } else if (key == "f") {
+        *flags = static_cast<uint8_t>(number);
+      } else if (key == "d") {
+        hrv->sdnn_ms = static_cast<uint16_t>(number);
+      } else if (key == "r") {
+        hrv->rmssd_ms = static_cast<uint16_t>(number);
+      } else if (key == "i") {
+        hrv->irregularity_pct = static_cast<uint8_t>(number);
+      }
+    } else if (!r.Skip(nullptr)) {
+      return false;
+    }
+    r.Consume(',');
+  }
+  return have_time && have_bpm && have_spo2;
+}
+
+bool ReadFile(const std::string& path, std::string* out, std::string* error) {
+  FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) {
+    *error = path + ": " + std::strerror(errno);
+    return false;
+  }
+  out->clear();
+  char buf[65536];
+  size_t n;
+  while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) out->append(buf, n);
+  bool ok = !std::ferror(f);
+  std::fclose(f);
+  if (!ok) *error = path + ": read error";
+  return ok;
+}
+
+}  // namespace
+
+bool VitalsLog::Load(std::string* error) {
+  records_.clear();
+  block_offsets_.clear();
+  dirty_from_ = 0;
+  end_ = 0;
+
+  if (access(path_.c_str(), F_OK) != 0) {
+    if (errno != ENOENT) {
+      *error = path_ + ": " + std::strerror(errno);
+      return false;
+    }
+    size_t slash = path_.rfind('/');
+    std::string prefs = (slash == std::string::npos ? std::string() : path_.substr(0, slash + 1)) +
+                        kLegacyPrefsFile;
+    return access(prefs.c_str(), F_OK) != 0 || LoadLegacy(prefs, error);
+  }
+
+  std::string bytes;
+  if (!ReadFile(path_, &bytes, error)) return false;
+  std::vector<HistoryBlock> blocks;
+  if (!ScanHistoryBlocks(bytes, &blocks, error)) {
+    *error = path_ + ": " + *error;
+    return false;
+  }
+  bool aligned = true;
+  for (const HistoryBlock& block : blocks) {
+    // Block k must start at record k * kHistoryBlockRecords; otherwise the
+    // whole file is rewritten on the next save.
+    if (records_.size() != block_offsets_.size() * kHistoryBlockRecords) aligned = false;
+    block_offsets_.push_back(block.offset);
+    if (!DecodeHistoryBlock(bytes, block, &records_)) {
+      *error = path_ + ": corrupt block at offset " + std::to_string(block.offset);
+      return false;
+    }
+  }
+  end_ = blocks.empty() ? kHistoryFileHeaderSize : blocks.back().end();
+  dirty_from_ = records_.size();
+  if (!aligned) {
+    block_offsets_.clear();
+    end_ = 0;
+    dirty_from_ = 0;
+  }
+  return true;
+}
+
+bool VitalsLog::LoadLegacy(const std::string& prefs_path, std::string* error) {
+  std::string text;
+  if (!ReadFile(prefs_path, &text, error)) return false;
+
+  JsonReader r(text);
+  if (r.AtEnd()) return true;
+  if (!r.Consume('{')) {
+    *error = prefs_path + ": not a JSON object";
+    return false;
+  }
+  std::string key, entry;
+  while (!r.Consume('}')) {
+    if (!r.String(&key) || !r.Consume(':')) {
+      *error = prefs_path + ": malformed JSON";
+      return false;
+    }
+    if (key != kLegacyPrefsKey) {
+      if (!r.Skip(nullptr)) {
+        *error = prefs_path + ": malformed JSON";
+        return false;
+      }
+    } else {
+      if (!r.Consume('[')) {
+        *error = prefs_path + ": " + kLegacyPrefsKey + " is not a list";
+        return false;
+      }
+      while (!r.Consume(']')) {
+        int64_t time_us;
+        double bpm = 0, spo2 = 0;
+        uint8_t flags;
+        Hrv hrv;
+        if (!r.String(&entry)) {
+          *error = prefs_path + ": malformed log entry";
+          return false;
+        }
+        if (ParseLog(entry, &time_us, &bpm, &spo2, &flags, &hrv)) {
+          Add(time_us, bpm, spo2, flags, (flags & kFlagHrv) ? &hrv : nullptr);
+        }
+        r.Consume(',');
+      }
+    }
+    r.Consume(',');
+  }
+  return true;
+}
+
+bool VitalsLog::Save(std::string* error) {
+  if (!dirty() && end_ > 0) return true;
+  size_t first = dirty_from_ / kHistoryBlockRecords;
+  size_t offset = first < block_offsets_.size() ? block_offsets_[first] : end_;
+  std::string out;
+  if (offset == 0) AppendHistoryFileHeader(&out);
+  std::vector<size_t> offsets(block_offsets_.begin(),
+                              block_offsets_.begin() + std::min(first, block_offsets_.size()));
+  for (size_t start = first * kHistoryBlockRecords; start < records_.size();
+       start += kHistoryBlockRecords) {
+    size_t count = std::min(kHistoryBlockRecords, records_.size() - start);
+    offsets.push_back(offset + out.size());
+    EncodeHistoryBlock(records_.data() + start, count, &out);
+  }
+
+  int fd = open(path_.c_str(), O_WRONLY | O_CREAT, 0644);
+  if (fd < 0) {
+    *error = path_ + ": " + std::strerror(errno);
+    return false;
+  }
+  size_t done = 0;
+  bool ok = ftruncate(fd, static_cast<off_t>(offset)) == 0;
+  while (ok && done < out.size()) {
+    ssize_t w = pwrite(fd, out.data() + done, out.size() - done, static_cast<off_t>(offset + done));
+    if (w < 0 && errno == EINTR) continue;
+    ok = w >= 0;
+    if (ok) done += static_cast<size_t>(w);
+  }
+  ok = ok && fsync(fd) == 0;
+  if (!ok) *error = path_ + ": " + std::strerror(errno);
+  if (close(fd) != 0 && ok) {
+    *error = path_ + ": " + std::strerror(errno);
+    ok = false;
+  }
+  if (!ok) {
+    // Unknown state on disk: rewrite everything next time.
+    block_offsets_.clear();
+    end_ = 0;
+    dirty_from_ = 0;
+    return false;
+  }
+  block_offsets_ = std::move(offsets);
+  end_ = offset + out.size();
+  dirty_from_ = records_.size();
+  return true;
+}
+
+bool VitalsLog::MatchesFile(std::string* error) const {
+  std::string bytes;
+  if (!ReadFile(path_, &bytes, error)) return false;
+  std::string encoded;
+  AppendHistoryFileHeader(&encoded);
+  for (size_t start = 0; start < records_.size(); start += kHistoryBlockRecords) {
+    EncodeHistoryBlock(records_.data() + start,
+                       std::min(kHistoryBlockRecords, records_.size() - start), &encoded);
+  }
+  if (encoded == bytes) return true;
+  size_t at = 0;
+  while (at < encoded.size() && at < bytes.size() && encoded[at] == bytes[at]) at++;
+  *error = path_ + ": re-encoded records differ from the file at offset " + std::to_string(at);
+  return false;
+}
+
+bool VitalsLog::Add(int64_t time_us, double bpm, double spo2, uint8_t flags, const Hrv* hrv) {
+  auto later = [](const Record& r, int64_t t) { return r.time_us < t; };
+  auto it = records_.end();
+  if (!records_.empty() && records_.back().time_us >= time_us) {
+    it = std::lower_bound(records_.begin(), records_.end(), time_us, later);
+    if (it != records_.end() && it->time_us == time_us) return false;
+  }
+  Record r;
+  r.time_us = time_us;
+  r.bpm = static_cast<uint8_t>(std::min(255L, std::max(0L, std::lround(bpm))));
+  r.spo2_x10 = static_cast<uint16_t>(std::min(65535L, std::max(0L, std::lround(spo2 * 10))));
+  r.flags = static_cast<uint8_t>(hrv ? (flags | kFlagHrv) : (flags & ~kFlagHrv));
+  if (hrv) r.hrv = *hrv;
+  dirty_from_ = std::min(dirty_from_, static_cast<size_t>(it - records_.begin()));
+  records_.insert(it, r);
+  return true;
+}
+
+}  // namespace ingest
@@ -0,0 +1,73 @@
+#ifndef INGESTD_VITALS_LOG_H_
+#define INGESTD_VITALS_LOG_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "history_codec.h"
+
+namespace ingest {
+
+// Measurement history in the app's history file (health_log.vlog, see
+// history_codec.h), so a file written here can be opened by the app and
+// vice versa.
+//
+// Records are kept sorted by time; block k of the file holds records
+// [k * kHistoryBlockRecords, (k + 1) * kHistoryBlockRecords). Save()
+// rewrites from the block holding the first record not yet written, which
+// is normally just the last block, and syncs before returning.
+//
+// Older app versions kept the history as a JSON list under "health_logs"
+// in shared_preferences.json (~/.local/share/<application id>/ on Linux).
+// When the history file does not exist yet, Load() imports that list from
+// the shared_preferences.json next to it; the JSON file is never written.
+class VitalsLog {
+ public:
+  // Same values as HistoryStore.FLAG_*.
+  static constexpr uint8_t kFlagEmergency = 1;
+  static constexpr uint8_t kFlagBackfill = 2;
+  static constexpr uint8_t kFlagHrv = kHistoryFlagHrv;  // the HRV fields are set
+  static constexpr const char* kLegacyPrefsFile = "shared_preferences.json";
+  static constexpr const char* kLegacyPrefsKey = "flutter.health_logs";
+
+  // HRV at the time of the record (HistoryStore's HRV columns).
+  using Hrv = VitalsHrv;
+  using Record = VitalsRecord;
+
+  explicit VitalsLog(std::string path) : path_(std::move(path)) {}
+
+  const std::string& path() const { return path_; }
+  size_t size() const { return records_.size(); }
+  const std::vector<Record>& records() const { return records_; }
+  bool dirty() const { return dirty_from_ < records_.size(); }
+
+  // A missing file is an empty log (plus whatever the legacy JSON held).
+  // Returns false (with |error|) if the file exists but cannot be read or
+  // is not a history file.
+  bool Load(std::string* error);
+  // Writes the changed blocks in place and syncs.
+  bool Save(std::string* error);
+  // True if the file holds exactly the bytes a save from scratch would
+  // write for the loaded records, i.e. decoding and re-encoding is
+  // lossless (checks the format against files written by the app).
+  bool MatchesFile(std::string* error) const;
+
+  // Keeps records sorted by time; returns false for a duplicate timestamp
+  // (e.g. the same backfill batch received twice). |hrv| sets kFlagHrv.
+  bool Add(int64_t time_us, double bpm, double spo2, uint8_t flags, const Hrv* hrv = nullptr);
+
+ private:
+  bool LoadLegacy(const std::string& prefs_path, std::string* error);
+
+  std::string path_;
+  std::vector<Record> records_;
+  size_t dirty_from_ = 0;              // first record not in the file
+  std::vector<size_t> block_offsets_;  // of block k in the file
+  size_t end_ = 0;                     // of the valid data; 0 = no file yet
+};
+
+}  // namespace ingest
+
+#endif  // INGESTD_VITALS_LOG_H_
@@ -0,0 +1,159 @@
+// Fan-out regression for the live ring: one producer publishes as fast as it
+// can while several consumer processes, some deliberately slow, follow it.
+//
+// Every message encodes its own sequence number in each field, so a torn
+// read (a slot overwritten during the copy and not caught) shows up as a
+// mismatch. Every consumer must account for every message as received or
+// lost, in order, with none corrupt. The producer's CPU time per message is
+// reported with and without consumers; it never looks at them, and the only
+// extra work is one FUTEX_WAKE per message while some consumer is asleep.
+//
+//   health_live_check [--messages N] [--consumers N] [--slow-consumers N]
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "live_client.h"
+#include "live_ring.h"
+
+namespace {
+
+constexpr int kMaxSamples = 32;
+
+int Consume(const std::string& socket_path, uint64_t messages, bool slow) {
+  live::Subscriber sub;
+  std::string error;
+  if (!sub.Connect(socket_path, false, &error)) {
+    std::fprintf(stderr, "consumer: %s\n", error.c_str());
+    return 2;
+  }
+  live::Message msg;
+  live::WaveHeader wave;
+  std::vector<int32_t> samples;
+  uint64_t received = 0, torn = 0, last = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+  while (received + sub.lost() < messages) {
+    if (std::chrono::steady_clock::now() > deadline) break;
+    if (!sub.Next(&msg)) {
+      sub.Wait(100);
+      continue;
+    }
+    received++;
+    bool ok = msg.AsWave(&wave, &samples) && wave.time_us == static_cast<int64_t>(msg.seq) &&
+              wave.count == msg.seq % kMaxSamples + 1 && (received == 1 || msg.seq > last);
+    for (size_t i = 0; ok && i < samples.size(); i++) {
+      ok = samples[i] == static_cast<int32_t>(msg.seq * 31 + i);
+    }
+    if (!ok) torn++;
+    last = msg.seq;
+    if (slow && received % 64 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::printf("consumer %d%s: received %" PRIu64 ", lost %" PRIu64 ", corrupt %" PRIu64 "\n",
+              static_cast<int>(getpid()), slow ? " (slow)" : "", received, sub.lost(), torn);
+  std::fflush(stdout);
+  return torn != 0 || received + sub.lost() != messages ? 1 : 0;
+}
+
+// CPU time of the calling thread, so that consumers sharing the core do not
+// count against the producer.
+double ThreadNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+double PublishAll(live::Publisher* pub, uint64_t base, uint64_t messages) {
+  uint8_t buf[live::kMaxMessage];
+  double start = ThreadNanos();
+  for (uint64_t n = 0; n < messages; n++) {
+    uint64_t seq = base + n;
+    live::WaveHeader h = {};
+    h.stream = 'D';
+    h.count = static_cast<uint16_t>(seq % kMaxSamples + 1);
+    h.rate_hz = 25;
+    h.time_us = static_cast<int64_t>(seq);
+    std::memcpy(buf, &h, sizeof(h));
+    for (int i = 0; i < h.count; i++) {
+      int32_t v = static_cast<int32_t>(seq * 31 + i);
+      std::memcpy(buf + sizeof(h) + i * sizeof(v), &v, sizeof(v));
+    }
+    pub->Publish(live::kWave, buf, sizeof(h) + h.count * sizeof(int32_t));
+    // Pause now and then so the fast consumers usually keep up and the
+    // slow ones are lapped.
+    if (n % (live::kSlotCount / 4) == 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+  }
+  return (ThreadNanos() - start) / static_cast<double>(messages);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint64_t messages = 200000;
+  int consumers = 3, slow_consumers = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string a = argv[i];
+    if (a == "--messages") messages = std::strtoull(argv[i + 1], nullptr, 10);
+    else if (a == "--consumers") consumers = std::atoi(argv[i + 1]);
+    else if (a == "--slow-consumers") slow_consumers = std::atoi(argv[i + 1]);
+    else {
+      std::fprintf(stderr, "usage: health_live_check [--messages N] [--consumers N]"
+                           " [--slow-consumers N]\n");
+      return 2;
+    }
+  }
+
+  std::string socket_path = "/tmp/health_live_check." + std::to_string(getpid()) + "/live.sock";
+  live::Publisher pub;
+  std::string error;
+  if (!pub.Open(socket_path, &error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 2;
+  }
+
+  // Cost with nobody attached, for comparison.
+  double alone_ns = PublishAll(&pub, 0, messages);
+  uint64_t base = pub.published();
+
+  std::vector<pid_t> children;
+  for (int c = 0; c < consumers + slow_consumers; c++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      // Consumers start at the head, i.e. the first message after the
+      // baseline run.
+      _exit(Consume(socket_path, messages, c >= consumers));
+    }
+    children.push_back(pid);
+  }
+  // Hand out the ring as the consumers connect.
+  while (pub.handed_out() < children.size()) {
+    pub.Accept();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  double shared_ns = PublishAll(&pub, base, messages);
+
+  int failures = 0;
+  for (pid_t pid : children) {
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failures++;
+  }
+  std::string dir = socket_path.substr(0, socket_path.rfind('/'));
+  pub.Close();
+  rmdir(dir.c_str());
+  std::printf("publish_cpu_ns    %.0f alone, %.0f with %zu consumers\n", alone_ns,
+              shared_ns, children.size());
+  std::printf("%s\n", failures ? "FAIL" : "ok");
+  return failures ? 1 : 0;
+}
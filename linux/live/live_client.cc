@@ -0,0 +1,184 @@
+#include "live_client.h"
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace live {
+
+namespace {
+
+constexpr int kSpinMicros = 50;
+
+std::string Errno(const std::string& what) { return what + ": " + std::strerror(errno); }
+
+// Receives the ring descriptor and the producer's version byte.
+int ReceiveFd(int sock, uint8_t* version) {
+  char byte = 0;
+  struct iovec iov = {&byte, 1};
+  union {
+    struct cmsghdr header;
+    char buf[CMSG_SPACE(sizeof(int))];
+  } control;
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  ssize_t n;
+  do {
+    n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+  } while (n < 0 && errno == EINTR);
+  if (n != 1) return -1;
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) return -1;
+  int fd;
+  std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+  *version = static_cast<uint8_t>(byte);
+  return fd;
+}
+
+}  // namespace
+
+bool Message::AsVitals(VitalsMessage* out) const {
+  if (type != kVitals || length < sizeof(VitalsMessage)) return false;
+  std::memcpy(out, data, sizeof(VitalsMessage));
+  return true;
+}
+
+bool Message::AsWave(WaveHeader* header, std::vector<int32_t>* samples) const {
+  if (type != kWave || length < sizeof(WaveHeader)) return false;
+  std::memcpy(header, data, sizeof(WaveHeader));
+  if (sizeof(WaveHeader) + header->count * sizeof(int32_t) > length) return false;
+  samples->resize(header->count);
+  std::memcpy(samples->data(), data + sizeof(WaveHeader), header->count * sizeof(int32_t));
+  return true;
+}
+
+Subscriber::~Subscriber() { Close(); }
+
+bool Subscriber::Connect(const std::string& socket_path, bool from_oldest, std::string* error) {
+  Close();
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    *error = socket_path + ": path too long";
+    return false;
+  }
+  std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+  int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sock < 0) {
+    *error = Errno("socket");
+    return false;
+  }
+  if (connect(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+    *error = Errno(socket_path);
+    close(sock);
+    return false;
+  }
+  uint8_t version = 0;
+  int fd = ReceiveFd(sock, &version);
+  close(sock);
+  if (fd < 0) {
+    *error = socket_path + ": no ring descriptor received";
+    return false;
+  }
+  if (version != kVersion) {
+    *error = socket_path + ": unsupported ring version " + std::to_string(version);
+    close(fd);
+    return false;
+  }
+  void* header = mmap(nullptr, kSlotsOffset, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  void* slots = mmap(nullptr, kRingBytes - kSlotsOffset, PROT_READ, MAP_SHARED, fd,
+                     static_cast<off_t>(kSlotsOffset));
+  close(fd);  // the mappings keep the ring alive
+  if (header == MAP_FAILED || slots == MAP_FAILED) {
+    *error = Errno("mmap");
+    if (header != MAP_FAILED) munmap(header, kSlotsOffset);
+    if (slots != MAP_FAILED) munmap(slots, kRingBytes - kSlotsOffset);
+    return false;
+  }
+  ring_ = static_cast<RingHeader*>(header);
+  slots_ = static_cast<const uint8_t*>(slots);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (ring_->magic != kMagic || ring_->slot_size != kSlotSize ||
+      ring_->slot_count != kSlotCount) {
+    *error = socket_path + ": ring layout does not match this client";
+    Close();
+    return false;
+  }
+  uint64_t head = ring_->head.load(std::memory_order_acquire);
+  next_ = !from_oldest ? head : head > kSlotCount ? head - kSlotCount : 0;
+  lost_ = 0;
+  return true;
+}
+
+void Subscriber::Close() {
+  if (ring_) munmap(ring_, kSlotsOffset);
+  if (slots_) munmap(const_cast<uint8_t*>(slots_), kRingBytes - kSlotsOffset);
+  ring_ = nullptr;
+  slots_ = nullptr;
+}
+
+uint64_t Subscriber::backlog() const {
+  return ring_ ? ring_->head.load(std::memory_order_acquire) - next_ : 0;
+}
+
+bool Subscriber::Next(Message* out) {
+  if (!ring_) return false;
+  for (;;) {
+    uint64_t head = ring_->head.load(std::memory_order_acquire);
+    if (next_ >= head) return false;
+    if (head - next_ > kSlotCount) {
+      lost_ += head - kSlotCount - next_;
+      next_ = head - kSlotCount;
+    }
+    const Slot* slot = reinterpret_cast<const Slot*>(slots_) + (next_ & (kSlotCount - 1));
+    const uint64_t want = 2 * next_ + 2;
+    if (slot->mark.load(std::memory_order_acquire) == want) {
+      out->type = static_cast<uint8_t>(slot->type);
+      out->length = slot->length < kMaxMessage ? slot->length : kMaxMessage;
+      std::memcpy(out->data, slot->data, out->length);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot->mark.load(std::memory_order_relaxed) == want) {
+        out->seq = next_++;
+        return true;
+      }
+    }
+    // Overwritten while we were getting to it (or during the copy).
+    lost_++;
+    next_++;
+  }
+}
+
+void Subscriber::Wait(int timeout_ms) {
+  if (!ring_) return;
+  // Poll briefly first: under a busy stream the next message is usually
+  // microseconds away, and a sleeping consumer costs the producer a wake-up.
+  // Not on a single core, where polling only keeps the producer off it.
+  static const bool spin = sysconf(_SC_NPROCESSORS_ONLN) > 1;
+  auto spin_until = std::chrono::steady_clock::now() + std::chrono::microseconds(kSpinMicros);
+  while (spin && std::chrono::steady_clock::now() < spin_until) {
+    if (backlog() > 0) return;
+  }
+  uint32_t seen = ring_->notify.load(std::memory_order_acquire);
+  if (backlog() > 0) return;
+  ring_->waiters.fetch_add(1, std::memory_order_seq_cst);
+  if (backlog() == 0) {
+    struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    // Returns at once if a message was published since |seen| was read.
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&ring_->notify), FUTEX_WAIT, seen, &timeout,
+            nullptr, 0);
+  }
+  ring_->waiters.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+}  // namespace live
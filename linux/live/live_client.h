@@ -0,0 +1,62 @@
+#ifndef LIVE_LIVE_CLIENT_H_
+#define LIVE_LIVE_CLIENT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "live_ring.h"
+
+// Consumer side of the live ring (see live_ring.h). Link against
+// health_live; each Subscriber is independent and touches nothing the
+// producer waits on.
+namespace live {
+
+struct Message {
+  uint64_t seq = 0;
+  uint8_t type = 0;
+  uint32_t length = 0;
+  uint8_t data[kMaxMessage];
+
+  // Typed views; false if the message is not of that type or is short.
+  bool AsVitals(VitalsMessage* out) const;
+  bool AsWave(WaveHeader* header, std::vector<int32_t>* samples) const;
+};
+
+class Subscriber {
+ public:
+  Subscriber() = default;
+  ~Subscriber();
+  Subscriber(const Subscriber&) = delete;
+  Subscriber& operator=(const Subscriber&) = delete;
+
+  // Asks the producer at |socket_path| for the ring and maps it. Reading
+  // starts at the next message, or at the oldest one still in the ring if
+  // |from_oldest|.
+  bool Connect(const std::string& socket_path, bool from_oldest, std::string* error);
+  void Close();
+
+  // Copies the next message into |out|. Returns false if there is none yet.
+  // Messages overwritten before they could be read are skipped and counted
+  // in lost().
+  bool Next(Message* out);
+
+  // Blocks until a message may be available or |timeout_ms| passes. Polls
+  // for a few microseconds before sleeping.
+  void Wait(int timeout_ms);
+
+  // Messages published but not read yet.
+  uint64_t backlog() const;
+  uint64_t lost() const { return lost_; }
+  int64_t producer_pid() const { return ring_ ? ring_->producer_pid : 0; }
+
+ private:
+  RingHeader* ring_ = nullptr;   // header page, writable (waiters)
+  const uint8_t* slots_ = nullptr;
+  uint64_t next_ = 0;
+  uint64_t lost_ = 0;
+};
+
+}  // namespace live
+
+#endif  // LIVE_LIVE_CLIENT_H_
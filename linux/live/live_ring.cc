@@ -0,0 +1,171 @@
+#include "live_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace live {
+
+namespace {
+
+std::string Errno(const std::string& what) { return what + ": " + std::strerror(errno); }
+
+// Sends |fd| with a one-byte message carrying kVersion, so a client can
+// reject a producer it does not understand before mapping anything.
+bool SendFd(int sock, int fd) {
+  char byte = static_cast<char>(kVersion);
+  struct iovec iov = {&byte, 1};
+  union {
+    struct cmsghdr header;
+    char buf[CMSG_SPACE(sizeof(int))];
+  } control;
+  std::memset(&control, 0, sizeof(control));
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+  return sendmsg(sock, &msg, MSG_NOSIGNAL) == 1;
+}
+
+}  // namespace
+
+std::string DefaultSocketPath() {
+  const char* env = std::getenv("HEALTH_APP_LIVE_SOCKET");
+  if (env && *env) return env;
+  const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+  if (runtime && *runtime) return std::string(runtime) + "/health_app/live.sock";
+  return "/tmp/health_app-" + std::to_string(getuid()) + "/live.sock";
+}
+
+Publisher::~Publisher() { Close(); }
+
+bool Publisher::Open(const std::string& socket_path, std::string* error) {
+  Close();
+  // A private name: it is unlinked right away and the descriptor is what
+  // consumers get.
+  std::string name = "/health_app.live." + std::to_string(getpid());
+  shm_fd_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (shm_fd_ < 0) {
+    *error = Errno("shm_open " + name);
+    return false;
+  }
+  shm_unlink(name.c_str());
+  if (ftruncate(shm_fd_, static_cast<off_t>(kRingBytes)) != 0) {
+    *error = Errno("ftruncate");
+    Close();
+    return false;
+  }
+  void* base = mmap(nullptr, kRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd_, 0);
+  if (base == MAP_FAILED) {
+    *error = Errno("mmap");
+    Close();
+    return false;
+  }
+  // Fresh pages are zero: every slot mark is 0, i.e. "nothing written".
+  ring_ = new (base) RingHeader();
+  ring_->slot_size = kSlotSize;
+  ring_->slot_count = kSlotCount;
+  ring_->version = kVersion;
+  ring_->producer_pid = getpid();
+  ring_->head.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  ring_->magic = kMagic;
+
+  size_t slash = socket_path.rfind('/');
+  if (slash != std::string::npos && slash > 0) {
+    std::string dir = socket_path.substr(0, slash);
+    if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+      *error = Errno("mkdir " + dir);
+      Close();
+      return false;
+    }
+  }
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    *error = socket_path + ": path too long";
+    Close();
+    return false;
+  }
+  std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    *error = Errno("socket");
+    Close();
+    return false;
+  }
+  unlink(socket_path.c_str());
+  if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(listen_fd_, 16) != 0) {
+    *error = Errno(socket_path);
+    Close();
+    return false;
+  }
+  socket_path_ = socket_path;
+  return true;
+}
+
+void Publisher::Close() {
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(socket_path_.c_str());
+  }
+  if (ring_) {
+    munmap(ring_, kRingBytes);
+    ring_ = nullptr;
+  }
+  if (shm_fd_ >= 0) {
+    close(shm_fd_);
+    shm_fd_ = -1;
+  }
+}
+
+void Publisher::Accept() {
+  for (;;) {
+    int client = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) return;  // EAGAIN: no more pending
+    if (SendFd(client, shm_fd_)) handed_out_++;
+    close(client);
+  }
+}
+
+bool Publisher::Publish(uint8_t type, const void* data, size_t length) {
+  if (!ring_ || length > kMaxMessage) return false;
+  uint64_t seq = ring_->head.load(std::memory_order_relaxed);
+  Slot* slot = SlotAt(ring_, seq);
+  slot->mark.store(2 * seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot->type = type;
+  slot->length = static_cast<uint32_t>(length);
+  std::memcpy(slot->data, data, length);
+  slot->mark.store(2 * seq + 2, std::memory_order_release);
+  ring_->head.store(seq + 1, std::memory_order_release);
+  // Sequentially consistent against Subscriber::Wait(): either the waiter
+  // is seen here or it sees the new head / notify value before sleeping.
+  ring_->notify.fetch_add(1, std::memory_order_seq_cst);
+  // Only pay for the syscall when somebody is actually asleep.
+  if (ring_->waiters.load(std::memory_order_seq_cst) != 0) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&ring_->notify), FUTEX_WAKE, INT32_MAX,
+            nullptr, nullptr, 0);
+  }
+  return true;
+}
+
+}  // namespace live
@@ -0,0 +1,132 @@
+#ifndef LIVE_LIVE_RING_H_
+#define LIVE_LIVE_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Live data fan-out from the app to other local processes (a nurse-station
+// aggregator, a recorder, ...).
+//
+// The producer (the Linux runner) owns a POSIX shared-memory ring of
+// fixed-size slots and is the only writer. Any number of consumers map the
+// slots read-only and follow them on their own; the producer keeps no per-consumer
+// state and never waits for anyone. A consumer that falls more than a ring
+// behind sees the overwrite and skips ahead (counted as lost).
+//
+// Each slot is a seqlock: the writer marks it odd, copies the message in and
+// marks it even with the message's sequence number. A reader copies the
+// message out and accepts it only if the mark was the expected even value
+// both before and after the copy, so it never sees a torn message.
+//
+// Discovery is a Unix socket (DefaultSocketPath()). Connecting to it is the
+// whole protocol: the producer answers with the ring's file descriptor
+// (SCM_RIGHTS) and closes the connection. The shared-memory name is unlinked
+// as soon as it is created, so nothing is left behind in /dev/shm if the app
+// dies, and access is controlled by the socket's permissions (0700 dir).
+namespace live {
+
+constexpr uint32_t kMagic = 0x4556494C;  // "LIVE"
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kSlotSize = 256;
+constexpr uint32_t kSlotCount = 1024;    // power of two; ~5 min of the default stream
+constexpr uint32_t kSlotHeaderSize = 16;
+constexpr uint32_t kMaxMessage = kSlotSize - kSlotHeaderSize;
+
+// Message types. The producer only copies bytes; the layouts below are what
+// the app sends (lib/services/live_feed.dart), all little-endian.
+enum MessageType : uint8_t {
+  kWave = 'W',    // waveform block
+  kVitals = 'V',  // one vitals line
+};
+
+// kWave: WaveHeader followed by |count| int32 samples.
+struct WaveHeader {
+  uint8_t stream;   // 'R' raw, 'F' filtered, 'D' derivative
+  uint8_t reserved;
+  uint16_t count;
+  float rate_hz;    // sample rate of the block
+  int64_t time_us;  // host time the block arrived (epoch)
+};
+static_assert(sizeof(WaveHeader) == 16, "WaveHeader layout");
+
+struct VitalsMessage {
+  uint8_t quality;  // SQI flags, 0 = good
+  uint8_t reserved[3];
+  float bpm;
+  float spo2;
+  uint32_t reserved2;
+  int64_t time_us;  // sample time (epoch, device clock mapped to host)
+};
+static_assert(sizeof(VitalsMessage) == 24, "VitalsMessage layout");
+
+struct RingHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_size;
+  uint32_t slot_count;
+  std::atomic<uint64_t> head;      // sequence number of the next message
+  std::atomic<uint32_t> notify;    // futex word, bumped on every message
+  std::atomic<uint32_t> waiters;   // consumers blocked in Wait()
+  int64_t producer_pid;
+  uint8_t reserved[24];
+};
+static_assert(sizeof(RingHeader) == 64, "RingHeader layout");
+
+struct Slot {
+  std::atomic<uint64_t> mark;  // 2 * seq + 1 while writing, 2 * seq + 2 when done
+  uint32_t type;
+  uint32_t length;
+  uint8_t data[kMaxMessage];
+};
+static_assert(sizeof(Slot) == kSlotSize, "Slot layout");
+
+// The header has a page to itself: consumers map it writable (to register as
+// waiters) and the slots read-only.
+constexpr size_t kSlotsOffset = 4096;
+constexpr size_t kRingBytes = kSlotsOffset + static_cast<size_t>(kSlotCount) * kSlotSize;
+
+inline Slot* SlotAt(RingHeader* ring, uint64_t seq) {
+  return reinterpret_cast<Slot*>(reinterpret_cast<uint8_t*>(ring) + kSlotsOffset) +
+         (seq & (kSlotCount - 1));
+}
+
+// $HEALTH_APP_LIVE_SOCKET, else $XDG_RUNTIME_DIR/health_app/live.sock,
+// else /tmp/health_app-<uid>/live.sock.
+std::string DefaultSocketPath();
+
+// Producer side. Not thread-safe: call Publish() from one thread.
+class Publisher {
+ public:
+  Publisher() = default;
+  ~Publisher();
+  Publisher(const Publisher&) = delete;
+  Publisher& operator=(const Publisher&) = delete;
+
+  // Creates the ring and listens on |socket_path| (its directory is created
+  // 0700 if missing; a stale socket is replaced).
+  bool Open(const std::string& socket_path, std::string* error);
+  void Close();
+
+  // Watch this for readability and call Accept() (non-blocking).
+  int listen_fd() const { return listen_fd_; }
+  void Accept();
+
+  // One copy into the ring. Returns false if |length| > kMaxMessage.
+  bool Publish(uint8_t type, const void* data, size_t length);
+
+  uint64_t published() const { return ring_ ? ring_->head.load(std::memory_order_relaxed) : 0; }
+  uint64_t handed_out() const { return handed_out_; }
+
+ private:
+  RingHeader* ring_ = nullptr;
+  int shm_fd_ = -1;
+  int listen_fd_ = -1;
+  std::string socket_path_;
+  uint64_t handed_out_ = 0;
+};
+
+}  // namespace live
+
+#endif  // LIVE_LIVE_RING_H_
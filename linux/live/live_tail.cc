@@ -0,0 +1,92 @@
+// Prints the app's live stream: a minimal consumer of the live ring and an
+// example for the client library.
+//
+//   health_live_tail [--socket PATH] [--from-oldest] [--count N] [--timeout S]
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "live_client.h"
+
+namespace {
+
+void Usage() {
+  std::fprintf(stderr,
+      "usage: health_live_tail [options]\n"
+      "  --socket PATH   the app's live socket (default %s)\n"
+      "  --from-oldest   start at the oldest message still in the ring\n"
+      "  --count N       exit after N messages\n"
+      "  --timeout S     with --count, fail if they do not arrive within S seconds\n"
+      "  --quiet         print only the summary\n",
+      live::DefaultSocketPath().c_str());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string socket_path = live::DefaultSocketPath();
+  bool from_oldest = false, quiet = false;
+  long count = -1;
+  double timeout = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--from-oldest") { from_oldest = true; continue; }
+    if (a == "--quiet") { quiet = true; continue; }
+    if (i + 1 >= argc) {
+      Usage();
+      return 2;
+    }
+    const char* v = argv[++i];
+    if (a == "--socket") socket_path = v;
+    else if (a == "--count") count = std::atol(v);
+    else if (a == "--timeout") timeout = std::atof(v);
+    else {
+      Usage();
+      return 2;
+    }
+  }
+
+  live::Subscriber sub;
+  std::string error;
+  if (!sub.Connect(socket_path, from_oldest, &error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 2;
+  }
+  if (!quiet) std::printf("connected to pid %" PRId64 "\n", sub.producer_pid());
+
+  auto start = std::chrono::steady_clock::now();
+  live::Message msg;
+  live::VitalsMessage vitals;
+  live::WaveHeader wave;
+  std::vector<int32_t> samples;
+  long received = 0;
+  while (count < 0 || received < count) {
+    if (!sub.Next(&msg)) {
+      if (timeout > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                                 .count() > timeout) {
+        break;
+      }
+      sub.Wait(200);
+      continue;
+    }
+    received++;
+    if (quiet) continue;
+    if (msg.AsVitals(&vitals)) {
+      std::printf("%8" PRIu64 " V t=%" PRId64 " bpm=%.0f spo2=%.1f quality=%u\n", msg.seq,
+                  vitals.time_us, vitals.bpm, vitals.spo2, vitals.quality);
+    } else if (msg.AsWave(&wave, &samples)) {
+      std::printf("%8" PRIu64 " W %c %u @ %.1f Hz:", msg.seq, wave.stream, wave.count,
+                  wave.rate_hz);
+      for (int32_t s : samples) std::printf(" %d", s);
+      std::printf("\n");
+    } else {
+      std::printf("%8" PRIu64 " type 0x%02x, %u bytes\n", msg.seq, msg.type, msg.length);
+    }
+    std::fflush(stdout);
+  }
+  std::printf("received %ld, lost %" PRIu64 "\n", received, sub.lost());
+  return count >= 0 && received < count ? 1 : 0;
+}
@@ -1,15 +1,21 @@
 #include "my_application.h"
 
 #include <flutter_linux/flutter_linux.h>
+#include <glib-unix.h>
 #ifdef GDK_WINDOWING_X11
 #include <gdk/gdkx.h>
 #endif
 
 #include "flutter/generated_plugin_registrant.h"
+#include "live_ring.h"
 
 struct _MyApplication {
   GtkApplication parent_instance;
   char** dart_entrypoint_arguments;
+  // Live fan-out to other local processes (see linux/live/live_ring.h).
+  live::Publisher* live;
+  guint live_watch;
+  FlBasicMessageChannel* live_channel;
 };
 
 G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
@@ -19,6 +25,54 @@ static void first_frame_cb(MyApplication* self, FlView* view) {
   gtk_widget_show(gtk_widget_get_toplevel(GTK_WIDGET(view)));
 }
 
+// A consumer connected to the live socket: hand it the ring.
+static gboolean live_accept_cb(gint fd, GIOCondition condition,
+                               gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  self->live->Accept();
+  return G_SOURCE_CONTINUE;
+}
+
+// One message from LiveFeed (lib/services/live_feed.dart): a type byte
+// followed by the payload, copied once into the ring.
+static void live_message_cb(FlBasicMessageChannel* channel, FlValue* message,
+                            FlBasicMessageChannelResponseHandle* response_handle,
+                            gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  if (message != nullptr &&
+      fl_value_get_type(message) == FL_VALUE_TYPE_UINT8_LIST &&
+      fl_value_get_length(message) > 0) {
+    const uint8_t* bytes = fl_value_get_uint8_list(message);
+    self->live->Publish(bytes[0], bytes + 1, fl_value_get_length(message) - 1);
+  }
+  g_autoptr(FlValue) empty = fl_value_new_uint8_list(nullptr, 0);
+  fl_basic_message_channel_respond(channel, response_handle, empty, nullptr);
+}
+
+// Starts the live ring and its discovery socket. Failure only costs the
+// fan-out: the app runs as before.
+static void start_live(MyApplication* self, FlView* view) {
+  std::string error;
+  std::string path = live::DefaultSocketPath();
+  self->live = new live::Publisher();
+  if (!self->live->Open(path, &error)) {
+    g_warning("Live fan-out disabled: %s", error.c_str());
+    delete self->live;
+    self->live = nullptr;
+    return;
+  }
+  self->live_watch =
+      g_unix_fd_add(self->live->listen_fd(), G_IO_IN, live_accept_cb, self);
+
+  FlBinaryMessenger* messenger =
+      fl_engine_get_binary_messenger(fl_view_get_engine(view));
+  g_autoptr(FlBinaryCodec) codec = fl_binary_codec_new();
+  self->live_channel = fl_basic_message_channel_new(
+      messenger, "health_app/live", FL_MESSAGE_CODEC(codec));
+  fl_basic_message_channel_set_message_handler(
+      self->live_channel, live_message_cb, self, nullptr);
+}
+
 // Implements GApplication::activate.
 static void my_application_activate(GApplication* application) {
   MyApplication* self = MY_APPLICATION(application);
@@ -74,6 +128,7 @@ static void my_application_activate(GApplication* application) {
   gtk_widget_realize(GTK_WIDGET(view));
 
   fl_register_plugins(FL_PLUGIN_REGISTRY(view));
+  start_live(self, view);
 
   gtk_widget_grab_focus(GTK_WIDGET(view));
 }
@@ -121,6 +176,12 @@ static void my_application_shutdown(GApplication* application) {
 static void my_application_dispose(GObject* object) {
   MyApplication* self = MY_APPLICATION(object);
   g_clear_pointer(&self->dart_entrypoint_arguments, g_strfreev);
+  g_clear_object(&self->live_channel);
+  g_clear_handle_id(&self->live_watch, g_source_remove);
+  if (self->live != nullptr) {
+    delete self->live;
+    self->live = nullptr;
+  }
   G_OBJECT_CLASS(my_application_parent_class)->dispose(object);
 }
 
@@ -0,0 +1,142 @@
+import 'dart:math' as math;
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:health_app/models/alert_bitmap.dart';
+import 'package:health_app/models/history_store.dart';
+
+// 드문 구간(배열 컨테이너)과 빽빽한 구간(비트맵 컨테이너)이 섞인 오름차순 값
+List<int> _sample(int seed) {
+  final rng = math.Random(seed);
+  final values = <int>[];
+  int v = 0;
+  while (v < 600000) {
+    final dense = (v >> 16) % 3 == 1;
+    v += dense ? 1 + rng.nextInt(3) : 1 + rng.nextInt(200);
+    values.add(v);
+  }
+  return values;
+}
+
+void _expectMatches(AlertBitmap bitmap, List<int> values) {
+  expect(bitmap.cardinality, values.length);
+  final set = values.toSet();
+  final rng = math.Random(7);
+  for (int n = 0; n < 2000; n++) {
+    final v = rng.nextInt(values.isEmpty ? 10 : values.last + 10);
+    expect(bitmap.contains(v), set.contains(v));
+    int lo = 0, hi = values.length;
+    while (lo < hi) {
+      final mid = (lo + hi) >> 1;
+      if (values[mid] < v) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    expect(bitmap.rank(v), lo);
+    if (values.isNotEmpty) {
+      final k = rng.nextInt(values.length);
+      expect(bitmap.select(k), values[k]);
+    }
+  }
+}
+
+void main() {
+  test('rank, select and contains match a sorted list across container kinds', () {
+    final values = _sample(1);
+    final bitmap = AlertBitmap();
+    for (final v in values) {
+      bitmap.add(v);
+    }
+    _expectMatches(bitmap, values);
+  });
+
+  test('truncate keeps the prefix and accepts new values after it', () {
+    final values = _sample(2);
+    final bitmap = AlertBitmap();
+    for (final v in values) {
+      bitmap.add(v);
+    }
+    // 빽빽한 컨테이너 안에서 잘라 배열로 돌아가게
+    final cut = (1 << 16) + 3000;
+    bitmap.truncate(cut);
+    final kept = values.where((v) => v < cut).toList();
+    _expectMatches(bitmap, kept);
+    for (final v in values.where((v) => v >= cut + 5)) {
+      bitmap.add(v);
+      kept.add(v);
+    }
+    _expectMatches(bitmap, kept);
+  });
+
+  test('or matches the set union', () {
+    final a = _sample(3), b = _sample(4);
+    final x = AlertBitmap(), y = AlertBitmap();
+    a.forEach(x.add);
+    b.forEach(y.add);
+    final union = ({...a, ...b}.toList()..sort());
+    _expectMatches(AlertBitmap.or(x, y), union);
+  });
+
+  test('store keeps per-category indexes through back-filled inserts', () {
+    final rng = math.Random(5);
+    final store = HistoryStore();
+    final t0 = DateTime(2026, 3, 1).microsecondsSinceEpoch;
+    for (int i = 0; i < 20000; i++) {
+      // 가끔 과거 시각 (백필)
+      final t = t0 + (rng.nextInt(50) == 0 ? rng.nextInt(i + 1) * 5000000 + 1 : i * 5000000);
+      store.add(t, 40 + rng.nextInt(100).toDouble(), 85 + rng.nextInt(150) / 10);
+    }
+    for (final mask in [
+      HistoryStore.ALERT_HYPOXIA,
+      HistoryStore.ALERT_TACHYCARDIA,
+      HistoryStore.ALERT_BRADYCARDIA,
+      HistoryStore.ALERT_ANY,
+    ]) {
+      final expected = [
+        for (int i = 0; i < store.length; i++)
+          if ((store.alertsAt(i) & mask) != 0) i
+      ];
+      _expectMatches(store.alertIndex(mask), expected);
+
+      // 구간 보기: 최신이 위
+      final start = store.length ~/ 3, end = store.length * 2 ~/ 3;
+      final inRange = expected.where((i) => i >= start && i < end).toList();
+      final view = store.view(start, end, mask);
+      expect(view.length, inRange.length);
+      expect(store.alertCount(mask, start, end), inRange.length);
+      for (int k = 0; k < view.length; k++) {
+        expect(view.storeIndex(k), inRange[inRange.length - 1 - k]);
+      }
+    }
+
+    // 합집합은 추가할 때 같이 갱신됨
+    final any = store.alertIndex(HistoryStore.ALERT_ANY).cardinality;
+    store.add(t0 + 30000 * 5000000, 130, 97);
+    expect(store.alertIndex(HistoryStore.ALERT_ANY).cardinality, any + 1);
+    expect(store.view(0, store.length, HistoryStore.ALERT_ANY).storeIndex(0), store.length - 1);
+  });
+
+  test('alarms and the stored categories use the same rounded values', () {
+    final store = HistoryStore();
+    final values = [
+      (120.4, 97.0), (120.6, 97.0), // 빈맥 경계
+      (49.6, 97.0), (49.4, 97.0), // 서맥 경계
+      (70.0, 89.96), (70.0, 89.94), // 저산소 경계
+    ];
+    for (int i = 0; i < values.length; i++) {
+      final (bpm, spo2) = values[i];
+      store.add(i, bpm, spo2);
+      expect(store.alertsAt(i), HistoryStore.alertsOfValues(bpm, spo2));
+    }
+    expect([for (int i = 0; i < values.length; i++) store.alertsAt(i)], [
+      0,
+      HistoryStore.ALERT_TACHYCARDIA,
+      0,
+      HistoryStore.ALERT_BRADYCARDIA,
+      0,
+      HistoryStore.ALERT_HYPOXIA,
+    ]);
+  });
+}
@@ -0,0 +1,41 @@
+import 'dart:math' as math;
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:health_app/services/autocorr_hr.dart';
+
+// 시뮬레이터(linux/firmware_sim)의 합성 PPG 와 같은 모양: 수축기 피크 + 중복맥 + 기저선 변동
+List<int> syntheticPpg(double bpm, double seconds, double rate, math.Random rnd) {
+  final out = <int>[];
+  for (int i = 0; i < seconds * rate; i++) {
+    final t = i / rate;
+    final phase = (t * bpm / 60) % 1.0;
+    final pulse = math.exp(-math.pow((phase - 0.15) / 0.07, 2)) +
+        0.15 * math.exp(-math.pow((phase - 0.45) / 0.08, 2));
+    final wander = math.sin(2 * math.pi * 0.2 * t);
+    out.add((100000 - 900 * pulse + 300 * wander + 20 * (rnd.nextDouble() - 0.5)).round());
+  }
+  return out;
+}
+
+void main() {
+  for (final bpm in [45.0, 72.0, 130.0]) {
+    test('tracks a ${bpm.round()} BPM pulse train at 25 Hz', () {
+      final estimator = AutocorrHeartRate(25);
+      final samples = syntheticPpg(bpm, 20, 25, math.Random(1));
+      for (int i = 0; i < samples.length; i += 10) {
+        estimator.addSamples(samples.sublist(i, i + 10));
+      }
+      expect(estimator.bpm, isNotNull);
+      expect(estimator.bpm!, closeTo(bpm, 2));
+      expect(estimator.confidence, greaterThan(0.5));
+    });
+  }
+
+  test('gives no estimate on noise', () {
+    final rnd = math.Random(2);
+    final estimator = AutocorrHeartRate(25);
+    estimator.addSamples(List.generate(500, (_) => 100000 + rnd.nextInt(2000)));
+    expect(estimator.bpm, isNull);
+  });
+}
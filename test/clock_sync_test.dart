@@ -0,0 +1,31 @@
+import 'dart:math' as math;
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:health_app/services/clock_sync.dart';
+
+void main() {
+  test('estimates oscillator drift under jittery latency', () {
+    final clock = ClockSync();
+    final rnd = math.Random(3);
+    const start = 1700000000000000;
+    const truePeriod = 40000 * (1 + 100e-6); // 25Hz 공칭, +100ppm 빠른 발진기
+
+    // 5분 동안 매 샘플 0~50ms 의 임의 지연으로 수신
+    for (int t = 0; t < 25 * 300; t++) {
+      final sent = start + truePeriod * t;
+      clock.observe(t, (sent + rnd.nextDouble() * 50000).round(), 40000);
+    }
+
+    expect(clock.driftPpm, closeTo(100, 10));
+    final expected = start + truePeriod * 7499;
+    expect(clock.toHostMicros(7499), closeTo(expected, 2000));
+  });
+
+  test('restarts when the device counter goes backwards', () {
+    final clock = ClockSync();
+    clock.observe(1000, 5000000, 40000);
+    clock.observe(0, 9000000, 40000);
+    expect(clock.toHostMicros(0), 9000000);
+  });
+}
@@ -0,0 +1,162 @@
+import 'dart:convert';
+import 'dart:io';
+import 'dart:math' as math;
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:health_app/models/history_store.dart';
+import 'package:health_app/services/history_codec.dart';
+import 'package:health_app/services/history_file.dart';
+
+// 5초 주기 저장 + 지터, 가끔 긴 공백/HRV/긴급 기록
+HistoryStore _sample(int count, {int seed = 1}) {
+  final rng = math.Random(seed);
+  final store = HistoryStore();
+  int t = DateTime(2026, 3, 1).microsecondsSinceEpoch;
+  double bpm = 72, spo2 = 97.5;
+  int sdnn = 50, rmssd = 40, irregularity = 5;
+  for (int i = 0; i < count; i++) {
+    t += 5000000 + rng.nextInt(2000) - 1000 + (rng.nextInt(500) == 0 ? 3600000000 : 0);
+    bpm = (bpm + rng.nextInt(5) - 2).clamp(40, 180);
+    spo2 = (spo2 + (rng.nextInt(5) - 2) / 10).clamp(85, 100);
+    sdnn = math.max(10, sdnn + rng.nextInt(5) - 2);
+    rmssd = math.max(10, rmssd + rng.nextInt(5) - 2);
+    irregularity = (irregularity + rng.nextInt(3) - 1).clamp(0, 100);
+    final hrv = i % 100 >= 12; // 끊긴 뒤 창이 찰 때까지는 HRV 없음
+    store.add(t, bpm, spo2,
+        flags: rng.nextInt(50) == 0 ? HistoryStore.FLAG_EMERGENCY : 0,
+        sdnn: hrv ? sdnn : null,
+        rmssd: hrv ? rmssd : null,
+        irregularity: hrv ? irregularity : null);
+  }
+  return store;
+}
+
+// test/fixtures/history_v1.vlog 의 기록 (ingestd 의 ingestd_app_history_fixture 도 같은 파일을 읽음)
+// HRV/긴급/백필 기록, 2일 공백(64비트 시각 버킷), 30분 공백, 0 과 250 같은 큰 값 점프
+HistoryStore _fixture() {
+  final store = HistoryStore();
+  int t = 1772323200000000;
+  for (int i = 0; i < 300; i++) {
+    t += 5000000 + (i * 7919) % 2001 - 1000;
+    if (i == 100) t += 2 * 86400 * 1000000;
+    if (i == 200) t += 1800 * 1000000;
+    if (i == 260) t += 1000000;
+    final hrv = i % 50 >= 8;
+    store.add(t, (i == 150 ? 0 : i == 151 ? 250 : 60 + (i * 13) % 41).toDouble(),
+        (i == 150 ? 0 : 900 + (i * 17) % 101) / HistoryStore.SPO2_SCALE,
+        flags: (i % 37 == 5 ? HistoryStore.FLAG_EMERGENCY : 0) |
+            (i >= 120 && i < 130 ? HistoryStore.FLAG_BACKFILL : 0),
+        sdnn: hrv ? (i == 180 ? 2000 : 20 + (i * 3) % 60) : null,
+        rmssd: hrv ? 15 + (i * 5) % 70 : null,
+        irregularity: hrv ? i % 23 : null);
+  }
+  return store;
+}
+
+void _expectSame(HistoryStore a, HistoryStore b) {
+  expect(b.length, a.length);
+  expect(b.timeColumn, a.timeColumn);
+  expect(b.bpmColumn, a.bpmColumn);
+  expect(b.spo2Column, a.spo2Column);
+  expect(b.flagsColumn, a.flagsColumn);
+  for (int i = 0; i < a.length; i++) {
+    if ((a.flagsColumn[i] & HistoryStore.FLAG_HRV) == 0) continue;
+    expect(b.sdnnColumn[i], a.sdnnColumn[i]);
+    expect(b.rmssdColumn[i], a.rmssdColumn[i]);
+    expect(b.irregularityColumn[i], a.irregularityColumn[i]);
+  }
+}
+
+void main() {
+  late Directory tmp;
+  setUp(() async => tmp = await Directory.systemTemp.createTemp('history_codec'));
+  tearDown(() => tmp.delete(recursive: true));
+
+  test('incremental saves, backfill inserts and a torn tail reload exactly', () async {
+    final path = File('${tmp.path}/${HistoryFile.FILE_NAME}');
+    final source = _sample(1000);
+    final store = HistoryStore();
+    final file = HistoryFile(file: path);
+    for (int i = 0; i < source.length; i++) {
+      final log = source.at(i);
+      store.addLog(log);
+      if (i % 37 == 0) await file.save(store);
+    }
+    // 과거 블록에 백필이 끼어듦 -> 그 블록부터 다시 씀
+    store.add(source.timeUsAt(10) + 1, 60, 95, flags: HistoryStore.FLAG_BACKFILL);
+    await file.save(store);
+    _expectSame(store, HistoryCodec.decode(await path.readAsBytes()));
+
+    final reloaded = HistoryStore();
+    await HistoryFile(file: path).load(reloaded);
+    _expectSame(store, reloaded);
+
+    // 마지막 블록을 쓰다 끊긴 파일: 앞 블록만 읽히고, 다음 저장이 끝을 다시 씀
+    final bytes = await path.readAsBytes();
+    await path.writeAsBytes(bytes.sublist(0, bytes.length - 3));
+    final torn = HistoryStore();
+    final tornFile = HistoryFile(file: path);
+    await tornFile.load(torn);
+    expect(torn.length, HistoryCodec.BLOCK_RECORDS * (store.length ~/ HistoryCodec.BLOCK_RECORDS));
+    for (int i = torn.length; i < store.length; i++) {
+      torn.addLog(store.at(i));
+    }
+    await tornFile.save(torn);
+    _expectSame(store, HistoryCodec.decode(await path.readAsBytes()));
+  });
+
+  test('range scans skip blocks by their header', () {
+    final store = _sample(2000, seed: 2);
+    final bytes = HistoryCodec.fileHeader().toList();
+    for (int s = 0; s < store.length; s += HistoryCodec.BLOCK_RECORDS) {
+      bytes.addAll(HistoryCodec.encodeBlock(
+          store, s, math.min(s + HistoryCodec.BLOCK_RECORDS, store.length)));
+    }
+    final data = Uint8List.fromList(bytes);
+    final from = store.timeUsAt(700), to = store.timeUsAt(900);
+
+    int decoded = 0;
+    final hit = HistoryCodec.decode(data, fromUs: from, toUs: to, where: (_) {
+      decoded++;
+      return true;
+    });
+    expect(decoded, 2); // 블록 2, 3 만 (512..1023)
+    expect(hit.lowerBound(from), greaterThan(0));
+    expect(hit.timeColumn.first, store.timeUsAt(512));
+
+    final emergencies = HistoryCodec.decode(data,
+        where: (b) => (b.flagsAny & HistoryStore.FLAG_EMERGENCY) != 0);
+    expect(emergencies.flagsColumn.where((f) => (f & HistoryStore.FLAG_EMERGENCY) != 0).length,
+        store.flagsColumn.where((f) => (f & HistoryStore.FLAG_EMERGENCY) != 0).length);
+  });
+
+  test('a file written by ingestd decodes and re-encodes byte for byte', () async {
+    final fixture = await File('test/fixtures/history_v1.vlog').readAsBytes();
+    final expected = _fixture();
+    _expectSame(expected, HistoryCodec.decode(fixture));
+
+    final bytes = HistoryCodec.fileHeader().toList();
+    for (int s = 0; s < expected.length; s += HistoryCodec.BLOCK_RECORDS) {
+      bytes.addAll(HistoryCodec.encodeBlock(
+          expected, s, math.min(s + HistoryCodec.BLOCK_RECORDS, expected.length)));
+    }
+    expect(bytes, fixture);
+
+    // HistoryFile 로 처음부터 저장해도 같은 파일
+    final path = File('${tmp.path}/${HistoryFile.FILE_NAME}');
+    await HistoryFile(file: path).save(expected);
+    expect(await path.readAsBytes(), fixture);
+  });
+
+  test('encoded log is an order of magnitude smaller than the JSON list', () async {
+    final store = _sample(5000, seed: 3);
+    final file = HistoryFile(file: File('${tmp.path}/size.vlog'));
+    await file.save(store);
+    final vlog = await (await file.file).length();
+    final json = [for (int i = 0; i < store.length; i++) jsonEncode(store[i].toJson())]
+        .fold<int>(0, (n, s) => n + utf8.encode(s).length);
+    expect(vlog * 10, lessThan(json));
+  });
+}
@@ -0,0 +1,44 @@
+import 'dart:io';
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:health_app/models/history_store.dart';
+import 'package:health_app/services/history_export.dart';
+
+HistoryStore sampleStore(int count) {
+  final store = HistoryStore();
+  for (int i = 0; i < count; i++) {
+    store.add(1700000000000000 + i * 5000000, 60 + i % 40, 95 + (i % 5) / 10,
+        flags: i % 7 == 0 ? HistoryStore.FLAG_BACKFILL : 0);
+  }
+  return store;
+}
+
+void main() {
+  test('binary export round-trips across several chunks', () async {
+    final store = sampleStore(HistoryExporter.CHUNK * 2 + 100);
+    final dir = await Directory.systemTemp.createTemp('hlog');
+    final file = File('${dir.path}/out.hlog');
+
+    final count = await HistoryExporter.export(store, file, format: ExportFormat.binary);
+    final back = HistoryChunkEncoder.decodeBinary(await file.readAsBytes());
+
+    expect(count, store.length);
+    expect(back.timeColumn, store.timeColumn);
+    expect(back.bpmColumn, store.bpmColumn);
+    expect(back.spo2Column, store.spo2Column);
+    expect(back.flagsColumn, store.flagsColumn);
+    await dir.delete(recursive: true);
+  });
+
+  test('csv encoder drops records closer than the minimum interval', () {
+    final store = sampleStore(12);
+    final encoder = HistoryChunkEncoder(ExportFormat.csv, 15000000);
+    final (bytes, records) = encoder.encode(store.timeColumn, store.bpmColumn,
+        store.spo2Column, store.flagsColumn);
+    final lines = String.fromCharCodes(bytes).trim().split('\n');
+
+    expect(records, 4); // 5초 간격 12개 -> 15초마다 1개
+    expect(lines.first.split(',').sublist(1), ['1700000000000000', '60', '95.0', '1']);
+  });
+}
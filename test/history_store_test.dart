@@ -0,0 +1,46 @@
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:health_app/models/health_log.dart';
+import 'package:health_app/models/history_store.dart';
+
+void main() {
+  test('keeps records sorted and serves them newest-first', () {
+    final store = HistoryStore();
+    store.add(3000, 70, 98.5);
+    store.add(1000, 65, 97);
+    store.add(2000, 68, 96.2, flags: HistoryStore.FLAG_BACKFILL);
+
+    expect(store.length, 3);
+    expect(store.timeColumn, [1000, 2000, 3000]);
+    expect(store[0].timeUs, 3000);
+    expect(store[0].spo2, 98.5);
+    expect(store[1].flags, HistoryStore.FLAG_BACKFILL);
+    expect(store[2].bpm, 65);
+  });
+
+  test('skips duplicate timestamps and grows past the initial capacity', () {
+    final store = HistoryStore();
+    for (int i = 0; i < 5000; i++) {
+      store.add(i * 5000000, 72, 98);
+    }
+    expect(store.add(2500 * 5000000, 80, 99), isFalse);
+    expect(store.length, 5000);
+    expect(store.lowerBound(2500 * 5000000 + 1), 2501);
+  });
+
+  test('legacy rows without a date keep distinct times when given one each', () {
+    final store = HistoryStore();
+    final rows = [
+      {'time': '10:00:05', 'bpm': 72, 'spo2': 98},
+      {'time': '10:00:00', 'bpm': 70, 'spo2': 97},
+      {'time': '2024-05-01 09:00:00', 'bpm': 68, 'spo2': 96},
+    ];
+    for (int k = 0; k < rows.length; k++) {
+      final log = HealthLog.fromJson(rows[k], fallbackTimeUs: 1000 + k);
+      expect(store.addLog(log), isTrue);
+    }
+    expect(store.length, 3);
+    expect(store.timeColumn.take(2), [1000, 1001]);
+    expect(store.at(2).time, DateTime(2024, 5, 1, 9));
+  });
+}
@@ -0,0 +1,119 @@
+import 'dart:io';
+import 'dart:math' as math;
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:health_app/models/history_store.dart';
+import 'package:health_app/services/history_tile_file.dart';
+import 'package:health_app/services/history_tiles.dart';
+
+// 5초 주기 저장, 가끔 몇 시간 공백 (약 3일)
+HistoryStore _sample(int count, {int seed = 1}) {
+  final rng = math.Random(seed);
+  final store = HistoryStore();
+  int t = DateTime(2026, 3, 1).microsecondsSinceEpoch;
+  for (int i = 0; i < count; i++) {
+    t += 5000000 + (rng.nextInt(2000) == 0 ? 3 * 3600000000 : 0);
+    store.add(t, 50 + rng.nextInt(90).toDouble(), 88 + rng.nextInt(120) / 10);
+  }
+  return store;
+}
+
+void _expectSameTiles(HistoryTiles a, HistoryTiles b) {
+  expect(b.recordCount, a.recordCount);
+  expect(b.lastTimeUs, a.lastTimeUs);
+  final byKey = {for (final t in b.tiles) '${t.level}/${t.key}': t};
+  expect(byKey.length, a.tiles.length);
+  for (final t in a.tiles) {
+    final other = byKey['${t.level}/${t.key}']!;
+    expect(other.encode(), t.encode());
+  }
+}
+
+void main() {
+  late Directory tmp;
+  setUp(() async => tmp = await Directory.systemTemp.createTemp('history_tiles'));
+  tearDown(() => tmp.delete(recursive: true));
+
+  test('buckets match a brute-force pass at every level', () {
+    final store = _sample(50000);
+    final tiles = HistoryTiles()..rebuild(store);
+    final from = store.timeUsAt(1000), to = store.timeUsAt(40000);
+    for (int level = 0; level < HistoryTiles.LEVELS; level++) {
+      final width = HistoryTiles.bucketUs(level);
+      final series = tiles.query(level, from, to);
+      int checked = 0;
+      for (int i = 0; i < series.length; i += math.max(1, series.length ~/ 50)) {
+        final start = series.startUs[i];
+        final lo = store.lowerBound(start), hi = store.lowerBound(start + width);
+        final bpm = store.bpmColumn.sublist(lo, hi);
+        final spo2 = store.spo2Column.sublist(lo, hi);
+        expect(series.bpmMin[i], bpm.reduce(math.min).toDouble());
+        expect(series.bpmMax[i], bpm.reduce(math.max).toDouble());
+        expect(series.bpmAvg[i], closeTo(bpm.reduce((a, b) => a + b) / bpm.length, 1e-9));
+        expect(series.spo2Max[i], spo2.reduce(math.max) / HistoryStore.SPO2_SCALE);
+        checked++;
+      }
+      expect(checked, greaterThan(0));
+      // 보이는 칸 수는 구간 / 칸 폭 이하 (+ 양 끝)
+      expect(series.length, lessThanOrEqualTo((to - from) ~/ width + 2));
+    }
+  });
+
+  test('level choice keeps at most a few buckets per pixel, raw below a minute', () {
+    const day = Duration.microsecondsPerDay;
+    expect(HistoryTiles.levelFor(0, 30 * day, 800), 2); // 한 달: 54분/픽셀 -> 16분 칸
+    expect(HistoryTiles.levelFor(0, day, 800), 0);      // 하루: 108초/픽셀 -> 1분 칸
+    expect(HistoryTiles.levelFor(0, 3600000000, 800), -1);
+    for (final span in [60000000, 3600000000, day, 30 * day, 365 * day]) {
+      final level = HistoryTiles.levelFor(0, span, 800);
+      if (level >= 0 && level < HistoryTiles.LEVELS - 1) {
+        expect(span / HistoryTiles.bucketUs(level), lessThanOrEqualTo(800 * 4));
+      }
+    }
+  });
+
+  test('incremental adds and backfill match a rebuild; cache reloads and catches up', () async {
+    final source = _sample(20000, seed: 2);
+    final store = HistoryStore();
+    final tiles = HistoryTiles();
+    final path = File('${tmp.path}/${HistoryTileFile.FILE_NAME}');
+    final file = HistoryTileFile(file: path);
+    for (int i = 0; i < 15000; i++) {
+      store.addLog(source.at(i));
+      tiles.addFromStore(store, i, i + 1);
+      if (i % 997 == 0) await file.save(tiles, force: true);
+    }
+    // 백필: 과거에 끼워 넣어도 해당 칸만 바뀜
+    final backfill = source.timeUsAt(100) + 1;
+    store.add(backfill, 61, 95);
+    tiles.addFromStore(store, store.lowerBound(backfill), store.lowerBound(backfill) + 1);
+    _expectSameTiles(HistoryTiles()..rebuild(store), tiles);
+    await file.save(tiles, force: true);
+
+    // 캐시를 그대로 쓰고, 저장 뒤에 붙은 기록만 더함
+    for (int i = 15000; i < source.length; i++) {
+      store.addLog(source.at(i));
+    }
+    final reloaded = HistoryTiles();
+    expect(await HistoryTileFile(file: path).load(reloaded, store), isTrue);
+    _expectSameTiles(HistoryTiles()..rebuild(store), reloaded);
+
+    // 저장 뒤 과거에 끼워 넣은 기록이 있으면 캐시를 버리고 다시 만듦
+    store.add(source.timeUsAt(5) + 1, 70, 96);
+    final rebuilt = HistoryTiles();
+    final rebuiltFile = HistoryTileFile(file: path);
+    expect(await rebuiltFile.load(rebuilt, store), isFalse);
+    _expectSameTiles(HistoryTiles()..rebuild(store), rebuilt);
+    await rebuiltFile.save(rebuilt, force: true);
+    final again = HistoryTiles();
+    expect(await HistoryTileFile(file: path).load(again, store), isTrue);
+    _expectSameTiles(rebuilt, again);
+
+    // 쓰다 끊긴 캐시(헤더가 무효 표시)도 믿지 않음
+    final bytes = await path.readAsBytes();
+    bytes.fillRange(16, 24, 0xFF);
+    await path.writeAsBytes(bytes);
+    expect(await HistoryTileFile(file: path).load(HistoryTiles(), store), isFalse);
+  });
+}
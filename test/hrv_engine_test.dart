@@ -0,0 +1,86 @@
+import 'dart:math' as math;
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:health_app/services/hrv_engine.dart';
+import 'package:health_app/services/rr_batch.dart';
+
+void main() {
+  test('alternating intervals give the textbook SDNN, RMSSD and irregularity', () {
+    final engine = HrvEngine();
+    for (int i = 0; i < 40; i++) {
+      engine.add(i.isEven ? 750 : 1000);
+    }
+    final h = engine.summary!;
+
+    expect(h.beats, 40);
+    expect(h.meanNn, 875);
+    expect(h.rmssd, 250);
+    expect(h.sdnn, closeTo(125 * math.sqrt(40 / 39), 1e-9));
+    expect(h.irregularity, 1); // 매번 20% 넘게 바뀜
+    expect(h.isIrregular, isTrue);
+  });
+
+  test('running sums match a full recompute as beats leave the window', () {
+    final rng = math.Random(7);
+    final engine = HrvEngine();
+    final rr = <int>[];
+    final contiguous = <bool>[];
+
+    for (int n = 0; n < 3000; n++) {
+      final v = 500 + rng.nextInt(700);
+      final c = rng.nextInt(10) != 0;
+      rr.add(v);
+      contiguous.add(c);
+      engine.add(v, contiguous: c);
+      if (n % 97 != 0) continue;
+
+      // 창: 합이 WINDOW_MS 를 넘지 않는 가장 긴 꼬리
+      int start = rr.length - 1, sum = rr.last;
+      while (start > 0 && sum + rr[start - 1] <= HrvEngine.WINDOW_MS) {
+        sum += rr[--start];
+      }
+      final window = rr.sublist(start);
+      final mean = sum / window.length;
+      double sq = 0;
+      for (final x in window) {
+        sq += (x - mean) * (x - mean);
+      }
+      int pairs = 0, irregular = 0;
+      double diffSq = 0;
+      for (int i = start + 1; i < rr.length; i++) {
+        if (!contiguous[i]) continue;
+        final d = rr[i] - rr[i - 1];
+        pairs++;
+        diffSq += d * d;
+        if (d.abs() * 100 > rr[i - 1] * HrvEngine.IRREGULAR_PERCENT) irregular++;
+      }
+
+      expect(engine.beats, window.length);
+      expect(engine.pairs, pairs);
+      final h = engine.summary;
+      if (pairs < HrvEngine.MIN_PAIRS) {
+        expect(h, isNull);
+        continue;
+      }
+      expect(h!.meanNn, closeTo(mean, 1e-9));
+      expect(h.sdnn, closeTo(math.sqrt(sq / (window.length - 1)), 1e-6));
+      expect(h.rmssd, closeTo(math.sqrt(diffSq / pairs), 1e-9));
+      expect(h.irregularity, irregular / pairs);
+    }
+    expect(engine.beats, lessThan(HrvEngine.WINDOW_MS ~/ 500 + 1));
+  });
+
+  test('RR frame round-trips intervals and break marks', () {
+    final batch = RrBatch(0xFFFE, Uint16List.fromList([833, 1500, 240]),
+        Uint8List.fromList([0, 1, 1]));
+    final payload = batch.encode();
+    final decoded = RrBatch.decode(payload);
+
+    expect(payload.sublist(0, 5), [0xFE, 0xFF, 3, 833 & 0xFF, (833 >> 8) | 0x80]);
+    expect(decoded.seq, 0xFFFE);
+    expect(decoded.intervals, [833, 1500, 240]);
+    expect(decoded.contiguous, [0, 1, 1]);
+  });
+}
@@ -0,0 +1,20 @@
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:health_app/models/latency_histogram.dart';
+
+void main() {
+  test('buckets latencies and reports conservative percentiles', () {
+    final h = LatencyHistogram();
+    for (final ms in [10, 30, 40, 90, 120, 180, 260, 700, 5000]) {
+      h.add(Duration(milliseconds: ms));
+    }
+    expect(h.count, 9);
+    expect(h.counts[0], 1); // <25
+    expect(h.counts[1], 2); // <50
+    expect(h.counts[8], 1); // >=3200
+    expect(h.maxMs, 5000);
+    expect(h.percentileMs(0.5), 200);
+    expect(h.percentileMs(1.0), 5000);
+    expect(h.countAbove(400), 2);
+  });
+}
@@ -0,0 +1,32 @@
+import 'dart:math' as math;
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:health_app/services/reconnect_policy.dart';
+
+void main() {
+  test('backs off exponentially with jitter up to the cap', () {
+    final policy = ReconnectPolicy(random: math.Random(7));
+    for (int i = 0; i < 10; i++) {
+      final d = policy.nextDelay();
+      final ceiling = math.min(500 * (1 << i), 30000);
+      expect(d.inMilliseconds, inInclusiveRange(ceiling ~/ 2, ceiling));
+      expect(policy.shouldRescan, i >= ReconnectPolicy.RESCAN_AFTER_FAILURES);
+      policy.onAttemptFailed();
+    }
+  });
+
+  test('records time to reconnect and the data gap', () {
+    final policy = ReconnectPolicy();
+    final t0 = DateTime(2026, 1, 1, 12);
+    policy.onDisconnected(t0, t0.subtract(const Duration(milliseconds: 400)));
+    policy.onAttemptFailed();
+    policy.onConnected(t0.add(const Duration(seconds: 2)));
+    policy.onData(t0.add(const Duration(milliseconds: 2300)));
+
+    expect(policy.failures, 0);
+    expect(policy.reconnects, 1);
+    expect(policy.lastReconnectTime, const Duration(seconds: 2));
+    expect(policy.lastDataGap, const Duration(milliseconds: 2700));
+  });
+}
@@ -0,0 +1,137 @@
+import 'dart:io';
+import 'dart:math' as math;
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:health_app/models/history_store.dart';
+import 'package:health_app/models/session_index.dart';
+import 'package:health_app/services/session_file.dart';
+
+const int _s = 1000000;
+final int _t0 = DateTime(2026, 3, 1).microsecondsSinceEpoch;
+
+void main() {
+  late Directory tmp;
+  setUp(() async => tmp = await Directory.systemTemp.createTemp('session_index'));
+  tearDown(() => tmp.delete(recursive: true));
+
+  test('streaming summaries match a brute-force pass', () {
+    final rng = math.Random(3);
+    final index = SessionIndex();
+    final values = <List<(int, int)>>[];
+    int t = _t0;
+    for (int id = 1; id <= 20; id++) {
+      index.start(id, t);
+      final mine = <(int, int)>[];
+      for (int i = 0; i < 30 + rng.nextInt(300); i++) {
+        t += _s;
+        final bpm = 45 + rng.nextInt(90);
+        final spo2 = 88 + rng.nextInt(120) / 10;
+        expect(index.addVitals(t, bpm.toDouble(), spo2), isTrue);
+        mine.add((bpm, (spo2 * HistoryStore.SPO2_SCALE).round()));
+      }
+      index.end(id, t + _s);
+      values.add(mine);
+      t += 60 * _s;
+      // 세션 사이의 값은 어느 세션에도 들어가지 않음
+      expect(index.addVitals(t - 30 * _s, 70, 97), isFalse);
+    }
+    expect(index.length, 20);
+    for (int i = 0; i < index.length; i++) {
+      final s = index.at(i);
+      final bpm = values[i].map((v) => v.$1);
+      final spo2 = values[i].map((v) => v.$2);
+      expect(s.open, isFalse);
+      expect(s.count, values[i].length);
+      expect(s.bpmMin, bpm.reduce(math.min));
+      expect(s.bpmMax, bpm.reduce(math.max));
+      expect(s.bpmSum, bpm.reduce((a, b) => a + b));
+      expect(s.spo2Min, spo2.reduce(math.min));
+      expect(s.spo2Max, spo2.reduce(math.max));
+      expect(s.spo2Sum, spo2.reduce((a, b) => a + b));
+    }
+  });
+
+  test('a re-announced session continues and a missed end is closed by the next start', () {
+    final index = SessionIndex();
+    index.start(1, _t0);
+    index.addVitals(_t0 + 5 * _s, 70, 97);
+    // 재연결 후 #GET 응답: 같은 번호, 시계 보정으로 조금 다른 시작 시각
+    final again = index.start(1, _t0 + 2 * _s);
+    expect(index.length, 1);
+    expect(again.count, 1);
+    index.addVitals(_t0 + 6 * _s, 72, 98);
+    expect(index.current!.count, 2);
+
+    // 끊긴 동안 $E,1 과 $S,2 중 $E 만 놓침
+    index.start(2, _t0 + 60 * _s);
+    expect(index.length, 2);
+    expect(index.at(0).open, isFalse);
+    expect(index.at(0).endUs, _t0 + 6 * _s);
+    expect(index.current!.deviceId, 2);
+
+    // 이미 닫힌 세션의 $E 는 무시
+    index.end(1, _t0 + 100 * _s);
+    expect(index.at(0).endUs, _t0 + 6 * _s);
+    expect(index.current!.deviceId, 2);
+  });
+
+  test('between and sessionAt find sessions by time', () {
+    final index = SessionIndex();
+    for (int i = 0; i < 100; i++) {
+      index.start(i + 1, _t0 + i * 100 * _s);
+      index.end(i + 1, _t0 + (i * 100 + 50) * _s);
+    }
+    expect(index.sessionAt(_t0 + 1025 * _s)!.deviceId, 11);
+    expect(index.sessionAt(_t0 + 1075 * _s), isNull);
+    expect(index.sessionAt(_t0 + 1050 * _s)!.deviceId, 11);
+    final hits = index.between(_t0 + 1040 * _s, _t0 + 1300 * _s).map((s) => s.deviceId).toList();
+    expect(hits, [11, 12, 13]);
+    expect(index.between(_t0 - 10 * _s, _t0).isEmpty, isTrue);
+    // 기간 필터: 최신부터 [0, n) 이 기간에 걸친 세션
+    expect(index.countEndingAfter(_t0 + 1040 * _s), 90);
+    expect(index[89].deviceId, 11);
+    expect(index.countEndingAfter(_t0 + 10000 * _s), 0);
+
+    final store = HistoryStore();
+    for (int t = 0; t < 10000; t += 5) {
+      store.add(_t0 + t * _s, 70, 97);
+    }
+    final (start, end) = SessionIndex.recordRange(store, index.at(10));
+    expect(store.at(start).time.microsecondsSinceEpoch, _t0 + 1000 * _s);
+    expect(store.at(end - 1).time.microsecondsSinceEpoch, _t0 + 1050 * _s);
+  });
+
+  test('file round-trips and rewrites only the open session', () async {
+    final path = File('${tmp.path}/health_log.sessions');
+    final index = SessionIndex();
+    final file = SessionFile(file: path);
+    for (int id = 1; id <= 5; id++) {
+      index.start(id, _t0 + id * 1000 * _s);
+      index.addVitals(_t0 + (id * 1000 + 1) * _s, 60.0 + id, 95.5);
+      index.alert();
+      if (id < 5) index.end(id, _t0 + (id * 1000 + 2) * _s);
+    }
+    await file.save(index);
+    expect(await path.length(), SessionFile.HEADER_SIZE + 5 * SessionFile.ENTRY_SIZE);
+
+    index.addVitals(_t0 + 5003 * _s, 80, 99);
+    expect(index.dirtyFrom, 4);
+    await file.save(index);
+    expect(await path.length(), SessionFile.HEADER_SIZE + 5 * SessionFile.ENTRY_SIZE);
+
+    final loaded = SessionIndex();
+    expect(await SessionFile(file: path).load(loaded), isTrue);
+    expect(loaded.length, 5);
+    expect(loaded.isDirty, isFalse);
+    for (int i = 0; i < 5; i++) {
+      final a = index.at(i), b = loaded.at(i);
+      expect([b.deviceId, b.startUs, b.endUs, b.open, b.count, b.alerts],
+          [a.deviceId, a.startUs, a.endUs, a.open, a.count, a.alerts]);
+      expect([b.bpmMin, b.bpmMax, b.bpmSum, b.spo2Min, b.spo2Max, b.spo2Sum],
+          [a.bpmMin, a.bpmMax, a.bpmSum, a.spo2Min, a.spo2Max, a.spo2Sum]);
+    }
+    expect(loaded.current!.count, 2);
+    expect(loaded.current!.spo2Max, 990);
+  });
+}
@@ -0,0 +1,60 @@
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:health_app/services/telemetry_decoder.dart';
+import 'package:health_app/services/waveform_block.dart';
+
+Uint8List frame(int type, Uint8List payload) {
+  int crc = TelemetryDecoder.crc8(0, type);
+  for (final b in payload) {
+    crc = TelemetryDecoder.crc8(crc, b);
+  }
+  return Uint8List.fromList([
+    TelemetryDecoder.FRAME_SYNC, payload.length + 1, type, ...payload, crc,
+  ]);
+}
+
+void main() {
+  test('waveform block round-trips through delta/zigzag varints', () {
+    final samples = Int32List.fromList([-61, -40, 0, 63, -64, 1500, -2000, 180000]);
+    final block = WaveformBlock(7, 'D', samples);
+    final decoded = WaveformBlock.decode(block.encode());
+
+    expect(decoded.seq, 7);
+    expect(decoded.stream, 'D');
+    expect(decoded.samples, samples);
+  });
+
+  test('decoder splits ASCII lines and binary frames, rejects bad CRC', () {
+    final lines = <String>[];
+    final blocks = <WaveformBlock>[];
+    final decoder = TelemetryDecoder(
+      onLine: lines.add,
+      onFrame: (type, payload) => blocks.add(WaveformBlock.decode(payload)),
+    );
+
+    final good = frame(WaveformBlock.FRAME_TYPE,
+        WaveformBlock(1, 'D', Int32List.fromList([10, 10, 13, 10])).encode());
+    final bad = Uint8List.fromList(good)..[good.length - 1] ^= 0xFF;
+
+    decoder.add(Uint8List.fromList('2025-01-01 12:00:00,5,98,'.codeUnits));
+    decoder.add(good.sublist(0, 3)); // 프레임이 패킷 경계에 걸쳐도 처리
+    decoder.add(good.sublist(3));
+    decoder.add(Uint8List.fromList('72\r\n'.codeUnits));
+    decoder.add(bad);
+
+    expect(lines, ['2025-01-01 12:00:00,5,98,72']);
+    expect(blocks.single.samples, [10, 10, 13, 10]);
+    expect(decoder.badFrames, 1);
+
+    // LEN 이 깨져 다음 프레임의 SYNC 까지 삼킨 프레임: 다시 훑어 뒤의 프레임과 줄은 살림
+    decoder.add(Uint8List.fromList(good)..[1] += 1);
+    decoder.add(good);
+    decoder.add(Uint8List.fromList('2025-01-01 12:00:01,6,97,71\r\n'.codeUnits));
+
+    expect(decoder.badFrames, 2);
+    expect(blocks.length, 2);
+    expect(lines, ['2025-01-01 12:00:00,5,98,72', '2025-01-01 12:00:01,6,97,71']);
+  });
+}